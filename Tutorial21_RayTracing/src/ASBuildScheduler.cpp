@@ -0,0 +1,211 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "ASBuildScheduler.hpp"
+
+#include <algorithm>
+
+#include "Errors.hpp"
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+ASBuildScheduler::ASBuildScheduler(Uint32 NumSlots) :
+    m_Slots(NumSlots)
+{
+    VERIFY(NumSlots >= 2, "At least two slots are required to overlap builds with tracing");
+}
+
+ASBuildScheduler::BuildTicket ASBuildScheduler::BeginBuild()
+{
+    BuildTicket Ticket;
+    for (Uint32 s = 0; s < GetNumSlots(); ++s)
+    {
+        if (s == m_TracedSlot)
+            continue;
+
+        if (Ticket.Slot == InvalidSlot || m_Slots[s].TraceFenceValue < m_Slots[Ticket.Slot].TraceFenceValue)
+            Ticket.Slot = s;
+    }
+    VERIFY_EXPR(Ticket.Slot != InvalidSlot);
+
+    auto& Slot = m_Slots[Ticket.Slot];
+
+    Ticket.WaitTraceFenceValue   = Slot.TraceFenceValue;
+    Ticket.SignalBuildFenceValue = m_NextBuildFenceValue++;
+
+    Slot.BuildFenceValue = Ticket.SignalBuildFenceValue;
+    m_LastBuiltSlot      = Ticket.Slot;
+
+    return Ticket;
+}
+
+ASBuildScheduler::TraceTicket ASBuildScheduler::BeginTrace()
+{
+    TraceTicket Ticket;
+    if (m_LastBuiltSlot == InvalidSlot)
+        return Ticket;
+
+    auto& Slot = m_Slots[m_LastBuiltSlot];
+
+    Ticket.Slot                  = m_LastBuiltSlot;
+    Ticket.WaitBuildFenceValue   = Slot.BuildFenceValue;
+    Ticket.SignalTraceFenceValue = m_NextTraceFenceValue++;
+
+    Slot.TraceFenceValue = Ticket.SignalTraceFenceValue;
+    m_TracedSlot         = Ticket.Slot;
+
+    return Ticket;
+}
+
+void ASBuildScheduler::Reset()
+{
+    for (auto& Slot : m_Slots)
+        Slot = {};
+
+    m_LastBuiltSlot = InvalidSlot;
+    m_TracedSlot    = InvalidSlot;
+}
+
+bool ASBuildScheduler::RunSelfCheck()
+{
+    constexpr Uint32 NumFrames = 16;
+
+    Uint32 NumErrors = 0;
+    for (Uint32 NumSlots = 2; NumSlots <= 3; ++NumSlots)
+    {
+        // With a dedicated build queue, the frame traces first (see the class description);
+        // when builds share the queue with tracing, the frame builds first.
+        for (const bool BuildFirst : {false, true})
+        {
+            Uint32     Frame       = 0;
+            const auto ReportError = [&](const char* Message) {
+                if (NumErrors++ < 16)
+                    LOG_ERROR_MESSAGE("AS build scheduler check (", NumSlots, " slots, ", (BuildFirst ? "shared queue" : "build queue"), "): ", Message, " in frame ", Frame);
+            };
+
+            // Model of the fences: the value that the last build and the last trace of every slot
+            // signal, and the last values signaled on each fence.
+            std::vector<Uint64> SlotBuildValues(NumSlots);
+            std::vector<Uint64> SlotTraceValues(NumSlots);
+            Uint64              LastBuildValue = 0;
+            Uint64              LastTraceValue = 0;
+
+            ASBuildScheduler Scheduler{NumSlots};
+
+            const auto CheckBuild = [&]() {
+                const Uint32 TracedSlot = Scheduler.GetTracedSlot();
+                const auto   Ticket     = Scheduler.BeginBuild();
+                if (Ticket.Slot >= NumSlots)
+                {
+                    ReportError("invalid build slot");
+                    return InvalidSlot;
+                }
+                if (Ticket.Slot == TracedSlot)
+                    ReportError("the slot traced in the current frame is rebuilt");
+                for (Uint32 s = 0; s < NumSlots; ++s)
+                {
+                    if (s != TracedSlot && SlotTraceValues[s] < SlotTraceValues[Ticket.Slot])
+                        ReportError("the rebuilt slot is not the least recently traced one");
+                }
+                if (Ticket.WaitTraceFenceValue != SlotTraceValues[Ticket.Slot])
+                    ReportError("the build does not wait for the last trace of its slot");
+                if (Ticket.SignalBuildFenceValue != LastBuildValue + 1 || Scheduler.GetLastSignaledBuildFenceValue() != Ticket.SignalBuildFenceValue)
+                    ReportError("build fence values do not grow by one");
+                if (Scheduler.GetLastBuiltSlot() != Ticket.Slot)
+                    ReportError("the built slot is not the last built one");
+
+                SlotBuildValues[Ticket.Slot] = LastBuildValue = Ticket.SignalBuildFenceValue;
+                return Ticket.Slot;
+            };
+
+            const auto CheckTrace = [&](bool ExpectSlot) {
+                const Uint32 BuiltSlot = Scheduler.GetLastBuiltSlot();
+                const auto   Ticket    = Scheduler.BeginTrace();
+                if (Ticket.Slot == InvalidSlot)
+                {
+                    if (ExpectSlot)
+                        ReportError("nothing is traced after a build");
+                    return InvalidSlot;
+                }
+                if (!ExpectSlot)
+                    ReportError("a slot is traced before anything is built");
+                if (Ticket.Slot != BuiltSlot)
+                    ReportError("the traced slot is not the last built one");
+                else if (Ticket.WaitBuildFenceValue != SlotBuildValues[Ticket.Slot] || Ticket.WaitBuildFenceValue == 0)
+                    ReportError("tracing does not wait for the last build of its slot");
+                if (Ticket.SignalTraceFenceValue != LastTraceValue + 1 || Scheduler.GetLastSignaledTraceFenceValue() != Ticket.SignalTraceFenceValue)
+                    ReportError("trace fence values do not grow by one");
+                if (Scheduler.GetTracedSlot() != Ticket.Slot)
+                    ReportError("the traced slot is not remembered");
+
+                if (Ticket.Slot < NumSlots)
+                    SlotTraceValues[Ticket.Slot] = LastTraceValue = Ticket.SignalTraceFenceValue;
+                return Ticket.Slot;
+            };
+
+            // The second half of the frames runs after Reset(), as after the TLASes are recreated.
+            // Fence values keep growing, so the model only forgets the slot history.
+            Uint32 PrevBuildSlot = InvalidSlot;
+            for (; Frame < NumFrames * 2; ++Frame)
+            {
+                if (Frame == NumFrames)
+                {
+                    Scheduler.Reset();
+                    std::fill(SlotBuildValues.begin(), SlotBuildValues.end(), Uint64{0});
+                    std::fill(SlotTraceValues.begin(), SlotTraceValues.end(), Uint64{0});
+                    PrevBuildSlot = InvalidSlot;
+                }
+
+                if (BuildFirst)
+                {
+                    const Uint32 BuildSlot = CheckBuild();
+                    if (CheckTrace(true) != BuildSlot)
+                        ReportError("the frame does not trace the slot it has just built");
+                }
+                else
+                {
+                    const Uint32 TraceSlot = CheckTrace(PrevBuildSlot != InvalidSlot);
+                    if (TraceSlot != PrevBuildSlot)
+                        ReportError("the frame does not trace the slot built during the previous frame");
+                    PrevBuildSlot = CheckBuild();
+                }
+            }
+        }
+    }
+
+    if (NumErrors > 0)
+    {
+        LOG_ERROR_MESSAGE("AS build scheduler check failed with ", NumErrors, " errors");
+        return false;
+    }
+    LOG_INFO_MESSAGE("AS build scheduler check passed");
+    return true;
+}
+
+} // namespace Diligent
@@ -0,0 +1,127 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "BasicTypes.h"
+
+namespace Diligent
+{
+
+/// CPU-side bookkeeping for double-buffered top-level acceleration structures.
+
+/// The scheduler decides which TLAS slot is rebuilt and which one is traced in
+/// the current frame, and which fence values the build and the trace queues must
+/// wait for and signal. It does not touch any GPU objects, so the rotation logic
+/// can be exercised without a device.
+///
+/// Typical frame with asynchronous builds:
+///
+///     auto Trace = Scheduler.BeginTrace(); // slot built during the previous frame
+///     auto Build = Scheduler.BeginBuild(); // any other slot that is no longer traced
+///     BuildCtx->DeviceWaitForFence(TraceFence, Build.WaitTraceFenceValue);
+///     ... build Build.Slot ...
+///     BuildCtx->EnqueueSignal(BuildFence, Build.SignalBuildFenceValue);
+///     GraphicsCtx->DeviceWaitForFence(BuildFence, Trace.WaitBuildFenceValue);
+///     ... trace Trace.Slot ...
+///     GraphicsCtx->EnqueueSignal(TraceFence, Trace.SignalTraceFenceValue);
+///
+/// When builds and tracing share the same queue, BeginBuild() may be called first
+/// so that the frame traces the slot it has just built.
+class ASBuildScheduler
+{
+public:
+    static constexpr Uint32 InvalidSlot = ~0u;
+
+    struct BuildTicket
+    {
+        Uint32 Slot = InvalidSlot;
+
+        // The build queue must wait until the trace fence reaches this value
+        // before overwriting the slot (0 if the slot has never been traced).
+        Uint64 WaitTraceFenceValue = 0;
+
+        // The value the build queue signals once the slot is built.
+        Uint64 SignalBuildFenceValue = 0;
+    };
+
+    struct TraceTicket
+    {
+        Uint32 Slot = InvalidSlot;
+
+        // The trace queue must wait until the build fence reaches this value.
+        Uint64 WaitBuildFenceValue = 0;
+
+        // The value the trace queue signals once it no longer reads the slot.
+        Uint64 SignalTraceFenceValue = 0;
+    };
+
+    explicit ASBuildScheduler(Uint32 NumSlots = 2);
+
+    /// Selects the slot to rebuild. The slot traced in the current frame is never
+    /// selected; among the remaining ones the least recently traced slot is used.
+    BuildTicket BeginBuild();
+
+    /// Selects the most recently built slot for tracing.
+    /// Returns a ticket with InvalidSlot if nothing has been built yet.
+    TraceTicket BeginTrace();
+
+    /// Forgets all slot history, e.g. after the TLAS objects have been recreated.
+    /// Fence values keep growing as fences can not be rewound.
+    void Reset();
+
+    Uint32 GetNumSlots() const { return static_cast<Uint32>(m_Slots.size()); }
+    Uint32 GetLastBuiltSlot() const { return m_LastBuiltSlot; }
+    Uint32 GetTracedSlot() const { return m_TracedSlot; }
+
+    Uint64 GetLastSignaledBuildFenceValue() const { return m_NextBuildFenceValue - 1; }
+    Uint64 GetLastSignaledTraceFenceValue() const { return m_NextTraceFenceValue - 1; }
+
+    /// Runs both frame orders with two and three slots against a model of the fences, and checks
+    /// that a slot is never rebuilt before the last trace that reads it has signaled, that tracing
+    /// waits for the latest build of its slot, and that Reset() keeps the fence values growing.
+    /// Logs the errors and returns false if a check fails.
+    static bool RunSelfCheck();
+
+private:
+    struct SlotInfo
+    {
+        Uint64 BuildFenceValue = 0;
+        Uint64 TraceFenceValue = 0;
+    };
+    std::vector<SlotInfo> m_Slots;
+
+    Uint32 m_LastBuiltSlot = InvalidSlot;
+    Uint32 m_TracedSlot    = InvalidSlot;
+
+    Uint64 m_NextBuildFenceValue = 1;
+    Uint64 m_NextTraceFenceValue = 1;
+};
+
+} // namespace Diligent
@@ -0,0 +1,151 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "ASMemoryReport.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <utility>
+
+#include "Align.hpp"
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+void ASMemoryReport::AddEntry(std::string Name, CATEGORY Category, Uint64 Size)
+{
+    VERIFY_EXPR(Category < CATEGORY_COUNT);
+    m_Entries.push_back({std::move(Name), Category, Size, true});
+}
+
+void ASMemoryReport::AddUnknownEntry(std::string Name, CATEGORY Category)
+{
+    VERIFY_EXPR(Category < CATEGORY_COUNT);
+    m_Entries.push_back({std::move(Name), Category, 0, false});
+}
+
+void ASMemoryReport::RemoveEntries(CATEGORY Category)
+{
+    m_Entries.erase(std::remove_if(m_Entries.begin(), m_Entries.end(),
+                                   [Category](const Entry& E) { return E.Category == Category; }),
+                    m_Entries.end());
+}
+
+Uint64 ASMemoryReport::GetCategorySize(CATEGORY Category) const
+{
+    Uint64 Size = 0;
+    for (const auto& E : m_Entries)
+    {
+        if (E.Category == Category)
+            Size += E.Size;
+    }
+    return Size;
+}
+
+Uint64 ASMemoryReport::GetTotalSize() const
+{
+    Uint64 Size = 0;
+    for (const auto& E : m_Entries)
+        Size += E.Size;
+    return Size;
+}
+
+Uint32 ASMemoryReport::GetNumUnknownEntries(CATEGORY Category) const
+{
+    Uint32 NumUnknown = 0;
+    for (const auto& E : m_Entries)
+    {
+        if (E.Category == Category && !E.IsKnown)
+            ++NumUnknown;
+    }
+    return NumUnknown;
+}
+
+const char* ASMemoryReport::GetCategoryName(CATEGORY Category)
+{
+    switch (Category)
+    {
+        case CATEGORY_BLAS: return "BLAS";
+        case CATEGORY_TLAS: return "TLAS";
+        case CATEGORY_INSTANCE_BUFFER: return "Instance buffers";
+        case CATEGORY_SCRATCH_BUFFER: return "Scratch buffers";
+        case CATEGORY_SBT: return "SBT";
+        default:
+            UNEXPECTED("Unexpected category");
+            return "Unknown";
+    }
+}
+
+std::string ASMemoryReport::Format() const
+{
+    std::string Text;
+    char        Line[256];
+
+    std::snprintf(Line, sizeof(Line), "Ray tracing memory: %.1f KB\n", static_cast<double>(GetTotalSize()) / 1024.0);
+    Text += Line;
+    for (Uint32 c = 0; c < CATEGORY_COUNT; ++c)
+    {
+        const auto   Category   = static_cast<CATEGORY>(c);
+        const Uint32 NumUnknown = GetNumUnknownEntries(Category);
+        std::snprintf(Line, sizeof(Line), "  %-18s %10.1f KB%s\n", GetCategoryName(Category),
+                      static_cast<double>(GetCategorySize(Category)) / 1024.0,
+                      NumUnknown > 0 ? " + unknown" : "");
+        Text += Line;
+    }
+
+    for (const auto& E : m_Entries)
+    {
+        if (E.IsKnown)
+            std::snprintf(Line, sizeof(Line), "    [%s] %s: %.1f KB\n", GetCategoryName(E.Category), E.Name.c_str(), static_cast<double>(E.Size) / 1024.0);
+        else
+            std::snprintf(Line, sizeof(Line), "    [%s] %s: unknown\n", GetCategoryName(E.Category), E.Name.c_str());
+        Text += Line;
+    }
+
+    return Text;
+}
+
+Uint64 ASMemoryReport::ComputeSBTSize(Uint32 HandleSize,
+                                      Uint32 BaseAlignment,
+                                      Uint32 NumRayGenShaders,
+                                      Uint32 NumMissShaders,
+                                      Uint32 NumHitGroups,
+                                      Uint32 NumCallableShaders)
+{
+    const Uint64 Alignment = std::max(BaseAlignment, 1u);
+
+    Uint64 Size = 0;
+    for (Uint32 NumRecords : {NumRayGenShaders, NumMissShaders, NumHitGroups, NumCallableShaders})
+    {
+        if (NumRecords > 0)
+            Size = AlignUpNonPw2(Size, Alignment) + Uint64{NumRecords} * HandleSize;
+    }
+    return Size;
+}
+
+} // namespace Diligent
@@ -0,0 +1,97 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "BasicTypes.h"
+
+namespace Diligent
+{
+
+/// Accounts GPU memory used by ray tracing: acceleration structures, instance buffers,
+/// scratch buffers and the shader binding table.
+
+/// The report only stores named sizes, so it has no device dependencies. Sizes that the
+/// engine does not expose are recorded as unknown rather than guessed.
+class ASMemoryReport
+{
+public:
+    enum CATEGORY : Uint32
+    {
+        CATEGORY_BLAS = 0,
+        CATEGORY_TLAS,
+        CATEGORY_INSTANCE_BUFFER,
+        CATEGORY_SCRATCH_BUFFER,
+        CATEGORY_SBT,
+        CATEGORY_COUNT
+    };
+
+    struct Entry
+    {
+        std::string Name;
+        CATEGORY    Category = CATEGORY_BLAS;
+        Uint64      Size     = 0;
+        bool        IsKnown  = true;
+    };
+
+    void AddEntry(std::string Name, CATEGORY Category, Uint64 Size);
+    void AddUnknownEntry(std::string Name, CATEGORY Category);
+
+    /// Removes all entries of the given category, e.g. before it is measured again.
+    void RemoveEntries(CATEGORY Category);
+    void Clear() { m_Entries.clear(); }
+
+    const std::vector<Entry>& GetEntries() const { return m_Entries; }
+
+    Uint64 GetCategorySize(CATEGORY Category) const;
+    Uint64 GetTotalSize() const;
+
+    /// Returns the number of entries in the category whose size is unknown.
+    Uint32 GetNumUnknownEntries(CATEGORY Category) const;
+
+    /// Returns a multi-line text with per-category totals followed by all entries.
+    std::string Format() const;
+
+    static const char* GetCategoryName(CATEGORY Category);
+
+    /// Computes the size of a shader binding table with no shader record data, laid out as
+    /// ray generation, miss, hit group and callable regions each aligned by BaseAlignment.
+    static Uint64 ComputeSBTSize(Uint32 HandleSize,
+                                 Uint32 BaseAlignment,
+                                 Uint32 NumRayGenShaders,
+                                 Uint32 NumMissShaders,
+                                 Uint32 NumHitGroups,
+                                 Uint32 NumCallableShaders);
+
+private:
+    std::vector<Entry> m_Entries;
+};
+
+} // namespace Diligent
@@ -0,0 +1,408 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "ATrousDenoiser.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    define ATROUS_DENOISER_SSE 1
+#    include <emmintrin.h>
+#else
+#    define ATROUS_DENOISER_SSE 0
+#endif
+
+#include "DebugUtilities.hpp"
+#include "ParallelFor.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+// B3-spline kernel, indexed by the absolute tap offset.
+constexpr float Kernel[3] = {3.f / 8.f, 1.f / 4.f, 1.f / 16.f};
+
+constexpr float Log2E = 1.4426950f;
+
+// Least-squares fits of log2(1 + t) and exp2(t) for t in [0, 1), with errors below 3e-5 and
+// 1e-5. The tap weights are heuristics, so this is plenty and much cheaper than std::pow.
+constexpr float Log2Coeffs[6] = {3.16815451e-05f, 1.44127084f, -0.705719484f, 0.408749668f, -0.187743998f, 0.0434343345f};
+constexpr float Exp2Coeffs[5] = {1.00000725f, 0.692931571f, 0.241709642f, 0.0516672168f, 0.013676598f};
+
+float GetLuminance(float R, float G, float B)
+{
+    return 0.2126f * R + 0.7152f * G + 0.0722f * B;
+}
+
+// Expects a positive normalized number.
+float Log2Approx(float x)
+{
+    Uint32 Bits;
+    std::memcpy(&Bits, &x, sizeof(Bits));
+    const float Exponent = static_cast<float>(static_cast<Int32>(Bits >> 23) - 127);
+    Bits                 = (Bits & 0x007FFFFFu) | 0x3F800000u;
+    float Mantissa;
+    std::memcpy(&Mantissa, &Bits, sizeof(Mantissa));
+
+    const float t = Mantissa - 1.f;
+    return Exponent + (Log2Coeffs[0] + t * (Log2Coeffs[1] + t * (Log2Coeffs[2] + t * (Log2Coeffs[3] + t * (Log2Coeffs[4] + t * Log2Coeffs[5])))));
+}
+
+float Exp2Approx(float x)
+{
+    x                 = std::min(std::max(x, -126.f), 126.f);
+    const float Floor = std::floor(x);
+    const float t     = x - Floor;
+
+    const Uint32 Bits = static_cast<Uint32>(static_cast<Int32>(Floor) + 127) << 23;
+    float        Scale;
+    std::memcpy(&Scale, &Bits, sizeof(Scale));
+    return Scale * (Exp2Coeffs[0] + t * (Exp2Coeffs[1] + t * (Exp2Coeffs[2] + t * (Exp2Coeffs[3] + t * Exp2Coeffs[4]))));
+}
+
+#if ATROUS_DENOISER_SSE
+__m128 Log2Approx(__m128 x)
+{
+    const __m128i Bits     = _mm_castps_si128(x);
+    const __m128  Exponent = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(Bits, 23), _mm_set1_epi32(127)));
+    const __m128  Mantissa = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(Bits, _mm_set1_epi32(0x007FFFFF)), _mm_set1_epi32(0x3F800000)));
+
+    const __m128 t = _mm_sub_ps(Mantissa, _mm_set1_ps(1.f));
+    __m128       P = _mm_set1_ps(Log2Coeffs[5]);
+    for (int i = 4; i >= 0; --i)
+        P = _mm_add_ps(_mm_set1_ps(Log2Coeffs[i]), _mm_mul_ps(t, P));
+    return _mm_add_ps(Exponent, P);
+}
+
+__m128 Exp2Approx(__m128 x)
+{
+    x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-126.f)), _mm_set1_ps(126.f));
+
+    // Floor: truncation rounds negative numbers up, so subtract one where that happened.
+    __m128i      Int   = _mm_cvttps_epi32(x);
+    const __m128 Trunc = _mm_cvtepi32_ps(Int);
+    Int                = _mm_add_epi32(Int, _mm_castps_si128(_mm_cmpgt_ps(Trunc, x))); // mask is -1
+    const __m128 Floor = _mm_cvtepi32_ps(Int);
+    const __m128 t     = _mm_sub_ps(x, Floor);
+
+    const __m128 Scale = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(Int, _mm_set1_epi32(127)), 23));
+    __m128       P     = _mm_set1_ps(Exp2Coeffs[4]);
+    for (int i = 3; i >= 0; --i)
+        P = _mm_add_ps(_mm_set1_ps(Exp2Coeffs[i]), _mm_mul_ps(t, P));
+    return _mm_mul_ps(Scale, P);
+}
+#endif
+
+} // namespace
+
+void ATrousDenoiser::VarianceRow(Uint32 y, ColorPlanes& Dst) const
+{
+    const auto& Src = m_Planes[0];
+    for (Uint32 x = 0; x < m_Width; ++x)
+    {
+        const size_t P        = size_t{y} * m_Width + x;
+        const Uint32 ObjectId = m_ObjectIds[P];
+
+        float Sum   = 0;
+        float SumSq = 0;
+        float Count = 0;
+        for (Uint32 qy = y > 0 ? y - 1 : 0; qy <= std::min(y + 1, m_Height - 1); ++qy)
+        {
+            for (Uint32 qx = x > 0 ? x - 1 : 0; qx <= std::min(x + 1, m_Width - 1); ++qx)
+            {
+                const size_t Q = size_t{qy} * m_Width + qx;
+                if (m_ObjectIds[Q] != ObjectId)
+                    continue;
+
+                const float L = GetLuminance(Src.R[Q], Src.G[Q], Src.B[Q]);
+                Sum += L;
+                SumSq += L * L;
+                Count += 1;
+            }
+        }
+        const float Mean = Sum / Count;
+
+        Dst.R[P]   = Src.R[P];
+        Dst.G[P]   = Src.G[P];
+        Dst.B[P]   = Src.B[P];
+        Dst.Var[P] = std::max(SumSq / Count - Mean * Mean, 0.f);
+    }
+}
+
+void ATrousDenoiser::FilterPixel(Uint32 x, Uint32 y, Int32 Step, const Settings& Attribs, const ColorPlanes& Src, ColorPlanes& Dst) const
+{
+    const size_t P         = size_t{y} * m_Width + x;
+    const float  DepthP    = m_Depth[P];
+    const float  LumP      = GetLuminance(Src.R[P], Src.G[P], Src.B[P]);
+    const float  LumScale  = 1.f / (Attribs.LuminanceSigma * std::sqrt(Src.Var[P]) + 1e-4f);
+    const float  DepthTol  = Attribs.DepthSigma * DepthP;
+    const Uint32 ObjectIdP = m_ObjectIds[P];
+
+    float WeightSum   = Kernel[0] * Kernel[0];
+    float R           = Src.R[P] * WeightSum;
+    float G           = Src.G[P] * WeightSum;
+    float B           = Src.B[P] * WeightSum;
+    float VarianceSum = Src.Var[P] * WeightSum * WeightSum;
+    for (Int32 dy = -2; dy <= 2; ++dy)
+    {
+        const Int32 qy = static_cast<Int32>(y) + dy * Step;
+        if (qy < 0 || qy >= static_cast<Int32>(m_Height))
+            continue;
+
+        for (Int32 dx = -2; dx <= 2; ++dx)
+        {
+            const Int32 qx = static_cast<Int32>(x) + dx * Step;
+            if ((dx == 0 && dy == 0) || qx < 0 || qx >= static_cast<Int32>(m_Width))
+                continue;
+
+            const size_t Q = static_cast<size_t>(qy) * m_Width + qx;
+            if (m_ObjectIds[Q] != ObjectIdP)
+                continue;
+
+            const float PixelDist = static_cast<float>(std::max(std::abs(dx), std::abs(dy)) * Step);
+            const float NdotN     = m_NormalX[P] * m_NormalX[Q] + m_NormalY[P] * m_NormalY[Q] + m_NormalZ[P] * m_NormalZ[Q];
+
+            const float E = std::abs(DepthP - m_Depth[Q]) / (DepthTol * PixelDist + 1e-4f) +
+                std::abs(LumP - GetLuminance(Src.R[Q], Src.G[Q], Src.B[Q])) * LumScale;
+            const float W = Kernel[std::abs(dx)] * Kernel[std::abs(dy)] *
+                Exp2Approx(Attribs.NormalPower * Log2Approx(std::max(NdotN, 1e-6f)) - E * Log2E);
+
+            WeightSum += W;
+            R += Src.R[Q] * W;
+            G += Src.G[Q] * W;
+            B += Src.B[Q] * W;
+            VarianceSum += Src.Var[Q] * W * W;
+        }
+    }
+
+    Dst.R[P]   = R / WeightSum;
+    Dst.G[P]   = G / WeightSum;
+    Dst.B[P]   = B / WeightSum;
+    Dst.Var[P] = VarianceSum / (WeightSum * WeightSum);
+}
+
+void ATrousDenoiser::FilterRow(Uint32 y, Int32 Step, const Settings& Attribs, const ColorPlanes& Src, ColorPlanes& Dst) const
+{
+    Uint32 x = 0;
+#if ATROUS_DENOISER_SSE
+    // Four pixels at a time where all horizontal taps are inside of the image.
+    const Uint32 Margin = 2 * static_cast<Uint32>(Step);
+    for (; x < std::min(Margin, m_Width); ++x)
+        FilterPixel(x, y, Step, Attribs, Src, Dst);
+
+    const __m128 AbsMask     = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    const __m128 LumR        = _mm_set1_ps(0.2126f);
+    const __m128 LumG        = _mm_set1_ps(0.7152f);
+    const __m128 LumB        = _mm_set1_ps(0.0722f);
+    const __m128 Epsilon     = _mm_set1_ps(1e-4f);
+    const __m128 MinCos      = _mm_set1_ps(1e-6f);
+    const __m128 NormalPower = _mm_set1_ps(Attribs.NormalPower);
+    const __m128 NegLog2E    = _mm_set1_ps(-Log2E);
+    for (; x + 3 + Margin < m_Width; x += 4)
+    {
+        const size_t P = size_t{y} * m_Width + x;
+
+        const __m128  RP        = _mm_loadu_ps(&Src.R[P]);
+        const __m128  GP        = _mm_loadu_ps(&Src.G[P]);
+        const __m128  BP        = _mm_loadu_ps(&Src.B[P]);
+        const __m128  VarP      = _mm_loadu_ps(&Src.Var[P]);
+        const __m128  DepthP    = _mm_loadu_ps(&m_Depth[P]);
+        const __m128  NXP       = _mm_loadu_ps(&m_NormalX[P]);
+        const __m128  NYP       = _mm_loadu_ps(&m_NormalY[P]);
+        const __m128  NZP       = _mm_loadu_ps(&m_NormalZ[P]);
+        const __m128i ObjectIdP = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&m_ObjectIds[P]));
+        const __m128  LumP      = _mm_add_ps(_mm_add_ps(_mm_mul_ps(LumR, RP), _mm_mul_ps(LumG, GP)), _mm_mul_ps(LumB, BP));
+        const __m128  LumScale  = _mm_div_ps(_mm_set1_ps(1.f), _mm_add_ps(_mm_mul_ps(_mm_set1_ps(Attribs.LuminanceSigma), _mm_sqrt_ps(VarP)), Epsilon));
+        const __m128  DepthTol  = _mm_mul_ps(_mm_set1_ps(Attribs.DepthSigma), DepthP);
+
+        __m128 WeightSum   = _mm_set1_ps(Kernel[0] * Kernel[0]);
+        __m128 R           = _mm_mul_ps(RP, WeightSum);
+        __m128 G           = _mm_mul_ps(GP, WeightSum);
+        __m128 B           = _mm_mul_ps(BP, WeightSum);
+        __m128 VarianceSum = _mm_mul_ps(VarP, _mm_mul_ps(WeightSum, WeightSum));
+        for (Int32 dy = -2; dy <= 2; ++dy)
+        {
+            const Int32 qy = static_cast<Int32>(y) + dy * Step;
+            if (qy < 0 || qy >= static_cast<Int32>(m_Height))
+                continue;
+
+            for (Int32 dx = -2; dx <= 2; ++dx)
+            {
+                if (dx == 0 && dy == 0)
+                    continue;
+
+                const size_t  Q          = static_cast<size_t>(qy) * m_Width + x + dx * Step;
+                const __m128i ObjectIdQ  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&m_ObjectIds[Q]));
+                const __m128  SameObject = _mm_castsi128_ps(_mm_cmpeq_epi32(ObjectIdP, ObjectIdQ));
+                if (_mm_movemask_ps(SameObject) == 0)
+                    continue;
+
+                const __m128 RQ    = _mm_loadu_ps(&Src.R[Q]);
+                const __m128 GQ    = _mm_loadu_ps(&Src.G[Q]);
+                const __m128 BQ    = _mm_loadu_ps(&Src.B[Q]);
+                const __m128 LumQ  = _mm_add_ps(_mm_add_ps(_mm_mul_ps(LumR, RQ), _mm_mul_ps(LumG, GQ)), _mm_mul_ps(LumB, BQ));
+                const __m128 NdotN = _mm_add_ps(_mm_add_ps(_mm_mul_ps(NXP, _mm_loadu_ps(&m_NormalX[Q])), _mm_mul_ps(NYP, _mm_loadu_ps(&m_NormalY[Q]))),
+                                                _mm_mul_ps(NZP, _mm_loadu_ps(&m_NormalZ[Q])));
+
+                const __m128 PixelDist = _mm_set1_ps(static_cast<float>(std::max(std::abs(dx), std::abs(dy)) * Step));
+                const __m128 DepthDiff = _mm_and_ps(AbsMask, _mm_sub_ps(DepthP, _mm_loadu_ps(&m_Depth[Q])));
+                const __m128 LumDiff   = _mm_and_ps(AbsMask, _mm_sub_ps(LumP, LumQ));
+                const __m128 E         = _mm_add_ps(_mm_div_ps(DepthDiff, _mm_add_ps(_mm_mul_ps(DepthTol, PixelDist), Epsilon)), _mm_mul_ps(LumDiff, LumScale));
+
+                const __m128 Exponent = _mm_add_ps(_mm_mul_ps(NormalPower, Log2Approx(_mm_max_ps(NdotN, MinCos))), _mm_mul_ps(E, NegLog2E));
+                const __m128 W        = _mm_and_ps(SameObject, _mm_mul_ps(_mm_set1_ps(Kernel[std::abs(dx)] * Kernel[std::abs(dy)]), Exp2Approx(Exponent)));
+
+                WeightSum   = _mm_add_ps(WeightSum, W);
+                R           = _mm_add_ps(R, _mm_mul_ps(RQ, W));
+                G           = _mm_add_ps(G, _mm_mul_ps(GQ, W));
+                B           = _mm_add_ps(B, _mm_mul_ps(BQ, W));
+                VarianceSum = _mm_add_ps(VarianceSum, _mm_mul_ps(_mm_loadu_ps(&Src.Var[Q]), _mm_mul_ps(W, W)));
+            }
+        }
+
+        _mm_storeu_ps(&Dst.R[P], _mm_div_ps(R, WeightSum));
+        _mm_storeu_ps(&Dst.G[P], _mm_div_ps(G, WeightSum));
+        _mm_storeu_ps(&Dst.B[P], _mm_div_ps(B, WeightSum));
+        _mm_storeu_ps(&Dst.Var[P], _mm_div_ps(VarianceSum, _mm_mul_ps(WeightSum, WeightSum)));
+    }
+#endif
+    for (; x < m_Width; ++x)
+        FilterPixel(x, y, Step, Attribs, Src, Dst);
+}
+
+void ATrousDenoiser::Filter(const float4*   pColor,
+                            const float*    pDepth,
+                            const float4*   pNormals,
+                            const Uint32*   pObjectIds,
+                            Uint32          Width,
+                            Uint32          Height,
+                            const Settings& Attribs,
+                            float4*         pOutput)
+{
+    VERIFY_EXPR(pColor != nullptr && pDepth != nullptr && pNormals != nullptr && pObjectIds != nullptr && pOutput != nullptr);
+
+    m_Width  = Width;
+    m_Height = Height;
+
+    const size_t NumPixels = size_t{Width} * Height;
+    m_Depth.assign(pDepth, pDepth + NumPixels);
+    m_ObjectIds.assign(pObjectIds, pObjectIds + NumPixels);
+    for (auto* pPlane : {&m_NormalX, &m_NormalY, &m_NormalZ})
+        pPlane->resize(NumPixels);
+    for (auto& Planes : m_Planes)
+    {
+        for (auto* pPlane : {&Planes.R, &Planes.G, &Planes.B, &Planes.Var})
+            pPlane->resize(NumPixels);
+    }
+
+    for (size_t i = 0; i < NumPixels; ++i)
+    {
+        m_Planes[0].R[i] = pColor[i].x;
+        m_Planes[0].G[i] = pColor[i].y;
+        m_Planes[0].B[i] = pColor[i].z;
+        m_NormalX[i]     = pNormals[i].x;
+        m_NormalY[i]     = pNormals[i].y;
+        m_NormalZ[i]     = pNormals[i].z;
+    }
+
+    ParallelFor(Height, [&](Uint32 y) { VarianceRow(y, m_Planes[1]); });
+
+    Uint32 Src = 1;
+    for (Uint32 Pass = 0; Pass < Attribs.NumPasses; ++Pass)
+    {
+        const Int32 Step = 1 << Pass;
+        ParallelFor(Height, [&](Uint32 y) { FilterRow(y, Step, Attribs, m_Planes[Src], m_Planes[1 - Src]); });
+        Src = 1 - Src;
+    }
+
+    const auto& Result = m_Planes[Src];
+    for (size_t i = 0; i < NumPixels; ++i)
+        pOutput[i] = float4{Result.R[i], Result.G[i], Result.B[i], Result.Var[i]};
+}
+
+ATrousDenoiser::BenchmarkResult ATrousDenoiser::RunBenchmark(Uint32 Width, Uint32 Height, const Settings& Attribs, Uint32 Seed)
+{
+    BenchmarkResult Result;
+    Result.Width  = Width;
+    Result.Height = Height;
+    if (Width == 0 || Height == 0)
+        return Result;
+
+    // A ground plane in the lower half and a wall in the upper half, both with smooth shading.
+    // Shadow rays with one sample either hit the light or not, so every pixel of the noisy
+    // image is either black or twice as bright as the clean one.
+    const size_t        NumPixels = size_t{Width} * Height;
+    std::vector<float4> Clean(NumPixels), Noisy(NumPixels), Normals(NumPixels), Output(NumPixels);
+    std::vector<float>  Depth(NumPixels);
+    std::vector<Uint32> ObjectIds(NumPixels);
+
+    std::mt19937                          Gen{Seed};
+    std::uniform_real_distribution<float> Dist{0.f, 1.f};
+    for (Uint32 y = 0; y < Height; ++y)
+    {
+        for (Uint32 x = 0; x < Width; ++x)
+        {
+            const size_t i  = size_t{y} * Width + x;
+            const float  u  = static_cast<float>(x) / Width;
+            const float  v  = static_cast<float>(y) / Height;
+            const bool   IsWall = v < 0.5f;
+
+            Clean[i]     = IsWall ? float4{0.2f + 0.6f * u, 0.5f, 0.3f, 0} : float4{0.4f, 0.3f + 0.4f * v, 0.2f + 0.2f * u, 0};
+            Normals[i]   = IsWall ? float4{0, 0, -1, 0} : float4{0, 1, 0, 0};
+            Depth[i]     = IsWall ? 20.f : 20.f / (0.5f + 4.f * (v - 0.5f));
+            ObjectIds[i] = IsWall ? 1 : 2;
+            Noisy[i]     = Dist(Gen) < 0.5f ? float4{0, 0, 0, 0} : Clean[i] * 2.f;
+        }
+    }
+
+    ATrousDenoiser Denoiser;
+    const auto     Start = std::chrono::high_resolution_clock::now();
+    Denoiser.Filter(Noisy.data(), Depth.data(), Normals.data(), ObjectIds.data(), Width, Height, Attribs, Output.data());
+    Result.FilterMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - Start).count();
+
+    double NoisyErr    = 0;
+    double FilteredErr = 0;
+    for (size_t i = 0; i < NumPixels; ++i)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            NoisyErr += (Noisy[i][c] - Clean[i][c]) * (Noisy[i][c] - Clean[i][c]);
+            FilteredErr += (Output[i][c] - Clean[i][c]) * (Output[i][c] - Clean[i][c]);
+        }
+    }
+    Result.NoisyRMSE    = std::sqrt(NoisyErr / (NumPixels * 3));
+    Result.FilteredRMSE = std::sqrt(FilteredErr / (NumPixels * 3));
+    return Result;
+}
+
+} // namespace Diligent
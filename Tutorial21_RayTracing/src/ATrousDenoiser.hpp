@@ -0,0 +1,103 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "BasicMath.hpp"
+
+namespace Diligent
+{
+
+/// CPU implementation of the edge-aware a-trous denoiser in Denoise.csh.
+
+/// A variance pass estimates the luminance variance of every pixel in its 3x3 neighborhood on
+/// the same object. Every filter pass then blurs the color with a 5x5 B3-spline kernel whose taps
+/// are 2^pass pixels apart, so a few passes cover a large footprint. Tap weights drop across
+/// depth, normal and object boundaries of the G-buffer and across luminance differences larger
+/// than the estimated noise, and the variance is filtered along with the color.
+///
+/// Pixels are stored as structure of arrays and four pixels of a row are filtered at a time with
+/// SSE, with a scalar path for image borders. Rows are filtered in parallel. Exponentials use the
+/// same polynomial approximations in both paths, so the results do not depend on the path.
+class ATrousDenoiser
+{
+public:
+    struct Settings
+    {
+        Uint32 NumPasses      = 4;
+        float  DepthSigma     = 0.02f; ///< Tolerated relative depth difference per pixel of distance
+        float  NormalPower    = 64.f;  ///< Exponent of the cosine between the normals
+        float  LuminanceSigma = 4.f;   ///< Tolerated luminance difference in standard deviations
+    };
+
+    /// Filters the color image. The G-buffer holds distances to the primary hits, world-space
+    /// normals in xyz and object ids that differ between objects, see GBuffer.fxh. The output
+    /// holds the filtered color in xyz and the filtered luminance variance in w.
+    void Filter(const float4*   pColor,
+                const float*    pDepth,
+                const float4*   pNormals,
+                const Uint32*   pObjectIds,
+                Uint32          Width,
+                Uint32          Height,
+                const Settings& Attribs,
+                float4*         pOutput);
+
+    struct BenchmarkResult
+    {
+        Uint32 Width        = 0;
+        Uint32 Height       = 0;
+        double FilterMs     = 0;
+        double NoisyRMSE    = 0; ///< Error of the input against the clean image
+        double FilteredRMSE = 0; ///< Error of the output against the clean image
+    };
+
+    /// Filters a synthetic image of two objects with one-sample shadow noise and
+    /// reports the time and the error against the noise-free image.
+    static BenchmarkResult RunBenchmark(Uint32 Width, Uint32 Height, const Settings& Attribs, Uint32 Seed = 0);
+
+private:
+    struct ColorPlanes
+    {
+        std::vector<float> R, G, B, Var;
+    };
+
+    void VarianceRow(Uint32 y, ColorPlanes& Dst) const;
+    void FilterRow(Uint32 y, Int32 Step, const Settings& Attribs, const ColorPlanes& Src, ColorPlanes& Dst) const;
+    void FilterPixel(Uint32 x, Uint32 y, Int32 Step, const Settings& Attribs, const ColorPlanes& Src, ColorPlanes& Dst) const;
+
+    Uint32 m_Width  = 0;
+    Uint32 m_Height = 0;
+
+    std::vector<float>  m_Depth;
+    std::vector<float>  m_NormalX, m_NormalY, m_NormalZ;
+    std::vector<Uint32> m_ObjectIds;
+    ColorPlanes         m_Planes[2];
+};
+
+} // namespace Diligent
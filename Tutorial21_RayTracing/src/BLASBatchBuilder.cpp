@@ -0,0 +1,191 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "BLASBatchBuilder.hpp"
+
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+BLASBatchBuilder::BLASBatchBuilder(IRenderDevice* pDevice,
+                                   Uint64         ImmediateContextMask,
+                                   Uint64         MaxBufferSize) :
+    m_pDevice{pDevice},
+    m_ImmediateContextMask{ImmediateContextMask},
+    m_Packer{
+        pDevice->GetAdapterInfo().RayTracing.VertexBufferAlignment,
+        pDevice->GetAdapterInfo().RayTracing.IndexBufferAlignment,
+        MaxBufferSize,
+    }
+{
+}
+
+Uint32 BLASBatchBuilder::AddTriangleMesh(const TriangleMeshDesc& Desc)
+{
+    VERIFY(m_BLASes.empty(), "Meshes can not be added after the batch has been built");
+
+    GeometryPacker::MeshDesc MeshDesc;
+    MeshDesc.pVertices      = Desc.pVertices;
+    MeshDesc.VertexStride   = Desc.VertexStride;
+    MeshDesc.PositionOffset = Desc.PositionOffset;
+    MeshDesc.NumVertices    = Desc.NumVertices;
+    MeshDesc.pIndices       = Desc.pIndices;
+    MeshDesc.NumIndices     = Desc.NumIndices;
+
+    const auto Mesh = m_Packer.AddMesh(MeshDesc);
+    m_Meshes.push_back({Desc.Name != nullptr ? Desc.Name : "Mesh " + std::to_string(Mesh), Desc.GeometryFlags, Desc.BuildFlags});
+    return Mesh;
+}
+
+void BLASBatchBuilder::CreateBuffers(const std::vector<std::vector<Uint8>>& Data, const char* Name, std::vector<RefCntAutoPtr<IBuffer>>& Buffers)
+{
+    Buffers.resize(Data.size());
+    for (size_t i = 0; i < Data.size(); ++i)
+    {
+        const auto BufferName = std::string{Name} + ' ' + std::to_string(i);
+
+        BufferDesc BuffDesc;
+        BuffDesc.Name                 = BufferName.c_str();
+        BuffDesc.Usage                = USAGE_IMMUTABLE;
+        BuffDesc.BindFlags            = BIND_RAY_TRACING;
+        BuffDesc.Size                 = Data[i].size();
+        BuffDesc.ImmediateContextMask = m_ImmediateContextMask;
+
+        BufferData BufData{Data[i].data(), BuffDesc.Size};
+        m_pDevice->CreateBuffer(BuffDesc, &BufData, &Buffers[i]);
+        VERIFY_EXPR(Buffers[i] != nullptr);
+    }
+}
+
+void BLASBatchBuilder::Build(IDeviceContext* pContext, ScratchBufferAllocator& ScratchAllocator)
+{
+    VERIFY(m_BLASes.empty(), "The batch has already been built");
+
+    const Uint32 NumMeshes = m_Packer.GetNumMeshes();
+    if (NumMeshes == 0)
+        return;
+
+    // Upload packed geometry. Staging copies are not needed once the buffers are initialized.
+    CreateBuffers(m_Packer.GetVertexBuffers(), "BLAS batch vertices", m_VertexBuffers);
+    CreateBuffers(m_Packer.GetIndexBuffers(), "BLAS batch indices", m_IndexBuffers);
+    m_Packer.ReleaseStagingData();
+
+    // Create all BLASes first to learn scratch requirements of the whole batch.
+    std::vector<BLASTriangleDesc> Triangles(NumMeshes);
+    std::vector<Uint64>           ScratchSizes(NumMeshes);
+    m_BLASes.resize(NumMeshes);
+    for (Uint32 m = 0; m < NumMeshes; ++m)
+    {
+        const auto& Place = m_Packer.GetPlacement(m);
+
+        auto& Tri                = Triangles[m];
+        Tri.GeometryName         = "Mesh";
+        Tri.MaxVertexCount       = Place.NumVertices;
+        Tri.VertexValueType      = VT_FLOAT32;
+        Tri.VertexComponentCount = 3;
+        Tri.MaxPrimitiveCount    = Place.NumIndices / 3;
+        Tri.IndexType            = VT_UINT32;
+
+        BottomLevelASDesc ASDesc;
+        ASDesc.Name                 = m_Meshes[m].Name.c_str();
+        ASDesc.Flags                = m_Meshes[m].BuildFlags;
+        ASDesc.pTriangles           = &Tri;
+        ASDesc.TriangleCount        = 1;
+        ASDesc.ImmediateContextMask = m_ImmediateContextMask;
+
+        m_pDevice->CreateBLAS(ASDesc, &m_BLASes[m]);
+        VERIFY_EXPR(m_BLASes[m] != nullptr);
+
+        ScratchSizes[m] = m_BLASes[m]->GetScratchBufferSizes().Build;
+    }
+
+    // Size scratch memory once for the entire batch. Ranges do not overlap, so
+    // builds need no barriers between them.
+    ScratchAllocator.Reserve(ScratchAllocator.GetBatchSize(ScratchSizes.data(), NumMeshes));
+    std::vector<ScratchBufferAllocator::Allocation> Scratch(NumMeshes);
+    for (Uint32 m = 0; m < NumMeshes; ++m)
+        Scratch[m] = ScratchAllocator.Allocate(ScratchSizes[m]);
+
+    // One barrier for all inputs and outputs of the batch.
+    {
+        std::vector<StateTransitionDesc> Barriers;
+        Barriers.reserve(m_VertexBuffers.size() + m_IndexBuffers.size() + NumMeshes + 1);
+        for (auto& pVB : m_VertexBuffers)
+            Barriers.emplace_back(pVB, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_BUILD_AS_READ, STATE_TRANSITION_FLAG_UPDATE_STATE);
+        for (auto& pIB : m_IndexBuffers)
+            Barriers.emplace_back(pIB, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_BUILD_AS_READ, STATE_TRANSITION_FLAG_UPDATE_STATE);
+        for (auto& pBLAS : m_BLASes)
+            Barriers.emplace_back(pBLAS, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_BUILD_AS_WRITE, STATE_TRANSITION_FLAG_UPDATE_STATE);
+        for (Uint32 b = 0; b < ScratchAllocator.GetNumBuffers(); ++b)
+            Barriers.emplace_back(ScratchAllocator.GetBuffer(b), RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_BUILD_AS_WRITE, STATE_TRANSITION_FLAG_UPDATE_STATE);
+        pContext->TransitionResourceStates(static_cast<Uint32>(Barriers.size()), Barriers.data());
+    }
+
+    for (Uint32 m = 0; m < NumMeshes; ++m)
+    {
+        const auto& Place = m_Packer.GetPlacement(m);
+        const auto& Tri   = Triangles[m];
+
+        BLASBuildTriangleData TriData;
+        TriData.GeometryName         = Tri.GeometryName;
+        TriData.pVertexBuffer        = m_VertexBuffers[Place.VertexBuffer];
+        TriData.VertexOffset         = Place.VertexOffset;
+        TriData.VertexStride         = GeometryPacker::PackedVertexStride;
+        TriData.VertexCount          = Tri.MaxVertexCount;
+        TriData.VertexValueType      = Tri.VertexValueType;
+        TriData.VertexComponentCount = Tri.VertexComponentCount;
+        TriData.pIndexBuffer         = m_IndexBuffers[Place.IndexBuffer];
+        TriData.IndexOffset          = Place.IndexOffset;
+        TriData.PrimitiveCount       = Tri.MaxPrimitiveCount;
+        TriData.IndexType            = Tri.IndexType;
+        TriData.Flags                = m_Meshes[m].GeometryFlags;
+
+        BuildBLASAttribs Attribs;
+        Attribs.pBLAS                       = m_BLASes[m];
+        Attribs.pTriangleData               = &TriData;
+        Attribs.TriangleDataCount           = 1;
+        Attribs.pScratchBuffer              = Scratch[m].pBuffer;
+        Attribs.ScratchBufferOffset         = Scratch[m].Offset;
+        Attribs.BLASTransitionMode          = RESOURCE_STATE_TRANSITION_MODE_VERIFY;
+        Attribs.GeometryTransitionMode      = RESOURCE_STATE_TRANSITION_MODE_VERIFY;
+        Attribs.ScratchBufferTransitionMode = RESOURCE_STATE_TRANSITION_MODE_VERIFY;
+
+        pContext->BuildBLAS(Attribs);
+    }
+
+    // Make the results visible to TLAS builds.
+    {
+        std::vector<StateTransitionDesc> Barriers;
+        Barriers.reserve(NumMeshes);
+        for (auto& pBLAS : m_BLASes)
+            Barriers.emplace_back(pBLAS, RESOURCE_STATE_BUILD_AS_WRITE, RESOURCE_STATE_BUILD_AS_READ, STATE_TRANSITION_FLAG_UPDATE_STATE);
+        pContext->TransitionResourceStates(static_cast<Uint32>(Barriers.size()), Barriers.data());
+    }
+}
+
+} // namespace Diligent
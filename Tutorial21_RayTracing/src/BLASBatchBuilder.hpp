@@ -0,0 +1,105 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "RenderDevice.h"
+#include "DeviceContext.h"
+#include "BottomLevelAS.h"
+#include "RefCntAutoPtr.hpp"
+#include "GeometryPacker.hpp"
+#include "ScratchBufferAllocator.hpp"
+
+namespace Diligent
+{
+
+/// Builds bottom-level acceleration structures for many triangle meshes at once.
+
+/// Positions and indices of all meshes are packed into a few shared buffers by
+/// GeometryPacker, scratch memory for the whole batch is reserved with a single
+/// allocation, and all builds are recorded back to back between one barrier that
+/// makes the inputs readable and one barrier that publishes the results.
+class BLASBatchBuilder
+{
+public:
+    struct TriangleMeshDesc
+    {
+        const char* Name = nullptr;
+
+        const void* pVertices      = nullptr;
+        Uint32      VertexStride   = GeometryPacker::PackedVertexStride;
+        Uint32      PositionOffset = 0;
+        Uint32      NumVertices    = 0;
+
+        const Uint32* pIndices   = nullptr;
+        Uint32        NumIndices = 0;
+
+        RAYTRACING_GEOMETRY_FLAGS GeometryFlags = RAYTRACING_GEOMETRY_FLAG_OPAQUE;
+        RAYTRACING_BUILD_AS_FLAGS BuildFlags    = RAYTRACING_BUILD_AS_PREFER_FAST_TRACE;
+    };
+
+    BLASBatchBuilder(IRenderDevice* pDevice,
+                     Uint64         ImmediateContextMask,
+                     Uint64         MaxBufferSize = Uint64{256} << 20);
+
+    /// Copies mesh positions and indices into the packed staging data. Returns the mesh index.
+    Uint32 AddTriangleMesh(const TriangleMeshDesc& Desc);
+
+    /// Uploads the packed geometry, creates BLASes for all meshes and records their builds
+    /// into pContext. When the method returns, all BLASes are in RESOURCE_STATE_BUILD_AS_READ.
+    void Build(IDeviceContext* pContext, ScratchBufferAllocator& ScratchAllocator);
+
+    Uint32          GetNumMeshes() const { return m_Packer.GetNumMeshes(); }
+    IBottomLevelAS* GetBLAS(Uint32 Mesh) const { return m_BLASes[Mesh]; }
+
+    const GeometryPacker& GetPacker() const { return m_Packer; }
+
+private:
+    struct MeshInfo
+    {
+        std::string               Name;
+        RAYTRACING_GEOMETRY_FLAGS GeometryFlags;
+        RAYTRACING_BUILD_AS_FLAGS BuildFlags;
+    };
+
+    void CreateBuffers(const std::vector<std::vector<Uint8>>& Data, const char* Name, std::vector<RefCntAutoPtr<IBuffer>>& Buffers);
+
+    RefCntAutoPtr<IRenderDevice> m_pDevice;
+    const Uint64                 m_ImmediateContextMask;
+
+    GeometryPacker        m_Packer;
+    std::vector<MeshInfo> m_Meshes;
+
+    std::vector<RefCntAutoPtr<IBuffer>>        m_VertexBuffers;
+    std::vector<RefCntAutoPtr<IBuffer>>        m_IndexBuffers;
+    std::vector<RefCntAutoPtr<IBottomLevelAS>> m_BLASes;
+};
+
+} // namespace Diligent
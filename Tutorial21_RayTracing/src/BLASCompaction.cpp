@@ -0,0 +1,135 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "BLASCompaction.hpp"
+
+#include <string>
+#include <vector>
+
+#include "MapHelper.hpp"
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+void CompactBLASes(IRenderDevice*                       pDevice,
+                   IDeviceContext*                      pContext,
+                   Uint64                               ImmediateContextMask,
+                   RefCntAutoPtr<IBottomLevelAS>* const ppBLASes[],
+                   Uint32                               NumBLASes,
+                   Uint64*                              pCompactedSizes)
+{
+    if (NumBLASes == 0)
+        return;
+
+    // Compacted sizes of all BLASes are gathered in one buffer and read back with a single copy.
+    RefCntAutoPtr<IBuffer> pSizeBuffer;
+    RefCntAutoPtr<IBuffer> pReadbackBuffer;
+    {
+        BufferDesc BuffDesc;
+        BuffDesc.Name                 = "BLAS compacted sizes";
+        BuffDesc.Usage                = USAGE_DEFAULT;
+        BuffDesc.BindFlags            = BIND_UNORDERED_ACCESS;
+        BuffDesc.Size                 = sizeof(Uint64) * NumBLASes;
+        BuffDesc.ImmediateContextMask = ImmediateContextMask;
+
+        pDevice->CreateBuffer(BuffDesc, nullptr, &pSizeBuffer);
+        VERIFY_EXPR(pSizeBuffer != nullptr);
+
+        BuffDesc.Name           = "BLAS compacted sizes readback";
+        BuffDesc.Usage          = USAGE_STAGING;
+        BuffDesc.BindFlags      = BIND_NONE;
+        BuffDesc.CPUAccessFlags = CPU_ACCESS_READ;
+
+        pDevice->CreateBuffer(BuffDesc, nullptr, &pReadbackBuffer);
+        VERIFY_EXPR(pReadbackBuffer != nullptr);
+    }
+
+    for (Uint32 i = 0; i < NumBLASes; ++i)
+    {
+        VERIFY((ppBLASes[i]->RawPtr()->GetDesc().Flags & RAYTRACING_BUILD_AS_ALLOW_COMPACTION) != 0,
+               "BLAS must be built with RAYTRACING_BUILD_AS_ALLOW_COMPACTION flag");
+
+        WriteBLASCompactedSizeAttribs Attribs;
+        Attribs.pBLAS                = *ppBLASes[i];
+        Attribs.pDestBuffer          = pSizeBuffer;
+        Attribs.DestBufferOffset     = sizeof(Uint64) * i;
+        Attribs.BLASTransitionMode   = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
+        Attribs.BufferTransitionMode = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
+        pContext->WriteBLASCompactedSize(Attribs);
+    }
+
+    pContext->CopyBuffer(pSizeBuffer, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
+                         pReadbackBuffer, 0, sizeof(Uint64) * NumBLASes,
+                         RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    pContext->WaitForIdle();
+
+    std::vector<Uint64> CompactedSizes(NumBLASes);
+    {
+        MapHelper<Uint64> Sizes{pContext, pReadbackBuffer, MAP_READ, MAP_FLAG_DO_NOT_WAIT};
+        for (Uint32 i = 0; i < NumBLASes; ++i)
+            CompactedSizes[i] = Sizes[i];
+    }
+
+    std::vector<StateTransitionDesc> Barriers;
+    Barriers.reserve(NumBLASes);
+    for (Uint32 i = 0; i < NumBLASes; ++i)
+    {
+        auto& pBLAS = *ppBLASes[i];
+
+        const auto Name = std::string{pBLAS->GetDesc().Name} + " (compacted)";
+
+        BottomLevelASDesc ASDesc;
+        ASDesc.Name                 = Name.c_str();
+        ASDesc.CompactedSize        = CompactedSizes[i];
+        ASDesc.ImmediateContextMask = ImmediateContextMask;
+
+        RefCntAutoPtr<IBottomLevelAS> pCompactedBLAS;
+        pDevice->CreateBLAS(ASDesc, &pCompactedBLAS);
+        VERIFY_EXPR(pCompactedBLAS != nullptr);
+
+        // Geometry descriptions are copied along with the data, so hit groups can still
+        // be bound by geometry name.
+        CopyBLASAttribs CopyAttribs;
+        CopyAttribs.pSrc              = pBLAS;
+        CopyAttribs.pDst              = pCompactedBLAS;
+        CopyAttribs.Mode              = COPY_AS_MODE_COMPACT;
+        CopyAttribs.SrcTransitionMode = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
+        CopyAttribs.DstTransitionMode = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
+        pContext->CopyBLAS(CopyAttribs);
+
+        // The original BLAS is kept alive by the engine until the copy completes.
+        pBLAS = pCompactedBLAS;
+        Barriers.emplace_back(pBLAS, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_BUILD_AS_READ, STATE_TRANSITION_FLAG_UPDATE_STATE);
+
+        if (pCompactedSizes != nullptr)
+            pCompactedSizes[i] = CompactedSizes[i];
+    }
+    pContext->TransitionResourceStates(static_cast<Uint32>(Barriers.size()), Barriers.data());
+}
+
+} // namespace Diligent
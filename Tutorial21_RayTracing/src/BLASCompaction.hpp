@@ -0,0 +1,52 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include "RenderDevice.h"
+#include "DeviceContext.h"
+#include "BottomLevelAS.h"
+#include "RefCntAutoPtr.hpp"
+
+namespace Diligent
+{
+
+/// Replaces every BLAS in ppBLASes with its compacted copy.
+
+/// All BLASes must have been built with RAYTRACING_BUILD_AS_ALLOW_COMPACTION. Compacted sizes
+/// are written by the GPU and read back on the CPU, so the function waits until pContext
+/// becomes idle; it is intended for load time. The original BLASes are released and
+/// compacted BLASes are left in RESOURCE_STATE_BUILD_AS_READ. If pCompactedSizes is not null,
+/// it receives the size in bytes of each compacted BLAS.
+void CompactBLASes(IRenderDevice*                       pDevice,
+                   IDeviceContext*                      pContext,
+                   Uint64                               ImmediateContextMask,
+                   RefCntAutoPtr<IBottomLevelAS>* const ppBLASes[],
+                   Uint32                               NumBLASes,
+                   Uint64*                              pCompactedSizes = nullptr);
+
+} // namespace Diligent
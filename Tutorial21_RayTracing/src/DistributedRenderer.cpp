@@ -0,0 +1,869 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "DistributedRenderer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <random>
+#include <string>
+#include <type_traits>
+
+// Workers are separate processes, which only desktop POSIX platforms support.
+#if PLATFORM_LINUX || PLATFORM_MACOS
+#    define DISTRIBUTED_RENDERER_WORKERS 1
+#    include <cerrno>
+#    include <climits>
+#    include <csignal>
+#    include <cstdlib>
+#    include <fcntl.h>
+#    include <netdb.h>
+#    include <netinet/in.h>
+#    include <poll.h>
+#    include <spawn.h>
+#    include <sys/socket.h>
+#    include <sys/time.h>
+#    include <sys/wait.h>
+#    include <unistd.h>
+#    if PLATFORM_MACOS
+#        include <mach-o/dyld.h>
+#    endif
+extern char** environ;
+#else
+#    define DISTRIBUTED_RENDERER_WORKERS 0
+#endif
+
+#include "Errors.hpp"
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+enum MESSAGE_TYPE : Uint32
+{
+    MESSAGE_TYPE_HELLO = 1,   // First message of a worker with the token of the coordinator
+    MESSAGE_TYPE_SCENE,       // Serialized scene, see SerializeScene()
+    MESSAGE_TYPE_TILE,        // TileMessage
+    MESSAGE_TYPE_TILE_RESULT, // Tile index followed by the tile pixels
+    MESSAGE_TYPE_QUIT
+};
+
+struct MessageHeader
+{
+    Uint32 Type = 0;
+    Uint32 Size = 0; // Payload size in bytes
+};
+
+struct TileMessage
+{
+    Uint32               Index       = 0;
+    Uint32               ImageWidth  = 0;
+    Uint32               ImageHeight = 0;
+    SoftwareTracer::Tile Tile;
+};
+
+constexpr Uint32 SceneMagic   = 0x43535254; // 'TRSC'
+constexpr Uint32 SceneVersion = 1;
+
+// Tiles sent to a worker before it returns the first one, so that it never waits for the next tile.
+constexpr size_t MaxTilesInFlight = 2;
+
+// Sizes come from the other process, so a worker never allocates more than this for a scene.
+// The coordinator only accepts tile results of the exact size of the tile.
+constexpr Uint32 MaxSceneMessageSize = 1u << 30;
+
+// Time a worker has to send its token after it is started or has connected.
+constexpr Uint32 HandshakeTimeoutMs = 10000;
+
+class SceneWriter
+{
+public:
+    explicit SceneWriter(std::vector<Uint8>& Data) :
+        m_Data{Data}
+    {}
+
+    template <typename T>
+    void Write(const T& Value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable types can be serialized");
+        const auto* pBytes = reinterpret_cast<const Uint8*>(&Value);
+        m_Data.insert(m_Data.end(), pBytes, pBytes + sizeof(T));
+    }
+
+    template <typename T>
+    void WriteArray(const std::vector<T>& Values)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable types can be serialized");
+        Write(static_cast<Uint32>(Values.size()));
+        const auto* pBytes = reinterpret_cast<const Uint8*>(Values.data());
+        m_Data.insert(m_Data.end(), pBytes, pBytes + Values.size() * sizeof(T));
+    }
+
+private:
+    std::vector<Uint8>& m_Data;
+};
+
+class SceneReader
+{
+public:
+    SceneReader(const Uint8* pData, size_t Size) :
+        m_pData{pData},
+        m_Size{Size}
+    {}
+
+    template <typename T>
+    bool Read(T& Value)
+    {
+        if (m_Size - m_Offset < sizeof(T))
+            return false;
+        std::memcpy(&Value, m_pData + m_Offset, sizeof(T));
+        m_Offset += sizeof(T);
+        return true;
+    }
+
+    template <typename T>
+    bool ReadArray(std::vector<T>& Values)
+    {
+        Uint32 Count = 0;
+        if (!Read(Count) || (m_Size - m_Offset) / sizeof(T) < Count)
+            return false;
+        Values.resize(Count);
+        std::memcpy(Values.data(), m_pData + m_Offset, Count * sizeof(T));
+        m_Offset += Count * sizeof(T);
+        return true;
+    }
+
+    bool IsEnd() const { return m_Offset == m_Size; }
+
+private:
+    const Uint8* m_pData  = nullptr;
+    size_t       m_Size   = 0;
+    size_t       m_Offset = 0;
+};
+
+std::vector<SoftwareTracer::Tile> SplitImage(Uint32 Width, Uint32 Height, Uint32 TileSize)
+{
+    std::vector<SoftwareTracer::Tile> Tiles;
+    for (Uint32 y = 0; y < Height; y += TileSize)
+    {
+        for (Uint32 x = 0; x < Width; x += TileSize)
+        {
+            SoftwareTracer::Tile T;
+            T.X      = x;
+            T.Y      = y;
+            T.Width  = std::min(TileSize, Width - x);
+            T.Height = std::min(TileSize, Height - y);
+            Tiles.push_back(T);
+        }
+    }
+    return Tiles;
+}
+
+void CopyTile(const SoftwareTracer::Tile& T, const float4* pTilePixels, Uint32 ImageWidth, float4* pPixels)
+{
+    for (Uint32 y = 0; y < T.Height; ++y)
+        std::copy_n(pTilePixels + size_t{y} * T.Width, T.Width, pPixels + size_t{T.Y + y} * ImageWidth + T.X);
+}
+
+#if DISTRIBUTED_RENDERER_WORKERS
+
+bool WriteAll(int Socket, const void* pData, size_t Size)
+{
+    const auto* pBytes = static_cast<const Uint8*>(pData);
+    while (Size > 0)
+    {
+#    ifdef MSG_NOSIGNAL
+        // A worker that exited must not kill the coordinator with SIGPIPE.
+        const auto Written = send(Socket, pBytes, Size, MSG_NOSIGNAL);
+#    else
+        const auto Written = send(Socket, pBytes, Size, 0);
+#    endif
+        if (Written < 0 && errno == EINTR)
+            continue;
+        if (Written <= 0)
+            return false;
+        pBytes += Written;
+        Size -= static_cast<size_t>(Written);
+    }
+    return true;
+}
+
+bool ReadAll(int Socket, void* pData, size_t Size)
+{
+    auto* pBytes = static_cast<Uint8*>(pData);
+    while (Size > 0)
+    {
+        const auto Read = recv(Socket, pBytes, Size, 0);
+        if (Read < 0 && errno == EINTR)
+            continue;
+        if (Read <= 0)
+            return false;
+        pBytes += Read;
+        Size -= static_cast<size_t>(Read);
+    }
+    return true;
+}
+
+// The payload may be split in two parts to avoid copying the tile pixels.
+bool SendMessage(int Socket, MESSAGE_TYPE Type, const void* pPayload, size_t PayloadSize, const void* pPayload2 = nullptr, size_t PayloadSize2 = 0)
+{
+    MessageHeader Header;
+    Header.Type = Type;
+    Header.Size = static_cast<Uint32>(PayloadSize + PayloadSize2);
+    return WriteAll(Socket, &Header, sizeof(Header)) &&
+        (PayloadSize == 0 || WriteAll(Socket, pPayload, PayloadSize)) &&
+        (PayloadSize2 == 0 || WriteAll(Socket, pPayload2, PayloadSize2));
+}
+
+// Messages with a payload larger than MaxPayloadSize fail before anything is allocated.
+bool ReceiveMessage(int Socket, MESSAGE_TYPE& Type, std::vector<Uint8>& Payload, size_t MaxPayloadSize)
+{
+    MessageHeader Header;
+    if (!ReadAll(Socket, &Header, sizeof(Header)) || Header.Size > MaxPayloadSize)
+        return false;
+    Type = static_cast<MESSAGE_TYPE>(Header.Type);
+    Payload.resize(Header.Size);
+    return Header.Size == 0 || ReadAll(Socket, Payload.data(), Header.Size);
+}
+
+// Message loop of a worker process. Returns true when the coordinator quits and false when the connection fails.
+bool ProcessMessages(int Socket)
+{
+    std::unique_ptr<SoftwareTracer> pTracer;
+    std::vector<Uint8>              Payload;
+    std::vector<float4>             Pixels;
+    MESSAGE_TYPE                    Type = MESSAGE_TYPE_QUIT;
+    while (ReceiveMessage(Socket, Type, Payload, MaxSceneMessageSize))
+    {
+        if (Type == MESSAGE_TYPE_SCENE)
+        {
+            SoftwareTracer::Scene Scene;
+            if (!DistributedRenderer::DeserializeScene(Payload.data(), Payload.size(), Scene))
+                return false;
+            pTracer = std::make_unique<SoftwareTracer>(std::move(Scene));
+        }
+        else if (Type == MESSAGE_TYPE_TILE)
+        {
+            TileMessage Msg;
+            if (!pTracer || Payload.size() != sizeof(Msg))
+                return false;
+            std::memcpy(&Msg, Payload.data(), sizeof(Msg));
+
+            Pixels.resize(size_t{Msg.Tile.Width} * Msg.Tile.Height);
+            pTracer->RenderTile(Msg.ImageWidth, Msg.ImageHeight, Msg.Tile, Pixels.data());
+            if (!SendMessage(Socket, MESSAGE_TYPE_TILE_RESULT, &Msg.Index, sizeof(Msg.Index), Pixels.data(), Pixels.size() * sizeof(float4)))
+                return false;
+        }
+        else
+        {
+            return Type == MESSAGE_TYPE_QUIT;
+        }
+    }
+    return false;
+}
+
+// Waits for the first message of a new worker, which must be the token of the coordinator.
+bool ReceiveHello(int Socket, Uint64 Token)
+{
+    // A peer that stops sending in the middle of the message must not block the coordinator.
+    timeval Timeout = {};
+    Timeout.tv_sec  = HandshakeTimeoutMs / 1000;
+    Timeout.tv_usec = (HandshakeTimeoutMs % 1000) * 1000;
+    setsockopt(Socket, SOL_SOCKET, SO_RCVTIMEO, &Timeout, sizeof(Timeout));
+
+    pollfd             Fd   = {Socket, POLLIN, 0};
+    MESSAGE_TYPE       Type = MESSAGE_TYPE_QUIT;
+    std::vector<Uint8> Payload;
+    Uint64             WorkerToken = 0;
+    const bool         Success     = poll(&Fd, 1, static_cast<int>(HandshakeTimeoutMs)) > 0 &&
+        ReceiveMessage(Socket, Type, Payload, sizeof(WorkerToken)) &&
+        Type == MESSAGE_TYPE_HELLO && Payload.size() == sizeof(WorkerToken) &&
+        std::memcmp(Payload.data(), &Token, sizeof(Token)) == 0;
+
+    Timeout = {};
+    setsockopt(Socket, SOL_SOCKET, SO_RCVTIMEO, &Timeout, sizeof(Timeout));
+    return Success;
+}
+
+// Path of the running executable, which local workers are started from.
+std::string GetExecutablePath()
+{
+#    if PLATFORM_LINUX
+    char       Path[PATH_MAX];
+    const auto Length = readlink("/proc/self/exe", Path, sizeof(Path) - 1);
+    return Length > 0 ? std::string{Path, static_cast<size_t>(Length)} : std::string{};
+#    else
+    char     Path[PATH_MAX];
+    uint32_t Size = sizeof(Path);
+    return _NSGetExecutablePath(Path, &Size) == 0 ? std::string{Path} : std::string{};
+#    endif
+}
+
+// Connects to a coordinator that accepts workers with DistributedRenderer::AcceptWorkers().
+int ConnectToCoordinator(const std::string& Host, const std::string& Port)
+{
+    addrinfo Hints    = {};
+    Hints.ai_family   = AF_UNSPEC;
+    Hints.ai_socktype = SOCK_STREAM;
+
+    addrinfo* pAddresses = nullptr;
+    if (getaddrinfo(Host.c_str(), Port.c_str(), &Hints, &pAddresses) != 0)
+        return -1;
+
+    int Socket = -1;
+    for (const auto* pAddr = pAddresses; pAddr != nullptr && Socket < 0; pAddr = pAddr->ai_next)
+    {
+        Socket = socket(pAddr->ai_family, pAddr->ai_socktype, pAddr->ai_protocol);
+        if (Socket >= 0 && connect(Socket, pAddr->ai_addr, pAddr->ai_addrlen) != 0)
+        {
+            close(Socket);
+            Socket = -1;
+        }
+    }
+    freeaddrinfo(pAddresses);
+    return Socket;
+}
+
+#endif
+
+} // namespace
+
+struct DistributedRenderer::Worker
+{
+#if DISTRIBUTED_RENDERER_WORKERS
+    int   Socket = -1;
+    pid_t Pid    = -1;
+#endif
+    std::deque<Uint32> InFlight; // Indices of the tiles sent to the worker
+};
+
+DistributedRenderer::DistributedRenderer()
+{
+    // Workers of other runs or other programs that connect to the port do not know the token.
+    std::random_device Rd;
+    m_Token = (Uint64{Rd()} << 32u) | Uint64{Rd()};
+}
+
+DistributedRenderer::~DistributedRenderer()
+{
+    Stop();
+}
+
+Uint32 DistributedRenderer::Start(Uint32 NumWorkers)
+{
+    Stop();
+
+#if DISTRIBUTED_RENDERER_WORKERS
+    const auto ExePath = GetExecutablePath();
+    if (NumWorkers > 0 && ExePath.empty())
+    {
+        LOG_ERROR_MESSAGE("Failed to find the executable to start render workers from");
+        return 0;
+    }
+
+    // Workers are new instances of the executable started with --render-worker rather than
+    // forks, which would copy the threads and the device state of the calling process.
+    for (Uint32 i = 0; i < NumWorkers; ++i)
+    {
+        int Sockets[2] = {-1, -1};
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, Sockets) != 0)
+        {
+            LOG_ERROR_MESSAGE("Failed to create a socket pair for a render worker");
+            break;
+        }
+        // Only the worker end of the new pair is inherited, so workers never hold the connections
+        // of other workers and see the coordinator close them.
+        fcntl(Sockets[0], F_SETFD, FD_CLOEXEC);
+
+        const auto  Connection = std::to_string(Sockets[1]);
+        const auto  Token      = GetToken();
+        char* const Args[]     = {const_cast<char*>(ExePath.c_str()), const_cast<char*>("--render-worker"),
+                                  const_cast<char*>(Connection.c_str()), const_cast<char*>(Token.c_str()), nullptr};
+
+        pid_t Pid = -1;
+        if (posix_spawn(&Pid, ExePath.c_str(), nullptr, nullptr, Args, environ) != 0)
+        {
+            LOG_ERROR_MESSAGE("Failed to start render worker process '", ExePath, "'");
+            close(Sockets[0]);
+            close(Sockets[1]);
+            break;
+        }
+
+        close(Sockets[1]);
+        Worker W;
+        W.Socket = Sockets[0];
+        W.Pid    = Pid;
+        m_Workers.push_back(std::move(W));
+    }
+
+    // Local workers go through the same handshake as remote ones.
+    for (size_t w = m_Workers.size(); w-- > 0;)
+    {
+        auto& W = m_Workers[w];
+        if (ReceiveHello(W.Socket, m_Token))
+            continue;
+
+        LOG_ERROR_MESSAGE("Render worker process ", W.Pid, " did not start");
+        close(W.Socket);
+        kill(W.Pid, SIGTERM);
+        waitpid(W.Pid, nullptr, 0);
+        m_Workers.erase(m_Workers.begin() + w);
+    }
+
+    SendScene(0);
+#else
+    if (NumWorkers > 0)
+        LOG_WARNING_MESSAGE("Render worker processes are not supported on this platform. Images are rendered in the calling process.");
+#endif
+
+    return static_cast<Uint32>(m_Workers.size());
+}
+
+Uint32 DistributedRenderer::AcceptWorkers(const char* Host, Uint16 Port, Uint32 NumWorkers, Uint32 TimeoutMs)
+{
+    // Other machines can only connect if the caller explicitly gives an address they can reach.
+    const std::string ListenHost{Host != nullptr && *Host != '\0' ? Host : "127.0.0.1"};
+
+    Uint32 NumAccepted = 0;
+#if DISTRIBUTED_RENDERER_WORKERS
+    addrinfo Hints    = {};
+    Hints.ai_family   = AF_UNSPEC;
+    Hints.ai_socktype = SOCK_STREAM;
+    Hints.ai_flags    = AI_PASSIVE;
+
+    addrinfo* pAddresses = nullptr;
+    if (getaddrinfo(ListenHost.c_str(), std::to_string(Port).c_str(), &Hints, &pAddresses) != 0)
+    {
+        LOG_ERROR_MESSAGE("Failed to resolve '", ListenHost, "' to listen for remote render workers");
+        return 0;
+    }
+
+    int Listener = -1;
+    for (const auto* pAddr = pAddresses; pAddr != nullptr && Listener < 0; pAddr = pAddr->ai_next)
+    {
+        Listener = socket(pAddr->ai_family, pAddr->ai_socktype, pAddr->ai_protocol);
+        if (Listener < 0)
+            continue;
+        fcntl(Listener, F_SETFD, FD_CLOEXEC);
+
+        const int ReuseAddr = 1;
+        setsockopt(Listener, SOL_SOCKET, SO_REUSEADDR, &ReuseAddr, sizeof(ReuseAddr));
+        if (bind(Listener, pAddr->ai_addr, pAddr->ai_addrlen) != 0 || listen(Listener, static_cast<int>(NumWorkers)) != 0)
+        {
+            close(Listener);
+            Listener = -1;
+        }
+    }
+    freeaddrinfo(pAddresses);
+    if (Listener < 0)
+    {
+        LOG_ERROR_MESSAGE("Failed to listen for remote render workers on ", ListenHost, ":", Port);
+        return 0;
+    }
+
+    const auto FirstWorker = m_Workers.size();
+    const auto Deadline    = std::chrono::steady_clock::now() + std::chrono::milliseconds{TimeoutMs};
+    while (NumAccepted < NumWorkers)
+    {
+        const auto RemainingMs = std::chrono::duration_cast<std::chrono::milliseconds>(Deadline - std::chrono::steady_clock::now()).count();
+        pollfd     Fd          = {Listener, POLLIN, 0};
+        if (RemainingMs <= 0 || poll(&Fd, 1, static_cast<int>(RemainingMs)) <= 0)
+            break;
+
+        const int Socket = accept(Listener, nullptr, nullptr);
+        if (Socket < 0)
+            continue;
+        fcntl(Socket, F_SETFD, FD_CLOEXEC);
+
+        if (!ReceiveHello(Socket, m_Token))
+        {
+            LOG_WARNING_MESSAGE("Rejected a connection to port ", Port, " that did not send the token of this run");
+            close(Socket);
+            continue;
+        }
+
+        // Remote workers are not child processes and are only disconnected by Stop().
+        Worker W;
+        W.Socket = Socket;
+        m_Workers.push_back(std::move(W));
+        ++NumAccepted;
+    }
+    close(Listener);
+
+    SendScene(FirstWorker);
+#else
+    (void)TimeoutMs;
+    if (NumWorkers > 0)
+        LOG_WARNING_MESSAGE("Remote render workers are not supported on this platform. Images are rendered in the calling process.");
+#endif
+
+    if (NumAccepted < NumWorkers)
+        LOG_WARNING_MESSAGE("Only ", NumAccepted, " of ", NumWorkers, " remote render workers connected to port ", Port);
+    return NumAccepted;
+}
+
+void DistributedRenderer::Stop()
+{
+#if DISTRIBUTED_RENDERER_WORKERS
+    for (auto& W : m_Workers)
+    {
+        SendMessage(W.Socket, MESSAGE_TYPE_QUIT, nullptr, 0);
+        close(W.Socket);
+        if (W.Pid > 0)
+            waitpid(W.Pid, nullptr, 0);
+    }
+#endif
+    m_Workers.clear();
+}
+
+bool DistributedRenderer::RunWorker(const char* Connection, const char* Token)
+{
+#if DISTRIBUTED_RENDERER_WORKERS
+    char*        pTokenEnd   = nullptr;
+    const Uint64 WorkerToken = Token != nullptr ? std::strtoull(Token, &pTokenEnd, 16) : 0;
+    if (Token == nullptr || *Token == '\0' || *pTokenEnd != '\0')
+    {
+        LOG_ERROR_MESSAGE("Render worker token '", (Token != nullptr ? Token : ""), "' is not valid");
+        return false;
+    }
+
+    // Local workers inherit their end of a socket pair, remote workers connect to the coordinator.
+    const std::string Address{Connection != nullptr ? Connection : ""};
+    const auto        PortPos = Address.rfind(':');
+
+    int Socket = -1;
+    if (PortPos == std::string::npos)
+    {
+        char* pEnd = nullptr;
+        Socket     = static_cast<int>(std::strtol(Address.c_str(), &pEnd, 10));
+        if (Address.empty() || *pEnd != '\0')
+            Socket = -1;
+    }
+    else
+    {
+        Socket = ConnectToCoordinator(Address.substr(0, PortPos), Address.substr(PortPos + 1));
+    }
+    if (Socket < 0)
+    {
+        LOG_ERROR_MESSAGE("Failed to connect render worker to '", Address, "'");
+        return false;
+    }
+
+    const bool Success = SendMessage(Socket, MESSAGE_TYPE_HELLO, &WorkerToken, sizeof(WorkerToken)) && ProcessMessages(Socket);
+    close(Socket);
+    return Success;
+#else
+    (void)Connection;
+    (void)Token;
+    LOG_ERROR_MESSAGE("Render workers are not supported on this platform");
+    return false;
+#endif
+}
+
+Uint32 DistributedRenderer::GetNumWorkers() const
+{
+    return static_cast<Uint32>(m_Workers.size());
+}
+
+std::string DistributedRenderer::GetToken() const
+{
+    char Token[17] = {};
+    std::snprintf(Token, sizeof(Token), "%016llx", static_cast<unsigned long long>(m_Token));
+    return Token;
+}
+
+void DistributedRenderer::SetScene(const SoftwareTracer::Scene& Scene)
+{
+    m_SceneData.clear();
+    SerializeScene(Scene, m_SceneData);
+    m_pLocalTracer.reset();
+    SendScene(0);
+}
+
+void DistributedRenderer::SendScene(size_t FirstWorker)
+{
+#if DISTRIBUTED_RENDERER_WORKERS
+    if (m_SceneData.empty())
+        return;
+    for (size_t w = FirstWorker; w < m_Workers.size(); ++w)
+        SendMessage(m_Workers[w].Socket, MESSAGE_TYPE_SCENE, m_SceneData.data(), m_SceneData.size());
+#else
+    (void)FirstWorker;
+#endif
+}
+
+void DistributedRenderer::Render(Uint32 Width, Uint32 Height, Uint32 TileSize, float4* pPixels)
+{
+    VERIFY(!m_SceneData.empty(), "The scene must be set before rendering");
+
+    const auto StartTime = std::chrono::high_resolution_clock::now();
+    TileSize             = std::max(TileSize, 1u);
+    const auto Tiles     = SplitImage(Width, Height, TileSize);
+
+    m_Stats          = {};
+    m_Stats.NumTiles = static_cast<Uint32>(Tiles.size());
+    m_Stats.TilesPerWorker.assign(m_Workers.size(), 0);
+
+    std::deque<Uint32> Pending;
+    for (Uint32 i = 0; i < Tiles.size(); ++i)
+        Pending.push_back(i);
+
+#if DISTRIBUTED_RENDERER_WORKERS
+    // A worker that fails returns its tiles to the queue and takes no more tiles.
+    std::vector<bool> IsAlive(m_Workers.size(), true);
+    const auto        DropWorker = [&](size_t w) {
+        LOG_WARNING_MESSAGE("Render worker ", w, " stopped responding. Its tiles are rendered by the other workers.");
+        auto& W = m_Workers[w];
+        Pending.insert(Pending.end(), W.InFlight.begin(), W.InFlight.end());
+        W.InFlight.clear();
+        IsAlive[w] = false;
+    };
+
+    const size_t        MaxResultSize = sizeof(Uint32) + size_t{TileSize} * TileSize * sizeof(float4);
+    std::vector<Uint8>  Payload;
+    std::vector<pollfd> PollFds;
+    std::vector<size_t> PollWorkers;
+    Uint32              NumCompleted = 0;
+    while (NumCompleted < Tiles.size())
+    {
+        // Keep every worker busy.
+        for (size_t w = 0; w < m_Workers.size(); ++w)
+        {
+            auto& W = m_Workers[w];
+            while (IsAlive[w] && W.InFlight.size() < MaxTilesInFlight && !Pending.empty())
+            {
+                TileMessage Msg;
+                Msg.Index       = Pending.front();
+                Msg.ImageWidth  = Width;
+                Msg.ImageHeight = Height;
+                Msg.Tile        = Tiles[Msg.Index];
+                Pending.pop_front();
+                W.InFlight.push_back(Msg.Index);
+                if (!SendMessage(W.Socket, MESSAGE_TYPE_TILE, &Msg, sizeof(Msg)))
+                    DropWorker(w);
+            }
+        }
+
+        PollFds.clear();
+        PollWorkers.clear();
+        for (size_t w = 0; w < m_Workers.size(); ++w)
+        {
+            if (IsAlive[w] && !m_Workers[w].InFlight.empty())
+            {
+                PollFds.push_back({m_Workers[w].Socket, POLLIN, 0});
+                PollWorkers.push_back(w);
+            }
+        }
+        if (PollFds.empty())
+            break;
+
+        if (poll(PollFds.data(), static_cast<nfds_t>(PollFds.size()), -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            LOG_ERROR_MESSAGE("Failed to wait for render workers");
+            break;
+        }
+
+        for (size_t i = 0; i < PollFds.size(); ++i)
+        {
+            if (PollFds[i].revents == 0)
+                continue;
+
+            const size_t w    = PollWorkers[i];
+            auto&        W    = m_Workers[w];
+            MESSAGE_TYPE Type = MESSAGE_TYPE_QUIT;
+            Uint32       Idx  = 0;
+            if (!ReceiveMessage(W.Socket, Type, Payload, MaxResultSize) || Type != MESSAGE_TYPE_TILE_RESULT || Payload.size() < sizeof(Idx))
+            {
+                DropWorker(w);
+                continue;
+            }
+            std::memcpy(&Idx, Payload.data(), sizeof(Idx));
+
+            const auto InFlightIt = std::find(W.InFlight.begin(), W.InFlight.end(), Idx);
+            if (InFlightIt == W.InFlight.end() ||
+                Payload.size() != sizeof(Idx) + size_t{Tiles[Idx].Width} * Tiles[Idx].Height * sizeof(float4))
+            {
+                DropWorker(w);
+                continue;
+            }
+            W.InFlight.erase(InFlightIt);
+
+            CopyTile(Tiles[Idx], reinterpret_cast<const float4*>(Payload.data() + sizeof(Idx)), Width, pPixels);
+            ++m_Stats.TilesPerWorker[w];
+            ++NumCompleted;
+        }
+    }
+
+    // Failed workers are not restarted during the render.
+    for (size_t w = m_Workers.size(); w-- > 0;)
+    {
+        if (!IsAlive[w])
+        {
+            close(m_Workers[w].Socket);
+            if (m_Workers[w].Pid > 0)
+                waitpid(m_Workers[w].Pid, nullptr, 0);
+            m_Workers.erase(m_Workers.begin() + w);
+        }
+    }
+#endif
+
+    // Tiles that no worker took are rendered here.
+    if (!Pending.empty())
+    {
+        if (!m_pLocalTracer)
+        {
+            SoftwareTracer::Scene Scene;
+            if (!DeserializeScene(m_SceneData.data(), m_SceneData.size(), Scene))
+            {
+                LOG_ERROR_MESSAGE("Failed to restore the scene of the distributed renderer. ", Pending.size(), " tiles are not rendered.");
+                m_Stats.RenderMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - StartTime).count();
+                return;
+            }
+            m_pLocalTracer = std::make_unique<SoftwareTracer>(std::move(Scene));
+        }
+
+        if (Pending.size() == Tiles.size())
+        {
+            m_pLocalTracer->Render(Width, Height, pPixels);
+        }
+        else
+        {
+            std::vector<float4> TilePixels;
+            for (const auto Idx : Pending)
+            {
+                TilePixels.resize(size_t{Tiles[Idx].Width} * Tiles[Idx].Height);
+                m_pLocalTracer->RenderTile(Width, Height, Tiles[Idx], TilePixels.data());
+                CopyTile(Tiles[Idx], TilePixels.data(), Width, pPixels);
+            }
+        }
+        m_Stats.NumLocalTiles = static_cast<Uint32>(Pending.size());
+    }
+
+    m_Stats.RenderMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - StartTime).count();
+}
+
+void DistributedRenderer::SerializeScene(const SoftwareTracer::Scene& Scene, std::vector<Uint8>& Data)
+{
+    // Data is written in the native byte order, so all machines must have the same architecture.
+    SceneWriter Writer{Data};
+    Writer.Write(SceneMagic);
+    Writer.Write(SceneVersion);
+    Writer.Write(static_cast<Uint32>(Scene.Meshes.size()));
+    for (const auto& Mesh : Scene.Meshes)
+    {
+        Writer.WriteArray(Mesh.Vertices);
+        Writer.WriteArray(Mesh.Indices);
+    }
+    Writer.WriteArray(Scene.Materials);
+    Writer.WriteArray(Scene.Instances);
+    Writer.WriteArray(Scene.Lights);
+    Writer.Write(Scene.Constants);
+    Writer.Write(Scene.Frame);
+}
+
+bool DistributedRenderer::DeserializeScene(const Uint8* pData, size_t Size, SoftwareTracer::Scene& Scene)
+{
+    SceneReader Reader{pData, Size};
+
+    Uint32 Magic = 0, Version = 0, NumMeshes = 0;
+    if (!Reader.Read(Magic) || Magic != SceneMagic || !Reader.Read(Version) || Version != SceneVersion || !Reader.Read(NumMeshes))
+        return false;
+
+    Scene.Meshes.clear();
+    for (Uint32 i = 0; i < NumMeshes; ++i)
+    {
+        SoftwareTracer::Mesh Mesh;
+        if (!Reader.ReadArray(Mesh.Vertices) || !Reader.ReadArray(Mesh.Indices) || Mesh.Indices.size() % 3 != 0)
+            return false;
+        for (const auto Idx : Mesh.Indices)
+        {
+            if (Idx >= Mesh.Vertices.size())
+                return false;
+        }
+        Scene.Meshes.push_back(std::move(Mesh));
+    }
+
+    if (!Reader.ReadArray(Scene.Materials) ||
+        !Reader.ReadArray(Scene.Instances) ||
+        !Reader.ReadArray(Scene.Lights) ||
+        !Reader.Read(Scene.Constants) ||
+        !Reader.Read(Scene.Frame) ||
+        !Reader.IsEnd())
+        return false;
+
+    for (const auto& Mat : Scene.Materials)
+    {
+        if (Mat.Type >= SoftwareTracer::MATERIAL_TYPE_COUNT)
+            return false;
+    }
+    for (const auto& Inst : Scene.Instances)
+    {
+        if ((Inst.Geometry != SoftwareTracer::SphereGeometry && Inst.Geometry >= Scene.Meshes.size()) || Inst.Material >= Scene.Materials.size())
+            return false;
+    }
+    return true;
+}
+
+std::vector<DistributedRenderer::ScalingResult> DistributedRenderer::RunScalingBenchmark(const SoftwareTracer::Scene& Scene,
+                                                                                         Uint32                       Width,
+                                                                                         Uint32                       Height,
+                                                                                         Uint32                       MaxWorkers,
+                                                                                         Uint32                       TileSize)
+{
+    std::vector<float4>        Pixels(size_t{Width} * Height);
+    std::vector<ScalingResult> Results;
+
+    DistributedRenderer Renderer;
+    Renderer.SetScene(Scene);
+    for (Uint32 NumWorkers = 1; NumWorkers <= MaxWorkers; NumWorkers *= 2)
+    {
+        if (Renderer.Start(NumWorkers) != NumWorkers)
+            break;
+
+        Renderer.Render(Width, Height, TileSize, Pixels.data());
+
+        ScalingResult Result;
+        Result.NumWorkers = NumWorkers;
+        Result.RenderMs   = Renderer.GetLastRenderStats().RenderMs;
+        Result.Speedup    = Results.empty() ? 1.0 : Results[0].RenderMs / Result.RenderMs;
+        Result.Efficiency = Result.Speedup / NumWorkers;
+        Results.push_back(Result);
+    }
+    Renderer.Stop();
+
+    return Results;
+}
+
+} // namespace Diligent
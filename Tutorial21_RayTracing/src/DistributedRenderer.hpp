@@ -0,0 +1,134 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BasicMath.hpp"
+#include "SoftwareTracer.hpp"
+
+namespace Diligent
+{
+
+/// Renders images with SoftwareTracer in worker processes.
+
+/// The coordinator sends the scene to every worker once and then hands out tiles of the image
+/// from a queue: every worker has up to two tiles in flight and gets the next one as soon as it
+/// returns a result, so fast and slow workers stay busy until the image is done. Tiles of a
+/// worker that exits are put back into the queue, and tiles that no worker can take are
+/// rendered by the coordinator.
+///
+/// Workers only run the CPU tracer. Local workers are new instances of the executable started with
+/// --render-worker and connected through local stream sockets. Messages are length-prefixed and
+/// the scene is self-contained, so remote workers on other machines of the same architecture
+/// connect over TCP and use the same protocol, see AcceptWorkers(). The first message of every
+/// worker is the random token of the renderer, and message sizes are limited before anything is
+/// allocated. Worker processes are only supported on POSIX platforms; elsewhere, images are
+/// rendered in the calling process.
+class DistributedRenderer
+{
+public:
+    DistributedRenderer();
+    ~DistributedRenderer();
+
+    DistributedRenderer(const DistributedRenderer&) = delete;
+    DistributedRenderer& operator=(const DistributedRenderer&) = delete;
+
+    /// Starts local workers. Returns the number of workers that were started.
+    Uint32 Start(Uint32 NumWorkers);
+
+    /// Waits up to TimeoutMs for NumWorkers remote workers started with --render-worker <host>:<Port> <token>,
+    /// see GetToken(), and adds them to the running workers. Only the loopback interface is used
+    /// unless Host gives another address to listen on. Returns the number of workers that connected.
+    Uint32 AcceptWorkers(const char* Host, Uint16 Port, Uint32 NumWorkers, Uint32 TimeoutMs);
+
+    /// Stops the workers.
+    void Stop();
+
+    /// Sends the scene to the workers. The scene is used by all following renders.
+    void SetScene(const SoftwareTracer::Scene& Scene);
+
+    /// Renders the image with the color in xyz and the primary hit distance in w, see SoftwareTracer::RenderTile().
+    void Render(Uint32 Width, Uint32 Height, Uint32 TileSize, float4* pPixels);
+
+    Uint32 GetNumWorkers() const;
+
+    /// Token that workers of this renderer send in their first message, generated for every renderer.
+    std::string GetToken() const;
+
+    struct RenderStats
+    {
+        double              RenderMs         = 0;
+        Uint32              NumTiles         = 0;
+        Uint32              NumLocalTiles    = 0; ///< Tiles rendered by the coordinator
+        std::vector<Uint32> TilesPerWorker;
+    };
+    const RenderStats& GetLastRenderStats() const { return m_Stats; }
+
+    /// Serializes the scene into the message payload that workers receive.
+    static void SerializeScene(const SoftwareTracer::Scene& Scene, std::vector<Uint8>& Data);
+
+    /// Restores a serialized scene. Returns false if the data is malformed.
+    static bool DeserializeScene(const Uint8* pData, size_t Size, SoftwareTracer::Scene& Scene);
+
+    /// Runs a worker until the coordinator stops it. Connection is either the descriptor of an inherited
+    /// socket or <host>:<port> of a coordinator in AcceptWorkers(), and Token is the GetToken() of the
+    /// coordinator. Returns false if the connection fails.
+    static bool RunWorker(const char* Connection, const char* Token);
+
+    struct ScalingResult
+    {
+        Uint32 NumWorkers = 0;
+        double RenderMs   = 0;
+        double Speedup    = 0; ///< Time with one worker divided by the time with NumWorkers
+        double Efficiency = 0; ///< Speedup divided by NumWorkers
+    };
+
+    /// Renders the scene with 1, 2, 4, ... up to MaxWorkers workers and measures the scaling.
+    /// Render times include building the scene in the workers, which they do in parallel.
+    static std::vector<ScalingResult> RunScalingBenchmark(const SoftwareTracer::Scene& Scene,
+                                                          Uint32                       Width,
+                                                          Uint32                       Height,
+                                                          Uint32                       MaxWorkers,
+                                                          Uint32                       TileSize = 32);
+
+private:
+    void SendScene(size_t FirstWorker);
+
+    struct Worker;
+
+    std::vector<Worker>             m_Workers;
+    std::vector<Uint8>              m_SceneData;
+    std::unique_ptr<SoftwareTracer> m_pLocalTracer;
+    RenderStats                     m_Stats;
+    Uint64                          m_Token = 0;
+};
+
+} // namespace Diligent
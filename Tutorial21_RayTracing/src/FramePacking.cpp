@@ -0,0 +1,487 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "FramePacking.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    define FRAME_PACKING_SSE 1
+#    include <emmintrin.h>
+#else
+#    define FRAME_PACKING_SSE 0
+#endif
+
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+// BT.709 coefficients with 15 fractional bits, the same as in ReadbackPack.csh. The luma
+// coefficients sum to one. The chroma coefficients apply to the sum of a 2x2 block, so they
+// include the division by 4, and they sum to zero, so gray has no chroma.
+constexpr int LumaR = 6966;
+constexpr int LumaG = 23436;
+constexpr int LumaB = 2366;
+constexpr int CbR   = -939;
+constexpr int CbG   = -3157;
+constexpr int CbB   = 4096;
+constexpr int CrR   = 4096;
+constexpr int CrG   = -3720;
+constexpr int CrB   = -376;
+
+constexpr int LumaBias   = 1 << 14;
+constexpr int ChromaBias = (128 << 15) + (1 << 14);
+
+static_assert(LumaR + LumaG + LumaB == 1 << 15, "Luma coefficients must sum to one");
+static_assert(CbR + CbG + CbB == 0 && CrR + CrG + CrB == 0, "Chroma coefficients must sum to zero");
+
+Uint8 ClampToUint8(int v)
+{
+    return static_cast<Uint8>(std::min(std::max(v, 0), 255));
+}
+
+float EncodeSRGB(float c)
+{
+    // Also maps NaN to 0, like saturate() in the shader.
+    c = c > 0.f ? std::min(c, 1.f) : 0.f;
+    return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.f / 2.4f) - 0.055f;
+}
+
+Uint32 QuantizeSRGB(float c, float MaxValue)
+{
+    return static_cast<Uint32>(EncodeSRGB(c) * MaxValue + 0.5f);
+}
+
+// Linear 8-bit values to sRGB 8-bit values.
+const std::array<Uint8, 256>& GetSRGBTable()
+{
+    static const std::array<Uint8, 256> Table = [] {
+        std::array<Uint8, 256> t{};
+        for (Uint32 i = 0; i < 256; ++i)
+            t[i] = static_cast<Uint8>(QuantizeSRGB(static_cast<float>(i) / 255.f, 255.f));
+        return t;
+    }();
+    return Table;
+}
+
+// Rounds x * 255 / 1023 exactly without a division.
+Uint32 Convert10To8(Uint32 x)
+{
+    const Uint32 t = x * 255;
+    return (t + (t >> 10) + 512) >> 10;
+}
+
+void ConvertRGB10A2ToRGBA8Scalar(const Uint32* pSrc, size_t Begin, size_t End, Uint8* pDst)
+{
+    for (size_t i = Begin; i < End; ++i)
+    {
+        const Uint32 v = pSrc[i];
+        pDst[i * 4 + 0] = static_cast<Uint8>(Convert10To8(v & 0x3FF));
+        pDst[i * 4 + 1] = static_cast<Uint8>(Convert10To8((v >> 10) & 0x3FF));
+        pDst[i * 4 + 2] = static_cast<Uint8>(Convert10To8((v >> 20) & 0x3FF));
+        pDst[i * 4 + 3] = static_cast<Uint8>((v >> 30) * 85);
+    }
+}
+
+// Converts the 8x2 pixel block at (x0, y0). Pixels outside the image repeat the last column and row.
+void ConvertBlockYCbCr420(const Uint8* pSrc, size_t SrcStride, Uint32 Width, Uint32 Height, Uint32 x0, Uint32 y0, const YCbCr420Layout& Layout, Uint8* pDst)
+{
+    int SumR[4] = {};
+    int SumG[4] = {};
+    int SumB[4] = {};
+    for (Uint32 dy = 0; dy < 2; ++dy)
+    {
+        const Uint8* pRow = pSrc + std::min(y0 + dy, Height - 1) * SrcStride;
+        Uint8*       pY   = pDst + size_t{y0 + dy} * Layout.LumaStride + x0;
+        for (Uint32 dx = 0; dx < 8; ++dx)
+        {
+            const Uint8* p = pRow + size_t{std::min(x0 + dx, Width - 1)} * 4;
+            pY[dx]         = static_cast<Uint8>((LumaR * p[0] + LumaG * p[1] + LumaB * p[2] + LumaBias) >> 15);
+            SumR[dx / 2] += p[0];
+            SumG[dx / 2] += p[1];
+            SumB[dx / 2] += p[2];
+        }
+    }
+
+    Uint8* pCb = pDst + Layout.CbOffset + size_t{y0 / 2} * Layout.ChromaStride + x0 / 2;
+    Uint8* pCr = pDst + Layout.CrOffset + size_t{y0 / 2} * Layout.ChromaStride + x0 / 2;
+    for (Uint32 i = 0; i < 4; ++i)
+    {
+        pCb[i] = ClampToUint8((CbR * SumR[i] + CbG * SumG[i] + CbB * SumB[i] + ChromaBias) >> 15);
+        pCr[i] = ClampToUint8((CrR * SumR[i] + CrG * SumG[i] + CrB * SumB[i] + ChromaBias) >> 15);
+    }
+}
+
+#if FRAME_PACKING_SSE
+
+// Two 16-bit coefficients in a 32-bit lane for _mm_madd_epi16().
+constexpr int PackCoeffs(int Lo, int Hi)
+{
+    return static_cast<int>((static_cast<Uint32>(Hi) << 16) | (static_cast<Uint32>(Lo) & 0xFFFFu));
+}
+
+void ConvertRGB10A2ToRGBA8SSE(const Uint32* pSrc, size_t NumPixels, Uint8* pDst)
+{
+    const __m128i Mask10 = _mm_set1_epi32(0x3FF);
+    const __m128i Round  = _mm_set1_epi32(512);
+
+    const auto To8 = [&](__m128i x) {
+        const __m128i t = _mm_sub_epi32(_mm_slli_epi32(x, 8), x);
+        return _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(t, _mm_srli_epi32(t, 10)), Round), 10);
+    };
+
+    size_t i = 0;
+    for (; i + 4 <= NumPixels; i += 4)
+    {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + i));
+        const __m128i r = To8(_mm_and_si128(v, Mask10));
+        const __m128i g = To8(_mm_and_si128(_mm_srli_epi32(v, 10), Mask10));
+        const __m128i b = To8(_mm_and_si128(_mm_srli_epi32(v, 20), Mask10));
+        const __m128i a = _mm_srli_epi32(v, 30);
+        // a * 85 = a * (64 + 16 + 4 + 1)
+        const __m128i a8 = _mm_add_epi32(_mm_add_epi32(_mm_slli_epi32(a, 6), _mm_slli_epi32(a, 4)), _mm_add_epi32(_mm_slli_epi32(a, 2), a));
+
+        const __m128i RGBA = _mm_or_si128(_mm_or_si128(r, _mm_slli_epi32(g, 8)), _mm_or_si128(_mm_slli_epi32(b, 16), _mm_slli_epi32(a8, 24)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + i * 4), RGBA);
+    }
+    ConvertRGB10A2ToRGBA8Scalar(pSrc, i, NumPixels, pDst);
+}
+
+// Converts an 8x2 pixel block that is inside the image. Every 32-bit lane holds one RGBA8 pixel;
+// masking every other byte gives R and B, or G and A, as 16-bit values, which _mm_madd_epi16()
+// multiplies with a pair of coefficients and adds.
+void ConvertBlockYCbCr420SSE(const Uint8* pRow0, const Uint8* pRow1, Uint8* pY0, Uint8* pY1, Uint8* pCb, Uint8* pCr)
+{
+    const __m128i MaskRB   = _mm_set1_epi32(0x00FF00FF);
+    const __m128i LumaRB   = _mm_set1_epi32(PackCoeffs(LumaR, LumaB));
+    const __m128i LumaGA   = _mm_set1_epi32(PackCoeffs(LumaG, 0));
+    const __m128i CbRB     = _mm_set1_epi32(PackCoeffs(CbR, CbB));
+    const __m128i CbGA     = _mm_set1_epi32(PackCoeffs(CbG, 0));
+    const __m128i CrRB     = _mm_set1_epi32(PackCoeffs(CrR, CrB));
+    const __m128i CrGA     = _mm_set1_epi32(PackCoeffs(CrG, 0));
+    const __m128i LumaRnd  = _mm_set1_epi32(LumaBias);
+    const __m128i ChromaRnd = _mm_set1_epi32(ChromaBias);
+
+    const __m128i p00 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow0));
+    const __m128i p01 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow0 + 16));
+    const __m128i p10 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow1));
+    const __m128i p11 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow1 + 16));
+
+    const auto RB = [&](__m128i p) { return _mm_and_si128(p, MaskRB); };
+    const auto GA = [&](__m128i p) { return _mm_and_si128(_mm_srli_epi32(p, 8), MaskRB); };
+    const auto Dot = [](__m128i rb, __m128i ga, __m128i CoeffRB, __m128i CoeffGA, __m128i Bias) {
+        return _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(rb, CoeffRB), _mm_madd_epi16(ga, CoeffGA)), Bias), 15);
+    };
+    const auto StoreLuma = [&](__m128i Lo, __m128i Hi, Uint8* pY) {
+        const __m128i Y = _mm_packs_epi32(Dot(RB(Lo), GA(Lo), LumaRB, LumaGA, LumaRnd), Dot(RB(Hi), GA(Hi), LumaRB, LumaGA, LumaRnd));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(pY), _mm_packus_epi16(Y, Y));
+    };
+    StoreLuma(p00, p01, pY0);
+    StoreLuma(p10, p11, pY1);
+
+    // Vertical sums of the 8 columns, then horizontal sums of column pairs. Sums of four 8-bit
+    // values fit in the 16-bit halves of the lanes.
+    const auto PairSums = [](__m128i Lo, __m128i Hi) {
+        const __m128 a = _mm_castsi128_ps(Lo);
+        const __m128 b = _mm_castsi128_ps(Hi);
+        return _mm_add_epi32(_mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0))),
+                             _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1))));
+    };
+    const __m128i SumRB = PairSums(_mm_add_epi32(RB(p00), RB(p10)), _mm_add_epi32(RB(p01), RB(p11)));
+    const __m128i SumGA = PairSums(_mm_add_epi32(GA(p00), GA(p10)), _mm_add_epi32(GA(p01), GA(p11)));
+
+    const __m128i Cb     = Dot(SumRB, SumGA, CbRB, CbGA, ChromaRnd);
+    const __m128i Cr     = Dot(SumRB, SumGA, CrRB, CrGA, ChromaRnd);
+    const __m128i Chroma = _mm_packus_epi16(_mm_packs_epi32(Cb, Cr), _mm_setzero_si128());
+
+    const int CbBytes = _mm_cvtsi128_si32(Chroma);
+    const int CrBytes = _mm_cvtsi128_si32(_mm_srli_si128(Chroma, 4));
+    std::memcpy(pCb, &CbBytes, 4);
+    std::memcpy(pCr, &CrBytes, 4);
+}
+
+#endif
+
+void ConvertRGBA8ToYCbCr420Impl(const Uint8* pSrc, size_t SrcStride, Uint32 Width, Uint32 Height, Uint8* pDst, bool UseSIMD)
+{
+    VERIFY_EXPR(Width > 0 && Height > 0);
+    const auto Layout = GetYCbCr420Layout(Width, Height);
+    for (Uint32 y0 = 0; y0 < Layout.LumaHeight; y0 += 2)
+    {
+        Uint32 x0 = 0;
+#if FRAME_PACKING_SSE
+        if (UseSIMD && y0 + 1 < Height)
+        {
+            const Uint8* pRow0 = pSrc + size_t{y0} * SrcStride;
+            const Uint8* pRow1 = pRow0 + SrcStride;
+            Uint8*       pY0   = pDst + size_t{y0} * Layout.LumaStride;
+            Uint8*       pY1   = pY0 + Layout.LumaStride;
+            Uint8*       pCb   = pDst + Layout.CbOffset + size_t{y0 / 2} * Layout.ChromaStride;
+            Uint8*       pCr   = pDst + Layout.CrOffset + size_t{y0 / 2} * Layout.ChromaStride;
+            for (; x0 + 8 <= Width; x0 += 8)
+                ConvertBlockYCbCr420SSE(pRow0 + x0 * 4, pRow1 + x0 * 4, pY0 + x0, pY1 + x0, pCb + x0 / 2, pCr + x0 / 2);
+        }
+#else
+        (void)UseSIMD;
+#endif
+        // Blocks at the right and bottom edges repeat the last column and row.
+        for (; x0 < Layout.LumaStride; x0 += 8)
+            ConvertBlockYCbCr420(pSrc, SrcStride, Width, Height, x0, y0, Layout, pDst);
+    }
+}
+
+void ConvertRGB10A2ToRGBA8Impl(const Uint32* pSrc, size_t NumPixels, Uint8* pDst, bool UseSIMD)
+{
+#if FRAME_PACKING_SSE
+    if (UseSIMD)
+    {
+        ConvertRGB10A2ToRGBA8SSE(pSrc, NumPixels, pDst);
+        return;
+    }
+#else
+    (void)UseSIMD;
+#endif
+    ConvertRGB10A2ToRGBA8Scalar(pSrc, 0, NumPixels, pDst);
+}
+
+} // namespace
+
+const char* GetReadbackFormatName(READBACK_FORMAT Format)
+{
+    switch (Format)
+    {
+        case READBACK_FORMAT_NATIVE: return "Native";
+        case READBACK_FORMAT_RGBA8_SRGB: return "RGBA8 sRGB";
+        case READBACK_FORMAT_RGB10A2: return "RGB10A2";
+        case READBACK_FORMAT_YCBCR420: return "YCbCr 4:2:0";
+        default:
+            UNEXPECTED("Unknown readback format");
+            return "Unknown";
+    }
+}
+
+YCbCr420Layout GetYCbCr420Layout(Uint32 Width, Uint32 Height)
+{
+    YCbCr420Layout Layout;
+    Layout.LumaStride   = (Width + 7u) & ~7u;
+    Layout.LumaHeight   = (Height + 1u) & ~1u;
+    Layout.ChromaStride = Layout.LumaStride / 2;
+    Layout.ChromaHeight = Layout.LumaHeight / 2;
+    Layout.CbOffset     = Layout.LumaStride * Layout.LumaHeight;
+    Layout.CrOffset     = Layout.CbOffset + Layout.ChromaStride * Layout.ChromaHeight;
+    Layout.Size         = Layout.CrOffset + Layout.ChromaStride * Layout.ChromaHeight;
+    return Layout;
+}
+
+size_t GetPackedFrameSize(READBACK_FORMAT Format, Uint32 Width, Uint32 Height)
+{
+    switch (Format)
+    {
+        case READBACK_FORMAT_RGBA8_SRGB:
+        case READBACK_FORMAT_RGB10A2:
+            return size_t{Width} * Height * 4;
+
+        case READBACK_FORMAT_YCBCR420:
+            return GetYCbCr420Layout(Width, Height).Size;
+
+        default:
+            UNEXPECTED("The size of native frames depends on the texture format");
+            return 0;
+    }
+}
+
+void PackFrame(const float4* pPixels, Uint32 Width, Uint32 Height, READBACK_FORMAT Format, Uint8* pDst)
+{
+    const size_t NumPixels = size_t{Width} * Height;
+    switch (Format)
+    {
+        case READBACK_FORMAT_RGBA8_SRGB:
+            for (size_t i = 0; i < NumPixels; ++i)
+            {
+                pDst[i * 4 + 0] = static_cast<Uint8>(QuantizeSRGB(pPixels[i].x, 255.f));
+                pDst[i * 4 + 1] = static_cast<Uint8>(QuantizeSRGB(pPixels[i].y, 255.f));
+                pDst[i * 4 + 2] = static_cast<Uint8>(QuantizeSRGB(pPixels[i].z, 255.f));
+                pDst[i * 4 + 3] = 255;
+            }
+            break;
+
+        case READBACK_FORMAT_RGB10A2:
+            for (size_t i = 0; i < NumPixels; ++i)
+            {
+                const Uint32 Word = QuantizeSRGB(pPixels[i].x, 1023.f) | (QuantizeSRGB(pPixels[i].y, 1023.f) << 10) |
+                    (QuantizeSRGB(pPixels[i].z, 1023.f) << 20) | (3u << 30);
+                std::memcpy(pDst + i * 4, &Word, 4);
+            }
+            break;
+
+        case READBACK_FORMAT_YCBCR420:
+        {
+            // The shader converts the sRGB 8-bit colors, so the CPU does the same.
+            std::vector<Uint8> RGBA8(NumPixels * 4);
+            PackFrame(pPixels, Width, Height, READBACK_FORMAT_RGBA8_SRGB, RGBA8.data());
+            ConvertRGBA8ToYCbCr420(RGBA8.data(), size_t{Width} * 4, Width, Height, pDst);
+            break;
+        }
+
+        default:
+            UNEXPECTED("Native frames are not packed");
+    }
+}
+
+void ConvertLinearRGBA8ToSRGB8(const Uint8* pSrc, size_t SrcStride, Uint32 Width, Uint32 Height, Uint8* pDst, size_t DstStride)
+{
+    // SSE2 has no byte gathers, and a table lookup per channel is faster than evaluating the curve.
+    const auto& Table = GetSRGBTable();
+    for (Uint32 y = 0; y < Height; ++y)
+    {
+        const Uint8* pSrcRow = pSrc + y * SrcStride;
+        Uint8*       pDstRow = pDst + y * DstStride;
+        for (Uint32 x = 0; x < Width; ++x)
+        {
+            pDstRow[x * 4 + 0] = Table[pSrcRow[x * 4 + 0]];
+            pDstRow[x * 4 + 1] = Table[pSrcRow[x * 4 + 1]];
+            pDstRow[x * 4 + 2] = Table[pSrcRow[x * 4 + 2]];
+            pDstRow[x * 4 + 3] = pSrcRow[x * 4 + 3];
+        }
+    }
+}
+
+void ConvertRGB10A2ToRGBA8(const Uint32* pSrc, size_t NumPixels, Uint8* pDst)
+{
+    ConvertRGB10A2ToRGBA8Impl(pSrc, NumPixels, pDst, true);
+}
+
+void ConvertRGBA8ToYCbCr420(const Uint8* pSrc, size_t SrcStride, Uint32 Width, Uint32 Height, Uint8* pDst)
+{
+    ConvertRGBA8ToYCbCr420Impl(pSrc, SrcStride, Width, Height, pDst, true);
+}
+
+void ConvertYCbCr420ToRGBA8(const Uint8* pSrc, Uint32 Width, Uint32 Height, Uint8* pDst, size_t DstStride)
+{
+    const auto Layout = GetYCbCr420Layout(Width, Height);
+    for (Uint32 y = 0; y < Height; ++y)
+    {
+        const Uint8* pY   = pSrc + size_t{y} * Layout.LumaStride;
+        const Uint8* pCb  = pSrc + Layout.CbOffset + size_t{y / 2} * Layout.ChromaStride;
+        const Uint8* pCr  = pSrc + Layout.CrOffset + size_t{y / 2} * Layout.ChromaStride;
+        Uint8*       pRow = pDst + y * DstStride;
+        for (Uint32 x = 0; x < Width; ++x)
+        {
+            const float Y  = static_cast<float>(pY[x]);
+            const float Cb = static_cast<float>(pCb[x / 2]) - 128.f;
+            const float Cr = static_cast<float>(pCr[x / 2]) - 128.f;
+
+            pRow[x * 4 + 0] = ClampToUint8(static_cast<int>(std::lround(Y + 1.5748f * Cr)));
+            pRow[x * 4 + 1] = ClampToUint8(static_cast<int>(std::lround(Y - 0.18733f * Cb - 0.46812f * Cr)));
+            pRow[x * 4 + 2] = ClampToUint8(static_cast<int>(std::lround(Y + 1.8556f * Cb)));
+            pRow[x * 4 + 3] = 255;
+        }
+    }
+}
+
+FramePackingBenchmarkResult RunFramePackingBenchmark(Uint32 Width, Uint32 Height, Uint32 NumIterations)
+{
+    FramePackingBenchmarkResult Result;
+    Result.Width  = Width;
+    Result.Height = Height;
+    if (Width == 0 || Height == 0 || NumIterations == 0)
+        return Result;
+
+    // Smooth gradients with noise, like a rendered frame with a few samples per pixel.
+    const size_t        NumPixels = size_t{Width} * Height;
+    std::vector<float4> Pixels(NumPixels);
+
+    std::mt19937                          Gen{0};
+    std::uniform_real_distribution<float> Noise{-0.05f, 0.05f};
+    for (Uint32 y = 0; y < Height; ++y)
+    {
+        for (Uint32 x = 0; x < Width; ++x)
+        {
+            const float u = static_cast<float>(x) / static_cast<float>(Width);
+            const float v = static_cast<float>(y) / static_cast<float>(Height);
+
+            Pixels[size_t{y} * Width + x] = float4{u + Noise(Gen), v + Noise(Gen), (1.f - u) * v + Noise(Gen), 1.f};
+        }
+    }
+
+    std::vector<Uint8>  LinearRGBA8(NumPixels * 4), SRGB8(NumPixels * 4);
+    std::vector<Uint32> RGB10A2(NumPixels);
+    for (size_t i = 0; i < NumPixels; ++i)
+    {
+        for (int c = 0; c < 4; ++c)
+            LinearRGBA8[i * 4 + c] = static_cast<Uint8>(std::min(std::max(Pixels[i][c], 0.f), 1.f) * 255.f + 0.5f);
+    }
+    PackFrame(Pixels.data(), Width, Height, READBACK_FORMAT_RGBA8_SRGB, SRGB8.data());
+    PackFrame(Pixels.data(), Width, Height, READBACK_FORMAT_RGB10A2, reinterpret_cast<Uint8*>(RGB10A2.data()));
+
+    const auto Measure = [NumIterations](const auto& Convert) {
+        Convert();
+        const auto Start = std::chrono::high_resolution_clock::now();
+        for (Uint32 i = 0; i < NumIterations; ++i)
+            Convert();
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - Start).count() / NumIterations;
+    };
+
+    std::vector<Uint8> RGBA8Scalar(NumPixels * 4), RGBA8SIMD(NumPixels * 4);
+    const size_t       YCbCrSize = GetYCbCr420Layout(Width, Height).Size;
+    std::vector<Uint8> YCbCrScalar(YCbCrSize), YCbCrSIMD(YCbCrSize);
+
+    Result.LinearToSRGBMs = Measure([&]() {
+        ConvertLinearRGBA8ToSRGB8(LinearRGBA8.data(), size_t{Width} * 4, Width, Height, RGBA8Scalar.data(), size_t{Width} * 4);
+    });
+    Result.RGB10A2ScalarMs  = Measure([&]() { ConvertRGB10A2ToRGBA8Impl(RGB10A2.data(), NumPixels, RGBA8Scalar.data(), false); });
+    Result.RGB10A2SIMDMs    = Measure([&]() { ConvertRGB10A2ToRGBA8Impl(RGB10A2.data(), NumPixels, RGBA8SIMD.data(), true); });
+    Result.YCbCr420ScalarMs = Measure([&]() { ConvertRGBA8ToYCbCr420Impl(SRGB8.data(), size_t{Width} * 4, Width, Height, YCbCrScalar.data(), false); });
+    Result.YCbCr420SIMDMs   = Measure([&]() { ConvertRGBA8ToYCbCr420Impl(SRGB8.data(), size_t{Width} * 4, Width, Height, YCbCrSIMD.data(), true); });
+
+    Result.SIMDMatchesScalar = RGBA8Scalar == RGBA8SIMD && YCbCrScalar == YCbCrSIMD;
+
+    ConvertYCbCr420ToRGBA8(YCbCrSIMD.data(), Width, Height, RGBA8SIMD.data(), size_t{Width} * 4);
+    double SqErr = 0;
+    for (size_t i = 0; i < NumPixels; ++i)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            const double d = static_cast<double>(RGBA8SIMD[i * 4 + c]) - static_cast<double>(SRGB8[i * 4 + c]);
+            SqErr += d * d;
+        }
+    }
+    Result.YCbCr420RMSE = std::sqrt(SqErr / static_cast<double>(NumPixels * 3));
+    return Result;
+}
+
+} // namespace Diligent
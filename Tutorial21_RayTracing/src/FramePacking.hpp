@@ -0,0 +1,116 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include "BasicMath.hpp"
+
+namespace Diligent
+{
+
+/// Pixel formats of frames read back from the GPU, see FrameReadback.
+
+/// The packed formats are display-referred: colors are clamped to [0, 1] and sRGB-encoded on
+/// the GPU by ReadbackPack.csh, so fewer bytes cross the bus than with the float color buffers.
+/// The functions below pack and convert the same formats on the CPU. Integer conversions give
+/// the same bytes as the shader; float to 8-bit conversions may differ in the rounding of pow().
+enum READBACK_FORMAT : Uint8
+{
+    /// Copy of the color texture without conversion: linear RGBA8, or RGBA16F with the denoiser.
+    READBACK_FORMAT_NATIVE = 0,
+
+    /// sRGB-encoded RGBA8, 4 bytes per pixel, the input of 8-bit image encoders.
+    READBACK_FORMAT_RGBA8_SRGB,
+
+    /// sRGB-encoded 10-bit RGB and 2-bit alpha in 32 bits (R in the low bits), 4 bytes per pixel.
+    READBACK_FORMAT_RGB10A2,
+
+    /// Planar full-range BT.709 YCbCr with 2x2 subsampled chroma, 1.5 bytes per pixel,
+    /// the input of video encoders. See YCbCr420Layout.
+    READBACK_FORMAT_YCBCR420,
+
+    READBACK_FORMAT_COUNT
+};
+
+const char* GetReadbackFormatName(READBACK_FORMAT Format);
+
+/// Layout of a YCbCr 4:2:0 frame: the Y plane is followed by the Cb and the Cr plane.
+/// Planes are padded to whole 8x2 pixel blocks, so every row is a multiple of 4 bytes;
+/// padding pixels repeat the last column and row of the image.
+struct YCbCr420Layout
+{
+    Uint32 LumaStride   = 0; ///< Bytes per row of the Y plane, a multiple of 8
+    Uint32 LumaHeight   = 0; ///< Rows of the Y plane, a multiple of 2
+    Uint32 ChromaStride = 0; ///< Bytes per row of the Cb and Cr planes
+    Uint32 ChromaHeight = 0;
+    Uint32 CbOffset     = 0;
+    Uint32 CrOffset     = 0;
+    Uint32 Size         = 0; ///< Total size in bytes
+};
+
+YCbCr420Layout GetYCbCr420Layout(Uint32 Width, Uint32 Height);
+
+/// Size of a packed frame in bytes. Not defined for READBACK_FORMAT_NATIVE.
+size_t GetPackedFrameSize(READBACK_FORMAT Format, Uint32 Width, Uint32 Height);
+
+/// Packs linear colors in the given packed format like ReadbackPack.csh, e.g. to check the GPU
+/// packing or to stream frames of the CPU tracer. Rows are packed in the order of pPixels.
+void PackFrame(const float4* pPixels, Uint32 Width, Uint32 Height, READBACK_FORMAT Format, Uint8* pDst);
+
+/// Converts linear RGBA8 rows, the native readback of the color buffer, to sRGB RGBA8.
+/// Strides are in bytes.
+void ConvertLinearRGBA8ToSRGB8(const Uint8* pSrc, size_t SrcStride, Uint32 Width, Uint32 Height, Uint8* pDst, size_t DstStride);
+
+/// Converts RGB10A2 pixels to RGBA8 for 8-bit encoders.
+void ConvertRGB10A2ToRGBA8(const Uint32* pSrc, size_t NumPixels, Uint8* pDst);
+
+/// Converts sRGB RGBA8 rows to YCbCr 4:2:0 with the integer math of ReadbackPack.csh, for
+/// video encoding when the GPU does not pack the frame. pDst receives GetYCbCr420Layout() bytes.
+void ConvertRGBA8ToYCbCr420(const Uint8* pSrc, size_t SrcStride, Uint32 Width, Uint32 Height, Uint8* pDst);
+
+/// Converts a YCbCr 4:2:0 frame back to RGBA8, e.g. to preview it or to measure the packing error.
+void ConvertYCbCr420ToRGBA8(const Uint8* pSrc, Uint32 Width, Uint32 Height, Uint8* pDst, size_t DstStride);
+
+struct FramePackingBenchmarkResult
+{
+    Uint32 Width  = 0;
+    Uint32 Height = 0;
+
+    /// Time of one frame in milliseconds with the scalar and the SSE paths.
+    double LinearToSRGBMs    = 0;    ///< Table lookups, there is no separate SSE path
+    double RGB10A2ScalarMs   = 0;
+    double RGB10A2SIMDMs     = 0;
+    double YCbCr420ScalarMs  = 0;
+    double YCbCr420SIMDMs    = 0;
+    bool   SIMDMatchesScalar = true; ///< Both paths produced the same bytes
+    double YCbCr420RMSE      = 0;    ///< Error of the YCbCr round trip in 8-bit steps
+};
+
+/// Converts a synthetic frame NumIterations times with every conversion and compares the paths.
+FramePackingBenchmarkResult RunFramePackingBenchmark(Uint32 Width, Uint32 Height, Uint32 NumIterations = 10);
+
+} // namespace Diligent
@@ -0,0 +1,306 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "FrameReadback.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+#include "GraphicsTypesX.hpp"
+#include "MapHelper.hpp"
+#include "ShaderStructures.hpp"
+#include "Errors.hpp"
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+FrameReadback::FrameReadback(const CreateInfo& CI) :
+    m_pDevice{CI.pDevice},
+    m_Slots(std::max(CI.NumSlots, 1u))
+{
+    VERIFY_EXPR(CI.pDevice != nullptr && CI.pStateCache != nullptr && CI.pShaderSourceFactory != nullptr);
+
+    FenceDesc FenceCI;
+    FenceCI.Name = "Frame readback fence";
+    FenceCI.Type = FENCE_TYPE_CPU_WAIT_ONLY;
+    m_pDevice->CreateFence(FenceCI, &m_pFence);
+    VERIFY_EXPR(m_pFence != nullptr);
+
+    CreatePackPSOs(CI);
+}
+
+void FrameReadback::CreatePackPSOs(const CreateInfo& CI)
+{
+    BufferDesc BuffDesc;
+    BuffDesc.Name           = "Readback pack constant buffer";
+    BuffDesc.Size           = sizeof(HLSL::ReadbackPackConstants);
+    BuffDesc.Usage          = USAGE_DYNAMIC;
+    BuffDesc.BindFlags      = BIND_UNIFORM_BUFFER;
+    BuffDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
+
+    m_pDevice->CreateBuffer(BuffDesc, nullptr, &m_pPackCB);
+    VERIFY_EXPR(m_pPackCB != nullptr);
+
+    ShaderCreateInfo ShaderCI;
+    ShaderCI.SourceLanguage             = SHADER_SOURCE_LANGUAGE_HLSL;
+    ShaderCI.ShaderCompiler             = SHADER_COMPILER_DXC;
+    ShaderCI.CompileFlags               = SHADER_COMPILE_FLAG_PACK_MATRIX_ROW_MAJOR;
+    ShaderCI.pShaderSourceStreamFactory = CI.pShaderSourceFactory;
+    ShaderCI.Desc.ShaderType            = SHADER_TYPE_COMPUTE;
+    ShaderCI.FilePath                   = "ReadbackPack.csh";
+
+    // Every packed format is an entry point of the same shader file.
+    const auto CreatePSO = [&](READBACK_FORMAT Format, const char* Name, const char* EntryPoint) {
+        ShaderCI.Desc.Name  = Name;
+        ShaderCI.EntryPoint = EntryPoint;
+
+        RefCntAutoPtr<IShader> pCS;
+        CI.pStateCache->CreateShader(ShaderCI, &pCS);
+        VERIFY_EXPR(pCS != nullptr);
+
+        ComputePipelineStateCreateInfo PSOCreateInfo;
+        PSOCreateInfo.PSODesc.Name         = Name;
+        PSOCreateInfo.PSODesc.PipelineType = PIPELINE_TYPE_COMPUTE;
+        PSOCreateInfo.pCS                  = pCS;
+
+        PipelineResourceLayoutDescX ResourceLayout;
+        ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC;
+        ResourceLayout.AddVariable(SHADER_TYPE_COMPUTE, "g_PackCB", SHADER_RESOURCE_VARIABLE_TYPE_STATIC);
+        PSOCreateInfo.PSODesc.ResourceLayout = ResourceLayout;
+
+        auto& pPSO = m_pPackPSOs[Format];
+        CI.pStateCache->CreateComputePipelineState(PSOCreateInfo, &pPSO);
+        VERIFY_EXPR(pPSO != nullptr);
+
+        if (auto* pVar = pPSO->GetStaticVariableByName(SHADER_TYPE_COMPUTE, "g_PackCB"))
+            pVar->Set(m_pPackCB);
+
+        pPSO->CreateShaderResourceBinding(&m_pPackSRBs[Format], true);
+        VERIFY_EXPR(m_pPackSRBs[Format] != nullptr);
+    };
+    CreatePSO(READBACK_FORMAT_RGBA8_SRGB, "Readback pack RGBA8 CS", "PackRGBA8Main");
+    CreatePSO(READBACK_FORMAT_RGB10A2, "Readback pack RGB10A2 CS", "PackRGB10A2Main");
+    CreatePSO(READBACK_FORMAT_YCBCR420, "Readback pack YCbCr 4:2:0 CS", "PackYCbCr420Main");
+}
+
+bool FrameReadback::Enqueue(IDeviceContext* pContext, ITexture* pColor, READBACK_FORMAT Format, Uint64 FrameId)
+{
+    VERIFY_EXPR(pContext != nullptr && pColor != nullptr && Format < READBACK_FORMAT_COUNT);
+
+    if (m_NumPending == m_Slots.size())
+    {
+        ++m_Stats.NumDropped;
+        return false;
+    }
+
+    auto&       S        = m_Slots[m_NextSlot];
+    const auto& ColorDsc = pColor->GetDesc();
+
+    S.Info           = {};
+    S.Info.FrameId   = FrameId;
+    S.Info.Format    = Format;
+    S.Info.TexFormat = ColorDsc.Format;
+    S.Info.Width     = ColorDsc.Width;
+    S.Info.Height    = ColorDsc.Height;
+
+    // Staging resources of a free slot are no longer used by the GPU and are recreated
+    // when the size or the format changes.
+    if (Format == READBACK_FORMAT_NATIVE)
+    {
+        if (!S.pStagingTex || S.pStagingTex->GetDesc().Width != ColorDsc.Width || S.pStagingTex->GetDesc().Height != ColorDsc.Height ||
+            S.pStagingTex->GetDesc().Format != ColorDsc.Format)
+        {
+            TextureDesc TexDesc;
+            TexDesc.Name           = "Frame readback staging texture";
+            TexDesc.Type           = RESOURCE_DIM_TEX_2D;
+            TexDesc.Width          = ColorDsc.Width;
+            TexDesc.Height         = ColorDsc.Height;
+            TexDesc.Format         = ColorDsc.Format;
+            TexDesc.Usage          = USAGE_STAGING;
+            TexDesc.BindFlags      = BIND_NONE;
+            TexDesc.CPUAccessFlags = CPU_ACCESS_READ;
+
+            S.pStagingTex.Release();
+            m_pDevice->CreateTexture(TexDesc, nullptr, &S.pStagingTex);
+            VERIFY_EXPR(S.pStagingTex != nullptr);
+        }
+
+        CopyTextureAttribs CopyAttribs{pColor, RESOURCE_STATE_TRANSITION_MODE_TRANSITION, S.pStagingTex, RESOURCE_STATE_TRANSITION_MODE_TRANSITION};
+        pContext->CopyTexture(CopyAttribs);
+    }
+    else
+    {
+        const Uint64 Size = GetPackedFrameSize(Format, ColorDsc.Width, ColorDsc.Height);
+        if (!S.pStagingBuf || S.pStagingBuf->GetDesc().Size != Size)
+        {
+            BufferDesc BuffDesc;
+            BuffDesc.Name           = "Frame readback staging buffer";
+            BuffDesc.Usage          = USAGE_STAGING;
+            BuffDesc.BindFlags      = BIND_NONE;
+            BuffDesc.CPUAccessFlags = CPU_ACCESS_READ;
+            BuffDesc.Size           = Size;
+
+            S.pStagingBuf.Release();
+            m_pDevice->CreateBuffer(BuffDesc, nullptr, &S.pStagingBuf);
+            VERIFY_EXPR(S.pStagingBuf != nullptr);
+        }
+
+        Pack(pContext, pColor, Format, Size);
+        pContext->CopyBuffer(m_pPackBuffer, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
+                             S.pStagingBuf, 0, Size,
+                             RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+        S.Info.Stride = Format == READBACK_FORMAT_YCBCR420 ? GetYCbCr420Layout(ColorDsc.Width, ColorDsc.Height).LumaStride : size_t{ColorDsc.Width} * 4;
+        S.Info.Size   = static_cast<size_t>(Size);
+    }
+
+    S.FenceValue = m_NextFenceValue++;
+    pContext->EnqueueSignal(m_pFence, S.FenceValue);
+
+    m_NextSlot = (m_NextSlot + 1) % static_cast<Uint32>(m_Slots.size());
+    ++m_NumPending;
+    return true;
+}
+
+void FrameReadback::Pack(IDeviceContext* pContext, ITexture* pColor, READBACK_FORMAT Format, Uint64 Size)
+{
+    // One pack buffer is shared by all slots: the copy into the staging buffer of a frame
+    // is recorded before the packing of the next frame overwrites it.
+    if (!m_pPackBuffer || m_pPackBuffer->GetDesc().Size < Size)
+    {
+        BufferDesc BuffDesc;
+        BuffDesc.Name              = "Frame readback pack buffer";
+        BuffDesc.Usage             = USAGE_DEFAULT;
+        BuffDesc.BindFlags         = BIND_UNORDERED_ACCESS;
+        BuffDesc.Mode              = BUFFER_MODE_STRUCTURED;
+        BuffDesc.ElementByteStride = sizeof(Uint32);
+        BuffDesc.Size              = Size;
+
+        m_pPackBuffer.Release();
+        m_pDevice->CreateBuffer(BuffDesc, nullptr, &m_pPackBuffer);
+        VERIFY_EXPR(m_pPackBuffer != nullptr);
+    }
+
+    const auto& ColorDsc = pColor->GetDesc();
+    const auto  Layout   = GetYCbCr420Layout(ColorDsc.Width, ColorDsc.Height);
+    {
+        MapHelper<HLSL::ReadbackPackConstants> Consts{pContext, m_pPackCB, MAP_WRITE, MAP_FLAG_DISCARD};
+        Consts->Width      = ColorDsc.Width;
+        Consts->Height     = ColorDsc.Height;
+        Consts->LumaStride = Layout.LumaStride;
+        Consts->LumaHeight = Layout.LumaHeight;
+        Consts->CbOffset   = Layout.CbOffset;
+        Consts->CrOffset   = Layout.CrOffset;
+    }
+
+    auto* pSRB = m_pPackSRBs[Format].RawPtr();
+    pSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_Color")->Set(pColor->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
+    pSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_Output")->Set(m_pPackBuffer->GetDefaultView(BUFFER_VIEW_UNORDERED_ACCESS));
+
+    pContext->SetPipelineState(m_pPackPSOs[Format]);
+    pContext->CommitShaderResources(pSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+    // YCbCr threads convert blocks of 8x2 pixels.
+    const Uint32 ThreadsX = Format == READBACK_FORMAT_YCBCR420 ? Layout.LumaStride / 8 : ColorDsc.Width;
+    const Uint32 ThreadsY = Format == READBACK_FORMAT_YCBCR420 ? Layout.LumaHeight / 2 : ColorDsc.Height;
+    pContext->DispatchCompute(DispatchComputeAttribs{(ThreadsX + 7) / 8, (ThreadsY + 7) / 8, 1});
+}
+
+void FrameReadback::Poll(IDeviceContext* pContext, const FrameCallback& Callback)
+{
+    const Uint64 CompletedValue = m_pFence->GetCompletedValue();
+    while (m_NumPending > 0)
+    {
+        const Uint32 First = (m_NextSlot + static_cast<Uint32>(m_Slots.size()) - m_NumPending) % static_cast<Uint32>(m_Slots.size());
+        auto&        S     = m_Slots[First];
+        if (S.FenceValue > CompletedValue)
+            break;
+        ReadSlot(pContext, S, Callback);
+    }
+}
+
+void FrameReadback::Flush(IDeviceContext* pContext, const FrameCallback& Callback)
+{
+    if (m_NumPending == 0)
+        return;
+
+    // The signal is only enqueued; the commands must be submitted before waiting.
+    pContext->Flush();
+    m_pFence->Wait(m_NextFenceValue - 1);
+    Poll(pContext, Callback);
+    VERIFY_EXPR(m_NumPending == 0);
+}
+
+void FrameReadback::ReadSlot(IDeviceContext* pContext, Slot& S, const FrameCallback& Callback)
+{
+    const auto StartTime = std::chrono::high_resolution_clock::now();
+
+    // The fence guarantees that the copy is complete, so mapping never waits.
+    Frame Info = S.Info;
+    if (Info.Format == READBACK_FORMAT_NATIVE)
+    {
+        MappedTextureSubresource MappedData;
+        pContext->MapTextureSubresource(S.pStagingTex, 0, 0, MAP_READ, MAP_FLAG_DO_NOT_WAIT, nullptr, MappedData);
+        Info.pData  = static_cast<const Uint8*>(MappedData.pData);
+        Info.Stride = static_cast<size_t>(MappedData.Stride);
+        Info.Size   = Info.Stride * Info.Height;
+    }
+    else
+    {
+        PVoid pData = nullptr;
+        pContext->MapBuffer(S.pStagingBuf, MAP_READ, MAP_FLAG_DO_NOT_WAIT, pData);
+        Info.pData = static_cast<const Uint8*>(pData);
+    }
+
+    auto MapTime = std::chrono::high_resolution_clock::now() - StartTime;
+
+    S.FenceValue = 0;
+    --m_NumPending;
+
+    if (Info.pData == nullptr)
+    {
+        LOG_WARNING_MESSAGE("Failed to map frame ", Info.FrameId, " for readback");
+        return;
+    }
+
+    if (Callback)
+        Callback(Info);
+    ++m_Stats.NumFrames;
+    m_Stats.BytesRead += Info.Size;
+
+    const auto UnmapStart = std::chrono::high_resolution_clock::now();
+    if (Info.Format == READBACK_FORMAT_NATIVE)
+        pContext->UnmapTextureSubresource(S.pStagingTex, 0, 0);
+    else
+        pContext->UnmapBuffer(S.pStagingBuf, MAP_READ);
+    MapTime += std::chrono::high_resolution_clock::now() - UnmapStart;
+
+    m_Stats.MapMs += std::chrono::duration<double, std::milli>(MapTime).count();
+}
+
+} // namespace Diligent
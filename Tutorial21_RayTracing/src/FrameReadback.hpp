@@ -0,0 +1,132 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <array>
+#include <functional>
+#include <vector>
+
+#include "RenderDevice.h"
+#include "DeviceContext.h"
+#include "Fence.h"
+#include "RefCntAutoPtr.hpp"
+#include "FramePacking.hpp"
+#include "PipelineStateCache.hpp"
+
+namespace Diligent
+{
+
+/// Reads rendered frames back to the CPU without stalling the GPU.
+
+/// Every Enqueue() records a copy of the frame into one of a ring of staging resources and
+/// signals a fence; Poll() maps the slots whose copies the GPU has completed, in the order
+/// they were enqueued, and passes the frames to a callback. The CPU never waits for the GPU,
+/// so frames arrive a few frames late. If the CPU falls behind and all slots are still in
+/// use, new frames are dropped instead of waiting.
+///
+/// Packed formats are converted by ReadbackPack.csh into a shared buffer before the copy,
+/// e.g. YCbCr 4:2:0 reads back 1.5 bytes per pixel instead of 8 bytes of RGBA16F.
+class FrameReadback
+{
+public:
+    struct CreateInfo
+    {
+        IRenderDevice*                   pDevice              = nullptr;
+        PipelineStateCache*              pStateCache          = nullptr;
+        IShaderSourceInputStreamFactory* pShaderSourceFactory = nullptr;
+        Uint32                           NumSlots             = 3; ///< Frames in flight
+    };
+
+    struct Frame
+    {
+        Uint64          FrameId   = 0;
+        READBACK_FORMAT Format    = READBACK_FORMAT_NATIVE;
+        TEXTURE_FORMAT  TexFormat = TEX_FORMAT_UNKNOWN; ///< Pixel format of native frames
+        Uint32          Width     = 0;
+        Uint32          Height    = 0;
+        const Uint8*    pData     = nullptr;
+        size_t          Stride    = 0; ///< Bytes per row; of the Y plane for YCbCr frames, see YCbCr420Layout
+        size_t          Size      = 0;
+    };
+
+    struct Statistics
+    {
+        Uint64 NumFrames  = 0;
+        Uint64 NumDropped = 0; ///< Frames that were not enqueued because all slots were in use
+        Uint64 BytesRead  = 0;
+        double MapMs      = 0; ///< Total time spent mapping and unmapping
+    };
+
+    using FrameCallback = std::function<void(const Frame&)>;
+
+    explicit FrameReadback(const CreateInfo& CI);
+
+    /// Records the packing and the copy of pColor into the next slot. Returns false if the
+    /// frame was dropped. The texture must be readable by shaders for packed formats.
+    bool Enqueue(IDeviceContext* pContext, ITexture* pColor, READBACK_FORMAT Format, Uint64 FrameId);
+
+    /// Passes every frame whose copy has completed to Callback. The frame data is only valid
+    /// during the call. Never waits for the GPU.
+    void Poll(IDeviceContext* pContext, const FrameCallback& Callback);
+
+    /// Waits until all enqueued frames have been copied and passes them to Callback.
+    void Flush(IDeviceContext* pContext, const FrameCallback& Callback);
+
+    Uint32 GetNumPendingFrames() const { return m_NumPending; }
+
+    const Statistics& GetStatistics() const { return m_Stats; }
+
+private:
+    struct Slot
+    {
+        RefCntAutoPtr<ITexture> pStagingTex; ///< Native frames
+        RefCntAutoPtr<IBuffer>  pStagingBuf; ///< Packed frames
+        Frame                   Info;
+        Uint64                  FenceValue = 0;
+    };
+
+    void CreatePackPSOs(const CreateInfo& CI);
+    void Pack(IDeviceContext* pContext, ITexture* pColor, READBACK_FORMAT Format, Uint64 Size);
+    void ReadSlot(IDeviceContext* pContext, Slot& S, const FrameCallback& Callback);
+
+    RefCntAutoPtr<IRenderDevice> m_pDevice;
+    RefCntAutoPtr<IFence>        m_pFence;
+    RefCntAutoPtr<IBuffer>       m_pPackCB;
+    RefCntAutoPtr<IBuffer>       m_pPackBuffer;
+
+    std::array<RefCntAutoPtr<IPipelineState>, READBACK_FORMAT_COUNT>         m_pPackPSOs;
+    std::array<RefCntAutoPtr<IShaderResourceBinding>, READBACK_FORMAT_COUNT> m_pPackSRBs;
+
+    std::vector<Slot> m_Slots;
+    Uint32            m_NextSlot       = 0; ///< Slot of the next enqueued frame
+    Uint32            m_NumPending     = 0; ///< Enqueued frames that have not been read
+    Uint64            m_NextFenceValue = 1;
+    Statistics        m_Stats;
+};
+
+} // namespace Diligent
@@ -0,0 +1,272 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "FrameSequenceWriter.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+#include "Image.h"
+#include "MappedFile.hpp"
+#include "RefCntAutoPtr.hpp"
+#include "Errors.hpp"
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+Uint8 LinearToSRGB8(float c)
+{
+    // Also maps NaN to 0.
+    if (!(c > 0.f))
+        return 0;
+    if (c >= 1.f)
+        return 255;
+    const float s = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.f / 2.4f) - 0.055f;
+    return static_cast<Uint8>(s * 255.f + 0.5f);
+}
+
+bool EncodePNG(const FrameSequenceWriter::Frame& F, std::vector<Uint8>& Data)
+{
+    // PNG rows go from top to bottom.
+    std::vector<Uint8> RGBA(size_t{F.Width} * F.Height * 4);
+    for (Uint32 y = 0; y < F.Height; ++y)
+    {
+        const float4* pSrc = &F.Pixels[size_t{F.Height - 1 - y} * F.Width];
+        Uint8*        pDst = &RGBA[size_t{y} * F.Width * 4];
+        for (Uint32 x = 0; x < F.Width; ++x)
+        {
+            pDst[x * 4 + 0] = LinearToSRGB8(pSrc[x].x);
+            pDst[x * 4 + 1] = LinearToSRGB8(pSrc[x].y);
+            pDst[x * 4 + 2] = LinearToSRGB8(pSrc[x].z);
+            pDst[x * 4 + 3] = 255;
+        }
+    }
+
+    Image::EncodeInfo Info;
+    Info.Width      = F.Width;
+    Info.Height     = F.Height;
+    Info.TexFormat  = TEX_FORMAT_RGBA8_UNORM;
+    Info.KeepAlpha  = false;
+    Info.pData      = RGBA.data();
+    Info.Stride     = F.Width * 4;
+    Info.FileFormat = IMAGE_FILE_FORMAT_PNG;
+
+    RefCntAutoPtr<IDataBlob> pEncoded;
+    Image::Encode(Info, &pEncoded);
+    if (!pEncoded)
+        return false;
+
+    const auto* pBytes = static_cast<const Uint8*>(pEncoded->GetConstDataPtr());
+    Data.assign(pBytes, pBytes + pEncoded->GetSize());
+    return true;
+}
+
+void EncodePFM(const FrameSequenceWriter::Frame& F, std::vector<Uint8>& Data)
+{
+    // PFM rows go from bottom to top like the frame. The negative scale marks little-endian data.
+    char         Header[64];
+    const size_t HeaderSize = static_cast<size_t>(std::snprintf(Header, sizeof(Header), "PF\n%u %u\n-1.0\n", F.Width, F.Height));
+
+    const size_t NumPixels = size_t{F.Width} * F.Height;
+    Data.resize(HeaderSize + NumPixels * sizeof(float) * 3);
+    std::memcpy(Data.data(), Header, HeaderSize);
+
+    std::vector<float> RGB(NumPixels * 3);
+    for (size_t i = 0; i < NumPixels; ++i)
+    {
+        RGB[i * 3 + 0] = F.Pixels[i].x;
+        RGB[i * 3 + 1] = F.Pixels[i].y;
+        RGB[i * 3 + 2] = F.Pixels[i].z;
+    }
+    std::memcpy(Data.data() + HeaderSize, RGB.data(), RGB.size() * sizeof(float));
+}
+
+} // namespace
+
+FrameSequenceWriter::FrameSequenceWriter(const CreateInfo& CI) :
+    m_CI{CI}
+{
+    VERIFY_EXPR(m_CI.MaxQueuedFrames > 0 && m_CI.NumThreads > 0);
+
+    std::error_code ec;
+    if (!m_CI.Directory.empty())
+        std::filesystem::create_directories(m_CI.Directory, ec);
+    if (ec)
+        LOG_ERROR_MESSAGE("Failed to create output directory '", m_CI.Directory, "': ", ec.message());
+
+    for (Uint32 i = 0; i < std::max(m_CI.NumThreads, 1u); ++i)
+        m_Threads.emplace_back(&FrameSequenceWriter::WorkerThread, this);
+}
+
+FrameSequenceWriter::~FrameSequenceWriter()
+{
+    Finish();
+    {
+        std::lock_guard<std::mutex> Lock{m_Mtx};
+        m_Quit = true;
+    }
+    m_QueueCV.notify_all();
+    for (auto& Thread : m_Threads)
+        Thread.join();
+}
+
+std::vector<float4> FrameSequenceWriter::AcquirePixels(size_t NumPixels)
+{
+    std::vector<float4> Pixels;
+    {
+        std::lock_guard<std::mutex> Lock{m_Mtx};
+        if (!m_FreePixels.empty())
+        {
+            Pixels = std::move(m_FreePixels.back());
+            m_FreePixels.pop_back();
+        }
+    }
+    Pixels.resize(NumPixels);
+    return Pixels;
+}
+
+void FrameSequenceWriter::Submit(Frame&& F)
+{
+    VERIFY_EXPR(F.Pixels.size() == size_t{F.Width} * F.Height);
+
+    std::unique_lock<std::mutex> Lock{m_Mtx};
+    if (m_Queue.size() >= m_CI.MaxQueuedFrames)
+    {
+        const auto WaitStart = std::chrono::high_resolution_clock::now();
+        m_SpaceCV.wait(Lock, [this] { return m_Queue.size() < m_CI.MaxQueuedFrames; });
+        m_Stats.SubmitWaitMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - WaitStart).count();
+    }
+    m_Queue.push_back(std::move(F));
+    ++m_NumInFlight;
+    m_Stats.MaxQueuedFrames = std::max(m_Stats.MaxQueuedFrames, static_cast<Uint32>(m_Queue.size()));
+    Lock.unlock();
+    m_QueueCV.notify_one();
+}
+
+void FrameSequenceWriter::Finish()
+{
+    std::unique_lock<std::mutex> Lock{m_Mtx};
+    m_IdleCV.wait(Lock, [this] { return m_NumInFlight == 0; });
+}
+
+std::string FrameSequenceWriter::GetFilePath(Uint32 Index) const
+{
+    char Name[32];
+    std::snprintf(Name, sizeof(Name), "_%05u.%s", Index, GetFileExtension(m_CI.Format));
+    return (std::filesystem::path{m_CI.Directory} / (m_CI.FilePrefix + Name)).string();
+}
+
+FrameSequenceWriter::Stats FrameSequenceWriter::GetStats() const
+{
+    std::lock_guard<std::mutex> Lock{m_Mtx};
+    return m_Stats;
+}
+
+bool FrameSequenceWriter::EncodeFrame(const Frame& F, FILE_FORMAT Format, std::vector<Uint8>& Data)
+{
+    switch (Format)
+    {
+        case FILE_FORMAT_PNG:
+            return EncodePNG(F, Data);
+
+        case FILE_FORMAT_PFM:
+            EncodePFM(F, Data);
+            return true;
+
+        default:
+            UNEXPECTED("Unknown file format");
+            return false;
+    }
+}
+
+const char* FrameSequenceWriter::GetFileExtension(FILE_FORMAT Format)
+{
+    return Format == FILE_FORMAT_PFM ? "pfm" : "png";
+}
+
+void FrameSequenceWriter::WorkerThread()
+{
+    std::vector<Uint8> Data;
+    for (;;)
+    {
+        Frame F;
+        {
+            std::unique_lock<std::mutex> Lock{m_Mtx};
+            m_QueueCV.wait(Lock, [this] { return m_Quit || !m_Queue.empty(); });
+            if (m_Queue.empty())
+                return;
+            F = std::move(m_Queue.front());
+            m_Queue.pop_front();
+        }
+        m_SpaceCV.notify_one();
+
+        const auto EncodeStart = std::chrono::high_resolution_clock::now();
+        bool       Success     = EncodeFrame(F, m_CI.Format, Data);
+        const auto WriteStart  = std::chrono::high_resolution_clock::now();
+
+        const std::string Path = GetFilePath(F.Index);
+        if (Success)
+            Success = WriteFile(Path, Data);
+        else
+            LOG_ERROR_MESSAGE("Failed to encode frame ", F.Index);
+        const auto WriteEnd = std::chrono::high_resolution_clock::now();
+
+        {
+            std::lock_guard<std::mutex> Lock{m_Mtx};
+            m_Stats.EncodeMs += std::chrono::duration<double, std::milli>(WriteStart - EncodeStart).count();
+            m_Stats.WriteMs += std::chrono::duration<double, std::milli>(WriteEnd - WriteStart).count();
+            if (Success)
+            {
+                ++m_Stats.NumFrames;
+                m_Stats.BytesWritten += Data.size();
+            }
+            else
+            {
+                ++m_Stats.NumFailed;
+            }
+            m_FreePixels.push_back(std::move(F.Pixels));
+            --m_NumInFlight;
+        }
+        m_IdleCV.notify_all();
+    }
+}
+
+bool FrameSequenceWriter::WriteFile(const std::string& Path, const std::vector<Uint8>& Data) const
+{
+    // An interrupted sequence never leaves a truncated frame behind.
+    return WriteFileAtomic(Path.c_str(), Data.data(), Data.size());
+}
+
+} // namespace Diligent
@@ -0,0 +1,134 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BasicMath.hpp"
+
+namespace Diligent
+{
+
+/// Encodes rendered frames and writes them to numbered files on background threads.
+
+/// The renderer submits a frame and continues with the next one while the writer threads
+/// convert, encode and write the previous frames. At most MaxQueuedFrames frames wait in the
+/// queue: Submit() blocks when it is full, so a renderer that is faster than the disk cannot
+/// use unbounded memory. Pixel buffers of written frames are handed back by AcquirePixels(),
+/// so a long sequence does not allocate a new image for every frame.
+class FrameSequenceWriter
+{
+public:
+    enum FILE_FORMAT : Uint8
+    {
+        /// 8-bit sRGB PNG.
+        FILE_FORMAT_PNG = 0,
+
+        /// Portable float map: linear 32-bit float RGB without tone mapping or quantization,
+        /// for compositing or converting to EXR with external tools.
+        FILE_FORMAT_PFM
+    };
+
+    struct CreateInfo
+    {
+        std::string Directory;
+        std::string FilePrefix      = "frame";
+        FILE_FORMAT Format          = FILE_FORMAT_PNG;
+        Uint32      MaxQueuedFrames = 2;
+        Uint32      NumThreads      = 2;
+    };
+
+    /// Image with the first row at the bottom, like the color buffer of the sample.
+    /// Only the xyz components of the pixels are written.
+    struct Frame
+    {
+        Uint32              Index  = 0; ///< Number in the file name
+        Uint32              Width  = 0;
+        Uint32              Height = 0;
+        std::vector<float4> Pixels;
+    };
+
+    explicit FrameSequenceWriter(const CreateInfo& CI);
+    ~FrameSequenceWriter();
+
+    FrameSequenceWriter(const FrameSequenceWriter&) = delete;
+    FrameSequenceWriter& operator=(const FrameSequenceWriter&) = delete;
+
+    /// Returns a buffer for the next frame, reusing the buffer of a written frame if there is one.
+    std::vector<float4> AcquirePixels(size_t NumPixels);
+
+    /// Queues the frame for writing. Blocks while MaxQueuedFrames frames are waiting.
+    void Submit(Frame&& F);
+
+    /// Waits until all submitted frames are written.
+    void Finish();
+
+    std::string GetFilePath(Uint32 Index) const;
+
+    struct Stats
+    {
+        Uint32 NumFrames       = 0; ///< Frames written successfully
+        Uint32 NumFailed       = 0;
+        Uint64 BytesWritten    = 0;
+        double EncodeMs        = 0; ///< Total over all writer threads
+        double WriteMs         = 0; ///< Total over all writer threads
+        double SubmitWaitMs    = 0; ///< Time Submit() was blocked by a full queue
+        Uint32 MaxQueuedFrames = 0; ///< Highest number of frames that were waiting at once
+    };
+    Stats GetStats() const;
+
+    /// Encodes the frame into the contents of a file of the given format.
+    static bool EncodeFrame(const Frame& F, FILE_FORMAT Format, std::vector<Uint8>& Data);
+
+    static const char* GetFileExtension(FILE_FORMAT Format);
+
+private:
+    void WorkerThread();
+    bool WriteFile(const std::string& Path, const std::vector<Uint8>& Data) const;
+
+    const CreateInfo m_CI;
+
+    mutable std::mutex               m_Mtx;
+    std::condition_variable          m_QueueCV;  // Signaled when a frame is queued or on shutdown
+    std::condition_variable          m_SpaceCV;  // Signaled when a frame is taken from the queue
+    std::condition_variable          m_IdleCV;   // Signaled when a frame is done
+    std::deque<Frame>                m_Queue;
+    std::vector<std::vector<float4>> m_FreePixels;
+    Uint32                           m_NumInFlight = 0; // Queued or being written
+    bool                             m_Quit        = false;
+    Stats                            m_Stats;
+
+    std::vector<std::thread> m_Threads;
+};
+
+} // namespace Diligent
@@ -0,0 +1,138 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "GeometryPacker.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+#include "Align.hpp"
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+// Offsets must satisfy the device alignment and also be a whole number of elements,
+// so that shaders can address packed meshes by their first vertex and first index.
+GeometryPacker::GeometryPacker(Uint64 VertexAlignment, Uint64 IndexAlignment, Uint64 MaxBufferSize) :
+    m_VertexAlignment{std::lcm(std::max(VertexAlignment, Uint64{1}), Uint64{PackedVertexStride})},
+    m_IndexAlignment{std::lcm(std::max(IndexAlignment, Uint64{1}), Uint64{sizeof(Uint32)})},
+    m_MaxBufferSize{MaxBufferSize}
+{
+}
+
+void GeometryPacker::Reserve(Uint64 NumVertices, Uint64 NumIndices)
+{
+    if (m_VertexBuffers.empty())
+        m_VertexBuffers.emplace_back();
+    if (m_IndexBuffers.empty())
+        m_IndexBuffers.emplace_back();
+
+    auto& VB = m_VertexBuffers.back();
+    auto& IB = m_IndexBuffers.back();
+    VB.reserve(static_cast<size_t>(std::min(VB.size() + NumVertices * PackedVertexStride, m_MaxBufferSize)));
+    IB.reserve(static_cast<size_t>(std::min(IB.size() + NumIndices * sizeof(Uint32), m_MaxBufferSize)));
+}
+
+Uint64 GeometryPacker::PlaceRange(std::vector<std::vector<Uint8>>& Buffers, Uint64 Size, Uint64 Alignment, Uint32& BufferIndex)
+{
+    if (Buffers.empty())
+        Buffers.emplace_back();
+
+    Uint64 Offset = AlignUpNonPw2(Uint64{Buffers.back().size()}, Alignment);
+    if (Offset + Size > m_MaxBufferSize && !Buffers.back().empty())
+    {
+        // A single mesh larger than the limit still gets its own buffer.
+        Buffers.emplace_back();
+        Offset = 0;
+    }
+
+    auto& Buffer = Buffers.back();
+    Buffer.resize(static_cast<size_t>(Offset + Size));
+
+    BufferIndex = static_cast<Uint32>(Buffers.size() - 1);
+    return Offset;
+}
+
+Uint32 GeometryPacker::AddMesh(const MeshDesc& Desc)
+{
+    VERIFY_EXPR(Desc.pVertices != nullptr && Desc.pIndices != nullptr);
+    VERIFY(Desc.PositionOffset + PackedVertexStride <= Desc.VertexStride, "Position does not fit into the vertex");
+    VERIFY(Desc.NumIndices % 3 == 0, "Index count must be a multiple of 3");
+
+    Placement Place;
+    Place.NumVertices = Desc.NumVertices;
+    Place.NumIndices  = Desc.NumIndices;
+
+    Place.VertexOffset = PlaceRange(m_VertexBuffers, Uint64{Desc.NumVertices} * PackedVertexStride, m_VertexAlignment, Place.VertexBuffer);
+    Place.IndexOffset  = PlaceRange(m_IndexBuffers, Uint64{Desc.NumIndices} * sizeof(Uint32), m_IndexAlignment, Place.IndexBuffer);
+
+    // Copy positions. Tightly packed input is copied in one go.
+    auto*       pDstVerts = &m_VertexBuffers[Place.VertexBuffer][static_cast<size_t>(Place.VertexOffset)];
+    const auto* pSrcVerts = static_cast<const Uint8*>(Desc.pVertices) + Desc.PositionOffset;
+    if (Desc.VertexStride == PackedVertexStride)
+    {
+        std::memcpy(pDstVerts, pSrcVerts, size_t{Desc.NumVertices} * PackedVertexStride);
+    }
+    else
+    {
+        for (Uint32 v = 0; v < Desc.NumVertices; ++v)
+            std::memcpy(pDstVerts + size_t{v} * PackedVertexStride, pSrcVerts + size_t{v} * Desc.VertexStride, PackedVertexStride);
+    }
+
+    std::memcpy(&m_IndexBuffers[Place.IndexBuffer][static_cast<size_t>(Place.IndexOffset)], Desc.pIndices, size_t{Desc.NumIndices} * sizeof(Uint32));
+
+    m_Placements.push_back(Place);
+    return static_cast<Uint32>(m_Placements.size() - 1);
+}
+
+Uint64 GeometryPacker::GetTotalVertexBytes() const
+{
+    Uint64 Total = 0;
+    for (const auto& VB : m_VertexBuffers)
+        Total += VB.size();
+    return Total;
+}
+
+Uint64 GeometryPacker::GetTotalIndexBytes() const
+{
+    Uint64 Total = 0;
+    for (const auto& IB : m_IndexBuffers)
+        Total += IB.size();
+    return Total;
+}
+
+void GeometryPacker::ReleaseStagingData()
+{
+    for (auto& VB : m_VertexBuffers)
+        std::vector<Uint8>{}.swap(VB);
+    for (auto& IB : m_IndexBuffers)
+        std::vector<Uint8>{}.swap(IB);
+}
+
+} // namespace Diligent
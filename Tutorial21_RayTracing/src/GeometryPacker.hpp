@@ -0,0 +1,110 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "BasicTypes.h"
+
+namespace Diligent
+{
+
+/// Packs positions and indices of many triangle meshes into a few large buffers.
+
+/// Only vertex positions (three 32-bit floats) are copied, so the packed vertex data can be
+/// used directly as BLAS build input with a stride of 12 bytes. Indices are copied as is and
+/// stay relative to the first vertex of their mesh; a mesh is addressed in the packed buffers
+/// by its byte offsets. Geometry is appended to the current buffer until it would exceed
+/// the maximum buffer size, then a new buffer is started.
+///
+/// The packer only works with CPU memory, so the packing logic can be tested without a device.
+class GeometryPacker
+{
+public:
+    static constexpr Uint32 PackedVertexStride = sizeof(float) * 3;
+
+    struct MeshDesc
+    {
+        const void* pVertices      = nullptr;
+        Uint32      VertexStride   = PackedVertexStride;
+        Uint32      PositionOffset = 0; ///< Offset of the float3 position within a vertex
+        Uint32      NumVertices    = 0;
+
+        const Uint32* pIndices   = nullptr;
+        Uint32        NumIndices = 0;
+    };
+
+    struct Placement
+    {
+        Uint32 VertexBuffer = 0;
+        Uint64 VertexOffset = 0; ///< Byte offset in the vertex buffer
+        Uint32 NumVertices  = 0;
+
+        Uint32 IndexBuffer = 0;
+        Uint64 IndexOffset = 0; ///< Byte offset in the index buffer
+        Uint32 NumIndices  = 0;
+
+        Uint32 GetFirstVertex() const { return static_cast<Uint32>(VertexOffset / PackedVertexStride); }
+        Uint32 GetFirstIndex() const { return static_cast<Uint32>(IndexOffset / sizeof(Uint32)); }
+    };
+
+    GeometryPacker(Uint64 VertexAlignment, Uint64 IndexAlignment, Uint64 MaxBufferSize);
+
+    /// Pre-allocates staging memory for the given number of vertices and indices.
+    void Reserve(Uint64 NumVertices, Uint64 NumIndices);
+
+    /// Places the mesh in the packed buffers and copies its data. Returns the mesh index.
+    Uint32 AddMesh(const MeshDesc& Desc);
+
+    Uint32           GetNumMeshes() const { return static_cast<Uint32>(m_Placements.size()); }
+    const Placement& GetPlacement(Uint32 Mesh) const { return m_Placements[Mesh]; }
+
+    const std::vector<std::vector<Uint8>>& GetVertexBuffers() const { return m_VertexBuffers; }
+    const std::vector<std::vector<Uint8>>& GetIndexBuffers() const { return m_IndexBuffers; }
+
+    Uint64 GetTotalVertexBytes() const;
+    Uint64 GetTotalIndexBytes() const;
+
+    /// Releases staging memory. Placements are kept.
+    void ReleaseStagingData();
+
+private:
+    // Returns the byte offset for a range of Size bytes in the last buffer of Buffers,
+    // starting a new buffer if the range does not fit.
+    Uint64 PlaceRange(std::vector<std::vector<Uint8>>& Buffers, Uint64 Size, Uint64 Alignment, Uint32& BufferIndex);
+
+    const Uint64 m_VertexAlignment;
+    const Uint64 m_IndexAlignment;
+    const Uint64 m_MaxBufferSize;
+
+    std::vector<Placement>          m_Placements;
+    std::vector<std::vector<Uint8>> m_VertexBuffers;
+    std::vector<std::vector<Uint8>> m_IndexBuffers;
+};
+
+} // namespace Diligent
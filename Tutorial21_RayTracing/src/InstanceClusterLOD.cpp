@@ -0,0 +1,178 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "InstanceClusterLOD.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <tuple>
+
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+// A proxy is replaced by the instances when the cluster comes closer than this fraction
+// of the proxy distance.
+constexpr float ProxyHysteresis = 0.9f;
+
+float GetDistanceToBounds(const float3& P, const float3& BoundsMin, const float3& BoundsMax)
+{
+    const float3 Closest = std::min(std::max(P, BoundsMin), BoundsMax);
+    return length(Closest - P);
+}
+
+} // namespace
+
+void TransformBounds(const float3& LocalMin, const float3& LocalMax, const InstanceMatrix& Transform, float3& WorldMin, float3& WorldMax)
+{
+    const float3 Center = (LocalMin + LocalMax) * 0.5f;
+    const float3 Extent = (LocalMax - LocalMin) * 0.5f;
+    for (int r = 0; r < 3; ++r)
+    {
+        const float* Row         = Transform.data[r];
+        const float  WorldCenter = Row[0] * Center.x + Row[1] * Center.y + Row[2] * Center.z + Row[3];
+        const float  WorldExtent = std::abs(Row[0]) * Extent.x + std::abs(Row[1]) * Extent.y + std::abs(Row[2]) * Extent.z;
+        WorldMin[r]              = WorldCenter - WorldExtent;
+        WorldMax[r]              = WorldCenter + WorldExtent;
+    }
+}
+
+void AppendTransformedMesh(const MeshVertex*        pVertices,
+                           Uint32                   NumVertices,
+                           const Uint32*            pIndices,
+                           Uint32                   NumIndices,
+                           const InstanceMatrix&    Transform,
+                           std::vector<MeshVertex>& MergedVertices,
+                           std::vector<Uint32>&     MergedIndices)
+{
+    const auto& M = Transform.data;
+
+    const Uint32 BaseVertex = static_cast<Uint32>(MergedVertices.size());
+    MergedVertices.reserve(MergedVertices.size() + NumVertices);
+    for (Uint32 v = 0; v < NumVertices; ++v)
+    {
+        const auto& Src = pVertices[v];
+        MeshVertex  Dst;
+        for (int r = 0; r < 3; ++r)
+        {
+            Dst.Pos[r]    = M[r][0] * Src.Pos.x + M[r][1] * Src.Pos.y + M[r][2] * Src.Pos.z + M[r][3];
+            Dst.Normal[r] = M[r][0] * Src.Normal.x + M[r][1] * Src.Normal.y + M[r][2] * Src.Normal.z;
+        }
+        Dst.Normal = normalize(Dst.Normal);
+        Dst.UV     = Src.UV;
+        MergedVertices.push_back(Dst);
+    }
+
+    MergedIndices.reserve(MergedIndices.size() + NumIndices);
+    for (Uint32 i = 0; i < NumIndices; ++i)
+        MergedIndices.push_back(BaseVertex + pIndices[i]);
+}
+
+void InstanceClusterLOD::Build(const InstanceMatrix* pTransforms,
+                               const Uint32*         pKeys,
+                               Uint32                NumInstances,
+                               const float3&         LocalMin,
+                               const float3&         LocalMax,
+                               float                 CellSize)
+{
+    VERIFY_EXPR(CellSize > 0);
+
+    m_Clusters.clear();
+    m_InstanceClusters.assign(NumInstances, InvalidCluster);
+    m_NumProxies = 0;
+
+    // Group instances by cell and key. The ordered map keeps the cluster order independent
+    // of the instance order within a cell.
+    std::map<std::tuple<Int32, Int32, Int32, Uint32>, std::vector<Uint32>> Cells;
+    std::vector<float3>                                                     BoundsMin(NumInstances);
+    std::vector<float3>                                                     BoundsMax(NumInstances);
+    for (Uint32 i = 0; i < NumInstances; ++i)
+    {
+        TransformBounds(LocalMin, LocalMax, pTransforms[i], BoundsMin[i], BoundsMax[i]);
+
+        const float3 Center = (BoundsMin[i] + BoundsMax[i]) * 0.5f;
+        const auto   CellX  = static_cast<Int32>(std::floor(Center.x / CellSize));
+        const auto   CellY  = static_cast<Int32>(std::floor(Center.y / CellSize));
+        const auto   CellZ  = static_cast<Int32>(std::floor(Center.z / CellSize));
+        Cells[std::make_tuple(CellX, CellY, CellZ, pKeys[i])].push_back(i);
+    }
+
+    for (auto& It : Cells)
+    {
+        auto& Instances = It.second;
+        if (Instances.size() < 2)
+            continue;
+
+        Cluster C;
+        C.Key       = std::get<3>(It.first);
+        C.BoundsMin = BoundsMin[Instances[0]];
+        C.BoundsMax = BoundsMax[Instances[0]];
+        for (const auto i : Instances)
+        {
+            C.BoundsMin           = std::min(C.BoundsMin, BoundsMin[i]);
+            C.BoundsMax           = std::max(C.BoundsMax, BoundsMax[i]);
+            m_InstanceClusters[i] = static_cast<Uint32>(m_Clusters.size());
+        }
+        C.Instances = std::move(Instances);
+        m_Clusters.emplace_back(std::move(C));
+    }
+}
+
+Uint32 InstanceClusterLOD::Update(const float3& CameraPos, float ProxyDistance, const Uint8* pIsActive)
+{
+    Uint32 NumSwitched = 0;
+    m_NumProxies       = 0;
+    for (auto& C : m_Clusters)
+    {
+        // The proxy contains all instances, so it can't be used while some of them are hidden.
+        bool AllActive = true;
+        if (pIsActive != nullptr)
+        {
+            for (const auto i : C.Instances)
+                AllActive = AllActive && pIsActive[i] != 0;
+        }
+
+        const float Distance  = GetDistanceToBounds(CameraPos, C.BoundsMin, C.BoundsMax);
+        const float Threshold = C.UseProxy ? ProxyDistance * ProxyHysteresis : ProxyDistance;
+        const bool  UseProxy  = AllActive && Distance > Threshold;
+        if (UseProxy != C.UseProxy)
+        {
+            C.UseProxy = UseProxy;
+            ++NumSwitched;
+        }
+        if (C.UseProxy)
+            ++m_NumProxies;
+    }
+    return NumSwitched;
+}
+
+} // namespace Diligent
@@ -0,0 +1,117 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "BasicMath.hpp"
+#include "TopLevelAS.h"
+#include "MeshLoader.hpp"
+
+namespace Diligent
+{
+
+/// Level of detail for many small instances of the same geometry.
+
+/// Instances are grouped into clusters by the grid cell of their center and by a key (such
+/// as the material), since instances with different keys need different hit groups. Every
+/// cluster has a proxy: one instance of a BLAS that holds the geometry of all its instances
+/// in world space. Beyond the proxy distance, the TLAS holds the proxy instead of the
+/// individual instances, which saves TLAS leaves and instance transforms during traversal.
+///
+/// Clusters and proxies depend only on the instance layout, so they are built once. Update()
+/// only switches the clusters whose distance to the camera crossed the proxy distance, with
+/// some hysteresis so that clusters do not flicker between representations.
+///
+/// The class does not use the render device, so clustering and merging can be measured on their own.
+class InstanceClusterLOD
+{
+public:
+    struct Cluster
+    {
+        float3              BoundsMin;
+        float3              BoundsMax;
+        Uint32              Key = 0;
+        std::vector<Uint32> Instances;
+        bool                UseProxy = false;
+    };
+
+    static constexpr Uint32 InvalidCluster = ~0u;
+
+    /// Clusters the instances.
+    ///   pTransforms        - instance transforms
+    ///   pKeys              - instances with different keys never share a cluster
+    ///   LocalMin, LocalMax - object-space bounds of the instanced geometry
+    ///   CellSize           - size of the grid cells that define the clusters
+    /// Cells with a single instance do not form a cluster.
+    void Build(const InstanceMatrix* pTransforms,
+               const Uint32*         pKeys,
+               Uint32                NumInstances,
+               const float3&         LocalMin,
+               const float3&         LocalMax,
+               float                 CellSize);
+
+    /// Switches clusters between individual instances and proxies. A cluster uses its proxy when
+    /// all of its instances are active and its bounds are farther than ProxyDistance from the camera.
+    /// pIsActive may be null if all instances are active. Returns the number of clusters that switched.
+    Uint32 Update(const float3& CameraPos, float ProxyDistance, const Uint8* pIsActive);
+
+    const std::vector<Cluster>& GetClusters() const { return m_Clusters; }
+
+    /// Returns the cluster of the instance, or InvalidCluster.
+    Uint32 GetInstanceCluster(Uint32 Instance) const { return m_InstanceClusters[Instance]; }
+
+    /// Returns true if the instance is represented by the proxy of its cluster.
+    bool IsInstanceMerged(Uint32 Instance) const
+    {
+        const Uint32 ClusterIdx = m_InstanceClusters[Instance];
+        return ClusterIdx != InvalidCluster && m_Clusters[ClusterIdx].UseProxy;
+    }
+
+    Uint32 GetNumProxies() const { return m_NumProxies; }
+
+private:
+    std::vector<Cluster> m_Clusters;
+    std::vector<Uint32>  m_InstanceClusters;
+    Uint32               m_NumProxies = 0;
+};
+
+/// Computes world-space bounds of the object-space box transformed by the instance matrix.
+void TransformBounds(const float3& LocalMin, const float3& LocalMax, const InstanceMatrix& Transform, float3& WorldMin, float3& WorldMax);
+
+/// Appends the mesh transformed by the instance matrix to the merged mesh. The transform
+/// must not have non-uniform scale, as normals are transformed by its rotation part.
+void AppendTransformedMesh(const MeshVertex*        pVertices,
+                           Uint32                   NumVertices,
+                           const Uint32*            pIndices,
+                           Uint32                   NumIndices,
+                           const InstanceMatrix&    Transform,
+                           std::vector<MeshVertex>& MergedVertices,
+                           std::vector<Uint32>&     MergedIndices);
+
+} // namespace Diligent
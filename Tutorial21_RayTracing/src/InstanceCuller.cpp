@@ -0,0 +1,187 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "InstanceCuller.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    define INSTANCE_CULLER_SSE 1
+#    include <emmintrin.h>
+#else
+#    define INSTANCE_CULLER_SSE 0
+#endif
+
+#include "DebugUtilities.hpp"
+#include "ParallelFor.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+// Instances culled by one task. Must be a multiple of four.
+constexpr Uint32 CullBlockSize = 1024;
+
+} // namespace
+
+void InstanceCuller::Reset(Uint32 NumInstances)
+{
+    m_NumInstances = NumInstances;
+    m_NumActive    = 0;
+
+    const size_t PaddedSize = (size_t{NumInstances} + 3) & ~size_t{3};
+    for (auto* pArray : {&m_CenterX, &m_CenterY, &m_CenterZ, &m_ExtentX, &m_ExtentY, &m_ExtentZ})
+        pArray->assign(PaddedSize, 0.f);
+    m_IsActive.assign(PaddedSize, 0);
+    m_IsVisible.assign(PaddedSize, 0);
+    m_Visible.clear();
+}
+
+void InstanceCuller::SetInstance(Uint32 Index, const float3& LocalMin, const float3& LocalMax, const InstanceMatrix& Transform, bool IsActive)
+{
+    VERIFY_EXPR(Index < m_NumInstances);
+
+    // Transform the center and compute the extent of the box that encloses the transformed box.
+    const float3 Center = (LocalMin + LocalMax) * 0.5f;
+    const float3 Extent = (LocalMax - LocalMin) * 0.5f;
+
+    float WorldCenter[3];
+    float WorldExtent[3];
+    for (int r = 0; r < 3; ++r)
+    {
+        const float* Row = Transform.data[r];
+        WorldCenter[r]   = Row[0] * Center.x + Row[1] * Center.y + Row[2] * Center.z + Row[3];
+        WorldExtent[r]   = std::abs(Row[0]) * Extent.x + std::abs(Row[1]) * Extent.y + std::abs(Row[2]) * Extent.z;
+    }
+    m_CenterX[Index] = WorldCenter[0];
+    m_CenterY[Index] = WorldCenter[1];
+    m_CenterZ[Index] = WorldCenter[2];
+    m_ExtentX[Index] = WorldExtent[0];
+    m_ExtentY[Index] = WorldExtent[1];
+    m_ExtentZ[Index] = WorldExtent[2];
+
+    if (m_IsActive[Index] != static_cast<Uint8>(IsActive))
+    {
+        m_IsActive[Index] = IsActive ? 1 : 0;
+        m_NumActive       = IsActive ? m_NumActive + 1 : m_NumActive - 1;
+    }
+}
+
+void InstanceCuller::CullBlock(Uint32 Block, const CullAttribs& Attribs)
+{
+    const Uint32 Begin = Block * CullBlockSize;
+    const Uint32 End   = std::min(Begin + CullBlockSize, static_cast<Uint32>(m_IsActive.size()));
+
+    if (Attribs.CullDistance <= 0)
+    {
+        std::copy(m_IsActive.begin() + Begin, m_IsActive.begin() + End, m_IsVisible.begin() + Begin);
+        return;
+    }
+
+    // An instance is culled if it is both farther than the cull distance and outside of
+    // at least one frustum plane.
+    const float CullDistSq = Attribs.CullDistance * Attribs.CullDistance;
+
+#if INSTANCE_CULLER_SSE
+    const __m128 SignMask = _mm_set1_ps(-0.f);
+    const __m128 Zero     = _mm_setzero_ps();
+    const __m128 CamX     = _mm_set1_ps(Attribs.CameraPos.x);
+    const __m128 CamY     = _mm_set1_ps(Attribs.CameraPos.y);
+    const __m128 CamZ     = _mm_set1_ps(Attribs.CameraPos.z);
+    const __m128 DistSq   = _mm_set1_ps(CullDistSq);
+    for (Uint32 i = Begin; i < End; i += 4)
+    {
+        const __m128 CX = _mm_loadu_ps(&m_CenterX[i]);
+        const __m128 CY = _mm_loadu_ps(&m_CenterY[i]);
+        const __m128 CZ = _mm_loadu_ps(&m_CenterZ[i]);
+        const __m128 EX = _mm_loadu_ps(&m_ExtentX[i]);
+        const __m128 EY = _mm_loadu_ps(&m_ExtentY[i]);
+        const __m128 EZ = _mm_loadu_ps(&m_ExtentZ[i]);
+
+        // Distance from the camera to the closest point of the box.
+        const __m128 DX    = _mm_max_ps(_mm_sub_ps(_mm_andnot_ps(SignMask, _mm_sub_ps(CX, CamX)), EX), Zero);
+        const __m128 DY    = _mm_max_ps(_mm_sub_ps(_mm_andnot_ps(SignMask, _mm_sub_ps(CY, CamY)), EY), Zero);
+        const __m128 DZ    = _mm_max_ps(_mm_sub_ps(_mm_andnot_ps(SignMask, _mm_sub_ps(CZ, CamZ)), EZ), Zero);
+        const __m128 IsFar = _mm_cmpgt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(DX, DX), _mm_mul_ps(DY, DY)), _mm_mul_ps(DZ, DZ)), DistSq);
+
+        __m128 IsOutside = Zero;
+        for (const auto& Plane : Attribs.FrustumPlanes)
+        {
+            // Signed distance from the plane to the center plus the projected half extent.
+            const __m128 Dist = _mm_add_ps(
+                _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(Plane.x), CX), _mm_mul_ps(_mm_set1_ps(Plane.y), CY)),
+                           _mm_add_ps(_mm_mul_ps(_mm_set1_ps(Plane.z), CZ), _mm_set1_ps(Plane.w))),
+                _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(std::abs(Plane.x)), EX), _mm_mul_ps(_mm_set1_ps(std::abs(Plane.y)), EY)),
+                           _mm_mul_ps(_mm_set1_ps(std::abs(Plane.z)), EZ)));
+            IsOutside = _mm_or_ps(IsOutside, _mm_cmplt_ps(Dist, Zero));
+        }
+
+        const int CulledMask = _mm_movemask_ps(_mm_and_ps(IsFar, IsOutside));
+        for (Uint32 k = 0; k < 4; ++k)
+            m_IsVisible[i + k] = m_IsActive[i + k] != 0 && (CulledMask & (1 << k)) == 0 ? 1 : 0;
+    }
+#else
+    for (Uint32 i = Begin; i < End; ++i)
+    {
+        const float DX    = std::max(std::abs(m_CenterX[i] - Attribs.CameraPos.x) - m_ExtentX[i], 0.f);
+        const float DY    = std::max(std::abs(m_CenterY[i] - Attribs.CameraPos.y) - m_ExtentY[i], 0.f);
+        const float DZ    = std::max(std::abs(m_CenterZ[i] - Attribs.CameraPos.z) - m_ExtentZ[i], 0.f);
+        const bool  IsFar = DX * DX + DY * DY + DZ * DZ > CullDistSq;
+
+        bool IsOutside = false;
+        for (const auto& Plane : Attribs.FrustumPlanes)
+        {
+            const float Dist = Plane.x * m_CenterX[i] + Plane.y * m_CenterY[i] + Plane.z * m_CenterZ[i] + Plane.w +
+                std::abs(Plane.x) * m_ExtentX[i] + std::abs(Plane.y) * m_ExtentY[i] + std::abs(Plane.z) * m_ExtentZ[i];
+            IsOutside = IsOutside || Dist < 0;
+        }
+
+        m_IsVisible[i] = m_IsActive[i] != 0 && !(IsFar && IsOutside) ? 1 : 0;
+    }
+#endif
+}
+
+const std::vector<Uint32>& InstanceCuller::Cull(const CullAttribs& Attribs)
+{
+    const Uint32 NumBlocks = static_cast<Uint32>((m_IsActive.size() + CullBlockSize - 1) / CullBlockSize);
+    ParallelFor(NumBlocks, [&](Uint32 Block) { CullBlock(Block, Attribs); });
+
+    // Compaction keeps the original order, so an unchanged set produces the same list
+    // and the TLAS can be updated instead of rebuilt.
+    m_Visible.clear();
+    for (Uint32 i = 0; i < m_NumInstances; ++i)
+    {
+        if (m_IsVisible[i] != 0)
+            m_Visible.push_back(i);
+    }
+    return m_Visible;
+}
+
+} // namespace Diligent
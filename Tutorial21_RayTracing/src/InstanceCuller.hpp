@@ -0,0 +1,91 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "BasicMath.hpp"
+#include "TopLevelAS.h"
+
+namespace Diligent
+{
+
+/// Removes instances from the list submitted to the TLAS build.
+
+/// Inactive instances are always removed, so the TLAS only holds the instances that can be hit,
+/// instead of all instances with a zero mask. Optionally, instances are also removed when their
+/// bounds are outside of the view frustum and farther than the cull distance from the camera.
+/// Rays leave the frustum after reflections and refractions, so the distance keeps nearby
+/// instances that can be seen indirectly or cast shadows into the view.
+///
+/// World-space bounds are stored as structure of arrays and four instances are tested at
+/// a time with SSE. Blocks of instances are culled in parallel.
+class InstanceCuller
+{
+public:
+    struct CullAttribs
+    {
+        /// View frustum planes (xyz is the normal that points inside, w is the distance)
+        float4 FrustumPlanes[6];
+
+        float3 CameraPos;
+
+        /// Instances outside of the frustum and farther than this distance are removed.
+        /// Zero disables distance culling.
+        float CullDistance = 0;
+    };
+
+    /// Resizes the instance list. All instances are inactive until they are set.
+    void Reset(Uint32 NumInstances);
+
+    /// Sets the world-space bounds of the instance from its object-space bounds and transform.
+    void SetInstance(Uint32 Index, const float3& LocalMin, const float3& LocalMax, const InstanceMatrix& Transform, bool IsActive);
+
+    /// Culls the instances and returns the indices of the remaining ones in increasing order.
+    const std::vector<Uint32>& Cull(const CullAttribs& Attribs);
+
+    Uint32 GetNumInstances() const { return m_NumInstances; }
+    Uint32 GetNumActive() const { return m_NumActive; }
+    Uint32 GetNumVisible() const { return static_cast<Uint32>(m_Visible.size()); }
+
+private:
+    void CullBlock(Uint32 Block, const CullAttribs& Attribs);
+
+    Uint32 m_NumInstances = 0;
+    Uint32 m_NumActive    = 0;
+
+    // World-space bounds as centers and half extents, padded to a multiple of four.
+    std::vector<float> m_CenterX, m_CenterY, m_CenterZ;
+    std::vector<float> m_ExtentX, m_ExtentY, m_ExtentZ;
+    std::vector<Uint8> m_IsActive;
+    std::vector<Uint8> m_IsVisible;
+
+    std::vector<Uint32> m_Visible;
+};
+
+} // namespace Diligent
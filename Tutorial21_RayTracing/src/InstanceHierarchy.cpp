@@ -0,0 +1,259 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "InstanceHierarchy.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+#include "ParallelFor.hpp"
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+// Instances flattened by one ParallelFor() item; smaller scenes are flattened on the calling thread.
+constexpr Uint32 FlattenChunkSize = 4096;
+
+} // namespace
+
+InstanceMatrix ConcatenateTransforms(const InstanceMatrix& Parent, const InstanceMatrix& Local)
+{
+    // Instance matrices transform column vectors: the rotation part is multiplied, and the
+    // translation of Local is rotated by Parent before the translation of Parent is added.
+    InstanceMatrix Result;
+    for (int r = 0; r < 3; ++r)
+    {
+        const float* P = Parent.data[r];
+        for (int c = 0; c < 4; ++c)
+            Result.data[r][c] = P[0] * Local.data[0][c] + P[1] * Local.data[1][c] + P[2] * Local.data[2][c];
+        Result.data[r][3] += P[3];
+    }
+    return Result;
+}
+
+InstanceMatrix InvertTransform(const InstanceMatrix& Transform)
+{
+    const auto& m = Transform.data;
+
+    // Inverse of the 3x3 part from its cofactors.
+    float Inv[3][3] = {
+        {m[1][1] * m[2][2] - m[1][2] * m[2][1], m[0][2] * m[2][1] - m[0][1] * m[2][2], m[0][1] * m[1][2] - m[0][2] * m[1][1]},
+        {m[1][2] * m[2][0] - m[1][0] * m[2][2], m[0][0] * m[2][2] - m[0][2] * m[2][0], m[0][2] * m[1][0] - m[0][0] * m[1][2]},
+        {m[1][0] * m[2][1] - m[1][1] * m[2][0], m[0][1] * m[2][0] - m[0][0] * m[2][1], m[0][0] * m[1][1] - m[0][1] * m[1][0]},
+    };
+    const float Det = m[0][0] * Inv[0][0] + m[0][1] * Inv[1][0] + m[0][2] * Inv[2][0];
+    VERIFY(Det != 0, "Instance transform is not invertible");
+
+    InstanceMatrix Result;
+    for (int r = 0; r < 3; ++r)
+    {
+        for (int c = 0; c < 3; ++c)
+            Result.data[r][c] = Inv[r][c] / Det;
+        Result.data[r][3] = -(Result.data[r][0] * m[0][3] + Result.data[r][1] * m[1][3] + Result.data[r][2] * m[2][3]);
+    }
+    return Result;
+}
+
+InstanceHierarchy::InstanceHierarchy()
+{
+    Clear();
+}
+
+void InstanceHierarchy::Clear()
+{
+    m_Groups.resize(1);
+    m_Groups[RootGroup]       = {};
+    m_Groups[RootGroup].Name  = "Root";
+    m_Groups[RootGroup].World = m_Groups[RootGroup].Local;
+
+    m_InstanceGroups.clear();
+    m_InstanceLocal.clear();
+    m_InstanceWorld.clear();
+    m_InstanceDirty.clear();
+    m_InstanceUpdated.clear();
+    m_IsDirty    = true;
+    m_NumUpdated = 0;
+}
+
+Uint32 InstanceHierarchy::AddGroup(Uint32 Parent, const InstanceMatrix& Transform, const char* Name)
+{
+    VERIFY_EXPR(Parent < m_Groups.size());
+
+    Group NewGroup;
+    NewGroup.Parent = Parent;
+    NewGroup.Local  = Transform;
+    NewGroup.Name   = Name != nullptr ? Name : "";
+    m_Groups.push_back(std::move(NewGroup));
+
+    m_IsDirty = true;
+    return static_cast<Uint32>(m_Groups.size() - 1);
+}
+
+Uint32 InstanceHierarchy::AddInstance(Uint32 Group, const InstanceMatrix& Transform)
+{
+    VERIFY_EXPR(Group < m_Groups.size());
+
+    m_InstanceGroups.push_back(Group);
+    m_InstanceLocal.push_back(Transform);
+    m_InstanceWorld.emplace_back();
+    m_InstanceDirty.push_back(1);
+    m_InstanceUpdated.push_back(0);
+
+    m_IsDirty = true;
+    return static_cast<Uint32>(m_InstanceLocal.size() - 1);
+}
+
+Uint32 InstanceHierarchy::CloneGroup(Uint32 Group, Uint32 Parent, const InstanceMatrix& Transform)
+{
+    VERIFY_EXPR(Group < m_Groups.size() && Parent < m_Groups.size());
+
+    // Groups of the subtree follow their parents, so a single pass finds and maps all of them.
+    constexpr Uint32    NotCloned = ~0u;
+    const Uint32        NumGroups = static_cast<Uint32>(m_Groups.size());
+    std::vector<Uint32> Clones(NumGroups, NotCloned);
+
+    Clones[Group] = AddGroup(Parent, Transform, m_Groups[Group].Name.c_str());
+    for (Uint32 g = Group + 1; g < NumGroups; ++g)
+    {
+        const Uint32 ClonedParent = Clones[m_Groups[g].Parent];
+        if (ClonedParent != NotCloned)
+            Clones[g] = AddGroup(ClonedParent, m_Groups[g].Local, m_Groups[g].Name.c_str());
+    }
+
+    const Uint32 NumInstances = GetNumInstances();
+    for (Uint32 i = 0; i < NumInstances; ++i)
+    {
+        // The transform is copied, as adding the instance may reallocate the array.
+        const Uint32 ClonedGroup = Clones[m_InstanceGroups[i]];
+        if (ClonedGroup != NotCloned)
+            AddInstance(ClonedGroup, InstanceMatrix{m_InstanceLocal[i]});
+    }
+    return Clones[Group];
+}
+
+void InstanceHierarchy::SetGroupTransform(Uint32 Group, const InstanceMatrix& Transform)
+{
+    VERIFY_EXPR(Group < m_Groups.size());
+    m_Groups[Group].Local = Transform;
+    m_Groups[Group].Dirty = true;
+    m_IsDirty             = true;
+}
+
+void InstanceHierarchy::SetInstanceTransform(Uint32 Instance, const InstanceMatrix& Transform)
+{
+    VERIFY_EXPR(Instance < m_InstanceLocal.size());
+    m_InstanceLocal[Instance] = Transform;
+    m_InstanceDirty[Instance] = 1;
+    m_IsDirty                 = true;
+}
+
+void InstanceHierarchy::SetInstanceWorldTransform(Uint32 Instance, const InstanceMatrix& WorldTransform)
+{
+    VERIFY_EXPR(Instance < m_InstanceLocal.size());
+    const auto GroupWorld = ComputeGroupWorldTransform(m_InstanceGroups[Instance]);
+    SetInstanceTransform(Instance, ConcatenateTransforms(InvertTransform(GroupWorld), WorldTransform));
+}
+
+InstanceMatrix InstanceHierarchy::ComputeGroupWorldTransform(Uint32 Group) const
+{
+    VERIFY_EXPR(Group < m_Groups.size());
+    InstanceMatrix World = m_Groups[Group].Local;
+    for (Uint32 g = Group; g != RootGroup;)
+    {
+        g     = m_Groups[g].Parent;
+        World = ConcatenateTransforms(m_Groups[g].Local, World);
+    }
+    return World;
+}
+
+Uint32 InstanceHierarchy::Flatten(Uint32 NumThreads)
+{
+    if (!m_IsDirty)
+    {
+        // Nothing changed, so no instance is updated by this call.
+        if (m_NumUpdated > 0)
+            std::fill(m_InstanceUpdated.begin(), m_InstanceUpdated.end(), Uint8{0});
+        m_NumUpdated = 0;
+        return 0;
+    }
+
+    // A group is dirty if its transform or the transform of any ancestor changed.
+    for (size_t g = 0; g < m_Groups.size(); ++g)
+    {
+        auto& G = m_Groups[g];
+        if (g == RootGroup)
+        {
+            if (G.Dirty)
+                G.World = G.Local;
+            continue;
+        }
+
+        const auto& ParentGroup = m_Groups[G.Parent];
+        G.Dirty                 = G.Dirty || ParentGroup.Dirty;
+        if (G.Dirty)
+            G.World = ConcatenateTransforms(ParentGroup.World, G.Local);
+    }
+
+    const Uint32        NumInstances = GetNumInstances();
+    const Uint32        NumChunks    = (NumInstances + FlattenChunkSize - 1) / FlattenChunkSize;
+    std::atomic<Uint32> NumUpdated{0};
+    ParallelFor(
+        NumChunks,
+        [&](Uint32 Chunk) {
+            const Uint32 Begin = Chunk * FlattenChunkSize;
+            const Uint32 End   = std::min(Begin + FlattenChunkSize, NumInstances);
+
+            Uint32 ChunkUpdated = 0;
+            for (Uint32 i = Begin; i < End; ++i)
+            {
+                const auto& G      = m_Groups[m_InstanceGroups[i]];
+                const bool  Update = m_InstanceDirty[i] != 0 || G.Dirty;
+                if (Update)
+                {
+                    m_InstanceWorld[i] = ConcatenateTransforms(G.World, m_InstanceLocal[i]);
+                    ++ChunkUpdated;
+                }
+                m_InstanceUpdated[i] = Update ? 1 : 0;
+                m_InstanceDirty[i]   = 0;
+            }
+            NumUpdated.fetch_add(ChunkUpdated);
+        },
+        NumThreads);
+
+    for (auto& G : m_Groups)
+        G.Dirty = false;
+
+    m_IsDirty    = false;
+    m_NumUpdated = NumUpdated.load();
+    return m_NumUpdated;
+}
+
+} // namespace Diligent
@@ -0,0 +1,134 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "BasicMath.hpp"
+#include "TopLevelAS.h"
+
+namespace Diligent
+{
+
+/// Nested groups of instances, flattened into the world transforms of the TLAS instances.
+
+/// Groups and instances form a tree: every group and every instance has a transform relative
+/// to its parent group, so moving a group, e.g. a whole arrangement of objects, is one edit
+/// no matter how many instances it holds. Flatten() concatenates the transforms into world
+/// transforms of the instances: groups are updated top-down, then instances in parallel, and
+/// only the nodes below groups or instances that changed since the previous call are updated.
+///
+/// CloneGroup() instantiates a group again with its own transform. The copy shares nothing
+/// with the original, so every copy can be moved and edited on its own, and flattening a copy
+/// costs the same as flattening the original.
+///
+/// The class does not use the render device, so the flattening can be measured on its own.
+class InstanceHierarchy
+{
+public:
+    static constexpr Uint32 RootGroup = 0;
+
+    /// Creates the root group with the identity transform.
+    InstanceHierarchy();
+
+    /// Removes all groups except the root, and all instances.
+    void Clear();
+
+    /// Adds a group under Parent and returns its index.
+    Uint32 AddGroup(Uint32 Parent, const InstanceMatrix& Transform, const char* Name = "");
+
+    /// Adds an instance to the group and returns its index. Instances are numbered in the order
+    /// they are added, so the indices can match an existing instance array.
+    Uint32 AddInstance(Uint32 Group, const InstanceMatrix& Transform);
+
+    /// Copies the group with all its subgroups and instances under Parent with a new transform,
+    /// and returns the index of the copy. The copies of the instances are appended in the order
+    /// of their indices.
+    Uint32 CloneGroup(Uint32 Group, Uint32 Parent, const InstanceMatrix& Transform);
+
+    void SetGroupTransform(Uint32 Group, const InstanceMatrix& Transform);
+    void SetInstanceTransform(Uint32 Instance, const InstanceMatrix& Transform);
+
+    /// Sets the transform of the instance relative to its group so that the instance gets the
+    /// given world transform. The group transforms must be invertible.
+    void SetInstanceWorldTransform(Uint32 Instance, const InstanceMatrix& WorldTransform);
+
+    /// Updates the world transforms of the instances below the nodes that changed since the
+    /// previous call. Returns the number of updated instances, see IsInstanceUpdated().
+    /// NumThreads == 0 selects GetDefaultNumWorkerThreads().
+    Uint32 Flatten(Uint32 NumThreads = 0);
+
+    /// Returns true if the world transform of the instance was updated by the last Flatten().
+    bool IsInstanceUpdated(Uint32 Instance) const { return m_InstanceUpdated[Instance] != 0; }
+
+    const InstanceMatrix& GetGroupTransform(Uint32 Group) const { return m_Groups[Group].Local; }
+    const InstanceMatrix& GetInstanceTransform(Uint32 Instance) const { return m_InstanceLocal[Instance]; }
+
+    /// World transforms as of the last Flatten().
+    const std::vector<InstanceMatrix>& GetWorldTransforms() const { return m_InstanceWorld; }
+
+    /// Computes the current world transform of the group from its ancestors, e.g. between edits and Flatten().
+    InstanceMatrix ComputeGroupWorldTransform(Uint32 Group) const;
+
+    Uint32      GetNumGroups() const { return static_cast<Uint32>(m_Groups.size()); }
+    Uint32      GetNumInstances() const { return static_cast<Uint32>(m_InstanceLocal.size()); }
+    Uint32      GetGroupParent(Uint32 Group) const { return m_Groups[Group].Parent; }
+    const char* GetGroupName(Uint32 Group) const { return m_Groups[Group].Name.c_str(); }
+    Uint32      GetInstanceGroup(Uint32 Instance) const { return m_InstanceGroups[Instance]; }
+
+private:
+    struct Group
+    {
+        Uint32         Parent = RootGroup;
+        InstanceMatrix Local;
+        InstanceMatrix World;
+        std::string    Name;
+        bool           Dirty = true; ///< The transform changed since the last Flatten()
+    };
+
+    // Groups are stored after their parents, so that one pass in order updates them top-down.
+    std::vector<Group> m_Groups;
+
+    std::vector<Uint32>         m_InstanceGroups;
+    std::vector<InstanceMatrix> m_InstanceLocal;
+    std::vector<InstanceMatrix> m_InstanceWorld;
+    std::vector<Uint8>          m_InstanceDirty;
+    std::vector<Uint8>          m_InstanceUpdated;
+
+    bool   m_IsDirty    = false; ///< Any node changed since the last Flatten()
+    Uint32 m_NumUpdated = 0;     ///< Instances updated by the last Flatten()
+};
+
+/// Concatenates two instance transforms: the result applies Local first, then Parent.
+InstanceMatrix ConcatenateTransforms(const InstanceMatrix& Parent, const InstanceMatrix& Local);
+
+/// Inverts an instance transform with an invertible rotation and scale.
+InstanceMatrix InvertTransform(const InstanceMatrix& Transform);
+
+} // namespace Diligent
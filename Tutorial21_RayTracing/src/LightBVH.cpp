@@ -0,0 +1,176 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "LightBVH.hpp"
+
+#include <algorithm>
+#include <cfloat>
+
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+float GetLightPower(const LightBVH::Light& L)
+{
+    return L.Color.x * 0.2126f + L.Color.y * 0.7152f + L.Color.z * 0.0722f;
+}
+
+} // namespace
+
+float LightBVH::GetFalloff(float Dist, float Range)
+{
+    const float x = Dist / std::max(Range, 1e-6f);
+    const float t = std::max(1.f - x * x, 0.f);
+    return t * t;
+}
+
+float LightBVH::GetImportance(const Node& N, const float3& P, const float3& Normal)
+{
+    if (N.Power <= 0)
+        return 0;
+
+    // Subtrees behind the surface can't light it.
+    const float3 Support{
+        Normal.x > 0 ? N.BoundsMax.x : N.BoundsMin.x,
+        Normal.y > 0 ? N.BoundsMax.y : N.BoundsMin.y,
+        Normal.z > 0 ? N.BoundsMax.z : N.BoundsMin.z,
+    };
+    if (dot(Normal, Support - P) <= 0)
+        return 0;
+
+    // Falloff at the closest point of the bounds is an upper bound of the falloff of all lights.
+    const float3 Closest{
+        std::min(std::max(P.x, N.BoundsMin.x), N.BoundsMax.x),
+        std::min(std::max(P.y, N.BoundsMin.y), N.BoundsMax.y),
+        std::min(std::max(P.z, N.BoundsMin.z), N.BoundsMax.z),
+    };
+    return N.Power * GetFalloff(length(Closest - P), N.MaxRange);
+}
+
+void LightBVH::Build(const Light* pLights, Uint32 NumLights)
+{
+    m_Lights.assign(pLights, pLights + NumLights);
+    m_Nodes.clear();
+    if (NumLights == 0)
+        return;
+
+    // Every leaf holds one light, so a tree over N lights has 2N - 1 nodes.
+    m_Nodes.reserve(size_t{NumLights} * 2 - 1);
+    m_Nodes.emplace_back();
+
+    std::vector<Uint32> Order(NumLights);
+    for (Uint32 i = 0; i < NumLights; ++i)
+        Order[i] = i;
+    BuildNode(0, 0, NumLights, Order);
+    VERIFY_EXPR(m_Nodes.size() == size_t{NumLights} * 2 - 1);
+}
+
+void LightBVH::BuildNode(Uint32 NodeIdx, Uint32 First, Uint32 Count, std::vector<Uint32>& Order)
+{
+    Node N;
+    N.BoundsMin = float3{+FLT_MAX, +FLT_MAX, +FLT_MAX};
+    N.BoundsMax = float3{-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    float3 CentroidMin = N.BoundsMin;
+    float3 CentroidMax = N.BoundsMax;
+    for (Uint32 i = First; i < First + Count; ++i)
+    {
+        const auto&  L = m_Lights[Order[i]];
+        const float3 R{L.Radius, L.Radius, L.Radius};
+        N.BoundsMin = std::min(N.BoundsMin, L.Pos - R);
+        N.BoundsMax = std::max(N.BoundsMax, L.Pos + R);
+        CentroidMin = std::min(CentroidMin, L.Pos);
+        CentroidMax = std::max(CentroidMax, L.Pos);
+        N.Power += GetLightPower(L);
+        N.MaxRange = std::max(N.MaxRange, L.Range);
+    }
+
+    if (Count == 1)
+    {
+        N.Child          = Order[First] | LeafFlag;
+        m_Nodes[NodeIdx] = N;
+        return;
+    }
+
+    // Split at the median along the largest extent of the light positions.
+    const float3 Extent = CentroidMax - CentroidMin;
+    const int    Axis   = Extent.x > Extent.y ? (Extent.x > Extent.z ? 0 : 2) : (Extent.y > Extent.z ? 1 : 2);
+    const Uint32 Half   = Count / 2;
+    std::nth_element(Order.begin() + First, Order.begin() + First + Half, Order.begin() + First + Count,
+                     [&](Uint32 a, Uint32 b) { return m_Lights[a].Pos[Axis] < m_Lights[b].Pos[Axis]; });
+
+    N.Child          = static_cast<Uint32>(m_Nodes.size());
+    m_Nodes[NodeIdx] = N;
+    m_Nodes.emplace_back();
+    m_Nodes.emplace_back();
+    BuildNode(N.Child, First, Half, Order);
+    BuildNode(N.Child + 1, First + Half, Count - Half, Order);
+}
+
+Uint32 LightBVH::SampleLight(const float3& P, const float3& Normal, float u, float& Pdf) const
+{
+    Pdf = 0;
+    if (m_Nodes.empty() || GetImportance(m_Nodes[0], P, Normal) <= 0)
+        return InvalidLight;
+
+    Pdf = 1;
+
+    Uint32 NodeIdx = 0;
+    while ((m_Nodes[NodeIdx].Child & LeafFlag) == 0)
+    {
+        const Uint32 Child = m_Nodes[NodeIdx].Child;
+        const float  I0    = GetImportance(m_Nodes[Child], P, Normal);
+        const float  I1    = GetImportance(m_Nodes[Child + 1], P, Normal);
+        if (I0 + I1 <= 0)
+        {
+            Pdf = 0;
+            return InvalidLight;
+        }
+
+        // Reuse the random number for the next level.
+        const float P0 = I0 / (I0 + I1);
+        if (u < P0)
+        {
+            NodeIdx = Child;
+            u       = u / P0;
+            Pdf *= P0;
+        }
+        else
+        {
+            NodeIdx = Child + 1;
+            u       = (u - P0) / (1 - P0);
+            Pdf *= 1 - P0;
+        }
+        u = std::min(u, 0.99999994f);
+    }
+    return m_Nodes[NodeIdx].Child & ~LeafFlag;
+}
+
+} // namespace Diligent
@@ -0,0 +1,96 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "BasicMath.hpp"
+
+namespace Diligent
+{
+
+/// Bounding volume hierarchy over point and spherical area lights.
+
+/// Every light has a range beyond which it does not contribute, and its contribution falls off
+/// smoothly within the range. To select a light for a shading point, the sampler walks from the
+/// root to a leaf and picks every child with a probability proportional to its importance: the
+/// total power of the subtree scaled by the falloff at the closest point of its bounds. Subtrees
+/// that are out of range or behind the surface have zero importance. The probability of the
+/// selected light is the product of the probabilities along the path, so a shading point can
+/// trace shadow rays toward a few lights while the estimate still accounts for all of them.
+///
+/// Layouts of Light and Node must match LightAttribs and LightBVHNode in structures.fxh.
+/// GetImportance() and SampleLight() mirror the shader code in RayUtils.fxh.
+class LightBVH
+{
+public:
+    struct Light
+    {
+        float3 Pos;
+        float  Radius = 0; ///< 0 for point lights
+        float3 Color;
+        float  Range = 0; ///< Distance at which the contribution falls to zero
+    };
+
+    struct Node
+    {
+        float3 BoundsMin;
+        float  Power = 0; ///< Sum of the light powers in the subtree
+        float3 BoundsMax;
+        float  MaxRange   = 0; ///< Largest light range in the subtree
+        Uint32 Child      = 0; ///< First of the two children, or the light index with LeafFlag
+        Uint32 Padding[3] = {};
+    };
+
+    static constexpr Uint32 LeafFlag     = 0x80000000u;
+    static constexpr Uint32 InvalidLight = ~0u;
+
+    /// Builds the hierarchy. The root is node 0; children of a node are stored next to each other.
+    void Build(const Light* pLights, Uint32 NumLights);
+
+    const std::vector<Node>&  GetNodes() const { return m_Nodes; }
+    const std::vector<Light>& GetLights() const { return m_Lights; }
+
+    /// Returns the importance of a subtree for the shading point P with normal N.
+    static float GetImportance(const Node& N, const float3& P, const float3& Normal);
+
+    /// Smooth falloff of a light at distance Dist, 1 at the light and 0 at Range.
+    static float GetFalloff(float Dist, float Range);
+
+    /// Selects a light for a uniform random number u in [0, 1). Returns InvalidLight
+    /// if no light contributes to the shading point.
+    Uint32 SampleLight(const float3& P, const float3& Normal, float u, float& Pdf) const;
+
+private:
+    void BuildNode(Uint32 NodeIdx, Uint32 First, Uint32 Count, std::vector<Uint32>& Order);
+
+    std::vector<Node>  m_Nodes;
+    std::vector<Light> m_Lights;
+};
+
+} // namespace Diligent
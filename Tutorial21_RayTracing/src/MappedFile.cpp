@@ -0,0 +1,211 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "MappedFile.hpp"
+
+#include <cstdio>
+#include <string>
+#include <utility>
+
+#if PLATFORM_WIN32 || PLATFORM_UNIVERSAL_WINDOWS
+#    ifndef NOMINMAX
+#        define NOMINMAX
+#    endif
+#    include <Windows.h>
+#else
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+#include "Errors.hpp"
+
+namespace Diligent
+{
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+MappedFile::MappedFile(MappedFile&& Other) noexcept
+{
+    *this = std::move(Other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& Other) noexcept
+{
+    if (this != &Other)
+    {
+        Close();
+        std::swap(m_pData, Other.m_pData);
+        std::swap(m_Size, Other.m_Size);
+#if PLATFORM_WIN32 || PLATFORM_UNIVERSAL_WINDOWS
+        std::swap(m_hFile, Other.m_hFile);
+        std::swap(m_hMapping, Other.m_hMapping);
+#endif
+    }
+    return *this;
+}
+
+#if PLATFORM_WIN32 || PLATFORM_UNIVERSAL_WINDOWS
+
+bool MappedFile::Open(const char* Path)
+{
+    Close();
+
+    HANDLE hFile = CreateFileA(Path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        LOG_ERROR_MESSAGE("Failed to open file '", Path, "'");
+        return false;
+    }
+    m_hFile = hFile;
+
+    LARGE_INTEGER FileSize{};
+    if (!GetFileSizeEx(hFile, &FileSize) || FileSize.QuadPart == 0)
+    {
+        LOG_ERROR_MESSAGE("File '", Path, "' is empty or its size can't be queried");
+        Close();
+        return false;
+    }
+
+    HANDLE hMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (hMapping == nullptr)
+    {
+        LOG_ERROR_MESSAGE("Failed to create file mapping for '", Path, "'");
+        Close();
+        return false;
+    }
+    m_hMapping = hMapping;
+
+    m_pData = static_cast<const Uint8*>(MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0));
+    if (m_pData == nullptr)
+    {
+        LOG_ERROR_MESSAGE("Failed to map file '", Path, "'");
+        Close();
+        return false;
+    }
+    m_Size = static_cast<size_t>(FileSize.QuadPart);
+
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (m_pData != nullptr)
+        UnmapViewOfFile(m_pData);
+    if (m_hMapping != nullptr)
+        CloseHandle(m_hMapping);
+    if (m_hFile != nullptr)
+        CloseHandle(m_hFile);
+
+    m_pData    = nullptr;
+    m_Size     = 0;
+    m_hMapping = nullptr;
+    m_hFile    = nullptr;
+}
+
+#else
+
+bool MappedFile::Open(const char* Path)
+{
+    Close();
+
+    const int fd = open(Path, O_RDONLY);
+    if (fd < 0)
+    {
+        LOG_ERROR_MESSAGE("Failed to open file '", Path, "'");
+        return false;
+    }
+
+    struct stat FileStat = {};
+    if (fstat(fd, &FileStat) != 0 || FileStat.st_size == 0)
+    {
+        LOG_ERROR_MESSAGE("File '", Path, "' is empty or its size can't be queried");
+        close(fd);
+        return false;
+    }
+
+    const size_t Size  = static_cast<size_t>(FileStat.st_size);
+    void*        pData = mmap(nullptr, Size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps its own reference to the file.
+    close(fd);
+    if (pData == MAP_FAILED)
+    {
+        LOG_ERROR_MESSAGE("Failed to map file '", Path, "'");
+        return false;
+    }
+
+    // Files are parsed front to back, so let the OS read ahead aggressively.
+    madvise(pData, Size, MADV_SEQUENTIAL);
+
+    m_pData = static_cast<const Uint8*>(pData);
+    m_Size  = Size;
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (m_pData != nullptr)
+        munmap(const_cast<Uint8*>(m_pData), m_Size);
+
+    m_pData = nullptr;
+    m_Size  = 0;
+}
+
+#endif
+
+bool WriteFileAtomic(const char* Path, const void* pData, size_t Size)
+{
+    const std::string TmpPath = std::string{Path} + ".tmp";
+
+    FILE* pFile = std::fopen(TmpPath.c_str(), "wb");
+    if (pFile == nullptr)
+    {
+        LOG_ERROR_MESSAGE("Failed to create file '", TmpPath, "'");
+        return false;
+    }
+    bool Success = Size == 0 || std::fwrite(pData, Size, 1, pFile) == 1;
+    Success      = std::fclose(pFile) == 0 && Success;
+
+#if PLATFORM_WIN32 || PLATFORM_UNIVERSAL_WINDOWS
+    // rename() does not replace existing files on Windows.
+    if (Success)
+        std::remove(Path);
+#endif
+    if (!Success || std::rename(TmpPath.c_str(), Path) != 0)
+    {
+        LOG_ERROR_MESSAGE("Failed to write file '", Path, "'");
+        std::remove(TmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace Diligent
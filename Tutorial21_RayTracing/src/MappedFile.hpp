@@ -0,0 +1,74 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+#include "BasicTypes.h"
+
+namespace Diligent
+{
+
+/// Read-only memory-mapped file.
+
+/// Pages are loaded by the OS on first access, so parsers can stream through large files
+/// without copying them into intermediate buffers.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& Other) noexcept;
+    MappedFile& operator=(MappedFile&& Other) noexcept;
+
+    /// Maps the whole file. Returns false and logs an error if the file can't be mapped.
+    bool Open(const char* Path);
+    void Close();
+
+    const Uint8* GetData() const { return m_pData; }
+    size_t       GetSize() const { return m_Size; }
+    bool         IsOpen() const { return m_pData != nullptr; }
+
+private:
+    const Uint8* m_pData = nullptr;
+    size_t       m_Size  = 0;
+#if PLATFORM_WIN32 || PLATFORM_UNIVERSAL_WINDOWS
+    void* m_hFile    = nullptr;
+    void* m_hMapping = nullptr;
+#endif
+};
+
+/// Writes the data to a temporary file next to Path and then renames it to Path, so that an
+/// interrupted write never leaves a truncated file behind. Returns false and logs an error on failure.
+bool WriteFileAtomic(const char* Path, const void* pData, size_t Size);
+
+} // namespace Diligent
@@ -0,0 +1,682 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "MaterialKernels.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+using MATERIAL_TYPE = SoftwareTracer::MATERIAL_TYPE;
+
+constexpr float SmallOffset = MaterialConstants::SmallOffset;
+
+// Kernels use selects rather than branches, so both sides of a condition are always computed.
+
+float Saturate(float x)
+{
+    return std::min(std::max(x, 0.f), 1.f);
+}
+
+float Frac(float x)
+{
+    return x - std::floor(x);
+}
+
+float Pow5(float x)
+{
+    const float x2 = x * x;
+    return x2 * x2 * x;
+}
+
+float3 Reflect(const float3& I, const float3& N)
+{
+    return I - N * (2.f * dot(N, I));
+}
+
+// Returns zero for total internal reflection, like HLSL refract().
+float3 Refract(const float3& I, const float3& N, float Eta)
+{
+    const float  NdotI = dot(N, I);
+    const float  k     = 1.f - Eta * Eta * (1.f - NdotI * NdotI);
+    const float3 T     = I * Eta - N * (Eta * NdotI + std::sqrt(std::max(k, 0.f)));
+    return k < 0.f ? float3{0, 0, 0} : T;
+}
+
+// Random color channel of the diffuse materials, see Rand01() in the hit shaders.
+float Rand01(Uint32 Seed)
+{
+    return Frac(std::sin(static_cast<float>(Seed) * 12.9898f + 78.233f) * 43758.5453f);
+}
+
+float3 RandColor(Uint32 Seed)
+{
+    return float3{Rand01(Seed + 0), Rand01(Seed + 1), Rand01(Seed + 2)};
+}
+
+// See FresnelSchlick() in GlassPrimaryHit.rchit.
+float3 FresnelSchlick(const float3& F0, float CosTheta)
+{
+    return F0 + (float3{1, 1, 1} - F0) * Pow5(1.f - CosTheta);
+}
+
+float FresnelSchlick(float F0, float CosTheta)
+{
+    return F0 + (1.f - F0) * Pow5(1.f - CosTheta);
+}
+
+// See Fresnel() in SphereGlassHit.rchit.
+float Fresnel(float Eta, float CosThetaI)
+{
+    CosThetaI = std::min(std::max(CosThetaI, -1.f), 1.f);
+    Eta       = CosThetaI < 0.f ? 1.f / Eta : Eta;
+    CosThetaI = std::abs(CosThetaI);
+
+    const float Sin2T     = Eta * Eta * (1.f - CosThetaI * CosThetaI);
+    const float CosThetaT = std::sqrt(std::max(1.f - Sin2T, 0.f));
+    const float Rs        = (Eta * CosThetaI - CosThetaT) / (Eta * CosThetaI + CosThetaT);
+    const float Rp        = (Eta * CosThetaT - CosThetaI) / (Eta * CosThetaT + CosThetaI);
+    return Sin2T > 1.f ? 1.f : 0.5f * (Rs * Rs + Rp * Rp);
+}
+
+void SetRay(SecondaryRay& Ray, const float3& Origin, const float3& Direction, const float3& Weight)
+{
+    Ray.Origin    = Origin;
+    Ray.Direction = Direction;
+    Ray.Weight    = Weight;
+}
+
+void SetRayRange(SecondaryRay& Ray, float TMin, float TMax)
+{
+    Ray.TMin = TMin;
+    Ray.TMax = TMax;
+}
+
+// Kernels of the hit groups. GetUniforms() sets the parts of the result that are the same for
+// all hits of the material; Shade() sets the parts that vary per hit, which are listed by the
+// flags, and nothing else.
+struct MaterialKernelBase
+{
+    static constexpr bool   HasColor     = false; // SurfaceShading::Color
+    static constexpr bool   HasLighting  = false; // SurfaceShading::LightingAlbedo and LightingNormal
+    static constexpr bool   HasKeyLights = false; // SurfaceShading::KeyLightColor
+    static constexpr Uint32 NumRays      = 0;     // Origin, Direction and Weight of SurfaceShading::Rays
+
+    static void GetUniforms(const MaterialConstants&, Uint32, SurfaceShading&) {}
+};
+
+template <MATERIAL_TYPE Type>
+struct MaterialKernel;
+
+// CubePrimaryHit.rchit
+template <>
+struct MaterialKernel<SoftwareTracer::MATERIAL_TYPE_TEXTURED> : MaterialKernelBase
+{
+    static constexpr bool HasLighting = true;
+
+    static void GetUniforms(const MaterialConstants&, Uint32, SurfaceShading& S)
+    {
+        S.Lighting = true;
+    }
+
+    static void Shade(const MaterialConstants&, const SurfaceHit& Hit, Uint32, SurfaceShading& S)
+    {
+        S.LightingAlbedo = Hit.BaseColor;
+        S.LightingNormal = Hit.Normal;
+    }
+};
+
+// Ground.rchit
+template <>
+struct MaterialKernel<SoftwareTracer::MATERIAL_TYPE_GROUND> : MaterialKernelBase
+{
+    static constexpr bool HasLighting = true;
+
+    static void GetUniforms(const MaterialConstants&, Uint32, SurfaceShading& S)
+    {
+        S.Lighting = true;
+    }
+
+    static void Shade(const MaterialConstants&, const SurfaceHit& Hit, Uint32, SurfaceShading& S)
+    {
+        S.LightingAlbedo = Hit.BaseColor;
+        S.LightingNormal = float3{0, 1, 0};
+    }
+};
+
+// GlassPrimaryHit.rchit, glass
+template <>
+struct MaterialKernel<SoftwareTracer::MATERIAL_TYPE_GLASS> : MaterialKernelBase
+{
+    static constexpr Uint32 NumRays = 2;
+
+    static void GetUniforms(const MaterialConstants&, Uint32, SurfaceShading& S)
+    {
+        SetRayRange(S.Rays[0], SmallOffset, 100.f);
+        SetRayRange(S.Rays[1], SmallOffset, 100.f);
+    }
+
+    static void Shade(const MaterialConstants& C, const SurfaceHit& Hit, Uint32, SurfaceShading& S)
+    {
+        // The front face is the side the interpolated normal points to.
+        const float3& V      = Hit.Direction;
+        const bool    Front  = dot(V, Hit.Normal) < 0;
+        const float3  Norm   = Hit.Normal * (Front ? 1.f : -1.f);
+        const float   RelIOR = Front ? 1.f / C.GlassIOR : C.GlassIOR;
+        const float   F      = FresnelSchlick(C.GlassF0, dot(V, -Norm));
+        const float3  T      = Refract(V, Norm, RelIOR);
+
+        // The shaders trace a zero direction on total internal reflection, which F hides.
+        const float RefrWeight = F < 1.f && dot(T, T) > 0 ? 1.f - F : 0.f;
+
+        SetRay(S.Rays[0], Hit.Pos + Norm * SmallOffset, Reflect(V, Norm), float3{F, F, F});
+        SetRay(S.Rays[1], Hit.Pos, T, float3{RefrWeight, RefrWeight, RefrWeight});
+    }
+};
+
+// GlassPrimaryHit.rchit, diffuse
+template <>
+struct MaterialKernel<SoftwareTracer::MATERIAL_TYPE_DIFFUSE> : MaterialKernelBase
+{
+    static constexpr bool HasColor = true;
+
+    static void Shade(const MaterialConstants& C, const SurfaceHit& Hit, Uint32, SurfaceShading& S)
+    {
+        // Lambert toward the first key light from the ray origin, see ShadeDiffuse(). The object id
+        // is the fixed instance index, so every object has its own color.
+        const float3 Albedo = RandColor(Hit.ObjectId);
+        const float  NdotL  = std::max(dot(Hit.Normal, normalize(C.LightPos[0] - Hit.Origin)), 0.f);
+        S.Color             = Albedo * C.LightColor[0] * NdotL + C.Ambient * Albedo;
+    }
+};
+
+// GlassPrimaryHit.rchit, metal
+template <>
+struct MaterialKernel<SoftwareTracer::MATERIAL_TYPE_METAL> : MaterialKernelBase
+{
+    static constexpr Uint32 NumRays = 1;
+
+    static void GetUniforms(const MaterialConstants&, Uint32, SurfaceShading& S)
+    {
+        SetRayRange(S.Rays[0], SmallOffset, 100.f);
+    }
+
+    static void Shade(const MaterialConstants&, const SurfaceHit& Hit, Uint32, SurfaceShading& S)
+    {
+        const float3& V = Hit.Direction;
+        const float3  F = FresnelSchlick(float3{0.95f, 0.93f, 0.88f}, Saturate(dot(-V, Hit.Normal)));
+        SetRay(S.Rays[0], Hit.Pos + Hit.Normal * SmallOffset, Reflect(V, Hit.Normal), F);
+    }
+};
+
+// SpherePrimaryHit.rchit
+template <>
+struct MaterialKernel<SoftwareTracer::MATERIAL_TYPE_MIRROR_SPHERE> : MaterialKernelBase
+{
+    static constexpr Uint32 NumRays = 1;
+
+    static Uint32 GetNumSamples(const MaterialConstants& C, Uint32 Recursion)
+    {
+        return Recursion > 1 ? 1u : static_cast<Uint32>(std::max(C.SphereReflectionBlur, 1));
+    }
+
+    static void GetUniforms(const MaterialConstants& C, Uint32 Recursion, SurfaceShading& S)
+    {
+        SetRayRange(S.Rays[0], 0.f, 100.f);
+        S.Rays[0].ConeSize   = 0.01f;
+        S.Rays[0].NumSamples = GetNumSamples(C, Recursion);
+        S.Rays[0].SampleSeed = 0x2000 + Recursion * 2;
+    }
+
+    static void Shade(const MaterialConstants& C, const SurfaceHit& Hit, Uint32 Recursion, SurfaceShading& S)
+    {
+        const float3 Weight = C.SphereReflectionColorMask / static_cast<float>(GetNumSamples(C, Recursion));
+        SetRay(S.Rays[0], Hit.Pos + Hit.Normal * SmallOffset, Reflect(Hit.Direction, Hit.Normal), Weight);
+    }
+};
+
+// SphereDiffuseHit.rchit
+template <>
+struct MaterialKernel<SoftwareTracer::MATERIAL_TYPE_DIFFUSE_SPHERE> : MaterialKernelBase
+{
+    static constexpr bool HasColor     = true;
+    static constexpr bool HasKeyLights = true;
+
+    static void Shade(const MaterialConstants& C, const SurfaceHit& Hit, Uint32, SurfaceShading& S)
+    {
+        // Small spheres have random colors.
+        const float3 Albedo = Hit.ObjectId >= 4 ? RandColor(Hit.ObjectId) : C.SphereReflectionColorMask;
+
+        S.Color = C.Ambient;
+        for (Uint32 i = 0; i < NUM_LIGHTS; ++i)
+        {
+            const float3 L     = normalize(C.LightPos[i] - Hit.Pos);
+            S.KeyLightColor[i] = C.LightColor[i] * Albedo * Saturate(dot(Hit.Normal, L));
+        }
+    }
+};
+
+// SphereGlassHit.rchit, including its directions.
+template <>
+struct MaterialKernel<SoftwareTracer::MATERIAL_TYPE_GLASS_SPHERE> : MaterialKernelBase
+{
+    static constexpr Uint32 NumRays = 2;
+
+    static void GetUniforms(const MaterialConstants&, Uint32, SurfaceShading& S)
+    {
+        SetRayRange(S.Rays[0], 0.f, 1e38f);
+        SetRayRange(S.Rays[1], 0.f, 1e38f);
+    }
+
+    static void Shade(const MaterialConstants& C, const SurfaceHit& Hit, Uint32, SurfaceShading& S)
+    {
+        const float3 ToEye   = -Hit.Direction;
+        const float  CosI    = Saturate(dot(Hit.Normal, ToEye));
+        const float3 ReflDir = Reflect(ToEye, Hit.Normal);
+        const float3 RefrDir = Refract(ToEye, Hit.Normal, 1.f / C.GlassIOR);
+        const float  Kr      = Fresnel(C.GlassIOR, CosI);
+
+        const float3 RefrWeight = dot(RefrDir, RefrDir) > 0 ? C.GlassMaterialColor * (1.f - Kr) : float3{0, 0, 0};
+
+        SetRay(S.Rays[0], Hit.Pos + ReflDir * SmallOffset, ReflDir, float3{Kr, Kr, Kr});
+        SetRay(S.Rays[1], Hit.Pos + RefrDir * SmallOffset, RefrDir, RefrWeight);
+    }
+};
+
+// Streams of MaterialBatchShader::m_HitStreams.
+enum HIT_STREAM : Uint32
+{
+    HIT_STREAM_ORIGIN     = 0,
+    HIT_STREAM_DIRECTION  = 3,
+    HIT_STREAM_POS        = 6,
+    HIT_STREAM_NORMAL     = 9,
+    HIT_STREAM_BASE_COLOR = 12,
+    HIT_STREAM_COUNT      = 15
+};
+
+// Streams of MaterialBatchShader::m_ResultStreams. Every ray has its origin, direction and weight.
+enum RESULT_STREAM : Uint32
+{
+    RESULT_STREAM_COLOR           = 0,
+    RESULT_STREAM_LIGHTING_ALBEDO = 3,
+    RESULT_STREAM_LIGHTING_NORMAL = 6,
+    RESULT_STREAM_KEY_LIGHTS      = 9,
+    RESULT_STREAM_RAYS            = RESULT_STREAM_KEY_LIGHTS + NUM_LIGHTS * 3,
+    RESULT_STREAM_COUNT           = RESULT_STREAM_RAYS + SurfaceShading::MaxRays * 9
+};
+
+// Structure-of-arrays storage, in which the floats of one element are Stride floats apart.
+struct Streams
+{
+    float* pData  = nullptr;
+    Uint32 Stride = 0;
+
+    float3 Load(Uint32 Stream, Uint32 i) const
+    {
+        const float* p = pData + size_t{Stream} * Stride + i;
+        return float3{p[0], p[Stride], p[size_t{Stride} * 2]};
+    }
+
+    void Store(Uint32 Stream, Uint32 i, const float3& v) const
+    {
+        float* p              = pData + size_t{Stream} * Stride + i;
+        p[0]                  = v.x;
+        p[Stride]             = v.y;
+        p[size_t{Stride} * 2] = v.z;
+    }
+};
+
+template <MATERIAL_TYPE Type>
+void ShadeHit(const MaterialConstants& C, const SurfaceHit& Hit, Uint32 Recursion, SurfaceShading& S)
+{
+    S = SurfaceShading{};
+    MaterialKernel<Type>::GetUniforms(C, Recursion, S);
+    MaterialKernel<Type>::Shade(C, Hit, Recursion, S);
+}
+
+// Shades the sorted hits [Begin, End), which all have the material Type, and stores the results
+// that vary per hit.
+template <MATERIAL_TYPE Type>
+void ShadeRange(const MaterialConstants& C, const Streams& Hits, const Uint32* pObjectIds, Uint32 Begin, Uint32 End, Uint32 Recursion, const Streams& Results)
+{
+    using Kernel = MaterialKernel<Type>;
+    for (Uint32 i = Begin; i < End; ++i)
+    {
+        SurfaceHit Hit;
+        Hit.Origin    = Hits.Load(HIT_STREAM_ORIGIN, i);
+        Hit.Direction = Hits.Load(HIT_STREAM_DIRECTION, i);
+        Hit.Pos       = Hits.Load(HIT_STREAM_POS, i);
+        Hit.Normal    = Hits.Load(HIT_STREAM_NORMAL, i);
+        Hit.BaseColor = Hits.Load(HIT_STREAM_BASE_COLOR, i);
+        Hit.ObjectId  = pObjectIds[i];
+
+        SurfaceShading S;
+        Kernel::Shade(C, Hit, Recursion, S);
+
+        if (Kernel::HasColor)
+            Results.Store(RESULT_STREAM_COLOR, i, S.Color);
+        if (Kernel::HasLighting)
+        {
+            Results.Store(RESULT_STREAM_LIGHTING_ALBEDO, i, S.LightingAlbedo);
+            Results.Store(RESULT_STREAM_LIGHTING_NORMAL, i, S.LightingNormal);
+        }
+        if (Kernel::HasKeyLights)
+        {
+            for (Uint32 l = 0; l < NUM_LIGHTS; ++l)
+                Results.Store(RESULT_STREAM_KEY_LIGHTS + l * 3, i, S.KeyLightColor[l]);
+        }
+        for (Uint32 r = 0; r < Kernel::NumRays; ++r)
+        {
+            Results.Store(RESULT_STREAM_RAYS + r * 9 + 0, i, S.Rays[r].Origin);
+            Results.Store(RESULT_STREAM_RAYS + r * 9 + 3, i, S.Rays[r].Direction);
+            Results.Store(RESULT_STREAM_RAYS + r * 9 + 6, i, S.Rays[r].Weight);
+        }
+    }
+}
+
+// Reads the results of sorted hit i, which has the material Type, on top of the uniform results.
+template <MATERIAL_TYPE Type>
+void LoadResult(const Streams& Results, Uint32 i, SurfaceShading& S)
+{
+    using Kernel = MaterialKernel<Type>;
+    if (Kernel::HasColor)
+        S.Color = Results.Load(RESULT_STREAM_COLOR, i);
+    if (Kernel::HasLighting)
+    {
+        S.LightingAlbedo = Results.Load(RESULT_STREAM_LIGHTING_ALBEDO, i);
+        S.LightingNormal = Results.Load(RESULT_STREAM_LIGHTING_NORMAL, i);
+    }
+    if (Kernel::HasKeyLights)
+    {
+        for (Uint32 l = 0; l < NUM_LIGHTS; ++l)
+            S.KeyLightColor[l] = Results.Load(RESULT_STREAM_KEY_LIGHTS + l * 3, i);
+    }
+    for (Uint32 r = 0; r < Kernel::NumRays; ++r)
+    {
+        S.Rays[r].Origin    = Results.Load(RESULT_STREAM_RAYS + r * 9 + 0, i);
+        S.Rays[r].Direction = Results.Load(RESULT_STREAM_RAYS + r * 9 + 3, i);
+        S.Rays[r].Weight    = Results.Load(RESULT_STREAM_RAYS + r * 9 + 6, i);
+    }
+}
+
+struct KernelFuncs
+{
+    void (*ShadeHit)(const MaterialConstants&, const SurfaceHit&, Uint32, SurfaceShading&);
+    void (*ShadeRange)(const MaterialConstants&, const Streams&, const Uint32*, Uint32, Uint32, Uint32, const Streams&);
+    void (*GetUniforms)(const MaterialConstants&, Uint32, SurfaceShading&);
+    void (*LoadResult)(const Streams&, Uint32, SurfaceShading&);
+};
+
+template <MATERIAL_TYPE Type>
+constexpr KernelFuncs GetKernelFuncs()
+{
+    return KernelFuncs{ShadeHit<Type>, ShadeRange<Type>, MaterialKernel<Type>::GetUniforms, LoadResult<Type>};
+}
+
+constexpr KernelFuncs Kernels[] = {
+    GetKernelFuncs<SoftwareTracer::MATERIAL_TYPE_TEXTURED>(),
+    GetKernelFuncs<SoftwareTracer::MATERIAL_TYPE_GROUND>(),
+    GetKernelFuncs<SoftwareTracer::MATERIAL_TYPE_GLASS>(),
+    GetKernelFuncs<SoftwareTracer::MATERIAL_TYPE_DIFFUSE>(),
+    GetKernelFuncs<SoftwareTracer::MATERIAL_TYPE_METAL>(),
+    GetKernelFuncs<SoftwareTracer::MATERIAL_TYPE_MIRROR_SPHERE>(),
+    GetKernelFuncs<SoftwareTracer::MATERIAL_TYPE_DIFFUSE_SPHERE>(),
+    GetKernelFuncs<SoftwareTracer::MATERIAL_TYPE_GLASS_SPHERE>(),
+};
+static_assert(_countof(Kernels) == SoftwareTracer::MATERIAL_TYPE_COUNT, "Please update Kernels");
+
+float GetMaxDifference(const float3& a, const float3& b)
+{
+    return std::max({std::abs(a.x - b.x), std::abs(a.y - b.y), std::abs(a.z - b.z)});
+}
+
+float GetMaxDifference(const SurfaceShading& a, const SurfaceShading& b)
+{
+    float Diff = std::max({GetMaxDifference(a.Color, b.Color),
+                           GetMaxDifference(a.LightingAlbedo, b.LightingAlbedo),
+                           GetMaxDifference(a.LightingNormal, b.LightingNormal)});
+    for (Uint32 i = 0; i < NUM_LIGHTS; ++i)
+        Diff = std::max(Diff, GetMaxDifference(a.KeyLightColor[i], b.KeyLightColor[i]));
+    for (Uint32 i = 0; i < SurfaceShading::MaxRays; ++i)
+    {
+        const auto& RayA = a.Rays[i];
+        const auto& RayB = b.Rays[i];
+
+        Diff = std::max({Diff,
+                         GetMaxDifference(RayA.Origin, RayB.Origin),
+                         GetMaxDifference(RayA.Direction, RayB.Direction),
+                         GetMaxDifference(RayA.Weight, RayB.Weight),
+                         std::abs(RayA.TMin - RayB.TMin),
+                         std::abs(RayA.TMax - RayB.TMax),
+                         std::abs(RayA.ConeSize - RayB.ConeSize)});
+        if (RayA.NumSamples != RayB.NumSamples || RayA.SampleSeed != RayB.SampleSeed)
+            Diff = std::max(Diff, 1.f);
+    }
+    return a.Lighting == b.Lighting ? Diff : std::max(Diff, 1.f);
+}
+
+} // namespace
+
+MaterialConstants::MaterialConstants(const HLSL::Constants& Constants) :
+    Ambient{Constants.AmbientColor.x, Constants.AmbientColor.y, Constants.AmbientColor.z},
+    SphereReflectionColorMask{Constants.SphereReflectionColorMask},
+    GlassMaterialColor{Constants.GlassMaterialColor.x, Constants.GlassMaterialColor.y, Constants.GlassMaterialColor.z},
+    GlassIOR{Constants.GlassIndexOfRefraction.x},
+    GlassF0{std::pow((GlassIOR - 1.f) / (GlassIOR + 1.f), 2.f)},
+    SphereReflectionBlur{Constants.SphereReflectionBlur}
+{
+    for (Uint32 i = 0; i < NUM_LIGHTS; ++i)
+    {
+        LightPos[i]   = float3{Constants.LightPos[i].x, Constants.LightPos[i].y, Constants.LightPos[i].z};
+        LightColor[i] = float3{Constants.LightColor[i].x, Constants.LightColor[i].y, Constants.LightColor[i].z};
+    }
+}
+
+void MaterialBatchShader::Shade(const MaterialConstants& Constants,
+                                const SurfaceHit*        pHits,
+                                const MATERIAL_TYPE*     pTypes,
+                                Uint32                   NumHits,
+                                Uint32                   Recursion)
+{
+    // Counting sort by material type.
+    Uint32 Offsets[SoftwareTracer::MATERIAL_TYPE_COUNT + 1] = {};
+    for (Uint32 i = 0; i < NumHits; ++i)
+    {
+        VERIFY_EXPR(pTypes[i] < SoftwareTracer::MATERIAL_TYPE_COUNT);
+        ++Offsets[pTypes[i] + 1];
+    }
+    for (Uint32 t = 0; t < SoftwareTracer::MATERIAL_TYPE_COUNT; ++t)
+        Offsets[t + 1] += Offsets[t];
+
+    // Pad the streams so that they do not start at the same offset in a page: with tile-sized
+    // batches, the same element of every stream would otherwise map to the same cache set.
+    m_Stride = (NumHits + 15u) / 16u * 16u + 16u;
+    m_HitStreams.resize(size_t{HIT_STREAM_COUNT} * m_Stride);
+    m_ResultStreams.resize(size_t{RESULT_STREAM_COUNT} * m_Stride);
+    m_ObjectIds.resize(NumHits);
+    m_SortedIdx.resize(NumHits);
+    m_Types.resize(NumHits);
+
+    const Streams Hits{m_HitStreams.data(), m_Stride};
+    const Streams Results{m_ResultStreams.data(), m_Stride};
+
+    Uint32 Next[SoftwareTracer::MATERIAL_TYPE_COUNT];
+    std::copy_n(Offsets, SoftwareTracer::MATERIAL_TYPE_COUNT, Next);
+    for (Uint32 i = 0; i < NumHits; ++i)
+    {
+        const Uint32 SortedIdx = Next[pTypes[i]]++;
+        const auto&  Hit       = pHits[i];
+        Hits.Store(HIT_STREAM_ORIGIN, SortedIdx, Hit.Origin);
+        Hits.Store(HIT_STREAM_DIRECTION, SortedIdx, Hit.Direction);
+        Hits.Store(HIT_STREAM_POS, SortedIdx, Hit.Pos);
+        Hits.Store(HIT_STREAM_NORMAL, SortedIdx, Hit.Normal);
+        Hits.Store(HIT_STREAM_BASE_COLOR, SortedIdx, Hit.BaseColor);
+        m_ObjectIds[SortedIdx] = Hit.ObjectId;
+        m_SortedIdx[i]         = SortedIdx;
+        m_Types[i]             = static_cast<Uint8>(pTypes[i]);
+    }
+
+    for (Uint32 t = 0; t < SoftwareTracer::MATERIAL_TYPE_COUNT; ++t)
+    {
+        if (Offsets[t] == Offsets[t + 1])
+            continue;
+
+        m_Uniforms[t] = SurfaceShading{};
+        Kernels[t].GetUniforms(Constants, Recursion, m_Uniforms[t]);
+        Kernels[t].ShadeRange(Constants, Hits, m_ObjectIds.data(), Offsets[t], Offsets[t + 1], Recursion, Results);
+    }
+}
+
+void MaterialBatchShader::GetShading(Uint32 HitIdx, SurfaceShading& Shading) const
+{
+    VERIFY_EXPR(HitIdx < m_SortedIdx.size());
+    const Uint32 Type = m_Types[HitIdx];
+    Shading           = m_Uniforms[Type];
+    Kernels[Type].LoadResult(Streams{const_cast<float*>(m_ResultStreams.data()), m_Stride}, m_SortedIdx[HitIdx], Shading);
+}
+
+void MaterialBatchShader::ShadeHit(const MaterialConstants& Constants, const SurfaceHit& Hit, MATERIAL_TYPE Type, Uint32 Recursion, SurfaceShading& Shading)
+{
+    VERIFY_EXPR(Type < SoftwareTracer::MATERIAL_TYPE_COUNT);
+    Kernels[Type].ShadeHit(Constants, Hit, Recursion, Shading);
+}
+
+MaterialBatchShader::BenchmarkResult MaterialBatchShader::RunBenchmark(const MaterialConstants&          Constants,
+                                                                       const std::vector<SurfaceHit>&    Hits,
+                                                                       const std::vector<MATERIAL_TYPE>& Types,
+                                                                       Uint32                            NumIterations,
+                                                                       Uint32                            BatchSize)
+{
+    VERIFY_EXPR(Hits.size() == Types.size() && BatchSize > 0);
+
+    BenchmarkResult Result;
+    Result.NumHits = static_cast<Uint32>(Hits.size());
+    if (Result.NumHits == 0 || NumIterations == 0)
+        return Result;
+
+    VirtualMaterialShader       Virtual;
+    MaterialBatchShader         Batch;
+    std::vector<SurfaceShading> VirtualResults(Hits.size());
+
+    const auto Measure = [&](const auto& Shade) {
+        // The first run is not timed: it allocates the buffers and warms up the caches.
+        Shade();
+        const auto Start = std::chrono::high_resolution_clock::now();
+        for (Uint32 i = 0; i < NumIterations; ++i)
+            Shade();
+        const double Ns = std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - Start).count();
+        return Ns / (static_cast<double>(NumIterations) * Result.NumHits);
+    };
+    // Hits are shaded in batches of the size the tracer uses, see SoftwareTracer::RenderTile().
+    Result.VirtualNsPerHit = Measure([&]() {
+        for (Uint32 i = 0; i < Result.NumHits; i += BatchSize)
+            Virtual.Shade(Constants, &Hits[i], &Types[i], std::min(BatchSize, Result.NumHits - i), 0, &VirtualResults[i]);
+    });
+    Result.BatchNsPerHit = Measure([&]() {
+        for (Uint32 i = 0; i < Result.NumHits; i += BatchSize)
+            Batch.Shade(Constants, &Hits[i], &Types[i], std::min(BatchSize, Result.NumHits - i), 0);
+    });
+    Result.Speedup = Result.BatchNsPerHit > 0 ? Result.VirtualNsPerHit / Result.BatchNsPerHit : 0;
+
+    for (Uint32 i = 0; i < Result.NumHits; i += BatchSize)
+    {
+        const Uint32 NumHits = std::min(BatchSize, Result.NumHits - i);
+        Batch.Shade(Constants, &Hits[i], &Types[i], NumHits, 0);
+        for (Uint32 j = 0; j < NumHits; ++j)
+        {
+            SurfaceShading Shading;
+            Batch.GetShading(j, Shading);
+            Result.MaxDifference = std::max(Result.MaxDifference, GetMaxDifference(Shading, VirtualResults[i + j]));
+        }
+    }
+
+    return Result;
+}
+
+class VirtualMaterialShader::Material
+{
+public:
+    virtual ~Material() {}
+
+    virtual void Shade(const MaterialConstants& Constants, const SurfaceHit& Hit, Uint32 Recursion, SurfaceShading& Shading) const = 0;
+};
+
+namespace
+{
+
+template <MATERIAL_TYPE Type>
+class KernelMaterial final : public VirtualMaterialShader::Material
+{
+public:
+    virtual void Shade(const MaterialConstants& Constants, const SurfaceHit& Hit, Uint32 Recursion, SurfaceShading& Shading) const override final
+    {
+        ShadeHit<Type>(Constants, Hit, Recursion, Shading);
+    }
+};
+
+} // namespace
+
+VirtualMaterialShader::VirtualMaterialShader()
+{
+    m_Materials.emplace_back(new KernelMaterial<SoftwareTracer::MATERIAL_TYPE_TEXTURED>);
+    m_Materials.emplace_back(new KernelMaterial<SoftwareTracer::MATERIAL_TYPE_GROUND>);
+    m_Materials.emplace_back(new KernelMaterial<SoftwareTracer::MATERIAL_TYPE_GLASS>);
+    m_Materials.emplace_back(new KernelMaterial<SoftwareTracer::MATERIAL_TYPE_DIFFUSE>);
+    m_Materials.emplace_back(new KernelMaterial<SoftwareTracer::MATERIAL_TYPE_METAL>);
+    m_Materials.emplace_back(new KernelMaterial<SoftwareTracer::MATERIAL_TYPE_MIRROR_SPHERE>);
+    m_Materials.emplace_back(new KernelMaterial<SoftwareTracer::MATERIAL_TYPE_DIFFUSE_SPHERE>);
+    m_Materials.emplace_back(new KernelMaterial<SoftwareTracer::MATERIAL_TYPE_GLASS_SPHERE>);
+    VERIFY_EXPR(m_Materials.size() == SoftwareTracer::MATERIAL_TYPE_COUNT);
+}
+
+VirtualMaterialShader::~VirtualMaterialShader()
+{
+}
+
+void VirtualMaterialShader::Shade(const MaterialConstants& Constants,
+                                  const SurfaceHit*        pHits,
+                                  const MATERIAL_TYPE*     pTypes,
+                                  Uint32                   NumHits,
+                                  Uint32                   Recursion,
+                                  SurfaceShading*          pResults) const
+{
+    for (Uint32 i = 0; i < NumHits; ++i)
+    {
+        VERIFY_EXPR(pTypes[i] < m_Materials.size());
+        m_Materials[pTypes[i]]->Shade(Constants, pHits[i], Recursion, pResults[i]);
+    }
+}
+
+} // namespace Diligent
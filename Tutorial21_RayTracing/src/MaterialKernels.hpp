@@ -0,0 +1,179 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "BasicMath.hpp"
+#include "SoftwareTracer.hpp"
+
+namespace Diligent
+{
+
+/// Constants of the material kernels, taken from HLSL::Constants.
+struct MaterialConstants
+{
+    /// Small offset between ray intersection and new ray origin, see RayUtils.fxh.
+    static constexpr float SmallOffset = 0.0001f;
+
+    MaterialConstants() = default;
+    explicit MaterialConstants(const HLSL::Constants& Constants);
+
+    float3 Ambient;
+    float3 LightPos[NUM_LIGHTS];
+    float3 LightColor[NUM_LIGHTS];
+    float3 SphereReflectionColorMask;
+    float3 GlassMaterialColor;
+    float  GlassIOR             = 1.5f;
+    float  GlassF0              = 0.04f; ///< Reflectance of the glass cube at normal incidence
+    Int32  SphereReflectionBlur = 1;
+};
+
+/// Surface point hit by a ray, the input of the material kernels.
+struct SurfaceHit
+{
+    float3 Origin;    ///< Origin of the ray
+    float3 Direction; ///< Normalized direction of the ray
+    float3 Pos;
+    float3 Normal;    ///< Interpolated vertex normal in world space, or the outward sphere normal
+    float3 BaseColor; ///< See SoftwareTracer::Material
+    Uint32 ObjectId = 0;
+};
+
+/// Ray that a material traces to complete its shading. The traced color is multiplied by Weight,
+/// and rays with zero weight are not traced.
+struct SecondaryRay
+{
+    float3 Origin;
+    float3 Direction;
+    float3 Weight;
+
+    // The same for all hits of a material at a recursion depth.
+    float  TMin       = 0;
+    float  TMax       = 0;
+    float  ConeSize   = 0; ///< Samples are jittered within the cone with the disc samples, see DirectionWithinCone()
+    Uint32 NumSamples = 1; ///< The traced color is the sum of all samples
+    Uint32 SampleSeed = 0;
+};
+
+/// Result of a material kernel. Kernels do not trace rays: the parts of the hit shaders that
+/// do are described here and evaluated by the caller, see SoftwareTracer.
+struct SurfaceShading
+{
+    static constexpr Uint32 MaxRays = 2;
+
+    float3       Color;                     ///< Part of the color that needs no rays
+    float3       LightingAlbedo;            ///< Color passed to LightingPass() if Lighting is true
+    float3       LightingNormal;            ///< Normal passed to LightingPass() if Lighting is true
+    float3       KeyLightColor[NUM_LIGHTS]; ///< Added if the key light is not shadowed, see SphereDiffuseHit.rchit
+    SecondaryRay Rays[MaxRays];
+    bool         Lighting = false;
+};
+
+/// Shades hits with kernels that are specialized for every material type at compile time.
+
+/// Hits are sorted by material type with a counting sort and copied into structure-of-arrays
+/// streams. Every material then shades its range of hits in one loop with its own kernel, so
+/// there is one dispatch per material rather than per hit. The loops have no material branches
+/// and only store the results their material produces. Every hit is still shaded with scalar
+/// float3 math; the loops are not vectorized across hits.
+/// The kernels mirror the hit shaders and RayUtils.fxh.
+class MaterialBatchShader
+{
+public:
+    using MATERIAL_TYPE = SoftwareTracer::MATERIAL_TYPE;
+
+    /// Shades NumHits hits of rays at the given recursion depth. The results are kept until
+    /// the next call, see GetShading().
+    void Shade(const MaterialConstants& Constants,
+               const SurfaceHit*        pHits,
+               const MATERIAL_TYPE*     pTypes,
+               Uint32                   NumHits,
+               Uint32                   Recursion);
+
+    /// Returns the result of hit HitIdx of the last Shade() call.
+    void GetShading(Uint32 HitIdx, SurfaceShading& Shading) const;
+
+    /// Shades a single hit, e.g. the hit of a secondary ray.
+    static void ShadeHit(const MaterialConstants& Constants, const SurfaceHit& Hit, MATERIAL_TYPE Type, Uint32 Recursion, SurfaceShading& Shading);
+
+    struct BenchmarkResult
+    {
+        Uint32 NumHits         = 0;
+        double VirtualNsPerHit = 0; ///< VirtualMaterialShader
+        double BatchNsPerHit   = 0; ///< MaterialBatchShader, including sorting
+        double Speedup         = 0; ///< VirtualNsPerHit divided by BatchNsPerHit
+        float  MaxDifference   = 0; ///< Largest difference of the results of both shaders
+    };
+
+    /// Shades the hits NumIterations times with VirtualMaterialShader and with MaterialBatchShader
+    /// in batches of BatchSize hits and compares the time and the results.
+    static BenchmarkResult RunBenchmark(const MaterialConstants&          Constants,
+                                        const std::vector<SurfaceHit>&    Hits,
+                                        const std::vector<MATERIAL_TYPE>& Types,
+                                        Uint32                            NumIterations,
+                                        Uint32                            BatchSize = 1024);
+
+private:
+    Uint32              m_Stride = 0;    // Floats between two streams
+    std::vector<float>  m_HitStreams;    // One stream per float of SurfaceHit, in sorted order
+    std::vector<Uint32> m_ObjectIds;     // In sorted order
+    std::vector<float>  m_ResultStreams; // One stream per float of SurfaceShading that varies per hit, in sorted order
+    std::vector<Uint32> m_SortedIdx;     // Index of every hit in the sorted order
+    std::vector<Uint8>  m_Types;         // Material type of every hit
+
+    // Results that are the same for all hits of a material
+    SurfaceShading m_Uniforms[SoftwareTracer::MATERIAL_TYPE_COUNT];
+};
+
+/// Baseline for MaterialBatchShader: every hit is shaded in the original order by a virtual
+/// call to the shader of its material, which writes the whole result. The shaders use the
+/// same kernels.
+class VirtualMaterialShader
+{
+public:
+    using MATERIAL_TYPE = SoftwareTracer::MATERIAL_TYPE;
+
+    class Material;
+
+    VirtualMaterialShader();
+    ~VirtualMaterialShader();
+
+    void Shade(const MaterialConstants& Constants,
+               const SurfaceHit*        pHits,
+               const MATERIAL_TYPE*     pTypes,
+               Uint32                   NumHits,
+               Uint32                   Recursion,
+               SurfaceShading*          pResults) const;
+
+private:
+    std::vector<std::unique_ptr<Material>> m_Materials;
+};
+
+} // namespace Diligent
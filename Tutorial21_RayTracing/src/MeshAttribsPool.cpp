@@ -0,0 +1,99 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "MeshAttribsPool.hpp"
+
+#include <cmath>
+
+#include "DebugUtilities.hpp"
+#include "RayConeLOD.hpp"
+
+namespace Diligent
+{
+
+Uint32 MeshAttribsPool::AddMesh(const MeshVertex* pVertices, Uint32 NumVertices, const Uint32* pIndices, Uint32 NumIndices)
+{
+    VERIFY_EXPR(pVertices != nullptr && pIndices != nullptr);
+    VERIFY(NumIndices % 3 == 0, "Index count must be a multiple of 3");
+
+    Mesh NewMesh;
+    NewMesh.FirstVertex = static_cast<Uint32>(m_Vertices.size());
+    NewMesh.FirstIndex  = static_cast<Uint32>(m_Indices.size());
+    NewMesh.NumVertices = NumVertices;
+    NewMesh.NumIndices  = NumIndices;
+
+    m_Vertices.reserve(m_Vertices.size() + NumVertices);
+    for (Uint32 v = 0; v < NumVertices; ++v)
+        m_Vertices.push_back({EncodeNormal(pVertices[v].Normal), pVertices[v].UV});
+
+    // Indices stay relative to the first vertex of the mesh, like in BLAS build input.
+    m_Indices.insert(m_Indices.end(), pIndices, pIndices + NumIndices);
+
+    m_TriangleLODs.reserve(m_TriangleLODs.size() + NumIndices / 3);
+    for (Uint32 i = 0; i < NumIndices; i += 3)
+    {
+        const auto& V0 = pVertices[pIndices[i + 0]];
+        const auto& V1 = pVertices[pIndices[i + 1]];
+        const auto& V2 = pVertices[pIndices[i + 2]];
+        m_TriangleLODs.push_back(ComputeTriangleLODConstant(V0.Pos, V1.Pos, V2.Pos, V0.UV, V1.UV, V2.UV));
+    }
+
+    m_Meshes.push_back(NewMesh);
+    return static_cast<Uint32>(m_Meshes.size() - 1);
+}
+
+// Octahedron normal encoding: the unit sphere is projected onto an octahedron that is
+// then unfolded onto the [-1, 1] square.
+float2 MeshAttribsPool::EncodeNormal(const float3& Normal)
+{
+    const float L1 = std::abs(Normal.x) + std::abs(Normal.y) + std::abs(Normal.z);
+    if (L1 == 0)
+        return float2{0, 0};
+
+    float2 Enc{Normal.x / L1, Normal.y / L1};
+    if (Normal.z < 0)
+    {
+        Enc = float2{
+            (1.f - std::abs(Enc.y)) * (Enc.x >= 0 ? 1.f : -1.f),
+            (1.f - std::abs(Enc.x)) * (Enc.y >= 0 ? 1.f : -1.f),
+        };
+    }
+    return Enc;
+}
+
+float3 MeshAttribsPool::DecodeNormal(const float2& Enc)
+{
+    float3 N{Enc.x, Enc.y, 1.f - std::abs(Enc.x) - std::abs(Enc.y)};
+    if (N.z < 0)
+    {
+        N.x = (1.f - std::abs(Enc.y)) * (Enc.x >= 0 ? 1.f : -1.f);
+        N.y = (1.f - std::abs(Enc.x)) * (Enc.y >= 0 ? 1.f : -1.f);
+    }
+    return normalize(N);
+}
+
+} // namespace Diligent
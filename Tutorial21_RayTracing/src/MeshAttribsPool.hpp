@@ -0,0 +1,83 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "BasicMath.hpp"
+#include "MeshLoader.hpp"
+
+namespace Diligent
+{
+
+/// Collects shading attributes of all triangle meshes in the scene into shared arrays.
+
+/// Closest hit shaders find a mesh by its index and interpolate normals and texture
+/// coordinates from these arrays, so the number of meshes and their sizes are not
+/// limited by constant buffer layouts. Layouts of Mesh and Vertex must match
+/// MeshAttribs and MeshVertexAttribs in structures.fxh.
+/// The pool also keeps the ray cone LOD constant of every triangle, see RayConeLOD.hpp.
+/// Triangles of a mesh start at Mesh::FirstIndex / 3.
+class MeshAttribsPool
+{
+public:
+    struct Mesh
+    {
+        Uint32 FirstVertex = 0;
+        Uint32 FirstIndex  = 0;
+        Uint32 NumVertices = 0;
+        Uint32 NumIndices  = 0;
+    };
+
+    struct Vertex
+    {
+        float2 Normal; ///< Octahedron-encoded normal
+        float2 UV;
+    };
+
+    /// Appends mesh attributes and returns the mesh index.
+    Uint32 AddMesh(const MeshVertex* pVertices, Uint32 NumVertices, const Uint32* pIndices, Uint32 NumIndices);
+
+    Uint32 GetNumMeshes() const { return static_cast<Uint32>(m_Meshes.size()); }
+
+    const std::vector<Mesh>&   GetMeshes() const { return m_Meshes; }
+    const std::vector<Vertex>& GetVertices() const { return m_Vertices; }
+    const std::vector<Uint32>& GetIndices() const { return m_Indices; }
+    const std::vector<float>&  GetTriangleLODs() const { return m_TriangleLODs; }
+
+    static float2 EncodeNormal(const float3& Normal);
+    static float3 DecodeNormal(const float2& Encoded);
+
+private:
+    std::vector<Mesh>   m_Meshes;
+    std::vector<Vertex> m_Vertices;
+    std::vector<Uint32> m_Indices;
+    std::vector<float>  m_TriangleLODs;
+};
+
+} // namespace Diligent
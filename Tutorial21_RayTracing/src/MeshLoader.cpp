@@ -0,0 +1,576 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "MeshLoader.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+
+#include "Align.hpp"
+#include "Errors.hpp"
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+void MeshData::SetData(std::vector<MeshVertex>&& Vertices, std::vector<Uint32>&& Indices)
+{
+    Clear();
+
+    m_Vertices    = std::move(Vertices);
+    m_Indices     = std::move(Indices);
+    m_pVertices   = m_Vertices.data();
+    m_NumVertices = static_cast<Uint32>(m_Vertices.size());
+    m_pIndices    = m_Indices.data();
+    m_NumIndices  = static_cast<Uint32>(m_Indices.size());
+
+    if (!m_Vertices.empty())
+    {
+        m_BoundsMin = m_BoundsMax = m_Vertices[0].Pos;
+        for (const auto& V : m_Vertices)
+        {
+            m_BoundsMin = std::min(m_BoundsMin, V.Pos);
+            m_BoundsMax = std::max(m_BoundsMax, V.Pos);
+        }
+    }
+}
+
+void MeshData::SetExternalData(const MeshVertex* pVertices,
+                               Uint32            NumVertices,
+                               const Uint32*     pIndices,
+                               Uint32            NumIndices,
+                               const float3&     BoundsMin,
+                               const float3&     BoundsMax)
+{
+    Clear();
+
+    m_pVertices   = pVertices;
+    m_NumVertices = NumVertices;
+    m_pIndices    = pIndices;
+    m_NumIndices  = NumIndices;
+    m_BoundsMin   = BoundsMin;
+    m_BoundsMax   = BoundsMax;
+}
+
+void MeshData::AttachFile(MappedFile&& File)
+{
+    m_File = std::move(File);
+}
+
+void MeshData::Clear()
+{
+    m_Vertices.clear();
+    m_Indices.clear();
+    m_File.Close();
+
+    m_pVertices   = nullptr;
+    m_NumVertices = 0;
+    m_pIndices    = nullptr;
+    m_NumIndices  = 0;
+    m_BoundsMin   = float3{};
+    m_BoundsMax   = float3{};
+}
+
+namespace
+{
+
+// Minimal OBJ tokenizer that works directly on the mapped file. It does not rely on
+// null termination and never allocates.
+class OBJReader
+{
+public:
+    OBJReader(const char* pBegin, const char* pEnd) :
+        m_pCurr{pBegin},
+        m_pEnd{pEnd}
+    {}
+
+    bool IsEnd() const { return m_pCurr >= m_pEnd; }
+
+    void SkipSpaces()
+    {
+        while (m_pCurr < m_pEnd && (*m_pCurr == ' ' || *m_pCurr == '\t' || *m_pCurr == '\r'))
+            ++m_pCurr;
+    }
+
+    void SkipLine()
+    {
+        while (m_pCurr < m_pEnd && *m_pCurr != '\n')
+            ++m_pCurr;
+        if (m_pCurr < m_pEnd)
+            ++m_pCurr;
+    }
+
+    bool IsEndOfLine() const
+    {
+        return m_pCurr >= m_pEnd || *m_pCurr == '\n' || *m_pCurr == '#';
+    }
+
+    // Returns the keyword at the beginning of the line, e.g. "v", "vt", "f".
+    size_t ReadKeyword(const char*& pKeyword)
+    {
+        SkipSpaces();
+        pKeyword = m_pCurr;
+        while (m_pCurr < m_pEnd && *m_pCurr != ' ' && *m_pCurr != '\t' && *m_pCurr != '\r' && *m_pCurr != '\n')
+            ++m_pCurr;
+        return static_cast<size_t>(m_pCurr - pKeyword);
+    }
+
+    bool ReadFloat(float& Value)
+    {
+        SkipSpaces();
+
+        const char* p = m_pCurr;
+
+        bool Negative = false;
+        if (p < m_pEnd && (*p == '-' || *p == '+'))
+            Negative = *p++ == '-';
+
+        double Mantissa  = 0;
+        int    Exponent  = 0;
+        bool   HasDigits = false;
+        for (; p < m_pEnd && *p >= '0' && *p <= '9'; ++p, HasDigits = true)
+            Mantissa = Mantissa * 10.0 + (*p - '0');
+        if (p < m_pEnd && *p == '.')
+        {
+            for (++p; p < m_pEnd && *p >= '0' && *p <= '9'; ++p, HasDigits = true)
+            {
+                Mantissa = Mantissa * 10.0 + (*p - '0');
+                --Exponent;
+            }
+        }
+        if (!HasDigits)
+            return false;
+
+        if (p < m_pEnd && (*p == 'e' || *p == 'E'))
+        {
+            const char* pExp   = p + 1;
+            bool        ExpNeg = false;
+            if (pExp < m_pEnd && (*pExp == '-' || *pExp == '+'))
+                ExpNeg = *pExp++ == '-';
+            if (pExp < m_pEnd && *pExp >= '0' && *pExp <= '9')
+            {
+                int Exp = 0;
+                for (; pExp < m_pEnd && *pExp >= '0' && *pExp <= '9'; ++pExp)
+                    Exp = std::min(Exp * 10 + (*pExp - '0'), 1000);
+                Exponent += ExpNeg ? -Exp : Exp;
+                p = pExp;
+            }
+        }
+
+        double Result = Mantissa;
+        if (Exponent != 0)
+            Result *= std::pow(10.0, Exponent);
+
+        Value   = static_cast<float>(Negative ? -Result : Result);
+        m_pCurr = p;
+        return true;
+    }
+
+    bool ReadInt(int& Value)
+    {
+        const char* p        = m_pCurr;
+        bool        Negative = false;
+        if (p < m_pEnd && (*p == '-' || *p == '+'))
+            Negative = *p++ == '-';
+
+        if (p >= m_pEnd || *p < '0' || *p > '9')
+            return false;
+
+        Int64 Result = 0;
+        for (; p < m_pEnd && *p >= '0' && *p <= '9'; ++p)
+            Result = std::min<Int64>(Result * 10 + (*p - '0'), std::numeric_limits<int>::max());
+
+        Value   = static_cast<int>(Negative ? -Result : Result);
+        m_pCurr = p;
+        return true;
+    }
+
+    // Reads a face vertex in one of the forms: v, v/vt, v//vn, v/vt/vn.
+    bool ReadFaceVertex(int& v, int& vt, int& vn)
+    {
+        SkipSpaces();
+        vt = vn = 0;
+        if (!ReadInt(v))
+            return false;
+        if (m_pCurr < m_pEnd && *m_pCurr == '/')
+        {
+            ++m_pCurr;
+            if (m_pCurr < m_pEnd && *m_pCurr != '/')
+                ReadInt(vt);
+            if (m_pCurr < m_pEnd && *m_pCurr == '/')
+            {
+                ++m_pCurr;
+                ReadInt(vn);
+            }
+        }
+        return true;
+    }
+
+private:
+    const char*       m_pCurr;
+    const char* const m_pEnd;
+};
+
+struct FaceVertexKey
+{
+    Uint32 v, vt, vn;
+
+    bool operator==(const FaceVertexKey& Other) const
+    {
+        return v == Other.v && vt == Other.vt && vn == Other.vn;
+    }
+
+    struct Hasher
+    {
+        size_t operator()(const FaceVertexKey& Key) const
+        {
+            return (size_t{Key.v} * 73856093u) ^ (size_t{Key.vt} * 19349663u) ^ (size_t{Key.vn} * 83492791u);
+        }
+    };
+};
+
+// Converts a one-based (or negative, relative) OBJ index to a zero-based one.
+// Returns ~0u if the index is absent or out of range.
+Uint32 ResolveOBJIndex(int Index, size_t Count)
+{
+    if (Index > 0 && static_cast<size_t>(Index) <= Count)
+        return static_cast<Uint32>(Index - 1);
+    if (Index < 0 && static_cast<size_t>(-Index) <= Count)
+        return static_cast<Uint32>(Count + Index);
+    return ~0u;
+}
+
+constexpr Uint32 BinaryMeshMagic   = 0x534D5452; // 'RTMS'
+constexpr Uint32 BinaryMeshVersion = 1;
+
+struct BinaryMeshHeader
+{
+    Uint32 Magic;
+    Uint32 Version;
+    Uint32 NumVertices;
+    Uint32 NumIndices;
+    float  BoundsMin[3];
+    float  BoundsMax[3];
+    Uint64 VertexDataOffset;
+    Uint64 IndexDataOffset;
+};
+
+// Vertex data is aligned so that it can be read from the mapping without unaligned loads.
+constexpr Uint64 BinaryMeshDataAlignment = 64;
+
+} // namespace
+
+bool LoadOBJMesh(const char* Path, MeshData& Mesh)
+{
+    MappedFile File;
+    if (!File.Open(Path))
+        return false;
+
+    const char* pText = reinterpret_cast<const char*>(File.GetData());
+    OBJReader   Reader{pText, pText + File.GetSize()};
+
+    std::vector<float3> Positions;
+    std::vector<float2> TexCoords;
+    std::vector<float3> Normals;
+
+    std::vector<MeshVertex> Vertices;
+    std::vector<Uint32>     Indices;
+    std::vector<bool>       HasNormal;
+
+    std::unordered_map<FaceVertexKey, Uint32, FaceVertexKey::Hasher> VertexMap;
+
+    // Typical OBJ files spend 30-40 bytes per position line, which gives a good initial guess
+    // and avoids most reallocations while streaming through the file.
+    const size_t EstimatedVertices = File.GetSize() / 64;
+    Positions.reserve(EstimatedVertices);
+    Vertices.reserve(EstimatedVertices);
+    Indices.reserve(EstimatedVertices * 6);
+    VertexMap.reserve(EstimatedVertices);
+
+    std::vector<Uint32> Polygon;
+    for (size_t Line = 1; !Reader.IsEnd(); Reader.SkipLine(), ++Line)
+    {
+        const char*  pKeyword = nullptr;
+        const size_t Len      = Reader.ReadKeyword(pKeyword);
+
+        if (Len == 1 && pKeyword[0] == 'v')
+        {
+            float3 P;
+            if (!Reader.ReadFloat(P.x) || !Reader.ReadFloat(P.y) || !Reader.ReadFloat(P.z))
+            {
+                LOG_ERROR_MESSAGE("Invalid vertex position at line ", Line, " of '", Path, "'");
+                return false;
+            }
+            Positions.push_back(P);
+        }
+        else if (Len == 2 && pKeyword[0] == 'v' && pKeyword[1] == 't')
+        {
+            float2 UV;
+            if (!Reader.ReadFloat(UV.x))
+            {
+                LOG_ERROR_MESSAGE("Invalid texture coordinate at line ", Line, " of '", Path, "'");
+                return false;
+            }
+            if (!Reader.ReadFloat(UV.y))
+                UV.y = 0;
+            // OBJ uses bottom-left origin for texture coordinates.
+            TexCoords.emplace_back(UV.x, 1.f - UV.y);
+        }
+        else if (Len == 2 && pKeyword[0] == 'v' && pKeyword[1] == 'n')
+        {
+            float3 N;
+            if (!Reader.ReadFloat(N.x) || !Reader.ReadFloat(N.y) || !Reader.ReadFloat(N.z))
+            {
+                LOG_ERROR_MESSAGE("Invalid vertex normal at line ", Line, " of '", Path, "'");
+                return false;
+            }
+            Normals.push_back(N);
+        }
+        else if (Len == 1 && pKeyword[0] == 'f')
+        {
+            Polygon.clear();
+
+            int v = 0, vt = 0, vn = 0;
+            while (!Reader.IsEndOfLine() && Reader.ReadFaceVertex(v, vt, vn))
+            {
+                FaceVertexKey Key{
+                    ResolveOBJIndex(v, Positions.size()),
+                    ResolveOBJIndex(vt, TexCoords.size()),
+                    ResolveOBJIndex(vn, Normals.size()),
+                };
+                if (Key.v == ~0u)
+                {
+                    LOG_ERROR_MESSAGE("Invalid position index at line ", Line, " of '", Path, "'");
+                    return false;
+                }
+
+                auto It = VertexMap.emplace(Key, static_cast<Uint32>(Vertices.size()));
+                if (It.second)
+                {
+                    MeshVertex Vert;
+                    Vert.Pos    = Positions[Key.v];
+                    Vert.UV     = Key.vt != ~0u ? TexCoords[Key.vt] : float2{};
+                    Vert.Normal = Key.vn != ~0u ? Normals[Key.vn] : float3{};
+                    Vertices.push_back(Vert);
+                    HasNormal.push_back(Key.vn != ~0u);
+                }
+                Polygon.push_back(It.first->second);
+                Reader.SkipSpaces();
+            }
+
+            for (size_t i = 2; i < Polygon.size(); ++i)
+            {
+                Indices.push_back(Polygon[0]);
+                Indices.push_back(Polygon[i - 1]);
+                Indices.push_back(Polygon[i]);
+            }
+        }
+        // Other statements (groups, materials, smoothing groups, etc.) are ignored.
+    }
+
+    if (Indices.empty())
+    {
+        LOG_ERROR_MESSAGE("OBJ file '", Path, "' contains no faces");
+        return false;
+    }
+
+    // Compute area-weighted normals for vertices that do not have them and renormalize all normals.
+    for (size_t i = 0; i < Indices.size(); i += 3)
+    {
+        auto& V0 = Vertices[Indices[i + 0]];
+        auto& V1 = Vertices[Indices[i + 1]];
+        auto& V2 = Vertices[Indices[i + 2]];
+
+        const float3 FaceNormal = cross(V1.Pos - V0.Pos, V2.Pos - V0.Pos);
+        for (Uint32 Idx : {Indices[i + 0], Indices[i + 1], Indices[i + 2]})
+        {
+            if (!HasNormal[Idx])
+                Vertices[Idx].Normal += FaceNormal;
+        }
+    }
+    for (auto& Vert : Vertices)
+    {
+        auto& N = Vert.Normal;
+        N       = length(N) > 0 ? normalize(N) : float3{0, 1, 0};
+    }
+
+    Mesh.SetData(std::move(Vertices), std::move(Indices));
+    return true;
+}
+
+bool ParseBinaryMesh(const void* pData, size_t Size, MeshData& Mesh)
+{
+    if (Size < sizeof(BinaryMeshHeader))
+    {
+        LOG_ERROR_MESSAGE("Binary mesh data is truncated");
+        return false;
+    }
+
+    const auto* pBytes = static_cast<const Uint8*>(pData);
+
+    BinaryMeshHeader Header;
+    std::memcpy(&Header, pBytes, sizeof(Header));
+    if (Header.Magic != BinaryMeshMagic || Header.Version != BinaryMeshVersion)
+    {
+        LOG_ERROR_MESSAGE("Data is not a binary mesh or has unsupported version");
+        return false;
+    }
+
+    // Offsets come from the file, so nothing is added to them before they are known to be within the data.
+    const auto IsInData = [Size](Uint64 Offset, Uint64 Count, Uint64 ElementSize) {
+        return Offset <= Size && Count <= (Size - Offset) / ElementSize;
+    };
+    if (Header.VertexDataOffset % BinaryMeshDataAlignment != 0 ||
+        Header.IndexDataOffset % sizeof(Uint32) != 0 ||
+        !IsInData(Header.VertexDataOffset, Header.NumVertices, sizeof(MeshVertex)) ||
+        !IsInData(Header.IndexDataOffset, Header.NumIndices, sizeof(Uint32)) ||
+        Header.NumIndices % 3 != 0)
+    {
+        LOG_ERROR_MESSAGE("Binary mesh data is corrupted");
+        return false;
+    }
+
+    const auto* pVertices = reinterpret_cast<const MeshVertex*>(pBytes + Header.VertexDataOffset);
+    const auto* pIndices  = reinterpret_cast<const Uint32*>(pBytes + Header.IndexDataOffset);
+
+    // Meshes are used in place, so an index out of range would make every consumer read past the vertex data.
+    for (Uint32 i = 0; i < Header.NumIndices; ++i)
+    {
+        if (pIndices[i] >= Header.NumVertices)
+        {
+            LOG_ERROR_MESSAGE("Binary mesh index ", pIndices[i], " at position ", i, " is out of range [0, ", Header.NumVertices, ")");
+            return false;
+        }
+    }
+
+    const float3 BoundsMin{Header.BoundsMin[0], Header.BoundsMin[1], Header.BoundsMin[2]};
+    const float3 BoundsMax{Header.BoundsMax[0], Header.BoundsMax[1], Header.BoundsMax[2]};
+    Mesh.SetExternalData(pVertices, Header.NumVertices, pIndices, Header.NumIndices, BoundsMin, BoundsMax);
+    return true;
+}
+
+bool LoadBinaryMesh(const char* Path, MeshData& Mesh)
+{
+    MappedFile File;
+    if (!File.Open(Path))
+        return false;
+
+    if (!ParseBinaryMesh(File.GetData(), File.GetSize(), Mesh))
+    {
+        LOG_ERROR_MESSAGE("Failed to load binary mesh file '", Path, "'");
+        return false;
+    }
+
+    // The mapping address does not change when the file object is moved.
+    Mesh.AttachFile(std::move(File));
+    return true;
+}
+
+std::vector<Uint8> SerializeBinaryMesh(const MeshData& Mesh)
+{
+    BinaryMeshHeader Header{};
+    Header.Magic            = BinaryMeshMagic;
+    Header.Version          = BinaryMeshVersion;
+    Header.NumVertices      = Mesh.GetNumVertices();
+    Header.NumIndices       = Mesh.GetNumIndices();
+    Header.VertexDataOffset = AlignUp(Uint64{sizeof(Header)}, BinaryMeshDataAlignment);
+    Header.IndexDataOffset  = Header.VertexDataOffset + Uint64{Header.NumVertices} * sizeof(MeshVertex);
+    for (int c = 0; c < 3; ++c)
+    {
+        Header.BoundsMin[c] = Mesh.GetBoundsMin()[c];
+        Header.BoundsMax[c] = Mesh.GetBoundsMax()[c];
+    }
+
+    std::vector<Uint8> Data(static_cast<size_t>(Header.IndexDataOffset + Uint64{Header.NumIndices} * sizeof(Uint32)));
+    std::memcpy(Data.data(), &Header, sizeof(Header));
+    if (Header.NumVertices > 0)
+        std::memcpy(&Data[static_cast<size_t>(Header.VertexDataOffset)], Mesh.GetVertices(), size_t{Header.NumVertices} * sizeof(MeshVertex));
+    if (Header.NumIndices > 0)
+        std::memcpy(&Data[static_cast<size_t>(Header.IndexDataOffset)], Mesh.GetIndices(), size_t{Header.NumIndices} * sizeof(Uint32));
+    return Data;
+}
+
+bool SaveBinaryMesh(const char* Path, const MeshData& Mesh)
+{
+    const auto Data = SerializeBinaryMesh(Mesh);
+
+    FILE* pFile = std::fopen(Path, "wb");
+    if (pFile == nullptr)
+    {
+        LOG_ERROR_MESSAGE("Failed to create file '", Path, "'");
+        return false;
+    }
+
+    bool Success = std::fwrite(Data.data(), Data.size(), 1, pFile) == 1;
+    Success      = std::fclose(pFile) == 0 && Success;
+
+    if (!Success)
+        LOG_ERROR_MESSAGE("Failed to write binary mesh file '", Path, "'");
+    return Success;
+}
+
+bool LoadMesh(const char* Path, MeshData& Mesh, bool UseBinaryCache)
+{
+    const char* pExt = std::strrchr(Path, '.');
+    if (pExt != nullptr && (std::strcmp(pExt, ".obj") == 0 || std::strcmp(pExt, ".OBJ") == 0))
+    {
+        if (!UseBinaryCache)
+            return LoadOBJMesh(Path, Mesh);
+
+        namespace fs = std::filesystem;
+
+        // Parse the text file only if the binary copy next to it is missing or outdated.
+        const fs::path  OBJPath{Path};
+        const fs::path  CachePath = fs::path{OBJPath}.replace_extension(".rtmesh");
+        std::error_code ec;
+        const auto      CacheTime = fs::last_write_time(CachePath, ec);
+        if (!ec && CacheTime >= fs::last_write_time(OBJPath, ec) && !ec)
+        {
+            if (LoadBinaryMesh(CachePath.string().c_str(), Mesh))
+                return true;
+        }
+
+        if (!LoadOBJMesh(Path, Mesh))
+            return false;
+
+        if (SaveBinaryMesh(CachePath.string().c_str(), Mesh))
+            LOG_INFO_MESSAGE("Saved binary mesh cache '", CachePath.string(), "'");
+        return true;
+    }
+    if (pExt != nullptr && std::strcmp(pExt, ".rtmesh") == 0)
+        return LoadBinaryMesh(Path, Mesh);
+
+    LOG_ERROR_MESSAGE("Unsupported mesh format: '", Path, "'");
+    return false;
+}
+
+} // namespace Diligent
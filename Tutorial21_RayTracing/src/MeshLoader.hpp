@@ -0,0 +1,118 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "BasicMath.hpp"
+#include "MappedFile.hpp"
+
+namespace Diligent
+{
+
+/// Vertex layout produced by the mesh loader. It matches the layout of the vertices
+/// generated by CreateGeometryPrimitive() with GEOMETRY_PRIMITIVE_VERTEX_FLAG_ALL.
+struct MeshVertex
+{
+    float3 Pos;
+    float3 Normal;
+    float2 UV;
+};
+static_assert(sizeof(MeshVertex) == 32, "Binary mesh files rely on the size of MeshVertex");
+
+/// Triangle mesh loaded from a file.
+
+/// Data is either owned by the mesh (parsed from a text format) or points directly into
+/// a memory-mapped binary file or cache, in which case no copy is made until the data is uploaded.
+class MeshData
+{
+public:
+    const MeshVertex* GetVertices() const { return m_pVertices; }
+    Uint32            GetNumVertices() const { return m_NumVertices; }
+    const Uint32*     GetIndices() const { return m_pIndices; }
+    Uint32            GetNumIndices() const { return m_NumIndices; }
+
+    const float3& GetBoundsMin() const { return m_BoundsMin; }
+    const float3& GetBoundsMax() const { return m_BoundsMax; }
+
+    bool IsMapped() const { return m_File.IsOpen(); }
+
+    /// Takes ownership of the vertex and index data and computes the bounds.
+    void SetData(std::vector<MeshVertex>&& Vertices, std::vector<Uint32>&& Indices);
+
+    /// References vertex and index data owned by someone else, e.g. a mapped scene cache.
+    void SetExternalData(const MeshVertex* pVertices,
+                         Uint32            NumVertices,
+                         const Uint32*     pIndices,
+                         Uint32            NumIndices,
+                         const float3&     BoundsMin,
+                         const float3&     BoundsMax);
+
+    /// Keeps the file that external data points into mapped for the lifetime of the mesh.
+    void AttachFile(MappedFile&& File);
+
+    void Clear();
+
+private:
+    std::vector<MeshVertex> m_Vertices;
+    std::vector<Uint32>     m_Indices;
+    MappedFile              m_File;
+
+    const MeshVertex* m_pVertices   = nullptr;
+    Uint32            m_NumVertices = 0;
+    const Uint32*     m_pIndices    = nullptr;
+    Uint32            m_NumIndices  = 0;
+
+    float3 m_BoundsMin;
+    float3 m_BoundsMax;
+};
+
+/// Parses a Wavefront OBJ file. Only positions, texture coordinates, normals and faces are read;
+/// polygons are triangulated as fans. Missing normals are computed from the faces.
+bool LoadOBJMesh(const char* Path, MeshData& Mesh);
+
+/// Maps a binary mesh file written by SaveBinaryMesh(). Vertex and index data are used in place.
+bool LoadBinaryMesh(const char* Path, MeshData& Mesh);
+
+/// Interprets memory in the binary mesh format. The mesh references the memory, which
+/// must stay valid while the mesh is used and be aligned by 64 bytes. Returns false if
+/// the data is truncated or any index is out of the vertex range.
+bool ParseBinaryMesh(const void* pData, size_t Size, MeshData& Mesh);
+
+/// Returns the mesh in the binary format.
+std::vector<Uint8> SerializeBinaryMesh(const MeshData& Mesh);
+
+/// Writes the mesh in the binary format that LoadBinaryMesh() can map without parsing.
+bool SaveBinaryMesh(const char* Path, const MeshData& Mesh);
+
+/// Loads a mesh choosing the format by the file extension (.obj or .rtmesh).
+/// When UseBinaryCache is true, an OBJ file is converted to a .rtmesh file next to it
+/// once, and later loads map the binary file if it is not older than the OBJ file.
+bool LoadMesh(const char* Path, MeshData& Mesh, bool UseBinaryCache = true);
+
+} // namespace Diligent
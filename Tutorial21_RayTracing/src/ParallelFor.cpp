@@ -0,0 +1,172 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "ParallelFor.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Diligent
+{
+
+namespace
+{
+
+// Threads that ParallelFor() hands items to. The threads are created on the first call and
+// live until the program exits, so loops that run every frame do not create threads.
+class WorkerPool
+{
+public:
+    explicit WorkerPool(Uint32 NumWorkers)
+    {
+        m_Threads.reserve(NumWorkers);
+        for (Uint32 t = 0; t < NumWorkers; ++t)
+            m_Threads.emplace_back([this]() { WorkerThread(); });
+    }
+
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> Lock{m_Mtx};
+            m_Exit = true;
+        }
+        m_WakeCV.notify_all();
+        for (auto& Thread : m_Threads)
+            Thread.join();
+    }
+
+    // Runs the loop on the calling thread and up to NumThreads - 1 workers. Returns false without
+    // running anything if the pool is running another loop, e.g. when called from inside Func.
+    bool Run(Uint32 Count, const std::function<void(Uint32)>& Func, Uint32 NumThreads)
+    {
+        bool Expected = false;
+        if (!m_Running.compare_exchange_strong(Expected, true))
+            return false;
+
+        {
+            std::lock_guard<std::mutex> Lock{m_Mtx};
+            m_pFunc    = &Func;
+            m_Count    = Count;
+            m_NextItem = 0;
+            m_NumSlots = std::min(NumThreads - 1, static_cast<Uint32>(m_Threads.size()));
+            ++m_Generation;
+        }
+        m_WakeCV.notify_all();
+
+        ProcessItems();
+
+        // Workers that have not joined yet must not see the loop after it returns.
+        {
+            std::unique_lock<std::mutex> Lock{m_Mtx};
+            m_NumSlots = 0;
+            m_DoneCV.wait(Lock, [this]() { return m_NumBusy == 0; });
+            m_pFunc = nullptr;
+        }
+
+        m_Running.store(false);
+        return true;
+    }
+
+private:
+    void ProcessItems()
+    {
+        for (Uint32 i = m_NextItem.fetch_add(1); i < m_Count; i = m_NextItem.fetch_add(1))
+            (*m_pFunc)(i);
+    }
+
+    void WorkerThread()
+    {
+        Uint64 Generation = 0;
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> Lock{m_Mtx};
+                m_WakeCV.wait(Lock, [&]() { return m_Exit || m_Generation != Generation; });
+                if (m_Exit)
+                    return;
+
+                Generation = m_Generation;
+                if (m_NumSlots == 0)
+                    continue;
+                --m_NumSlots;
+                ++m_NumBusy;
+            }
+
+            ProcessItems();
+
+            {
+                std::lock_guard<std::mutex> Lock{m_Mtx};
+                --m_NumBusy;
+            }
+            m_DoneCV.notify_one();
+        }
+    }
+
+    std::vector<std::thread> m_Threads;
+    std::atomic<bool>        m_Running{false};
+
+    std::mutex              m_Mtx;
+    std::condition_variable m_WakeCV;
+    std::condition_variable m_DoneCV;
+    Uint64                  m_Generation = 0;
+    Uint32                  m_NumSlots   = 0; // Workers that may still join the current loop
+    Uint32                  m_NumBusy    = 0; // Workers processing items of the current loop
+    bool                    m_Exit       = false;
+
+    const std::function<void(Uint32)>* m_pFunc = nullptr;
+    Uint32                             m_Count = 0;
+    std::atomic<Uint32>                m_NextItem{0};
+};
+
+} // namespace
+
+Uint32 GetDefaultNumWorkerThreads()
+{
+    return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+void ParallelFor(Uint32 Count, const std::function<void(Uint32)>& Func, Uint32 NumThreads)
+{
+    if (NumThreads == 0)
+        NumThreads = GetDefaultNumWorkerThreads();
+    NumThreads = std::min(NumThreads, Count);
+
+    // The calling thread is one of the workers.
+    static WorkerPool Pool{GetDefaultNumWorkerThreads() - 1};
+    if (NumThreads > 1 && Pool.Run(Count, Func, NumThreads))
+        return;
+
+    // Single items, single-threaded loops and loops nested in other loops run on the calling thread.
+    for (Uint32 i = 0; i < Count; ++i)
+        Func(i);
+}
+
+} // namespace Diligent
@@ -0,0 +1,50 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <functional>
+
+#include "BasicTypes.h"
+
+namespace Diligent
+{
+
+/// Returns the number of worker threads ParallelFor() uses by default.
+Uint32 GetDefaultNumWorkerThreads();
+
+/// Calls Func(i) for every i in [0, Count) on up to NumThreads threads including the
+/// calling thread, and returns when all calls have completed. Items are handed out one
+/// by one, so items of very different cost are balanced between the threads.
+/// NumThreads == 0 selects GetDefaultNumWorkerThreads().
+///
+/// The worker threads are created by the first call and reused by all later calls. A call
+/// made while another loop is running, e.g. from inside Func or from another thread, runs
+/// all items on the calling thread.
+void ParallelFor(Uint32 Count, const std::function<void(Uint32)>& Func, Uint32 NumThreads = 0);
+
+} // namespace Diligent
@@ -0,0 +1,153 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "PipelineStateCache.hpp"
+
+#include <filesystem>
+
+#include "DataBlobImpl.hpp"
+#include "DebugUtilities.hpp"
+#include "MappedFile.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+// Increment to discard cache files written by previous versions of the sample.
+constexpr Uint32 PipelineCacheContentVersion = 1;
+
+} // namespace
+
+PipelineStateCache::PipelineStateCache(IRenderDevice* pDevice, const std::string& FilePath) :
+    m_pDevice{pDevice},
+    m_FilePath{FilePath}
+{
+    if (m_FilePath.empty())
+        return;
+
+    RenderStateCacheCreateInfo CacheCI;
+    CacheCI.pDevice  = pDevice;
+    CacheCI.LogLevel = RENDER_STATE_CACHE_LOG_LEVEL_DISABLED;
+    CreateRenderStateCache(CacheCI, &m_pCache);
+    if (!m_pCache)
+    {
+        LOG_WARNING_MESSAGE("Failed to create render state cache. Shaders will be compiled at every launch.");
+        return;
+    }
+
+    std::error_code ec;
+    if (!std::filesystem::exists(m_FilePath, ec))
+        return;
+
+    MappedFile File;
+    if (!File.Open(m_FilePath.c_str()))
+        return;
+
+    auto pData = DataBlobImpl::Create(File.GetSize(), File.GetData());
+    if (!m_pCache->Load(pData, PipelineCacheContentVersion, /*MakeCopy = */ false))
+    {
+        // The cache is either stale or corrupted. It will be rewritten by the next Save().
+        LOG_WARNING_MESSAGE("Pipeline state cache '", m_FilePath, "' is not valid and will be rebuilt");
+        m_pCache->Reset();
+        m_IsDirty = true;
+    }
+}
+
+PipelineStateCache::~PipelineStateCache()
+{
+    // States created after the last Save(), e.g. pipeline variants selected while rendering.
+    Save();
+}
+
+void PipelineStateCache::CountLookup(bool Found)
+{
+    if (Found)
+    {
+        ++m_NumHits;
+    }
+    else
+    {
+        ++m_NumMisses;
+        m_IsDirty = true;
+    }
+}
+
+void PipelineStateCache::CreateShader(const ShaderCreateInfo& ShaderCI, IShader** ppShader)
+{
+    if (m_pCache)
+        CountLookup(m_pCache->CreateShader(ShaderCI, ppShader));
+    else
+        m_pDevice->CreateShader(ShaderCI, ppShader);
+}
+
+void PipelineStateCache::CreateGraphicsPipelineState(const GraphicsPipelineStateCreateInfo& PSOCreateInfo, IPipelineState** ppPSO)
+{
+    if (m_pCache)
+        CountLookup(m_pCache->CreateGraphicsPipelineState(PSOCreateInfo, ppPSO));
+    else
+        m_pDevice->CreateGraphicsPipelineState(PSOCreateInfo, ppPSO);
+}
+
+void PipelineStateCache::CreateRayTracingPipelineState(const RayTracingPipelineStateCreateInfo& PSOCreateInfo, IPipelineState** ppPSO)
+{
+    if (m_pCache)
+        CountLookup(m_pCache->CreateRayTracingPipelineState(PSOCreateInfo, ppPSO));
+    else
+        m_pDevice->CreateRayTracingPipelineState(PSOCreateInfo, ppPSO);
+}
+
+void PipelineStateCache::CreateComputePipelineState(const ComputePipelineStateCreateInfo& PSOCreateInfo, IPipelineState** ppPSO)
+{
+    if (m_pCache)
+        CountLookup(m_pCache->CreateComputePipelineState(PSOCreateInfo, ppPSO));
+    else
+        m_pDevice->CreateComputePipelineState(PSOCreateInfo, ppPSO);
+}
+
+bool PipelineStateCache::Save()
+{
+    if (!m_pCache || !m_IsDirty)
+        return true;
+
+    RefCntAutoPtr<IDataBlob> pData;
+    if (!m_pCache->WriteToBlob(PipelineCacheContentVersion, &pData) || !pData)
+    {
+        LOG_ERROR_MESSAGE("Failed to serialize pipeline state cache");
+        return false;
+    }
+
+    // A crash never leaves a truncated cache behind.
+    if (!WriteFileAtomic(m_FilePath.c_str(), pData->GetConstDataPtr(), pData->GetSize()))
+        return false;
+
+    m_IsDirty = false;
+    return true;
+}
+
+} // namespace Diligent
@@ -0,0 +1,77 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "RenderDevice.h"
+#include "RefCntAutoPtr.hpp"
+#include "RenderStateCache.h"
+
+namespace Diligent
+{
+
+/// Persistent cache of compiled shaders and pipeline states.
+
+/// Wraps the engine's render state cache, which identifies shaders by the hash of their
+/// source files (including the files they include) and macros, and pipelines by their create
+/// info. The cache is loaded from a file when the object is created and written back by Save()
+/// and when the object is destroyed, so shaders are only compiled when they changed since the
+/// previous launch. Without a file
+/// path, or if the render state cache can't be created, states are created by the device.
+class PipelineStateCache
+{
+public:
+    PipelineStateCache(IRenderDevice* pDevice, const std::string& FilePath);
+    ~PipelineStateCache();
+
+    void CreateShader(const ShaderCreateInfo& ShaderCI, IShader** ppShader);
+    void CreateGraphicsPipelineState(const GraphicsPipelineStateCreateInfo& PSOCreateInfo, IPipelineState** ppPSO);
+    void CreateRayTracingPipelineState(const RayTracingPipelineStateCreateInfo& PSOCreateInfo, IPipelineState** ppPSO);
+    void CreateComputePipelineState(const ComputePipelineStateCreateInfo& PSOCreateInfo, IPipelineState** ppPSO);
+
+    /// Writes the cache file if states were added since the cache was loaded or last saved.
+    bool Save();
+
+    /// Number of shaders and pipelines that were found in the cache or had to be created.
+    Uint32 GetNumHits() const { return m_NumHits; }
+    Uint32 GetNumMisses() const { return m_NumMisses; }
+
+private:
+    void CountLookup(bool Found);
+
+    RefCntAutoPtr<IRenderDevice>     m_pDevice;
+    RefCntAutoPtr<IRenderStateCache> m_pCache;
+    const std::string                m_FilePath;
+
+    Uint32 m_NumHits   = 0;
+    Uint32 m_NumMisses = 0;
+    bool   m_IsDirty   = false;
+};
+
+} // namespace Diligent
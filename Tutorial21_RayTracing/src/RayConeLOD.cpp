@@ -0,0 +1,61 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "RayConeLOD.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Diligent
+{
+
+namespace
+{
+
+// Triangles without texture coordinates use level 0.
+constexpr float MinTriangleLOD = -64.f;
+
+} // namespace
+
+float ComputePixelSpreadAngle(float VerticalFOV, Uint32 ScreenHeight)
+{
+    return std::atan(2.f * std::tan(VerticalFOV * 0.5f) / static_cast<float>(std::max(ScreenHeight, 1u)));
+}
+
+float ComputeTriangleLODConstant(const float3& P0, const float3& P1, const float3& P2,
+                                 const float2& UV0, const float2& UV1, const float2& UV2)
+{
+    // Both areas are doubled, which does not change their ratio.
+    const float PosArea = length(cross(P1 - P0, P2 - P0));
+    const float UVArea  = std::abs((UV1.x - UV0.x) * (UV2.y - UV0.y) - (UV2.x - UV0.x) * (UV1.y - UV0.y));
+    if (!(PosArea > 0.f) || !(UVArea > 0.f))
+        return MinTriangleLOD;
+
+    return std::max(0.5f * std::log2(UVArea / PosArea), MinTriangleLOD);
+}
+
+} // namespace Diligent
@@ -0,0 +1,54 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include "BasicMath.hpp"
+
+namespace Diligent
+{
+
+/// Texture level of detail selection with ray cones.
+
+/// Every primary ray carries a cone that starts with the footprint of one pixel. The cone
+/// width grows linearly with the hit distance, and reflections and refractions change its
+/// spread angle. At a hit, the mip level is derived from the cone width, the angle between
+/// the ray and the surface, and the ratio of texel area to world-space area of the triangle
+/// (T. Akenine-Moller et al., "Texture Level of Detail Strategies for Real-Time Ray Tracing").
+///
+/// The cones are propagated and the mip levels are selected by the shader code in RayUtils.fxh.
+/// The CPU computes the spread angle of primary rays and the per-triangle constants.
+
+/// Spread angle of a primary ray cone that covers one pixel.
+float ComputePixelSpreadAngle(float VerticalFOV, Uint32 ScreenHeight);
+
+/// Returns the texture-independent LOD constant of a triangle:
+/// 0.5 * log2(texture coordinate area / object-space area).
+float ComputeTriangleLODConstant(const float3& P0, const float3& P1, const float3& P2,
+                                 const float2& UV0, const float2& UV1, const float2& UV2);
+
+} // namespace Diligent
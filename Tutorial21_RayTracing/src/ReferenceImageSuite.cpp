@@ -0,0 +1,474 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "ReferenceImageSuite.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+
+#include "FrameSequenceWriter.hpp"
+#include "MappedFile.hpp"
+#include "RayConeLOD.hpp"
+#include "Errors.hpp"
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+// Vertical field of view of the sample camera.
+constexpr float VerticalFOV = PI_F / 4.f;
+
+// Difference of pixels that are NaN in only one of the images, the range of L*.
+constexpr float NaNDeltaE = 100.f;
+
+float LabF(float t)
+{
+    constexpr float Delta = 6.f / 29.f;
+    return t > Delta * Delta * Delta ? std::cbrt(t) : t / (3.f * Delta * Delta) + 4.f / 29.f;
+}
+
+// Converts a linear sRGB color to CIELAB with the D65 white point.
+float3 LinearRGBToLab(const float3& RGB)
+{
+    const float r = std::min(std::max(RGB.x, 0.f), 1.f);
+    const float g = std::min(std::max(RGB.y, 0.f), 1.f);
+    const float b = std::min(std::max(RGB.z, 0.f), 1.f);
+
+    const float fx = LabF((0.4124564f * r + 0.3575761f * g + 0.1804375f * b) / 0.95047f);
+    const float fy = LabF(0.2126729f * r + 0.7151522f * g + 0.0721750f * b);
+    const float fz = LabF((0.0193339f * r + 0.1191920f * g + 0.9503041f * b) / 1.08883f);
+    return float3{116.f * fy - 16.f, 500.f * (fx - fy), 200.f * (fy - fz)};
+}
+
+bool IsNaN(const float4& c)
+{
+    return std::isnan(c.x) || std::isnan(c.y) || std::isnan(c.z);
+}
+
+float GetDeltaE(const float4& a, const float4& b)
+{
+    const bool NaNA = IsNaN(a);
+    const bool NaNB = IsNaN(b);
+    if (NaNA || NaNB)
+        return NaNA == NaNB ? 0.f : NaNDeltaE;
+    return length(LinearRGBToLab(float3{a.x, a.y, a.z}) - LinearRGBToLab(float3{b.x, b.y, b.z}));
+}
+
+// Cube with an edge length of 2 and one normal per face, like the cube geometry primitive of the sample.
+SoftwareTracer::Mesh CreateCubeMesh()
+{
+    SoftwareTracer::Mesh Cube;
+    const float3         Normals[] = {{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}};
+    for (const auto& N : Normals)
+    {
+        const float3 U    = N.x != 0 ? float3{0, 1, 0} : float3{1, 0, 0};
+        const float3 V    = cross(N, U);
+        const Uint32 Base = static_cast<Uint32>(Cube.Vertices.size());
+        for (Uint32 i = 0; i < 4; ++i)
+        {
+            const float u = (i & 1) != 0 ? 1.f : 0.f;
+            const float v = (i & 2) != 0 ? 1.f : 0.f;
+
+            MeshVertex Vert;
+            Vert.Pos    = N + U * (u * 2.f - 1.f) + V * (v * 2.f - 1.f);
+            Vert.Normal = N;
+            Vert.UV     = float2{u, v};
+            Cube.Vertices.push_back(Vert);
+        }
+        const Uint32 Indices[] = {Base, Base + 1, Base + 3, Base, Base + 3, Base + 2};
+        Cube.Indices.insert(Cube.Indices.end(), std::begin(Indices), std::end(Indices));
+    }
+    return Cube;
+}
+
+HLSL::FrameConstants GetViewpointFrame(const HLSL::FrameConstants& Frame, const HLSL::Constants& Constants, const ReferenceImageSuite::Viewpoint& View, Uint32 Width, Uint32 Height)
+{
+    // Left-handed view basis with the y axis up, like the first person camera.
+    const float3 Forward = normalize(View.LookAt - View.CameraPos);
+    const float3 Right   = normalize(cross(float3{0, 1, 0}, Forward));
+    const float3 Up      = cross(Forward, Right);
+
+    const float4x4 ViewMatrix = float4x4::Translation(-View.CameraPos) * float4x4::ViewFromBasis(Right, Up, Forward);
+    const float4x4 ProjMatrix = float4x4::Projection(VerticalFOV, static_cast<float>(Width) / static_cast<float>(Height),
+                                                     Constants.ClipPlanes.x, Constants.ClipPlanes.y, false);
+
+    // The frame index seeds the random numbers of all samples, so it is the same for every image.
+    HLSL::FrameConstants ViewFrame = Frame;
+    ViewFrame.InvViewProj          = (ViewMatrix * ProjMatrix).Inverse();
+    ViewFrame.CameraPos            = float4{View.CameraPos, 1.f};
+    ViewFrame.FrameIndex           = 0;
+    ViewFrame.AccumWeight          = 1.f;
+    return ViewFrame;
+}
+
+} // namespace
+
+ReferenceImageSuite::ReferenceImageSuite(const CreateInfo& CI) :
+    m_CI{CI}
+{
+    VERIFY_EXPR(m_CI.Width > 0 && m_CI.Height > 0);
+
+    std::error_code ec;
+    if (!m_CI.Directory.empty())
+        std::filesystem::create_directories(m_CI.Directory, ec);
+    if (ec)
+        LOG_ERROR_MESSAGE("Failed to create reference image directory '", m_CI.Directory, "': ", ec.message());
+}
+
+const std::vector<ReferenceImageSuite::Viewpoint>& ReferenceImageSuite::GetCanonicalViewpoints()
+{
+    // Names are the file names of the golden images and must not change.
+    static const std::vector<Viewpoint> Viewpoints = {
+        {"overview", float3{7.f, -0.5f, -16.5f}, float3{0.f, -4.5f, 0.f}},
+        {"cubes", float3{0.f, -3.f, -12.f}, float3{0.f, -4.5f, -3.f}},
+        {"glass", float3{-9.f, -3.5f, -5.f}, float3{-4.f, -4.5f, 0.f}},
+        {"sphere_spiral", float3{-6.f, 2.f, 14.f}, float3{0.f, -5.5f, 0.f}},
+        {"top_down", float3{0.f, 18.f, -6.f}, float3{0.f, -6.f, 0.f}},
+        {"grazing", float3{14.f, -5.6f, 10.f}, float3{0.f, -5.f, 0.f}},
+    };
+    return Viewpoints;
+}
+
+SoftwareTracer::Scene ReferenceImageSuite::CreateCanonicalScene()
+{
+    SoftwareTracer::Scene Scene;
+    Scene.Meshes.push_back(CreateCubeMesh());
+
+    Scene.Materials.resize(SoftwareTracer::MATERIAL_TYPE_COUNT);
+    for (Uint32 i = 0; i < SoftwareTracer::MATERIAL_TYPE_COUNT; ++i)
+    {
+        Scene.Materials[i].Type      = static_cast<SoftwareTracer::MATERIAL_TYPE>(i);
+        Scene.Materials[i].BaseColor = float3{0.5f, 0.5f, 0.5f};
+    }
+
+    const auto AddInstance = [&](Uint32 Geometry, SoftwareTracer::MATERIAL_TYPE Material, const float3& Pos, const float3x3& Rotation) {
+        SoftwareTracer::Instance Inst;
+        Inst.Geometry = Geometry;
+        Inst.Material = Material;
+        Inst.ObjectId = static_cast<Uint32>(Scene.Instances.size());
+        Inst.Transform.SetRotation(Rotation.Data());
+        Inst.Transform.SetTranslation(Pos.x, Pos.y, Pos.z);
+        Scene.Instances.push_back(Inst);
+    };
+
+    // The ground and the three large cubes of the sample.
+    AddInstance(0, SoftwareTracer::MATERIAL_TYPE_GROUND, float3{0.f, -6.f, 0.f}, float3x3::Scale(100.f, 0.1f, 100.f));
+    AddInstance(0, SoftwareTracer::MATERIAL_TYPE_GLASS, float3{-4.f, -4.5f, 0.f}, float3x3::Identity());
+    AddInstance(0, SoftwareTracer::MATERIAL_TYPE_DIFFUSE, float3{0.f, -4.5f, -3.f}, float3x3::Identity());
+    AddInstance(0, SoftwareTracer::MATERIAL_TYPE_METAL, float3{4.f, -4.5f, -6.f}, float3x3::Identity());
+
+    // Spiral of spheres with all sphere materials.
+    const SoftwareTracer::MATERIAL_TYPE SphereMaterials[] = {SoftwareTracer::MATERIAL_TYPE_MIRROR_SPHERE, SoftwareTracer::MATERIAL_TYPE_DIFFUSE_SPHERE, SoftwareTracer::MATERIAL_TYPE_GLASS_SPHERE};
+    for (Uint32 i = 0; i < 40; ++i)
+    {
+        const float Radius = 5.f + 0.3f * static_cast<float>(i);
+        const float Angle  = 0.5f * static_cast<float>(i);
+        AddInstance(SoftwareTracer::SphereGeometry, SphereMaterials[i % 3], float3{Radius * std::cos(Angle), -5.5f + 0.05f * static_cast<float>(i), Radius * std::sin(Angle)},
+                    float3x3::Identity());
+    }
+
+    // Pyramid of small cubes: the edges of one square per layer, with textured and glass cubes.
+    for (int Layer = 0; Layer < 4; ++Layer)
+    {
+        const int Half = (4 - Layer) / 2;
+        for (int i = -Half; i <= Half; ++i)
+        {
+            for (int j = -Half; j <= Half; ++j)
+            {
+                if (std::abs(i) != Half && std::abs(j) != Half)
+                    continue;
+
+                const float Angle = 0.2f * static_cast<float>(Scene.Instances.size());
+                AddInstance(0, (i + j) % 2 == 0 ? SoftwareTracer::MATERIAL_TYPE_TEXTURED : SoftwareTracer::MATERIAL_TYPE_GLASS,
+                            float3{2.f * static_cast<float>(i), -5.5f + 1.5f * static_cast<float>(Layer), 12.f + 2.f * static_cast<float>(j)},
+                            float3x3::Scale(0.25f, 0.25f, 0.25f) * float3x3::RotationY(Angle));
+            }
+        }
+    }
+
+    // Two key lights like in the sample and a ring of small colored lights above the ground.
+    const float3 KeyLightPos[]   = {{8.f, 8.f, 0.f}, {0.f, 4.f, -5.f}};
+    const float3 KeyLightColor[] = {{1.f, 0.8f, 0.8f}, {0.85f, 1.f, 0.85f}};
+    for (Uint32 i = 0; i < NUM_LIGHTS; ++i)
+    {
+        LightBVH::Light L;
+        L.Pos   = KeyLightPos[i];
+        L.Color = KeyLightColor[i];
+        L.Range = 1e6f;
+        Scene.Lights.push_back(L);
+
+        Scene.Constants.LightPos[i]   = float4{KeyLightPos[i], 0.f};
+        Scene.Constants.LightColor[i] = float4{KeyLightColor[i], 0.f};
+    }
+    for (Uint32 i = 0; i < 12; ++i)
+    {
+        const float Angle = 2.f * PI_F * static_cast<float>(i) / 12.f;
+
+        LightBVH::Light L;
+        L.Pos    = float3{9.f * std::cos(Angle), -5.f, 9.f * std::sin(Angle)};
+        L.Color  = float3{i % 3 == 0 ? 2.f : 0.5f, i % 3 == 1 ? 2.f : 0.5f, i % 3 == 2 ? 2.f : 0.5f};
+        L.Range  = 3.f;
+        L.Radius = 0.1f;
+        Scene.Lights.push_back(L);
+    }
+
+    // Settings of the sample that the CPU renderer reads.
+    auto& Constants                     = Scene.Constants;
+    Constants.ClipPlanes                = float2{0.1f, 100.0f};
+    Constants.ShadowPCF                 = 1;
+    Constants.MaxRecursion              = 6;
+    Constants.LightSamples              = 2;
+    Constants.NumLights                 = static_cast<Uint32>(Scene.Lights.size());
+    Constants.SphereReflectionColorMask = {0.81f, 1.0f, 0.45f};
+    Constants.SphereReflectionBlur      = 1;
+    Constants.GlassMaterialColor        = {0.33f, 0.93f, 0.29f, 0.f};
+    Constants.GlassIndexOfRefraction    = {1.5f, 1.52f};
+    Constants.AmbientColor              = float4{0.5f, 0.5f, 0.5f, 0.f} * 0.025f;
+    Constants.DiscPoints[0]             = {+0.0f, +0.0f, +0.9f, -0.9f};
+    Constants.DiscPoints[1]             = {-0.8f, +1.0f, -1.1f, -0.8f};
+    Constants.DiscPoints[2]             = {+1.5f, +1.2f, -2.1f, +0.7f};
+    Constants.DiscPoints[3]             = {+0.1f, -2.2f, -0.2f, +2.4f};
+    Constants.DiscPoints[4]             = {+2.4f, -0.3f, -3.0f, +2.8f};
+    Constants.DiscPoints[5]             = {+2.0f, -2.6f, +0.7f, +3.5f};
+    Constants.DiscPoints[6]             = {-3.2f, -1.6f, +3.4f, +2.2f};
+    Constants.DiscPoints[7]             = {-1.8f, -3.2f, -1.1f, +3.6f};
+    return Scene;
+}
+
+std::vector<ReferenceImageSuite::ImageResult> ReferenceImageSuite::Run() const
+{
+    SoftwareTracer::Scene TracerScene      = CreateCanonicalScene();
+    TracerScene.Constants.PixelSpreadAngle = ComputePixelSpreadAngle(VerticalFOV, m_CI.Height);
+    SoftwareTracer Tracer{std::move(TracerScene)};
+
+    const size_t        NumPixels = size_t{m_CI.Width} * m_CI.Height;
+    std::vector<float4> Pixels(NumPixels);
+    std::vector<float4> Golden;
+    std::vector<float>  DeltaE(NumPixels);
+
+    std::vector<ImageResult> Results;
+    for (const auto& View : GetCanonicalViewpoints())
+    {
+        Tracer.SetFrame(GetViewpointFrame(Tracer.GetScene().Frame, Tracer.GetScene().Constants, View, m_CI.Width, m_CI.Height));
+
+        ImageResult Result;
+        Result.Name = View.Name;
+
+        const auto RenderStart = std::chrono::high_resolution_clock::now();
+        Tracer.Render(m_CI.Width, m_CI.Height, Pixels.data());
+        Result.RenderMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - RenderStart).count();
+
+        // Images of an earlier failed run are out of date.
+        const std::string GoldenPath = GetFilePath(View.Name, ".pfm");
+        const std::string ActualPath = GetFilePath(View.Name, ".actual.pfm");
+        const std::string DiffPath   = GetFilePath(View.Name, ".diff.png");
+        std::error_code   ec;
+        std::filesystem::remove(ActualPath, ec);
+        std::filesystem::remove(DiffPath, ec);
+
+        if (m_CI.UpdateGolden)
+        {
+            Result.Status = WriteImage(GoldenPath, Pixels.data(), true) ? RESULT_STATUS_UPDATED : RESULT_STATUS_FAILED;
+        }
+        else if (!LoadGolden(GoldenPath, Golden))
+        {
+            Result.Status = RESULT_STATUS_MISSING_GOLDEN;
+            WriteImage(ActualPath, Pixels.data(), true);
+        }
+        else
+        {
+            Result.Difference = CompareImages(Pixels.data(), Golden.data(), NumPixels, m_CI.VisibleDeltaE, DeltaE.data());
+
+            const bool Passed = Result.Difference.MeanDeltaE <= m_CI.MaxMeanDeltaE && Result.Difference.VisibleFraction <= m_CI.MaxVisibleFraction;
+            Result.Status     = Passed ? RESULT_STATUS_PASSED : RESULT_STATUS_FAILED;
+            if (!Passed)
+            {
+                // Gray shows differences below the visible threshold, red shows visible ones.
+                std::vector<float4> HeatMap(NumPixels);
+                for (size_t i = 0; i < NumPixels; ++i)
+                {
+                    const float v = DeltaE[i] / m_CI.VisibleDeltaE;
+                    HeatMap[i]    = v > 1.f ? float4{1, 0, 0, 0} : float4{v, v, v, 0};
+                }
+                WriteImage(ActualPath, Pixels.data(), true);
+                WriteImage(DiffPath, HeatMap.data(), false);
+            }
+        }
+
+        LOG_INFO_MESSAGE("Reference image '", Result.Name, "': ", GetStatusString(Result.Status), ", rendered in ", Result.RenderMs,
+                         " ms, mean delta E ", Result.Difference.MeanDeltaE, ", max delta E ", Result.Difference.MaxDeltaE,
+                         ", visibly different pixels ", Result.Difference.VisibleFraction * 100.f, "%");
+        Results.push_back(std::move(Result));
+    }
+
+    WriteReport(Results);
+    return Results;
+}
+
+bool ReferenceImageSuite::AllPassed(const std::vector<ImageResult>& Results)
+{
+    return std::all_of(Results.begin(), Results.end(), [](const ImageResult& Result) {
+        return Result.Status == RESULT_STATUS_PASSED || Result.Status == RESULT_STATUS_UPDATED;
+    });
+}
+
+ReferenceImageSuite::ImageDifference ReferenceImageSuite::CompareImages(const float4* pImageA, const float4* pImageB, size_t NumPixels, float VisibleDeltaE, float* pDeltaE)
+{
+    ImageDifference Diff;
+    if (NumPixels == 0)
+        return Diff;
+
+    double SumDeltaE  = 0;
+    size_t NumVisible = 0;
+    for (size_t i = 0; i < NumPixels; ++i)
+    {
+        const float DeltaE = GetDeltaE(pImageA[i], pImageB[i]);
+        SumDeltaE += DeltaE;
+        Diff.MaxDeltaE = std::max(Diff.MaxDeltaE, DeltaE);
+        if (DeltaE > VisibleDeltaE)
+            ++NumVisible;
+        if (pDeltaE != nullptr)
+            pDeltaE[i] = DeltaE;
+    }
+    Diff.MeanDeltaE      = static_cast<float>(SumDeltaE / static_cast<double>(NumPixels));
+    Diff.VisibleFraction = static_cast<float>(static_cast<double>(NumVisible) / static_cast<double>(NumPixels));
+    return Diff;
+}
+
+const char* ReferenceImageSuite::GetStatusString(RESULT_STATUS Status)
+{
+    switch (Status)
+    {
+        case RESULT_STATUS_PASSED: return "passed";
+        case RESULT_STATUS_FAILED: return "FAILED";
+        case RESULT_STATUS_MISSING_GOLDEN: return "missing golden image";
+        case RESULT_STATUS_UPDATED: return "updated";
+        default:
+            UNEXPECTED("Unknown status");
+            return "unknown";
+    }
+}
+
+std::string ReferenceImageSuite::GetFilePath(const char* Name, const char* Suffix) const
+{
+    return (std::filesystem::path{m_CI.Directory} / (std::string{Name} + Suffix)).string();
+}
+
+bool ReferenceImageSuite::LoadGolden(const std::string& Path, std::vector<float4>& Pixels) const
+{
+    std::error_code ec;
+    if (!std::filesystem::exists(Path, ec))
+        return false;
+
+    MappedFile File;
+    if (!File.Open(Path.c_str()))
+        return false;
+
+    // Header of FrameSequenceWriter::EncodeFrame(): "PF\n<width> <height>\n-1.0\n", then little-endian RGB rows.
+    char Header[65] = {};
+    std::memcpy(Header, File.GetData(), std::min(File.GetSize(), sizeof(Header) - 1));
+
+    unsigned int Width = 0, Height = 0;
+    float        Scale     = 0;
+    int          HeaderEnd = 0;
+    if (std::sscanf(Header, "PF %u %u %f%n", &Width, &Height, &Scale, &HeaderEnd) != 3 || Scale >= 0 || Header[HeaderEnd] != '\n')
+    {
+        LOG_WARNING_MESSAGE("Golden image '", Path, "' is not a little-endian PFM color image");
+        return false;
+    }
+    if (Width != m_CI.Width || Height != m_CI.Height)
+    {
+        LOG_WARNING_MESSAGE("Golden image '", Path, "' is ", Width, "x", Height, ", but the suite renders ", m_CI.Width, "x", m_CI.Height, " images");
+        return false;
+    }
+
+    const size_t NumPixels = size_t{Width} * Height;
+    const size_t DataStart = static_cast<size_t>(HeaderEnd) + 1;
+    if (File.GetSize() - DataStart != NumPixels * sizeof(float) * 3)
+    {
+        LOG_WARNING_MESSAGE("Golden image '", Path, "' is truncated");
+        return false;
+    }
+
+    Pixels.resize(NumPixels);
+    const Uint8* pData = File.GetData() + DataStart;
+    for (size_t i = 0; i < NumPixels; ++i)
+    {
+        float RGB[3];
+        std::memcpy(RGB, pData + i * sizeof(RGB), sizeof(RGB));
+        Pixels[i] = float4{RGB[0], RGB[1], RGB[2], 0};
+    }
+    return true;
+}
+
+bool ReferenceImageSuite::WriteImage(const std::string& Path, const float4* pPixels, bool PFM) const
+{
+    FrameSequenceWriter::Frame F;
+    F.Width  = m_CI.Width;
+    F.Height = m_CI.Height;
+    F.Pixels.assign(pPixels, pPixels + size_t{m_CI.Width} * m_CI.Height);
+
+    std::vector<Uint8> Data;
+    if (!FrameSequenceWriter::EncodeFrame(F, PFM ? FrameSequenceWriter::FILE_FORMAT_PFM : FrameSequenceWriter::FILE_FORMAT_PNG, Data))
+    {
+        LOG_ERROR_MESSAGE("Failed to encode image '", Path, "'");
+        return false;
+    }
+
+    // Golden images are replaced in place with --reference-update, so a failed write must not truncate them.
+    return WriteFileAtomic(Path.c_str(), Data.data(), Data.size());
+}
+
+void ReferenceImageSuite::WriteReport(const std::vector<ImageResult>& Results) const
+{
+    const std::string Path  = GetFilePath("report", ".csv");
+    FILE*             pFile = std::fopen(Path.c_str(), "w");
+    if (pFile == nullptr)
+    {
+        LOG_ERROR_MESSAGE("Failed to create report '", Path, "'");
+        return;
+    }
+
+    std::fprintf(pFile, "name,width,height,status,render_ms,mean_delta_e,max_delta_e,visible_fraction\n");
+    for (const auto& Result : Results)
+    {
+        std::fprintf(pFile, "%s,%u,%u,%s,%.3f,%.4f,%.4f,%.6f\n", Result.Name.c_str(), m_CI.Width, m_CI.Height, GetStatusString(Result.Status),
+                     Result.RenderMs, Result.Difference.MeanDeltaE, Result.Difference.MaxDeltaE, Result.Difference.VisibleFraction);
+    }
+    if (std::fclose(pFile) != 0)
+        LOG_ERROR_MESSAGE("Failed to write report '", Path, "'");
+}
+
+} // namespace Diligent
@@ -0,0 +1,130 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "BasicMath.hpp"
+#include "SoftwareTracer.hpp"
+
+namespace Diligent
+{
+
+/// Regression suite that renders canonical viewpoints of a fixed scene with SoftwareTracer and
+/// compares them with stored golden images.
+
+/// Every viewpoint is rendered with a fixed camera and frame index, so the random numbers of
+/// RayUtils.fxh and therefore the image are the same on every run. Images are compared in
+/// CIELAB: the difference of a pixel is its CIE76 delta E, where 2.3 is about one just
+/// noticeable difference. An image passes if the mean difference and the fraction of visibly
+/// different pixels are within the tolerances, so optimizations that only change the rounding
+/// pass and changes that alter the look fail.
+///
+/// Golden images are stored as PFM files named after the viewpoints; the ones of the sample are
+/// in assets/reference and are checked with --reference-suite reference. For a failed viewpoint,
+/// the suite also writes the rendered image and a difference heat map next to the golden image,
+/// and it writes the results with the render time of every image to report.csv.
+class ReferenceImageSuite
+{
+public:
+    struct Viewpoint
+    {
+        const char* Name = nullptr;
+        float3      CameraPos;
+        float3      LookAt;
+    };
+
+    struct CreateInfo
+    {
+        std::string Directory;                  ///< Golden images, failed images and the report
+        Uint32      Width              = 320;
+        Uint32      Height             = 240;
+        bool        UpdateGolden       = false; ///< Replace the golden images with the rendered images
+        float       MaxMeanDeltaE      = 0.5f;
+        float       VisibleDeltaE      = 2.3f;  ///< Pixels with a larger difference count as visibly different
+        float       MaxVisibleFraction = 0.001f;
+    };
+
+    /// Difference of two images in CIE76 delta E, see CompareImages().
+    struct ImageDifference
+    {
+        float MeanDeltaE      = 0;
+        float MaxDeltaE       = 0;
+        float VisibleFraction = 0; ///< Fraction of pixels with a difference above CreateInfo::VisibleDeltaE
+    };
+
+    enum RESULT_STATUS : Uint8
+    {
+        RESULT_STATUS_PASSED = 0,
+        RESULT_STATUS_FAILED,
+        RESULT_STATUS_MISSING_GOLDEN, ///< There is no valid golden image of the same size
+        RESULT_STATUS_UPDATED         ///< The golden image was written, see CreateInfo::UpdateGolden
+    };
+
+    struct ImageResult
+    {
+        std::string     Name;
+        RESULT_STATUS   Status   = RESULT_STATUS_PASSED;
+        double          RenderMs = 0;
+        ImageDifference Difference;
+    };
+
+    explicit ReferenceImageSuite(const CreateInfo& CI);
+
+    /// Renders all viewpoints of the canonical scene and compares them with the golden images.
+    /// The vertical field of view is the one of the sample.
+    std::vector<ImageResult> Run() const;
+
+    /// Fixed copy of the sample scene that does not depend on the command line, the scene cache
+    /// or the UI. The golden images must be updated whenever it changes.
+    static SoftwareTracer::Scene CreateCanonicalScene();
+
+    /// Returns true if every result passed or was updated.
+    static bool AllPassed(const std::vector<ImageResult>& Results);
+
+    /// Canonical viewpoints of the sample scene: an overview, close-ups of the cubes, the glass
+    /// and the sphere spiral, a view from above and a grazing view of the reflective ground.
+    static const std::vector<Viewpoint>& GetCanonicalViewpoints();
+
+    /// Compares two images with the color in xyz, see ImageDifference. Colors are clamped to
+    /// [0, 1] like in the 8-bit output; NaNs count as the largest difference.
+    static ImageDifference CompareImages(const float4* pImageA, const float4* pImageB, size_t NumPixels, float VisibleDeltaE, float* pDeltaE = nullptr);
+
+    static const char* GetStatusString(RESULT_STATUS Status);
+
+private:
+    std::string GetFilePath(const char* Name, const char* Suffix) const;
+    bool        LoadGolden(const std::string& Path, std::vector<float4>& Pixels) const;
+    bool        WriteImage(const std::string& Path, const float4* pPixels, bool PFM) const;
+    void        WriteReport(const std::vector<ImageResult>& Results) const;
+
+    const CreateInfo m_CI;
+};
+
+} // namespace Diligent
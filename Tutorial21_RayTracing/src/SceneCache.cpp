@@ -0,0 +1,283 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "SceneCache.hpp"
+
+#include <cstring>
+
+#include "Align.hpp"
+#include "Errors.hpp"
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+constexpr Uint32 SceneCacheMagic   = 0x43535452; // 'RTSC'
+constexpr Uint32 SceneCacheVersion = 1;
+
+// Vertex data inside chunks relies on this alignment, see BinaryMeshDataAlignment.
+constexpr Uint64 ChunkAlignment = 64;
+
+struct SceneCacheHeader
+{
+    Uint32 Magic;
+    Uint32 Version;
+    Uint32 NumChunks;
+    Uint32 Reserved;
+    Uint64 SourceHash;
+    Uint64 ContentHash; // Hash of everything that follows the header
+    Uint64 FileSize;
+};
+
+using ChunkTableEntry = SceneCacheReader::ChunkEntry;
+
+constexpr Uint64 Prime1 = 11400714785074694791ull;
+constexpr Uint64 Prime2 = 14029467366897019727ull;
+constexpr Uint64 Prime3 = 1609587929392839161ull;
+constexpr Uint64 Prime4 = 9650029242287828579ull;
+constexpr Uint64 Prime5 = 2870177450012600261ull;
+
+inline Uint64 RotL(Uint64 x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+inline Uint64 Read64(const Uint8* p)
+{
+    Uint64 v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline Uint32 Read32(const Uint8* p)
+{
+    Uint32 v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline Uint64 Round(Uint64 Acc, Uint64 Input)
+{
+    Acc += Input * Prime2;
+    Acc = RotL(Acc, 31);
+    return Acc * Prime1;
+}
+
+inline Uint64 MergeRound(Uint64 Acc, Uint64 Val)
+{
+    Acc ^= Round(0, Val);
+    return Acc * Prime1 + Prime4;
+}
+
+} // namespace
+
+Uint64 ComputeHash64(const void* pData, size_t Size, Uint64 Seed)
+{
+    const Uint8*       p    = static_cast<const Uint8*>(pData);
+    const Uint8* const pEnd = p + Size;
+
+    Uint64 h;
+    if (Size >= 32)
+    {
+        Uint64 v1 = Seed + Prime1 + Prime2;
+        Uint64 v2 = Seed + Prime2;
+        Uint64 v3 = Seed;
+        Uint64 v4 = Seed - Prime1;
+        for (const Uint8* const pLimit = pEnd - 32; p <= pLimit; p += 32)
+        {
+            v1 = Round(v1, Read64(p + 0));
+            v2 = Round(v2, Read64(p + 8));
+            v3 = Round(v3, Read64(p + 16));
+            v4 = Round(v4, Read64(p + 24));
+        }
+        h = RotL(v1, 1) + RotL(v2, 7) + RotL(v3, 12) + RotL(v4, 18);
+        h = MergeRound(h, v1);
+        h = MergeRound(h, v2);
+        h = MergeRound(h, v3);
+        h = MergeRound(h, v4);
+    }
+    else
+    {
+        h = Seed + Prime5;
+    }
+
+    h += static_cast<Uint64>(Size);
+
+    for (; p + 8 <= pEnd; p += 8)
+    {
+        h ^= Round(0, Read64(p));
+        h = RotL(h, 27) * Prime1 + Prime4;
+    }
+    if (p + 4 <= pEnd)
+    {
+        h ^= Uint64{Read32(p)} * Prime1;
+        h = RotL(h, 23) * Prime2 + Prime3;
+        p += 4;
+    }
+    for (; p < pEnd; ++p)
+    {
+        h ^= Uint64{*p} * Prime5;
+        h = RotL(h, 11) * Prime1;
+    }
+
+    h ^= h >> 33;
+    h *= Prime2;
+    h ^= h >> 29;
+    h *= Prime3;
+    h ^= h >> 32;
+    return h;
+}
+
+void SceneCacheWriter::AddChunk(Uint32 Id, const void* pData, size_t Size)
+{
+    const auto* pBytes = static_cast<const Uint8*>(pData);
+    AddChunk(Id, std::vector<Uint8>{pBytes, pBytes + Size});
+}
+
+void SceneCacheWriter::AddChunk(Uint32 Id, std::vector<Uint8>&& Data)
+{
+    VERIFY(!HasChunk(Id), "Chunk ", Id, " has already been added");
+    m_Chunks.push_back({Id, std::move(Data)});
+}
+
+bool SceneCacheWriter::HasChunk(Uint32 Id) const
+{
+    for (const auto& C : m_Chunks)
+    {
+        if (C.Id == Id)
+            return true;
+    }
+    return false;
+}
+
+bool SceneCacheWriter::Write(const char* Path, Uint64 SourceHash) const
+{
+    // Lay out the file in memory first: the content hash covers all bytes after the header.
+    std::vector<ChunkTableEntry> Table(m_Chunks.size(), ChunkTableEntry{});
+
+    Uint64 Offset = sizeof(SceneCacheHeader) + sizeof(ChunkTableEntry) * Table.size();
+    for (size_t i = 0; i < m_Chunks.size(); ++i)
+    {
+        Offset          = AlignUp(Offset, ChunkAlignment);
+        Table[i].Id     = m_Chunks[i].Id;
+        Table[i].Offset = Offset;
+        Table[i].Size   = m_Chunks[i].Data.size();
+        Offset += Table[i].Size;
+    }
+
+    std::vector<Uint8> FileData(static_cast<size_t>(Offset));
+    if (!Table.empty())
+        std::memcpy(&FileData[sizeof(SceneCacheHeader)], Table.data(), sizeof(ChunkTableEntry) * Table.size());
+    for (size_t i = 0; i < m_Chunks.size(); ++i)
+    {
+        if (!m_Chunks[i].Data.empty())
+            std::memcpy(&FileData[static_cast<size_t>(Table[i].Offset)], m_Chunks[i].Data.data(), m_Chunks[i].Data.size());
+    }
+
+    SceneCacheHeader Header{};
+    Header.Magic       = SceneCacheMagic;
+    Header.Version     = SceneCacheVersion;
+    Header.NumChunks   = static_cast<Uint32>(Table.size());
+    Header.SourceHash  = SourceHash;
+    Header.FileSize    = FileData.size();
+    Header.ContentHash = ComputeHash64(FileData.data() + sizeof(Header), FileData.size() - sizeof(Header));
+    std::memcpy(FileData.data(), &Header, sizeof(Header));
+
+    return WriteFileAtomic(Path, FileData.data(), FileData.size());
+}
+
+bool SceneCacheReader::Open(const char* Path, Uint64 SourceHash)
+{
+    m_File.Close();
+    m_Chunks.clear();
+
+    MappedFile File;
+    if (!File.Open(Path))
+        return false;
+
+    SceneCacheHeader Header{};
+    if (File.GetSize() < sizeof(Header))
+    {
+        LOG_WARNING_MESSAGE("Scene cache '", Path, "' is truncated");
+        return false;
+    }
+    std::memcpy(&Header, File.GetData(), sizeof(Header));
+
+    if (Header.Magic != SceneCacheMagic || Header.Version != SceneCacheVersion)
+    {
+        LOG_INFO_MESSAGE("Scene cache '", Path, "' has an unsupported version and will be rebuilt");
+        return false;
+    }
+    if (Header.SourceHash != SourceHash)
+    {
+        LOG_INFO_MESSAGE("Scene cache '", Path, "' is out of date and will be rebuilt");
+        return false;
+    }
+    if (Header.FileSize != File.GetSize() ||
+        sizeof(Header) + Uint64{Header.NumChunks} * sizeof(ChunkTableEntry) > File.GetSize() ||
+        ComputeHash64(File.GetData() + sizeof(Header), File.GetSize() - sizeof(Header)) != Header.ContentHash)
+    {
+        LOG_WARNING_MESSAGE("Scene cache '", Path, "' is corrupted and will be rebuilt");
+        return false;
+    }
+
+    std::vector<ChunkEntry> Chunks(Header.NumChunks);
+    if (!Chunks.empty())
+        std::memcpy(Chunks.data(), File.GetData() + sizeof(Header), sizeof(ChunkEntry) * Chunks.size());
+    for (const auto& C : Chunks)
+    {
+        // Offsets come from the file and are checked before anything is added to them.
+        if (C.Offset % ChunkAlignment != 0 || C.Offset > File.GetSize() || C.Size > File.GetSize() - C.Offset)
+        {
+            LOG_WARNING_MESSAGE("Scene cache '", Path, "' has an invalid chunk table");
+            return false;
+        }
+    }
+
+    m_File   = std::move(File);
+    m_Chunks = std::move(Chunks);
+    return true;
+}
+
+const void* SceneCacheReader::GetChunk(Uint32 Id, size_t& Size) const
+{
+    for (const auto& C : m_Chunks)
+    {
+        if (C.Id == Id)
+        {
+            Size = static_cast<size_t>(C.Size);
+            return m_File.GetData() + C.Offset;
+        }
+    }
+    Size = 0;
+    return nullptr;
+}
+
+} // namespace Diligent
@@ -0,0 +1,108 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "BasicTypes.h"
+#include "MappedFile.hpp"
+
+namespace Diligent
+{
+
+/// 64-bit non-cryptographic hash (XXH64 algorithm).
+Uint64 ComputeHash64(const void* pData, size_t Size, Uint64 Seed = 0);
+
+/// Collects data chunks and writes them to a scene cache file.
+
+/// A scene cache file consists of a header, a chunk table and chunk data. Chunks are aligned
+/// so that arrays of vertices, indices and texels can be used directly from the mapped file.
+/// The header stores two hashes: the source hash identifies the inputs the cache was built
+/// from and is provided by the application, and the content hash protects the file contents.
+class SceneCacheWriter
+{
+public:
+    /// Adds a chunk with a copy of the data. Chunk ids must be unique.
+    void AddChunk(Uint32 Id, const void* pData, size_t Size);
+    void AddChunk(Uint32 Id, std::vector<Uint8>&& Data);
+
+    bool HasChunk(Uint32 Id) const;
+
+    /// Writes the file to a temporary location and renames it, so that readers
+    /// never see a partially written cache.
+    bool Write(const char* Path, Uint64 SourceHash) const;
+
+private:
+    struct Chunk
+    {
+        Uint32             Id;
+        std::vector<Uint8> Data;
+    };
+    std::vector<Chunk> m_Chunks;
+};
+
+/// Maps a scene cache file and provides access to its chunks.
+class SceneCacheReader
+{
+public:
+    struct ChunkEntry
+    {
+        Uint32 Id;
+        Uint32 Reserved;
+        Uint64 Offset;
+        Uint64 Size;
+    };
+
+    /// Maps the file and validates its version, source hash and content hash.
+    /// Returns false if the cache is missing, stale or corrupted.
+    bool Open(const char* Path, Uint64 SourceHash);
+
+    bool IsOpen() const { return m_File.IsOpen(); }
+
+    /// Returns a pointer to the chunk data, or null if there is no such chunk.
+    const void* GetChunk(Uint32 Id, size_t& Size) const;
+
+    /// Returns chunk data as an array of T. Fails if the chunk size is not a multiple of sizeof(T).
+    template <typename T>
+    bool GetArray(Uint32 Id, const T*& pData, size_t& Count) const
+    {
+        size_t      Size   = 0;
+        const void* pChunk = GetChunk(Id, Size);
+        if (pChunk == nullptr || Size % sizeof(T) != 0)
+            return false;
+        pData = static_cast<const T*>(pChunk);
+        Count = Size / sizeof(T);
+        return true;
+    }
+
+private:
+    MappedFile              m_File;
+    std::vector<ChunkEntry> m_Chunks;
+};
+
+} // namespace Diligent
@@ -0,0 +1,199 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "SceneEditQueue.hpp"
+
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+struct SceneEditQueue::Batch
+{
+    Batch*    pNext    = nullptr;
+    Uint32    NumEdits = 0;
+    SceneEdit Edits[BatchSize];
+};
+
+namespace
+{
+
+// Edits that replace each other when they have the same target.
+SCENE_EDIT_TYPE GetCoalescingType(SCENE_EDIT_TYPE Type)
+{
+    return Type == SCENE_EDIT_REMOVE_INSTANCE ? SCENE_EDIT_ADD_INSTANCE : Type;
+}
+
+} // namespace
+
+SceneEditQueue::Writer::Writer(SceneEditQueue& Queue) :
+    m_Queue{Queue}
+{
+}
+
+SceneEditQueue::Writer::~Writer()
+{
+    Flush();
+
+    if (m_pBatch != nullptr)
+    {
+        m_pBatch->pNext = m_pSpare;
+        m_pSpare        = m_pBatch;
+        m_pBatch        = nullptr;
+    }
+    if (m_pSpare != nullptr)
+    {
+        Batch* pLast = m_pSpare;
+        while (pLast->pNext != nullptr)
+            pLast = pLast->pNext;
+        PushList(m_Queue.m_Free, m_pSpare, pLast);
+        m_pSpare = nullptr;
+    }
+}
+
+void SceneEditQueue::Writer::Push(const SceneEdit& Edit)
+{
+    VERIFY_EXPR(Edit.Type < SCENE_EDIT_TYPE_COUNT);
+
+    if (m_pBatch == nullptr)
+        m_pBatch = m_Queue.AcquireBatch(m_pSpare);
+
+    m_pBatch->Edits[m_pBatch->NumEdits++] = Edit;
+    if (m_pBatch->NumEdits == BatchSize)
+        Flush();
+}
+
+void SceneEditQueue::Writer::Flush()
+{
+    if (m_pBatch == nullptr || m_pBatch->NumEdits == 0)
+        return;
+
+    PushList(m_Queue.m_Published, m_pBatch, m_pBatch);
+    m_pBatch = nullptr;
+}
+
+SceneEditQueue::~SceneEditQueue()
+{
+    // All writers must have been destroyed, so every batch is in one of the lists.
+    for (Batch* pList : {m_Published.exchange(nullptr), m_Free.exchange(nullptr)})
+    {
+        while (pList != nullptr)
+        {
+            Batch* pNext = pList->pNext;
+            delete pList;
+            pList = pNext;
+        }
+    }
+}
+
+void SceneEditQueue::PushList(std::atomic<Batch*>& Head, Batch* pFirst, Batch* pLast)
+{
+    // Pushing is safe from ABA: the new head does not depend on anything but the old head.
+    Batch* pHead = Head.load(std::memory_order_relaxed);
+    do
+    {
+        pLast->pNext = pHead;
+    } while (!Head.compare_exchange_weak(pHead, pFirst, std::memory_order_release, std::memory_order_relaxed));
+}
+
+SceneEditQueue::Batch* SceneEditQueue::AcquireBatch(Batch*& pSpare)
+{
+    // Take the whole free list rather than one batch, so no batch is ever popped concurrently.
+    if (pSpare == nullptr)
+        pSpare = m_Free.exchange(nullptr, std::memory_order_acquire);
+
+    if (pSpare == nullptr)
+    {
+        m_NumBatches.fetch_add(1, std::memory_order_relaxed);
+        return new Batch;
+    }
+
+    Batch* pBatch    = pSpare;
+    pSpare           = pBatch->pNext;
+    pBatch->pNext    = nullptr;
+    pBatch->NumEdits = 0;
+    return pBatch;
+}
+
+const std::vector<SceneEdit>& SceneEditQueue::Drain()
+{
+    m_Edits.clear();
+    m_LastEdit.clear();
+    m_Stats.NumEdits     = 0;
+    m_Stats.NumCoalesced = 0;
+
+    Batch* pNewest = m_Published.exchange(nullptr, std::memory_order_acquire);
+    if (pNewest == nullptr)
+    {
+        m_Stats.NumBatches = m_NumBatches.load(std::memory_order_relaxed);
+        return m_Edits;
+    }
+
+    // The list starts with the newest batch. Reverse it to apply the edits in order.
+    Batch* pOldest = nullptr;
+    Batch* pLast   = pNewest;
+    while (pNewest != nullptr)
+    {
+        Batch* pNext   = pNewest->pNext;
+        pNewest->pNext = pOldest;
+        pOldest        = pNewest;
+        pNewest        = pNext;
+    }
+
+    const auto GetKey = [](const SceneEdit& Edit) {
+        return (Uint64{GetCoalescingType(Edit.Type)} << 32) | Edit.Target;
+    };
+
+    // An edit removes the earlier edit of the same kind and target, and the remaining edit keeps
+    // its own position. Replacing the earlier edit in place would move it before the edits that
+    // were made in between, e.g. an instance move before the move of its group.
+    Uint32 EditIdx = 0;
+    for (const Batch* pBatch = pOldest; pBatch != nullptr; pBatch = pBatch->pNext)
+    {
+        for (Uint32 i = 0; i < pBatch->NumEdits; ++i)
+            m_LastEdit[GetKey(pBatch->Edits[i])] = EditIdx++;
+        m_Stats.NumEdits += pBatch->NumEdits;
+    }
+
+    EditIdx = 0;
+    for (const Batch* pBatch = pOldest; pBatch != nullptr; pBatch = pBatch->pNext)
+    {
+        for (Uint32 i = 0; i < pBatch->NumEdits; ++i, ++EditIdx)
+        {
+            const auto& Edit = pBatch->Edits[i];
+            if (m_LastEdit[GetKey(Edit)] == EditIdx)
+                m_Edits.push_back(Edit);
+        }
+    }
+    m_Stats.NumCoalesced = m_Stats.NumEdits - static_cast<Uint32>(m_Edits.size());
+
+    PushList(m_Free, pOldest, pLast);
+    m_Stats.NumBatches = m_NumBatches.load(std::memory_order_relaxed);
+    return m_Edits;
+}
+
+} // namespace Diligent
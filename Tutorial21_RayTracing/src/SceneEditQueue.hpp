@@ -0,0 +1,152 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <unordered_map>
+#include <vector>
+
+#include "BasicMath.hpp"
+#include "TopLevelAS.h"
+#include "LightBVH.hpp"
+
+namespace Diligent
+{
+
+/// Kinds of scene edits, see SceneEditQueue.
+enum SCENE_EDIT_TYPE : Uint8
+{
+    /// Makes a removed instance active again.
+    SCENE_EDIT_ADD_INSTANCE = 0,
+
+    /// Removes the instance from the scene.
+    SCENE_EDIT_REMOVE_INSTANCE,
+
+    /// Replaces the transform of the instance.
+    SCENE_EDIT_MOVE_INSTANCE,
+
+    /// Replaces the material of the instance.
+    SCENE_EDIT_SET_MATERIAL,
+
+    /// Replaces the light.
+    SCENE_EDIT_SET_LIGHT,
+
+    /// Replaces the transform of an instance group, see InstanceHierarchy.
+    SCENE_EDIT_MOVE_GROUP,
+
+    SCENE_EDIT_TYPE_COUNT
+};
+
+struct SceneEdit
+{
+    SCENE_EDIT_TYPE Type   = SCENE_EDIT_ADD_INSTANCE;
+    Uint32          Target = 0; ///< Instance index, light index for SCENE_EDIT_SET_LIGHT, or group index for SCENE_EDIT_MOVE_GROUP
+
+    InstanceMatrix  Transform;    ///< SCENE_EDIT_MOVE_INSTANCE and SCENE_EDIT_MOVE_GROUP
+    Uint32          Material = 0; ///< SCENE_EDIT_SET_MATERIAL
+    LightBVH::Light Light;        ///< SCENE_EDIT_SET_LIGHT
+};
+
+/// Lock-free queue of scene edits from any number of threads to the render thread.
+
+/// Every producer thread uses its own Writer, which collects edits in a batch and publishes
+/// the full batch with one compare-and-swap, so producers never wait for each other or for
+/// the render thread and contend on a shared cache line only once per BatchSize edits.
+/// The render thread takes all published batches at once in Drain() and returns them to a
+/// free list, from which writers take them again, so batches are not allocated in the
+/// steady state. Neither list is ever popped one batch at a time, which avoids the ABA
+/// problem of lock-free stacks.
+///
+/// Drain() coalesces the edits: of several edits of the same kind for the same target, only
+/// the last one is kept, at its own position, and adding and removing an instance are the
+/// same kind. Edits of one writer keep their order; edits of different writers are ordered
+/// by the time their batches were published.
+class SceneEditQueue
+{
+    struct Batch;
+
+public:
+    static constexpr Uint32 BatchSize = 256;
+
+    /// Producer side of the queue, used by one thread at a time. Destroying a writer flushes
+    /// it; all writers must be destroyed before the queue.
+    class Writer
+    {
+    public:
+        explicit Writer(SceneEditQueue& Queue);
+        ~Writer();
+
+        Writer(const Writer&) = delete;
+        Writer& operator=(const Writer&) = delete;
+
+        void Push(const SceneEdit& Edit);
+
+        /// Publishes the edits that have been pushed so far. Edits in a partially filled batch
+        /// are not seen by Drain() until the batch is full or flushed.
+        void Flush();
+
+    private:
+        SceneEditQueue& m_Queue;
+        Batch*          m_pBatch = nullptr;
+        Batch*          m_pSpare = nullptr; // Free batches taken from the queue
+    };
+
+    SceneEditQueue() = default;
+    ~SceneEditQueue();
+
+    SceneEditQueue(const SceneEditQueue&) = delete;
+    SceneEditQueue& operator=(const SceneEditQueue&) = delete;
+
+    /// Takes all published edits and coalesces them. Must only be called from one thread.
+    /// The returned edits are valid until the next call.
+    const std::vector<SceneEdit>& Drain();
+
+    struct Stats
+    {
+        Uint32 NumEdits     = 0; ///< Edits taken by the last Drain()
+        Uint32 NumCoalesced = 0; ///< Edits that were replaced by later edits
+        Uint32 NumBatches   = 0; ///< Batches allocated so far
+    };
+    const Stats& GetStats() const { return m_Stats; }
+
+private:
+    static void PushList(std::atomic<Batch*>& Head, Batch* pFirst, Batch* pLast);
+
+    Batch* AcquireBatch(Batch*& pSpare);
+
+    std::atomic<Batch*> m_Published{nullptr}; // Newest batch first
+    std::atomic<Batch*> m_Free{nullptr};
+    std::atomic<Uint32> m_NumBatches{0};
+
+    // Only used by Drain()
+    std::vector<SceneEdit>             m_Edits;
+    std::unordered_map<Uint64, Uint32> m_LastEdit; // Index among the drained edits of the last edit of a kind and target
+    Stats                              m_Stats;
+};
+
+} // namespace Diligent
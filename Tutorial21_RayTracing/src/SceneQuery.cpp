@@ -0,0 +1,516 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "SceneQuery.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+#include "DebugUtilities.hpp"
+#include "InstanceClusterLOD.hpp"
+#include "ParallelFor.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+// Primitives in a leaf of the hierarchy.
+constexpr Uint32 MaxLeafSize = 4;
+
+// Rays traced by one task of a batch.
+constexpr Uint32 RayBlockSize = 256;
+
+// Largest depth of the hierarchy is bounded by the median split.
+constexpr Uint32 MaxTraversalDepth = 64;
+
+bool IntersectBox(const float3& BoxMin, const float3& BoxMax, const float3& Origin, const float3& InvDir, float TMin, float TMax, float& TEntry)
+{
+    for (int a = 0; a < 3; ++a)
+    {
+        float t0 = (BoxMin[a] - Origin[a]) * InvDir[a];
+        float t1 = (BoxMax[a] - Origin[a]) * InvDir[a];
+        if (t0 > t1)
+            std::swap(t0, t1);
+        TMin = std::max(TMin, t0);
+        TMax = std::min(TMax, t1);
+    }
+    TEntry = TMin;
+    return TMin <= TMax;
+}
+
+float3 GetInverseDirection(const float3& Dir)
+{
+    // Zero components produce infinities, which the slab test handles.
+    return float3{1.f / Dir.x, 1.f / Dir.y, 1.f / Dir.z};
+}
+
+} // namespace
+
+/// Binary hierarchy over primitive bounds. The root is node 0, children of an inner node are stored next to each other.
+struct SceneQuery::BVH
+{
+    struct Node
+    {
+        float3 BoundsMin;
+        Uint32 Index = 0; // First child of an inner node or the first primitive of a leaf in Prims
+        float3 BoundsMax;
+        Uint32 Count = 0; // Number of primitives of a leaf, 0 for inner nodes
+    };
+    std::vector<Node>   Nodes;
+    std::vector<Uint32> Prims;
+
+    void Build(const float3* pMin, const float3* pMax, Uint32 NumPrims)
+    {
+        Nodes.clear();
+        Prims.resize(NumPrims);
+        for (Uint32 i = 0; i < NumPrims; ++i)
+            Prims[i] = i;
+        if (NumPrims == 0)
+            return;
+
+        std::vector<float3> Centers(NumPrims);
+        for (Uint32 i = 0; i < NumPrims; ++i)
+            Centers[i] = (pMin[i] + pMax[i]) * 0.5f;
+
+        Nodes.reserve(size_t{NumPrims} * 2);
+        Nodes.emplace_back();
+        BuildNode(0, 0, NumPrims, pMin, pMax, Centers);
+    }
+
+    void BuildNode(Uint32 NodeIdx, Uint32 First, Uint32 Count, const float3* pMin, const float3* pMax, const std::vector<float3>& Centers)
+    {
+        Node N;
+        N.BoundsMin      = float3{+FLT_MAX, +FLT_MAX, +FLT_MAX};
+        N.BoundsMax      = float3{-FLT_MAX, -FLT_MAX, -FLT_MAX};
+        float3 CenterMin = N.BoundsMin;
+        float3 CenterMax = N.BoundsMax;
+        for (Uint32 i = First; i < First + Count; ++i)
+        {
+            N.BoundsMin = std::min(N.BoundsMin, pMin[Prims[i]]);
+            N.BoundsMax = std::max(N.BoundsMax, pMax[Prims[i]]);
+            CenterMin   = std::min(CenterMin, Centers[Prims[i]]);
+            CenterMax   = std::max(CenterMax, Centers[Prims[i]]);
+        }
+
+        if (Count <= MaxLeafSize)
+        {
+            N.Index        = First;
+            N.Count        = Count;
+            Nodes[NodeIdx] = N;
+            return;
+        }
+
+        // Split at the median along the largest extent of the primitive centers.
+        const float3 Extent = CenterMax - CenterMin;
+        const int    Axis   = Extent.x > Extent.y ? (Extent.x > Extent.z ? 0 : 2) : (Extent.y > Extent.z ? 1 : 2);
+        const Uint32 Half   = Count / 2;
+        std::nth_element(Prims.begin() + First, Prims.begin() + First + Half, Prims.begin() + First + Count,
+                         [&](Uint32 a, Uint32 b) { return Centers[a][Axis] < Centers[b][Axis]; });
+
+        N.Index        = static_cast<Uint32>(Nodes.size());
+        Nodes[NodeIdx] = N;
+        Nodes.emplace_back();
+        Nodes.emplace_back();
+        BuildNode(N.Index, First, Half, pMin, pMax, Centers);
+        BuildNode(N.Index + 1, First + Half, Count - Half, pMin, pMax, Centers);
+    }
+
+    /// Calls IntersectPrim(Prim, TMax) for the primitives whose leaves the ray enters before TMax.
+    /// IntersectPrim shortens TMax and returns true when it finds a hit. With AnyHit, traversal stops at the first hit.
+    template <bool AnyHit, typename IntersectPrimType>
+    bool Traverse(const float3& Origin, const float3& Dir, float TMin, float& TMax, IntersectPrimType&& IntersectPrim) const
+    {
+        if (Nodes.empty())
+            return false;
+
+        const float3 InvDir = GetInverseDirection(Dir);
+
+        Uint32 Stack[MaxTraversalDepth];
+        Uint32 StackSize   = 0;
+        Stack[StackSize++] = 0;
+
+        bool Found = false;
+        while (StackSize > 0)
+        {
+            const Node& N = Nodes[Stack[--StackSize]];
+
+            float TEntry;
+            if (!IntersectBox(N.BoundsMin, N.BoundsMax, Origin, InvDir, TMin, TMax, TEntry))
+                continue;
+
+            if (N.Count > 0)
+            {
+                for (Uint32 i = N.Index; i < N.Index + N.Count; ++i)
+                {
+                    if (IntersectPrim(Prims[i], TMax))
+                    {
+                        Found = true;
+                        if (AnyHit)
+                            return true;
+                    }
+                }
+                continue;
+            }
+
+            // Visit the closer child first, so that its hits cull the other child.
+            const Node& C0 = Nodes[N.Index];
+            const Node& C1 = Nodes[N.Index + 1];
+            float       T0, T1;
+            const bool  Hit0 = IntersectBox(C0.BoundsMin, C0.BoundsMax, Origin, InvDir, TMin, TMax, T0);
+            const bool  Hit1 = IntersectBox(C1.BoundsMin, C1.BoundsMax, Origin, InvDir, TMin, TMax, T1);
+            VERIFY_EXPR(StackSize + 2 <= MaxTraversalDepth);
+            if (Hit0 && Hit1)
+            {
+                Stack[StackSize++] = T0 < T1 ? N.Index + 1 : N.Index;
+                Stack[StackSize++] = T0 < T1 ? N.Index : N.Index + 1;
+            }
+            else if (Hit0)
+                Stack[StackSize++] = N.Index;
+            else if (Hit1)
+                Stack[StackSize++] = N.Index + 1;
+        }
+        return Found;
+    }
+};
+
+class SceneQuery::Geometry
+{
+public:
+    // Triangle geometry
+    std::vector<float3> Positions;
+    std::vector<Uint32> Indices;
+    BVH                 Tree;
+
+    // Sphere geometry
+    bool   IsSphere = false;
+    float3 Center;
+    float  Radius = 0;
+
+    float3 BoundsMin;
+    float3 BoundsMax;
+
+    /// Intersects the ray in object space and returns the object-space normal, the triangle
+    /// and the barycentrics of the hit.
+    template <bool AnyHit>
+    bool Intersect(const float3& Origin, const float3& Dir, float TMin, float& TMax, float3& Normal, Uint32& Primitive, float2& Barycentrics) const
+    {
+        if (IsSphere)
+        {
+            // Same as SphereIntersection.rint, except that hits behind TMin are skipped.
+            const float3 OC = Origin - Center;
+            const float  a  = dot(Dir, Dir);
+            const float  b  = 2.f * dot(OC, Dir);
+            const float  c  = dot(OC, OC) - Radius * Radius;
+            const float  d  = b * b - 4.f * a * c;
+            if (d < 0)
+                return false;
+
+            const float SqrtD = std::sqrt(d);
+            float       t     = (-b - SqrtD) / (2.f * a);
+            if (t < TMin)
+                t = (-b + SqrtD) / (2.f * a);
+            if (t < TMin || t > TMax)
+                return false;
+
+            TMax      = t;
+            Normal    = Origin + Dir * t - Center;
+            Primitive = 0;
+            return true;
+        }
+
+        return Tree.Traverse<AnyHit>(Origin, Dir, TMin, TMax, [&](Uint32 Tri, float& TriTMax) {
+            // Moller-Trumbore, both faces are hit.
+            const float3& V0  = Positions[Indices[Tri * 3 + 0]];
+            const float3  E1  = Positions[Indices[Tri * 3 + 1]] - V0;
+            const float3  E2  = Positions[Indices[Tri * 3 + 2]] - V0;
+            const float3  P   = cross(Dir, E2);
+            const float   Det = dot(E1, P);
+            if (std::abs(Det) < 1e-12f)
+                return false;
+
+            const float  InvDet = 1.f / Det;
+            const float3 S      = Origin - V0;
+            const float  u      = dot(S, P) * InvDet;
+            if (u < 0 || u > 1)
+                return false;
+
+            const float3 Q = cross(S, E1);
+            const float  v = dot(Dir, Q) * InvDet;
+            if (v < 0 || u + v > 1)
+                return false;
+
+            const float t = dot(E2, Q) * InvDet;
+            if (t < TMin || t > TriTMax)
+                return false;
+
+            TriTMax      = t;
+            Normal       = cross(E1, E2);
+            Primitive    = Tri;
+            Barycentrics = float2{u, v};
+            return true;
+        });
+    }
+};
+
+struct SceneQuery::InstanceData
+{
+    std::shared_ptr<const Geometry> pGeometry;
+    Uint32                          InstanceIndex = 0;
+    Uint32                          CustomId      = 0;
+
+    // Inverse of the instance transform: object-space point = WorldToObject * (world-space point - Translation)
+    float  WorldToObject[3][3] = {};
+    float3 Translation;
+};
+
+std::shared_ptr<const SceneQuery::Geometry> SceneQuery::CreateTriangleGeometry(const MeshVertex* pVertices,
+                                                                               Uint32            NumVertices,
+                                                                               const Uint32*     pIndices,
+                                                                               Uint32            NumIndices)
+{
+    VERIFY_EXPR(NumIndices % 3 == 0);
+
+    auto pGeometry = std::make_shared<Geometry>();
+    pGeometry->Positions.resize(NumVertices);
+    for (Uint32 v = 0; v < NumVertices; ++v)
+        pGeometry->Positions[v] = pVertices[v].Pos;
+    pGeometry->Indices.assign(pIndices, pIndices + NumIndices);
+
+    const Uint32        NumTriangles = NumIndices / 3;
+    std::vector<float3> TriMin(NumTriangles), TriMax(NumTriangles);
+    for (Uint32 t = 0; t < NumTriangles; ++t)
+    {
+        const auto& V0 = pGeometry->Positions[pIndices[t * 3 + 0]];
+        const auto& V1 = pGeometry->Positions[pIndices[t * 3 + 1]];
+        const auto& V2 = pGeometry->Positions[pIndices[t * 3 + 2]];
+        TriMin[t]      = std::min(std::min(V0, V1), V2);
+        TriMax[t]      = std::max(std::max(V0, V1), V2);
+    }
+    pGeometry->Tree.Build(TriMin.data(), TriMax.data(), NumTriangles);
+
+    if (!pGeometry->Tree.Nodes.empty())
+    {
+        pGeometry->BoundsMin = pGeometry->Tree.Nodes[0].BoundsMin;
+        pGeometry->BoundsMax = pGeometry->Tree.Nodes[0].BoundsMax;
+    }
+    return pGeometry;
+}
+
+std::shared_ptr<const SceneQuery::Geometry> SceneQuery::CreateSphereGeometry(const float3& Center, float Radius)
+{
+    auto pGeometry       = std::make_shared<Geometry>();
+    pGeometry->IsSphere  = true;
+    pGeometry->Center    = Center;
+    pGeometry->Radius    = Radius;
+    pGeometry->BoundsMin = Center - float3{Radius, Radius, Radius};
+    pGeometry->BoundsMax = Center + float3{Radius, Radius, Radius};
+    return pGeometry;
+}
+
+SceneQuery::SceneQuery(std::vector<Instance> Instances) :
+    m_pInstanceBVH{std::make_unique<BVH>()}
+{
+    m_Instances.resize(Instances.size());
+    std::vector<float3> InstMin(Instances.size()), InstMax(Instances.size());
+    for (size_t i = 0; i < Instances.size(); ++i)
+    {
+        const auto& Src = Instances[i];
+        auto&       Dst = m_Instances[i];
+        VERIFY_EXPR(Src.pGeometry != nullptr);
+
+        Dst.pGeometry     = Src.pGeometry;
+        Dst.InstanceIndex = Src.InstanceIndex;
+        Dst.CustomId      = Src.CustomId;
+
+        // Invert the 3x3 part of the transform with the adjugate.
+        const auto& M   = Src.Transform.data;
+        const float Det = M[0][0] * (M[1][1] * M[2][2] - M[1][2] * M[2][1]) -
+            M[0][1] * (M[1][0] * M[2][2] - M[1][2] * M[2][0]) +
+            M[0][2] * (M[1][0] * M[2][1] - M[1][1] * M[2][0]);
+        VERIFY(std::abs(Det) > 1e-12f, "Instance transform is not invertible");
+        const float InvDet = 1.f / Det;
+
+        auto& Inv       = Dst.WorldToObject;
+        Inv[0][0]       = (M[1][1] * M[2][2] - M[1][2] * M[2][1]) * InvDet;
+        Inv[0][1]       = (M[0][2] * M[2][1] - M[0][1] * M[2][2]) * InvDet;
+        Inv[0][2]       = (M[0][1] * M[1][2] - M[0][2] * M[1][1]) * InvDet;
+        Inv[1][0]       = (M[1][2] * M[2][0] - M[1][0] * M[2][2]) * InvDet;
+        Inv[1][1]       = (M[0][0] * M[2][2] - M[0][2] * M[2][0]) * InvDet;
+        Inv[1][2]       = (M[0][2] * M[1][0] - M[0][0] * M[1][2]) * InvDet;
+        Inv[2][0]       = (M[1][0] * M[2][1] - M[1][1] * M[2][0]) * InvDet;
+        Inv[2][1]       = (M[0][1] * M[2][0] - M[0][0] * M[2][1]) * InvDet;
+        Inv[2][2]       = (M[0][0] * M[1][1] - M[0][1] * M[1][0]) * InvDet;
+        Dst.Translation = float3{M[0][3], M[1][3], M[2][3]};
+
+        TransformBounds(Src.pGeometry->BoundsMin, Src.pGeometry->BoundsMax, Src.Transform, InstMin[i], InstMax[i]);
+    }
+    m_pInstanceBVH->Build(InstMin.data(), InstMax.data(), static_cast<Uint32>(Instances.size()));
+}
+
+SceneQuery::~SceneQuery()
+{
+}
+
+Uint32 SceneQuery::GetNumInstances() const
+{
+    return static_cast<Uint32>(m_Instances.size());
+}
+
+template <bool AnyHit>
+bool SceneQuery::Trace(const Ray& R, Hit& H) const
+{
+    float TMax = R.TMax;
+    return m_pInstanceBVH->Traverse<AnyHit>(R.Origin, R.Direction, R.TMin, TMax, [&](Uint32 InstIdx, float& InstTMax) {
+        const auto& Inst = m_Instances[InstIdx];
+        const auto& Inv  = Inst.WorldToObject;
+
+        // The direction is not normalized, so object-space distances equal world-space distances.
+        const auto ToObject = [&Inv](const float3& v) {
+            return float3{
+                Inv[0][0] * v.x + Inv[0][1] * v.y + Inv[0][2] * v.z,
+                Inv[1][0] * v.x + Inv[1][1] * v.y + Inv[1][2] * v.z,
+                Inv[2][0] * v.x + Inv[2][1] * v.y + Inv[2][2] * v.z,
+            };
+        };
+        const float3 Origin = ToObject(R.Origin - Inst.Translation);
+        const float3 Dir    = ToObject(R.Direction);
+
+        float3 Normal;
+        Uint32 Primitive = 0;
+        float2 Barycentrics;
+        if (!Inst.pGeometry->Intersect<AnyHit>(Origin, Dir, R.TMin, InstTMax, Normal, Primitive, Barycentrics))
+            return false;
+
+        if (!AnyHit)
+        {
+            // Normals are transformed by the inverse transpose.
+            float3 N{
+                Inv[0][0] * Normal.x + Inv[1][0] * Normal.y + Inv[2][0] * Normal.z,
+                Inv[0][1] * Normal.x + Inv[1][1] * Normal.y + Inv[2][1] * Normal.z,
+                Inv[0][2] * Normal.x + Inv[1][2] * Normal.y + Inv[2][2] * Normal.z,
+            };
+            N = normalize(N);
+            if (dot(N, R.Direction) > 0)
+                N = -N;
+
+            H.InstanceIndex  = Inst.InstanceIndex;
+            H.CustomId       = Inst.CustomId;
+            H.Distance       = InstTMax;
+            H.Normal         = N;
+            H.PrimitiveIndex = Primitive;
+            H.Barycentrics   = Barycentrics;
+        }
+        return true;
+    });
+}
+
+SceneQuery::Hit SceneQuery::TraceClosest(const Ray& R) const
+{
+    Hit H;
+    Trace<false>(R, H);
+    return H;
+}
+
+bool SceneQuery::TraceAny(const Ray& R) const
+{
+    Hit H;
+    return Trace<true>(R, H);
+}
+
+void SceneQuery::TraceClosest(const Ray* pRays, Hit* pHits, Uint32 NumRays) const
+{
+    const Uint32 NumBlocks = (NumRays + RayBlockSize - 1) / RayBlockSize;
+    ParallelFor(NumBlocks, [&](Uint32 Block) {
+        const Uint32 End = std::min((Block + 1) * RayBlockSize, NumRays);
+        for (Uint32 i = Block * RayBlockSize; i < End; ++i)
+            pHits[i] = TraceClosest(pRays[i]);
+    });
+}
+
+void SceneQuery::TraceAny(const Ray* pRays, bool* pHits, Uint32 NumRays) const
+{
+    const Uint32 NumBlocks = (NumRays + RayBlockSize - 1) / RayBlockSize;
+    ParallelFor(NumBlocks, [&](Uint32 Block) {
+        const Uint32 End = std::min((Block + 1) * RayBlockSize, NumRays);
+        for (Uint32 i = Block * RayBlockSize; i < End; ++i)
+            pHits[i] = TraceAny(pRays[i]);
+    });
+}
+
+SceneQuery::BenchmarkResult SceneQuery::RunBenchmark(const float3& Origin, Uint32 NumRays, Uint32 Seed) const
+{
+    BenchmarkResult Result;
+    Result.NumRays = NumRays;
+    if (m_pInstanceBVH->Nodes.empty() || NumRays == 0)
+        return Result;
+
+    // Aim at random points in the scene bounds, so that most rays enter the hierarchy.
+    const auto&                           Root = m_pInstanceBVH->Nodes[0];
+    std::mt19937                          Gen{Seed};
+    std::uniform_real_distribution<float> Dist{0.f, 1.f};
+
+    std::vector<Ray> Rays(NumRays);
+    for (auto& R : Rays)
+    {
+        const float3 Target{
+            Root.BoundsMin.x + (Root.BoundsMax.x - Root.BoundsMin.x) * Dist(Gen),
+            Root.BoundsMin.y + (Root.BoundsMax.y - Root.BoundsMin.y) * Dist(Gen),
+            Root.BoundsMin.z + (Root.BoundsMax.z - Root.BoundsMin.z) * Dist(Gen),
+        };
+        R.Origin    = Origin;
+        R.Direction = normalize(Target - Origin);
+    }
+
+    using Clock = std::chrono::high_resolution_clock;
+
+    std::vector<Hit> Hits(NumRays);
+    auto             Start = Clock::now();
+    TraceClosest(Rays.data(), Hits.data(), NumRays);
+    const double ClosestMs = std::chrono::duration<double, std::milli>(Clock::now() - Start).count();
+
+    std::unique_ptr<bool[]> AnyHits{new bool[NumRays]};
+    Start = Clock::now();
+    TraceAny(Rays.data(), AnyHits.get(), NumRays);
+    const double AnyMs = std::chrono::duration<double, std::milli>(Clock::now() - Start).count();
+
+    for (Uint32 i = 0; i < NumRays; ++i)
+    {
+        Result.NumClosestHits += Hits[i].IsHit() ? 1 : 0;
+        Result.NumAnyHits += AnyHits[i] ? 1 : 0;
+    }
+    VERIFY(Result.NumClosestHits == Result.NumAnyHits, "Closest-hit and any-hit queries disagree");
+
+    Result.ClosestRaysPerMs = NumRays / std::max(ClosestMs, 1e-3);
+    Result.AnyRaysPerMs     = NumRays / std::max(AnyMs, 1e-3);
+    return Result;
+}
+
+} // namespace Diligent
@@ -0,0 +1,135 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <cfloat>
+#include <memory>
+#include <vector>
+
+#include "BasicMath.hpp"
+#include "TopLevelAS.h"
+#include "MeshLoader.hpp"
+
+namespace Diligent
+{
+
+/// Ray queries against a CPU copy of the scene, e.g. for picking and occlusion tests in tools.
+
+/// The scene mirrors the instances of the TLAS: every instance references a shared geometry
+/// (a triangle mesh or an analytic sphere) with a transform. Geometries have their own
+/// bounding volume hierarchy and the scene has one over the instance bounds, like a BLAS
+/// and a TLAS. A scene is immutable once it is created, so any number of threads can query
+/// it at the same time. To change the scene, create a new one from the same geometries and
+/// swap the pointer; queries in flight keep the old scene alive.
+class SceneQuery
+{
+public:
+    class Geometry;
+
+    /// Builds the hierarchy over the triangles of the mesh. Only positions are copied.
+    static std::shared_ptr<const Geometry> CreateTriangleGeometry(const MeshVertex* pVertices,
+                                                                  Uint32            NumVertices,
+                                                                  const Uint32*     pIndices,
+                                                                  Uint32            NumIndices);
+
+    /// Sphere in object space, see SphereIntersection.rint.
+    static std::shared_ptr<const Geometry> CreateSphereGeometry(const float3& Center, float Radius);
+
+    struct Instance
+    {
+        std::shared_ptr<const Geometry> pGeometry;
+        InstanceMatrix                  Transform;
+        Uint32                          InstanceIndex = 0; ///< Returned in hits, e.g. the index of the TLAS instance
+        Uint32                          CustomId      = 0;
+    };
+
+    struct Ray
+    {
+        float3 Origin;
+        float3 Direction; ///< Distances are measured in units of the direction length
+        float  TMin = 0;
+        float  TMax = FLT_MAX;
+    };
+
+    static constexpr Uint32 InvalidInstance = ~0u;
+
+    struct Hit
+    {
+        Uint32 InstanceIndex = InvalidInstance;
+        Uint32 CustomId      = 0;
+        float  Distance      = FLT_MAX;
+        float3 Normal; ///< World-space geometric normal, facing the ray origin
+
+        /// Triangle index and barycentrics of vertices 1 and 2, e.g. to interpolate vertex attributes.
+        Uint32 PrimitiveIndex = 0;
+        float2 Barycentrics;
+
+        bool IsHit() const { return InstanceIndex != InvalidInstance; }
+    };
+
+    explicit SceneQuery(std::vector<Instance> Instances);
+    ~SceneQuery();
+
+    /// Returns the closest hit along the ray.
+    Hit TraceClosest(const Ray& R) const;
+
+    /// Returns true if anything is hit along the ray. Stops at the first hit found.
+    bool TraceAny(const Ray& R) const;
+
+    /// Traces the rays on multiple threads.
+    void TraceClosest(const Ray* pRays, Hit* pHits, Uint32 NumRays) const;
+    void TraceAny(const Ray* pRays, bool* pHits, Uint32 NumRays) const;
+
+    Uint32 GetNumInstances() const;
+
+    /// Timing of batched queries, see RunBenchmark().
+    struct BenchmarkResult
+    {
+        Uint32 NumRays          = 0;
+        Uint32 NumClosestHits   = 0;
+        Uint32 NumAnyHits       = 0;
+        double ClosestRaysPerMs = 0;
+        double AnyRaysPerMs     = 0;
+    };
+
+    /// Traces NumRays random rays from the origin into the scene bounds as one closest-hit
+    /// batch and one any-hit batch and measures their throughput.
+    BenchmarkResult RunBenchmark(const float3& Origin, Uint32 NumRays, Uint32 Seed = 0) const;
+
+private:
+    struct BVH;
+    struct InstanceData;
+
+    template <bool AnyHit>
+    bool Trace(const Ray& R, Hit& H) const;
+
+    std::vector<InstanceData> m_Instances;
+    std::unique_ptr<BVH>      m_pInstanceBVH;
+};
+
+} // namespace Diligent
@@ -0,0 +1,265 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "ScratchArena.hpp"
+
+#include <algorithm>
+#include <random>
+
+#include "Align.hpp"
+#include "Errors.hpp"
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+ScratchArena::ScratchArena(Uint64 Alignment, Uint64 MinBlockSize) :
+    m_Alignment{std::max(Alignment, Uint64{1})},
+    m_MinBlockSize{AlignUp(std::max(MinBlockSize, Uint64{1}), m_Alignment)}
+{
+    VERIFY(IsPowerOfTwo(m_Alignment), "Scratch alignment must be a power of two");
+}
+
+Uint64 ScratchArena::AlignSize(Uint64 Size) const
+{
+    return AlignUp(Size, m_Alignment);
+}
+
+Uint64 ScratchArena::GetBatchSize(const Uint64* pSizes, Uint32 NumSizes) const
+{
+    Uint64 Total = 0;
+    for (Uint32 i = 0; i < NumSizes; ++i)
+        Total += AlignSize(pSizes[i]);
+    return Total;
+}
+
+ScratchArena::Allocation ScratchArena::Allocate(Uint64 Size)
+{
+    Allocation Alloc;
+    if (Size == 0)
+        return Alloc;
+
+    Uint64 AlignedOffset = AlignSize(m_Offset);
+    if (m_CurrBlock == InvalidBlock || AlignedOffset + Size > m_BlockSizes[m_CurrBlock])
+    {
+        // Move to the first following block that is large enough; skipped blocks stay unused.
+        Uint32 NextBlock = m_CurrBlock == InvalidBlock ? 0 : m_CurrBlock + 1;
+        while (NextBlock < m_BlockSizes.size() && m_BlockSizes[NextBlock] < Size)
+            ++NextBlock;
+
+        if (NextBlock == m_BlockSizes.size())
+        {
+            // Grow geometrically to keep the number of blocks in a spilling batch small.
+            const Uint64 LastSize = m_BlockSizes.empty() ? 0 : m_BlockSizes.back();
+            m_BlockSizes.push_back(std::max({AlignSize(Size), m_MinBlockSize, LastSize * 2}));
+            ++m_Stats.NumBlocksAdded;
+        }
+
+        if (m_CurrBlock != InvalidBlock)
+            m_UsedInPrevBlocks += m_BlockSizes[m_CurrBlock];
+
+        m_CurrBlock   = NextBlock;
+        m_Offset      = 0;
+        AlignedOffset = 0;
+    }
+
+    Alloc.Block  = m_CurrBlock;
+    Alloc.Offset = AlignedOffset;
+    Alloc.Size   = Size;
+
+    m_Offset = AlignedOffset + Size;
+
+    m_Stats.RequestedBytes += Size;
+    m_Stats.NumAllocations += 1;
+    UpdatePeaks();
+
+    return Alloc;
+}
+
+void ScratchArena::Reserve(Uint64 Size)
+{
+    if (Size == 0)
+        return;
+
+    if (m_CurrBlock != InvalidBlock && AlignSize(m_Offset) + Size <= m_BlockSizes[m_CurrBlock])
+        return;
+
+    const Uint64 BlockSize = std::max(AlignSize(Size), m_MinBlockSize);
+    if (IsBatchEmpty())
+    {
+        // Nothing references the existing blocks in this batch - replace them.
+        if (m_BlockSizes.size() == 1 && m_BlockSizes[0] >= Size)
+        {
+            m_CurrBlock = 0;
+            return;
+        }
+        m_BlockSizes = {BlockSize};
+        m_CurrBlock  = 0;
+    }
+    else
+    {
+        m_UsedInPrevBlocks += m_BlockSizes[m_CurrBlock];
+        m_BlockSizes.push_back(BlockSize);
+        m_CurrBlock = static_cast<Uint32>(m_BlockSizes.size() - 1);
+        m_Offset    = 0;
+    }
+    ++m_Stats.NumBlocksAdded;
+    UpdatePeaks();
+}
+
+void ScratchArena::Reset()
+{
+    UpdatePeaks();
+    if (m_Stats.NumAllocations > 0)
+        m_Stats.PeakWastedBytes = std::max(m_Stats.PeakWastedBytes, GetCapacity() - m_Stats.RequestedBytes);
+
+    // If the batch did not fit into a single block, replace all blocks with
+    // one block that is large enough to serve the same batch next time.
+    if (m_BlockSizes.size() > 1)
+    {
+        m_BlockSizes = {std::max(AlignSize(GetUsedBytes()), m_MinBlockSize)};
+        ++m_Stats.NumBlocksAdded;
+    }
+
+    m_CurrBlock        = InvalidBlock;
+    m_Offset           = 0;
+    m_UsedInPrevBlocks = 0;
+
+    m_Stats.RequestedBytes = 0;
+    m_Stats.NumAllocations = 0;
+    m_Stats.NumBatches += 1;
+}
+
+Uint64 ScratchArena::GetCapacity() const
+{
+    Uint64 Capacity = 0;
+    for (auto BlockSize : m_BlockSizes)
+        Capacity += BlockSize;
+    return Capacity;
+}
+
+void ScratchArena::UpdatePeaks()
+{
+    m_Stats.PeakUsedBytes = std::max(m_Stats.PeakUsedBytes, GetUsedBytes());
+}
+
+ScratchArena::Statistics ScratchArena::GetStatistics() const
+{
+    Statistics Stats = m_Stats;
+
+    Stats.CapacityBytes = GetCapacity();
+    Stats.UsedBytes   = GetUsedBytes();
+    Stats.WastedBytes = Stats.CapacityBytes - Stats.RequestedBytes;
+    Stats.NumBlocks   = static_cast<Uint32>(m_BlockSizes.size());
+
+    return Stats;
+}
+
+bool ScratchArena::RunSelfCheck()
+{
+    // Alignments of typical scratch buffers, and a block size that makes batches spill.
+    constexpr Uint64 Alignments[] = {1, 128, 256};
+    constexpr Uint64 MinBlockSize = 4096;
+    constexpr Uint32 NumBatches   = 8;
+
+    Uint32       NumErrors = 0;
+    std::mt19937 Rng{42};
+    for (const Uint64 Alignment : Alignments)
+    {
+        Uint32     Batch       = 0;
+        const auto ReportError = [&](const char* Message) {
+            if (NumErrors++ < 16)
+                LOG_ERROR_MESSAGE("Scratch arena check (alignment ", Alignment, "): ", Message, " in batch ", Batch);
+        };
+
+        ScratchArena Arena{Alignment, MinBlockSize};
+        if (Arena.Allocate(0))
+            ReportError("a zero-size request returns an allocation");
+
+        for (; Batch < NumBatches; ++Batch)
+        {
+            // Sizes up to twice the block size, so that single allocations do not fit into a block either.
+            std::vector<Uint64> Sizes(4 + Rng() % 28);
+            for (auto& Size : Sizes)
+                Size = 1 + Rng() % (MinBlockSize * 2);
+
+            // Every batch runs twice: the repeat must be served from the one block left by Reset().
+            std::vector<Allocation> Allocs(Sizes.size());
+            for (Uint32 Pass = 0; Pass < 2; ++Pass)
+            {
+                // In a single block, every allocation starts at the aligned end of the previous one.
+                const Uint32 NumBlocksAdded = Arena.GetStatistics().NumBlocksAdded;
+                Uint64       SingleBlockEnd = 0;
+                for (size_t i = 0; i < Sizes.size(); ++i)
+                {
+                    const auto Alloc = Arena.Allocate(Sizes[i]);
+                    if (!Alloc || Alloc.Block >= Arena.GetBlockSizes().size())
+                    {
+                        ReportError("allocation has no valid block");
+                        continue;
+                    }
+                    if (Alloc.Size != Sizes[i] || Alloc.Offset % Alignment != 0)
+                        ReportError("allocation is not aligned or has a wrong size");
+                    if (Alloc.Offset + Alloc.Size > Arena.GetBlockSizes()[Alloc.Block])
+                        ReportError("allocation does not fit into its block");
+                    if (i > 0 && Allocs[i - 1].Block == Alloc.Block && Allocs[i - 1].Offset + Allocs[i - 1].Size > Alloc.Offset)
+                        ReportError("allocation overlaps the previous one");
+                    if (i > 0 && Alloc.Block < Allocs[i - 1].Block)
+                        ReportError("allocation goes back to a previous block");
+                    if (Pass == 1 && (Alloc.Block != 0 || Alloc.Offset != Arena.AlignSize(SingleBlockEnd)))
+                        ReportError("repeated allocation is not at its offset in a single block");
+                    Allocs[i]      = Alloc;
+                    SingleBlockEnd = Arena.AlignSize(SingleBlockEnd) + Sizes[i];
+                }
+
+                const auto Stats = Arena.GetStatistics();
+                if (Stats.NumAllocations != Sizes.size() || Stats.UsedBytes > Stats.CapacityBytes || Stats.RequestedBytes > Stats.UsedBytes)
+                    ReportError("statistics do not match the batch");
+                if (Pass == 1 && (Stats.NumBlocks != 1 || Stats.NumBlocksAdded != NumBlocksAdded || Stats.UsedBytes != SingleBlockEnd))
+                    ReportError("repeated batch does not fit into one block without adding blocks");
+                Arena.Reset();
+            }
+        }
+
+        // Reserve() on an empty batch leaves a single block for the whole batch.
+        Arena.Reserve(MinBlockSize * 16);
+        const auto Alloc = Arena.Allocate(MinBlockSize * 16);
+        if (Arena.GetBlockSizes().size() != 1 || Alloc.Block != 0 || Alloc.Offset != 0)
+            ReportError("reserved batch is not served from a single block");
+        Arena.Reset();
+    }
+
+    if (NumErrors > 0)
+    {
+        LOG_ERROR_MESSAGE("Scratch arena check failed with ", NumErrors, " errors");
+        return false;
+    }
+    LOG_INFO_MESSAGE("Scratch arena check passed");
+    return true;
+}
+
+} // namespace Diligent
@@ -0,0 +1,139 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "BasicTypes.h"
+
+namespace Diligent
+{
+
+/// Linear arena that hands out aligned ranges from a list of memory blocks.
+
+/// The arena only does the offset arithmetic and does not own any memory, so the same
+/// logic drives GPU scratch buffers and can be exercised on the CPU. Allocations are
+/// grouped into batches: all allocations of a batch stay valid until Reset() is called.
+///
+/// When an allocation does not fit into the current block, a new block is appended.
+/// On Reset(), if the finished batch spilled into several blocks, they are replaced with
+/// a single block large enough for the whole batch, so that a repeated batch of the same
+/// size is served from one block. Use Reserve() to size the block for a batch up front.
+class ScratchArena
+{
+public:
+    static constexpr Uint32 InvalidBlock = ~0u;
+
+    struct Allocation
+    {
+        Uint32 Block  = InvalidBlock;
+        Uint64 Offset = 0;
+        Uint64 Size   = 0;
+
+        explicit operator bool() const { return Block != InvalidBlock; }
+    };
+
+    struct Statistics
+    {
+        /// Total size of all blocks.
+        Uint64 CapacityBytes = 0;
+
+        /// Bytes consumed by the current batch, including alignment padding
+        /// and unused tails of the blocks the batch has moved past.
+        Uint64 UsedBytes = 0;
+
+        /// Bytes actually requested by the allocations of the current batch.
+        Uint64 RequestedBytes = 0;
+
+        /// Capacity that does not hold requested data: CapacityBytes - RequestedBytes.
+        Uint64 WastedBytes = 0;
+
+        /// Maximum of UsedBytes over all batches.
+        Uint64 PeakUsedBytes = 0;
+
+        /// Maximum of WastedBytes measured at the end of each non-empty batch.
+        Uint64 PeakWastedBytes = 0;
+
+        Uint32 NumAllocations = 0; ///< Allocations in the current batch
+        Uint32 NumBlocks      = 0; ///< Current number of blocks
+        Uint32 NumBlocksAdded = 0; ///< Total number of blocks ever created
+        Uint32 NumBatches     = 0; ///< Number of completed batches
+    };
+
+    ScratchArena(Uint64 Alignment, Uint64 MinBlockSize);
+
+    /// Returns an aligned range of Size bytes. Appends a new block if the range
+    /// does not fit into the current one. Zero-size requests return an empty allocation.
+    Allocation Allocate(Uint64 Size);
+
+    /// Makes sure that Size bytes can be allocated from the current block.
+    /// If nothing has been allocated in the current batch, existing blocks are replaced
+    /// with a single block, otherwise a new block is appended.
+    void Reserve(Uint64 Size);
+
+    /// Finishes the current batch. All previous allocations become invalid.
+    void Reset();
+
+    /// Rounds Size up to the arena alignment.
+    Uint64 AlignSize(Uint64 Size) const;
+
+    /// Returns the number of bytes the given sizes occupy when allocated back to back
+    /// from a single block.
+    Uint64 GetBatchSize(const Uint64* pSizes, Uint32 NumSizes) const;
+
+    Uint64 GetAlignment() const { return m_Alignment; }
+
+    const std::vector<Uint64>& GetBlockSizes() const { return m_BlockSizes; }
+
+    Statistics GetStatistics() const;
+
+    /// Runs batches of random sizes with several alignments and checks that allocations are
+    /// aligned, do not overlap and stay within their blocks, and that a repeated batch is served
+    /// from the single block left by Reset() at the same offsets without adding blocks.
+    /// Logs the errors and returns false if a check fails.
+    static bool RunSelfCheck();
+
+private:
+    Uint64 GetUsedBytes() const { return m_UsedInPrevBlocks + m_Offset; }
+    bool   IsBatchEmpty() const { return GetUsedBytes() == 0; }
+    Uint64 GetCapacity() const;
+    void   UpdatePeaks();
+
+    const Uint64 m_Alignment;
+    const Uint64 m_MinBlockSize;
+
+    std::vector<Uint64> m_BlockSizes;
+
+    Uint32 m_CurrBlock        = InvalidBlock;
+    Uint64 m_Offset           = 0;
+    Uint64 m_UsedInPrevBlocks = 0;
+
+    Statistics m_Stats;
+};
+
+} // namespace Diligent
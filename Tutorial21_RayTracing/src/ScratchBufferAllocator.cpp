@@ -0,0 +1,101 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "ScratchBufferAllocator.hpp"
+
+#include <string>
+
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+ScratchBufferAllocator::ScratchBufferAllocator(IRenderDevice* pDevice,
+                                               Uint64         ImmediateContextMask,
+                                               Uint64         MinBlockSize) :
+    m_pDevice{pDevice},
+    m_ImmediateContextMask{ImmediateContextMask},
+    m_Arena{pDevice->GetAdapterInfo().RayTracing.ScratchBufferAlignment, MinBlockSize}
+{
+}
+
+ScratchBufferAllocator::Allocation ScratchBufferAllocator::Allocate(Uint64 Size)
+{
+    Allocation Alloc;
+
+    const auto ArenaAlloc = m_Arena.Allocate(Size);
+    if (!ArenaAlloc)
+        return Alloc;
+
+    SyncBuffers();
+
+    Alloc.pBuffer = m_Buffers[ArenaAlloc.Block];
+    Alloc.Offset  = ArenaAlloc.Offset;
+    Alloc.Size    = ArenaAlloc.Size;
+    return Alloc;
+}
+
+void ScratchBufferAllocator::Reserve(Uint64 Size)
+{
+    m_Arena.Reserve(Size);
+    SyncBuffers();
+}
+
+void ScratchBufferAllocator::Reset()
+{
+    m_Arena.Reset();
+    SyncBuffers();
+}
+
+void ScratchBufferAllocator::SyncBuffers()
+{
+    const auto& BlockSizes = m_Arena.GetBlockSizes();
+
+    // Buffers that are released here may still be used by the GPU;
+    // the engine keeps them alive until the commands that reference them complete.
+    m_Buffers.resize(BlockSizes.size());
+    for (size_t i = 0; i < BlockSizes.size(); ++i)
+    {
+        if (m_Buffers[i] && m_Buffers[i]->GetDesc().Size == BlockSizes[i])
+            continue;
+
+        const auto Name = "AS Scratch Buffer " + std::to_string(i);
+
+        BufferDesc BuffDesc;
+        BuffDesc.Name                 = Name.c_str();
+        BuffDesc.Usage                = USAGE_DEFAULT;
+        BuffDesc.BindFlags            = BIND_RAY_TRACING;
+        BuffDesc.Size                 = BlockSizes[i];
+        BuffDesc.ImmediateContextMask = m_ImmediateContextMask;
+
+        m_Buffers[i].Release();
+        m_pDevice->CreateBuffer(BuffDesc, nullptr, &m_Buffers[i]);
+        VERIFY_EXPR(m_Buffers[i] != nullptr);
+    }
+}
+
+} // namespace Diligent
@@ -0,0 +1,90 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "RenderDevice.h"
+#include "Buffer.h"
+#include "RefCntAutoPtr.hpp"
+#include "ScratchArena.hpp"
+
+namespace Diligent
+{
+
+/// Sub-allocates acceleration structure scratch memory from a few large buffers.
+
+/// Every BLAS and TLAS build gets a range of a shared scratch buffer instead of its own
+/// buffer. Ranges are aligned to RayTracingProperties::ScratchBufferAlignment. The memory
+/// layout is managed by ScratchArena; this class only keeps one GPU buffer per arena block.
+///
+/// Ranges of one batch never overlap, so builds of a batch may be recorded back to back.
+/// Reset() starts a new batch that reuses the same memory; builds of the new batch must be
+/// ordered after the previous ones on the GPU (e.g. recorded into the same context).
+class ScratchBufferAllocator
+{
+public:
+    struct Allocation
+    {
+        IBuffer* pBuffer = nullptr;
+        Uint64   Offset  = 0;
+        Uint64   Size    = 0;
+
+        explicit operator bool() const { return pBuffer != nullptr; }
+    };
+
+    ScratchBufferAllocator(IRenderDevice* pDevice,
+                           Uint64         ImmediateContextMask,
+                           Uint64         MinBlockSize = Uint64{1} << 20);
+
+    Allocation Allocate(Uint64 Size);
+
+    /// See ScratchArena::Reserve().
+    void Reserve(Uint64 Size);
+
+    /// See ScratchArena::Reset().
+    void Reset();
+
+    Uint64 GetBatchSize(const Uint64* pSizes, Uint32 NumSizes) const { return m_Arena.GetBatchSize(pSizes, NumSizes); }
+
+    ScratchArena::Statistics GetStatistics() const { return m_Arena.GetStatistics(); }
+
+    Uint32   GetNumBuffers() const { return static_cast<Uint32>(m_Buffers.size()); }
+    IBuffer* GetBuffer(Uint32 Index) const { return m_Buffers[Index]; }
+
+private:
+    // Creates or releases GPU buffers to match the arena blocks.
+    void SyncBuffers();
+
+    RefCntAutoPtr<IRenderDevice>        m_pDevice;
+    const Uint64                        m_ImmediateContextMask;
+    ScratchArena                        m_Arena;
+    std::vector<RefCntAutoPtr<IBuffer>> m_Buffers;
+};
+
+} // namespace Diligent
@@ -0,0 +1,60 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+#include "BasicMath.hpp"
+
+namespace Diligent
+{
+
+// Structures shared with the shaders. CPU code that mirrors the shaders includes them from here.
+namespace HLSL
+{
+#include "../assets/structures.fxh"
+}
+
+// Layouts shared with the shaders. Payload sizes determine the ray stack size, and constant
+// buffer members must not straddle 16-byte boundaries in HLSL packing rules.
+static_assert(sizeof(HLSL::PrimaryRayPayload) == 12, "Primary ray payload must stay packed");
+static_assert(sizeof(HLSL::ShadowRayPayload) == 8, "Unexpected shadow ray payload size");
+static_assert(sizeof(HLSL::FrameConstants) == 96, "Unexpected per-frame constants size");
+static_assert(MAX_DISPERS_SAMPLES <= PAYLOAD_WAVELENGTH_MASK + 1, "Wavelength index does not fit into the payload flags");
+static_assert(sizeof(HLSL::Constants) % 16 == 0, "Constants must be aligned by 16 bytes");
+static_assert(offsetof(HLSL::Constants, SphereReflectionColorMask) % 16 == 0, "float3 must start a 16-byte row");
+static_assert(offsetof(HLSL::Constants, GlassReflectionColorMask) % 16 == 0, "float3 must start a 16-byte row");
+static_assert(offsetof(HLSL::Constants, DispersionSamples) % 16 == 0, "Arrays must be aligned by 16 bytes");
+static_assert(offsetof(HLSL::Constants, DiscPoints) % 16 == 0, "Arrays must be aligned by 16 bytes");
+static_assert(offsetof(HLSL::Constants, LightPos) % 16 == 0, "Arrays must be aligned by 16 bytes");
+static_assert(offsetof(HLSL::Constants, LightColor) % 16 == 0, "Arrays must be aligned by 16 bytes");
+static_assert(sizeof(HLSL::DenoiseConstants) == 16, "Unexpected denoiser constants size");
+static_assert(sizeof(HLSL::ReadbackPackConstants) == 32, "Unexpected readback packing constants size");
+static_assert(sizeof(HLSL::VariableRateConstants) == 16, "Unexpected variable-rate constants size");
+
+} // namespace Diligent
@@ -0,0 +1,480 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "SoftwareTracer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "MaterialKernels.hpp"
+#include "DebugUtilities.hpp"
+#include "ParallelFor.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+constexpr float SmallOffset = MaterialConstants::SmallOffset;
+
+// Tiles rendered by one task of Render().
+constexpr Uint32 RenderTileSize = 32;
+
+float3 TransformDirection(const InstanceMatrix& M, const float3& D)
+{
+    return float3{
+        M.data[0][0] * D.x + M.data[0][1] * D.y + M.data[0][2] * D.z,
+        M.data[1][0] * D.x + M.data[1][1] * D.y + M.data[1][2] * D.z,
+        M.data[2][0] * D.x + M.data[2][1] * D.y + M.data[2][2] * D.z,
+    };
+}
+
+// See HashPCG() in RayUtils.fxh.
+Uint32 HashPCG(Uint32 v)
+{
+    const Uint32 State = v * 747796405u + 2891336453u;
+    const Uint32 Word  = ((State >> ((State >> 28u) + 4u)) ^ State) * 277803737u;
+    return (Word >> 22u) ^ Word;
+}
+
+// See DirectionWithinCone() in RayUtils.fxh.
+float3 DirectionWithinCone(const float3& Dir, const float2& Offset)
+{
+    const float3 a    = float3{std::abs(Dir.x), std::abs(Dir.y), std::abs(Dir.z)};
+    const float3 Axis = a.x < a.y ? (a.x < a.z ? float3{1, 0, 0} : float3{0, 0, 1}) :
+                                    (a.y < a.z ? float3{0, 1, 0} : float3{0, 0, 1});
+    const float3 Left = normalize(cross(Dir, Axis));
+    const float3 Up   = normalize(cross(Dir, Left));
+    return normalize(Dir + Left * Offset.x + Up * Offset.y);
+}
+
+// See PrimaryMiss.rmiss.
+float3 GetSkyColor(const float3& Dir)
+{
+    static const float Palette[] = {0.25f, 0.35f, 0.45f, 0.55f, 0.65f, 0.75f};
+
+    float     Factor = std::min(std::max((Dir.y + 0.5f) / 1.5f * 4.f, 0.f), 4.f);
+    const int Idx    = static_cast<int>(std::floor(Factor));
+    Factor -= static_cast<float>(Idx);
+    const float Grey = Palette[Idx] + (Palette[Idx + 1] - Palette[Idx]) * Factor;
+    return float3{Grey, Grey, Grey};
+}
+
+} // namespace
+
+// Per-pixel state of the shaders: DispatchRaysIndex() and the hash of GetShadingRandom().
+struct SoftwareTracer::PixelContext
+{
+    Uint32 PixelHash = 0;
+
+    PixelContext(Uint32 x, Uint32 y, Uint32 FrameIndex) :
+        PixelHash{HashPCG(HashPCG(x + HashPCG(y)) ^ FrameIndex)}
+    {}
+
+    float GetShadingRandom(Uint32 Seed) const
+    {
+        return static_cast<float>(HashPCG(PixelHash + Seed) >> 8) * (1.f / 16777216.f);
+    }
+};
+
+SoftwareTracer::SoftwareTracer(Scene SceneData) :
+    m_Scene{std::move(SceneData)}
+{
+    std::vector<std::shared_ptr<const SceneQuery::Geometry>> Geometries;
+    Geometries.reserve(m_Scene.Meshes.size());
+    for (const auto& Mesh : m_Scene.Meshes)
+    {
+        Geometries.push_back(SceneQuery::CreateTriangleGeometry(Mesh.Vertices.data(), static_cast<Uint32>(Mesh.Vertices.size()),
+                                                                Mesh.Indices.data(), static_cast<Uint32>(Mesh.Indices.size())));
+    }
+    const auto pSphere = SceneQuery::CreateSphereGeometry(float3{0, 0, 0}, 0.5f);
+
+    std::vector<SceneQuery::Instance> Instances;
+    Instances.reserve(m_Scene.Instances.size());
+    for (Uint32 i = 0; i < m_Scene.Instances.size(); ++i)
+    {
+        const auto& Src = m_Scene.Instances[i];
+        VERIFY_EXPR(Src.Geometry == SphereGeometry || Src.Geometry < Geometries.size());
+        VERIFY_EXPR(Src.Material < m_Scene.Materials.size());
+
+        SceneQuery::Instance Inst;
+        Inst.pGeometry     = Src.Geometry == SphereGeometry ? pSphere : Geometries[Src.Geometry];
+        Inst.Transform     = Src.Transform;
+        Inst.InstanceIndex = i;
+        Instances.push_back(Inst);
+    }
+    m_pQuery = std::make_unique<SceneQuery>(std::move(Instances));
+
+    m_LightBVH.Build(m_Scene.Lights.data(), static_cast<Uint32>(m_Scene.Lights.size()));
+    m_pMaterialConstants = std::make_unique<const MaterialConstants>(m_Scene.Constants);
+}
+
+SoftwareTracer::~SoftwareTracer()
+{
+}
+
+float2 SoftwareTracer::GetDiscSample(const PixelContext& Ctx, Uint32 j, Uint32 Seed) const
+{
+    const auto& Points = m_Scene.Constants.DiscPoints[j / 2];
+
+    float2 Offset{Points[(j % 2) * 2], Points[(j % 2) * 2 + 1]};
+    if (m_Scene.Constants.JitterSamplePatterns != 0)
+    {
+        const float Angle  = Ctx.GetShadingRandom(Seed) * 6.2831853f;
+        const float Radius = std::sqrt(Ctx.GetShadingRandom(Seed + 1)) * 2.f;
+        const float C      = std::cos(Angle);
+        const float S      = std::sin(Angle);
+        Offset             = float2{Offset.x * C - Offset.y * S + S * Radius, Offset.x * S + Offset.y * C + C * Radius};
+    }
+    return Offset;
+}
+
+float SoftwareTracer::CastShadow(const SceneQuery::Ray& R, Uint32 Recursion) const
+{
+    if (static_cast<int>(Recursion) >= m_Scene.Constants.MaxRecursion)
+        return 1.f;
+    return m_pQuery->TraceAny(R) ? 0.f : 1.f;
+}
+
+float3 SoftwareTracer::CastPrimaryRay(const PixelContext& Ctx, const SceneQuery::Ray& R, Uint32 Recursion, float* pDepth) const
+{
+    if (static_cast<int>(Recursion) >= m_Scene.Constants.MaxRecursion)
+    {
+        // Pink color for debugging, like the shaders.
+        if (pDepth != nullptr)
+            *pDepth = 0;
+        return float3{0.95f, 0.18f, 0.95f};
+    }
+
+    const auto H = m_pQuery->TraceClosest(R);
+    if (!H.IsHit())
+    {
+        if (pDepth != nullptr)
+            *pDepth = m_Scene.Constants.ClipPlanes.y;
+        return GetSkyColor(R.Direction);
+    }
+
+    if (pDepth != nullptr)
+        *pDepth = H.Distance;
+    return ShadeHit(Ctx, R, H, Recursion);
+}
+
+float3 SoftwareTracer::ShadeLight(const PixelContext&    Ctx,
+                                  const float3&          Color,
+                                  const float3&          Pos,
+                                  const float3&          Norm,
+                                  const LightBVH::Light& Light,
+                                  Uint32                 Recursion) const
+{
+    const float3 ToLight = Light.Pos - Pos;
+    const float  Dist    = length(ToLight);
+    const float3 RayDir  = ToLight / std::max(Dist, 1e-6f);
+    const float  NdotL   = std::max(0.f, dot(Norm, RayDir));
+    const float  Falloff = LightBVH::GetFalloff(Dist, Light.Range);
+    if (NdotL <= 0.f || Falloff <= 0.f)
+        return float3{0, 0, 0};
+
+    SceneQuery::Ray Shadow;
+    Shadow.Origin = Pos + Norm * SmallOffset;
+    Shadow.TMin   = 0;
+    Shadow.TMax   = Dist * 1.01f;
+
+    const float ConeSize   = std::max(0.005f, Light.Radius / std::max(Dist, 1e-6f));
+    const int   PCFSamples = Recursion > 1 ? std::min(1, m_Scene.Constants.ShadowPCF) : m_Scene.Constants.ShadowPCF;
+    float       Shading    = 0;
+    for (int j = 0; j < PCFSamples; ++j)
+    {
+        const auto Offset = GetDiscSample(Ctx, j, 0x1000 + Recursion * 2);
+        Shadow.Direction  = DirectionWithinCone(RayDir, Offset * ConeSize);
+        Shading += CastShadow(Shadow, Recursion);
+    }
+    Shading = PCFSamples > 0 ? Shading / static_cast<float>(PCFSamples) : 1.f;
+
+    return Color * Light.Color * (NdotL * Falloff * Shading);
+}
+
+float3 SoftwareTracer::LightingPass(const PixelContext& Ctx, const float3& Color, const float3& Pos, const float3& Norm, Uint32 Recursion) const
+{
+    const auto& Constants = m_Scene.Constants;
+
+    float3       Col{0, 0, 0};
+    const Uint32 NumLights  = static_cast<Uint32>(m_Scene.Lights.size());
+    const Uint32 NumSamples = static_cast<Uint32>(std::max(Constants.LightSamples, 0));
+    if (NumLights <= NumSamples)
+    {
+        for (const auto& Light : m_Scene.Lights)
+            Col += ShadeLight(Ctx, Color, Pos, Norm, Light, Recursion);
+    }
+    else if (NumSamples > 0)
+    {
+        for (Uint32 s = 0; s < NumSamples; ++s)
+        {
+            float        Pdf      = 0;
+            const Uint32 LightIdx = m_LightBVH.SampleLight(Pos, Norm, Ctx.GetShadingRandom(Recursion * 16 + s), Pdf);
+            if (LightIdx != LightBVH::InvalidLight)
+                Col += ShadeLight(Ctx, Color, Pos, Norm, m_Scene.Lights[LightIdx], Recursion) / Pdf;
+        }
+        Col = Col / static_cast<float>(NumSamples);
+    }
+
+    const float3 Ambient{Constants.AmbientColor.x, Constants.AmbientColor.y, Constants.AmbientColor.z};
+    return Col * (1.f / NUM_LIGHTS) + Color * 0.125f + Ambient;
+}
+
+SceneQuery::Ray SoftwareTracer::GetPrimaryRay(Uint32 Width, Uint32 Height, Uint32 x, Uint32 y) const
+{
+    // See RayTrace.rgen.
+    const auto&  Frame = m_Scene.Frame;
+    const float3 CameraPos{Frame.CameraPos.x, Frame.CameraPos.y, Frame.CameraPos.z};
+    const float  u        = (static_cast<float>(x) + 0.5f) / static_cast<float>(Width);
+    const float  v        = (static_cast<float>(y) + 0.5f) / static_cast<float>(Height);
+    const float4 WorldPos = float4{u * 2.f - 1.f, v * 2.f - 1.f, 1.f, 1.f} * Frame.InvViewProj;
+
+    SceneQuery::Ray R;
+    R.Origin    = CameraPos;
+    R.Direction = normalize(float3{WorldPos.x, WorldPos.y, WorldPos.z} / WorldPos.w - CameraPos);
+    R.TMin      = m_Scene.Constants.ClipPlanes.x;
+    R.TMax      = m_Scene.Constants.ClipPlanes.y;
+    return R;
+}
+
+SurfaceHit SoftwareTracer::GetSurfaceHit(const SceneQuery::Ray& R, const SceneQuery::Hit& H) const
+{
+    const auto& Inst = m_Scene.Instances[H.InstanceIndex];
+
+    SurfaceHit Hit;
+    Hit.Origin    = R.Origin;
+    Hit.Direction = normalize(R.Direction);
+    Hit.Pos       = R.Origin + R.Direction * H.Distance;
+    Hit.BaseColor = m_Scene.Materials[Inst.Material].BaseColor;
+    Hit.ObjectId  = Inst.ObjectId;
+
+    // Interpolated vertex normal in world space, or the outward sphere normal.
+    if (Inst.Geometry == SphereGeometry)
+    {
+        const float3 Center{Inst.Transform.data[0][3], Inst.Transform.data[1][3], Inst.Transform.data[2][3]};
+        Hit.Normal = normalize(Hit.Pos - Center);
+    }
+    else
+    {
+        const auto&  Mesh = m_Scene.Meshes[Inst.Geometry];
+        const auto&  v0   = Mesh.Vertices[Mesh.Indices[H.PrimitiveIndex * 3 + 0]];
+        const auto&  v1   = Mesh.Vertices[Mesh.Indices[H.PrimitiveIndex * 3 + 1]];
+        const auto&  v2   = Mesh.Vertices[Mesh.Indices[H.PrimitiveIndex * 3 + 2]];
+        const float2 b    = H.Barycentrics;
+        Hit.Normal        = normalize(TransformDirection(Inst.Transform, v0.Normal * (1.f - b.x - b.y) + v1.Normal * b.x + v2.Normal * b.y));
+    }
+    return Hit;
+}
+
+float3 SoftwareTracer::ShadeHit(const PixelContext& Ctx, const SceneQuery::Ray& R, const SceneQuery::Hit& H, Uint32 Recursion) const
+{
+    const auto&      Inst = m_Scene.Instances[H.InstanceIndex];
+    const SurfaceHit Hit  = GetSurfaceHit(R, H);
+
+    SurfaceShading Shading;
+    MaterialBatchShader::ShadeHit(*m_pMaterialConstants, Hit, m_Scene.Materials[Inst.Material].Type, Recursion, Shading);
+    return ResolveShading(Ctx, Hit, Shading, Recursion);
+}
+
+float3 SoftwareTracer::ResolveShading(const PixelContext& Ctx, const SurfaceHit& Hit, const SurfaceShading& Shading, Uint32 Recursion) const
+{
+    float3 Color = Shading.Color;
+    if (Shading.Lighting)
+        Color += LightingPass(Ctx, Shading.LightingAlbedo, Hit.Pos, Shading.LightingNormal, Recursion + 1);
+
+    // One shadow ray per key light, see SphereDiffuseHit.rchit.
+    for (Uint32 i = 0; i < NUM_LIGHTS; ++i)
+    {
+        if (Shading.KeyLightColor[i] == float3{0, 0, 0})
+            continue;
+
+        const float3 L = normalize(m_pMaterialConstants->LightPos[i] - Hit.Pos);
+
+        SceneQuery::Ray Shadow;
+        Shadow.Origin    = Hit.Pos + L * SmallOffset;
+        Shadow.Direction = L;
+        Shadow.TMin      = 0;
+        Shadow.TMax      = 1e38f;
+        if (CastShadow(Shadow, 0) > 0)
+            Color += Shading.KeyLightColor[i];
+    }
+
+    for (const auto& Ray : Shading.Rays)
+    {
+        if (Ray.Weight == float3{0, 0, 0})
+            continue;
+
+        SceneQuery::Ray R;
+        R.Origin = Ray.Origin;
+        R.TMin   = Ray.TMin;
+        R.TMax   = Ray.TMax;
+
+        float3 Sum{0, 0, 0};
+        for (Uint32 j = 0; j < Ray.NumSamples; ++j)
+        {
+            R.Direction = Ray.ConeSize > 0 ?
+                DirectionWithinCone(Ray.Direction, GetDiscSample(Ctx, j, Ray.SampleSeed) * Ray.ConeSize) :
+                Ray.Direction;
+            Sum += CastPrimaryRay(Ctx, R, Recursion + 1);
+        }
+        Color += Sum * Ray.Weight;
+    }
+    return Color;
+}
+
+void SoftwareTracer::RenderTile(Uint32 Width, Uint32 Height, const Tile& T, float4* pPixels) const
+{
+    VERIFY_EXPR(T.X + T.Width <= Width && T.Y + T.Height <= Height);
+
+    // Primary hits are collected first and shaded in one batch.
+    std::vector<SurfaceHit>    Hits;
+    std::vector<MATERIAL_TYPE> Types;
+    std::vector<Uint32>        HitPixels; // Index of the pixel in the tile
+    Hits.reserve(size_t{T.Width} * T.Height);
+    Types.reserve(size_t{T.Width} * T.Height);
+    HitPixels.reserve(size_t{T.Width} * T.Height);
+
+    for (Uint32 y = T.Y; y < T.Y + T.Height; ++y)
+    {
+        for (Uint32 x = T.X; x < T.X + T.Width; ++x)
+        {
+            const Uint32          PixelIdx = (y - T.Y) * T.Width + (x - T.X);
+            const SceneQuery::Ray R        = GetPrimaryRay(Width, Height, x, y);
+            if (m_Scene.Constants.MaxRecursion <= 0)
+            {
+                // Debug color, no rays are traced.
+                float        Depth = 0;
+                const float3 Color = CastPrimaryRay(PixelContext{x, y, m_Scene.Frame.FrameIndex}, R, 0, &Depth);
+                pPixels[PixelIdx]  = float4{Color.x, Color.y, Color.z, Depth};
+                continue;
+            }
+
+            const auto H = m_pQuery->TraceClosest(R);
+            if (!H.IsHit())
+            {
+                const float3 Sky  = GetSkyColor(R.Direction);
+                pPixels[PixelIdx] = float4{Sky.x, Sky.y, Sky.z, m_Scene.Constants.ClipPlanes.y};
+                continue;
+            }
+
+            Hits.push_back(GetSurfaceHit(R, H));
+            Types.push_back(m_Scene.Materials[m_Scene.Instances[H.InstanceIndex].Material].Type);
+            HitPixels.push_back(PixelIdx);
+            pPixels[PixelIdx].w = H.Distance;
+        }
+    }
+
+    MaterialBatchShader BatchShader;
+    BatchShader.Shade(*m_pMaterialConstants, Hits.data(), Types.data(), static_cast<Uint32>(Hits.size()), 0);
+
+    for (Uint32 i = 0; i < Hits.size(); ++i)
+    {
+        SurfaceShading Shading;
+        BatchShader.GetShading(i, Shading);
+
+        const Uint32 x     = T.X + HitPixels[i] % T.Width;
+        const Uint32 y     = T.Y + HitPixels[i] / T.Width;
+        const float3 Color = ResolveShading(PixelContext{x, y, m_Scene.Frame.FrameIndex}, Hits[i], Shading, 0);
+
+        float4& Pixel = pPixels[HitPixels[i]];
+        Pixel.x       = Color.x;
+        Pixel.y       = Color.y;
+        Pixel.z       = Color.z;
+    }
+}
+
+void SoftwareTracer::CollectPrimaryHits(Uint32 Width, Uint32 Height, std::vector<SurfaceHit>& Hits, std::vector<MATERIAL_TYPE>& Types) const
+{
+    Hits.clear();
+    Types.clear();
+    for (Uint32 y = 0; y < Height; ++y)
+    {
+        for (Uint32 x = 0; x < Width; ++x)
+        {
+            const SceneQuery::Ray R = GetPrimaryRay(Width, Height, x, y);
+            const auto            H = m_pQuery->TraceClosest(R);
+            if (H.IsHit())
+            {
+                Hits.push_back(GetSurfaceHit(R, H));
+                Types.push_back(m_Scene.Materials[m_Scene.Instances[H.InstanceIndex].Material].Type);
+            }
+        }
+    }
+}
+
+void SoftwareTracer::RenderGBuffer(Uint32 Width, Uint32 Height, float* pDepth, float4* pNormals, Uint32* pObjectIds) const
+{
+    ParallelFor(Height, [&](Uint32 y) {
+        for (Uint32 x = 0; x < Width; ++x)
+        {
+            const size_t          i = size_t{y} * Width + x;
+            const SceneQuery::Ray R = GetPrimaryRay(Width, Height, x, y);
+            const auto            H = m_pQuery->TraceClosest(R);
+            if (!H.IsHit())
+            {
+                // See PrimaryMiss.rmiss.
+                pDepth[i]     = m_Scene.Constants.ClipPlanes.y;
+                pNormals[i]   = float4{-R.Direction, static_cast<float>(GBUFFER_SHADING_SKY)};
+                pObjectIds[i] = GBUFFER_MISS_OBJECT_ID;
+                continue;
+            }
+
+            // Mirrors, metals and glass cast secondary primary rays, like in the hit shaders.
+            const auto&      Inst     = m_Scene.Instances[H.InstanceIndex];
+            const auto       Type     = m_Scene.Materials[Inst.Material].Type;
+            const bool       Specular = Type == MATERIAL_TYPE_GLASS || Type == MATERIAL_TYPE_METAL || Type == MATERIAL_TYPE_MIRROR_SPHERE || Type == MATERIAL_TYPE_GLASS_SPHERE;
+            const SurfaceHit Hit      = GetSurfaceHit(R, H);
+
+            // See GetTriangleObjectId() and GetSphereObjectId() in GBuffer.fxh.
+            pDepth[i]     = H.Distance;
+            pNormals[i]   = float4{Hit.Normal, static_cast<float>(Specular ? GBUFFER_SHADING_SPECULAR : GBUFFER_SHADING_DIFFUSE)};
+            pObjectIds[i] = Inst.Geometry == SphereGeometry ? (Inst.ObjectId | 0x80000000u) : H.InstanceIndex + 1;
+        }
+    });
+}
+
+void SoftwareTracer::Render(Uint32 Width, Uint32 Height, float4* pPixels) const
+{
+    const Uint32 TilesX = (Width + RenderTileSize - 1) / RenderTileSize;
+    const Uint32 TilesY = (Height + RenderTileSize - 1) / RenderTileSize;
+    ParallelFor(TilesX * TilesY, [&](Uint32 TileIdx) {
+        Tile T;
+        T.X      = (TileIdx % TilesX) * RenderTileSize;
+        T.Y      = (TileIdx / TilesX) * RenderTileSize;
+        T.Width  = std::min(RenderTileSize, Width - T.X);
+        T.Height = std::min(RenderTileSize, Height - T.Y);
+
+        float4 TilePixels[RenderTileSize * RenderTileSize];
+        RenderTile(Width, Height, T, TilePixels);
+        for (Uint32 y = 0; y < T.Height; ++y)
+            std::copy_n(TilePixels + y * T.Width, T.Width, pPixels + size_t{T.Y + y} * Width + T.X);
+    });
+}
+
+} // namespace Diligent
@@ -0,0 +1,164 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "BasicMath.hpp"
+#include "TopLevelAS.h"
+#include "MeshLoader.hpp"
+#include "LightBVH.hpp"
+#include "SceneQuery.hpp"
+#include "ShaderStructures.hpp"
+
+namespace Diligent
+{
+
+struct MaterialConstants;
+struct SurfaceHit;
+struct SurfaceShading;
+
+/// CPU renderer that mirrors the ray tracing shaders.
+
+/// Rays are traced with SceneQuery and shaded like the hit and miss shaders: the material of an
+/// instance selects the shading model of its hit group, lights are sampled from the light
+/// hierarchy as in LightingPass(), and sample patterns use the per-pixel random numbers of
+/// RayUtils.fxh. Textures are not available on the CPU, so textured materials use a constant
+/// base color, and the glass uses a fixed IOR without dispersion.
+///
+/// Materials are evaluated by the kernels of MaterialBatchShader: the primary hits of a tile
+/// are shaded as one batch sorted by material, hits of secondary rays one at a time.
+///
+/// The scene is plain data, so it can be sent to other processes that render tiles of the
+/// image without a GPU, see DistributedRenderer.
+class SoftwareTracer
+{
+public:
+    /// Shading models of the hit groups.
+    enum MATERIAL_TYPE : Uint32
+    {
+        MATERIAL_TYPE_TEXTURED = 0,   ///< CubePrimaryHit.rchit
+        MATERIAL_TYPE_GROUND,         ///< Ground.rchit
+        MATERIAL_TYPE_GLASS,          ///< GlassPrimaryHit.rchit, glass
+        MATERIAL_TYPE_DIFFUSE,        ///< GlassPrimaryHit.rchit, diffuse
+        MATERIAL_TYPE_METAL,          ///< GlassPrimaryHit.rchit, metal
+        MATERIAL_TYPE_MIRROR_SPHERE,  ///< SpherePrimaryHit.rchit
+        MATERIAL_TYPE_DIFFUSE_SPHERE, ///< SphereDiffuseHit.rchit
+        MATERIAL_TYPE_GLASS_SPHERE,   ///< SphereGlassHit.rchit
+        MATERIAL_TYPE_COUNT
+    };
+
+    struct Material
+    {
+        MATERIAL_TYPE Type = MATERIAL_TYPE_TEXTURED;
+        float3        BaseColor; ///< Replaces the texture of textured materials
+    };
+
+    struct Mesh
+    {
+        std::vector<MeshVertex> Vertices;
+        std::vector<Uint32>     Indices;
+    };
+
+    /// Geometry of instances that are the sphere of SphereIntersection.rint: radius 0.5 at the origin.
+    static constexpr Uint32 SphereGeometry = ~0u;
+
+    struct Instance
+    {
+        Uint32         Geometry = 0; ///< Index in Scene::Meshes or SphereGeometry
+        Uint32         Material = 0; ///< Index in Scene::Materials
+        Uint32         ObjectId = 0; ///< Selects random colors, like GetInstanceObjectId() or the sphere object id in the shaders
+        InstanceMatrix Transform;
+    };
+
+    struct Scene
+    {
+        std::vector<Mesh>            Meshes;
+        std::vector<Material>        Materials;
+        std::vector<Instance>        Instances;
+        std::vector<LightBVH::Light> Lights; ///< Key lights first, like g_Lights
+        HLSL::Constants              Constants = {};
+        HLSL::FrameConstants         Frame     = {};
+    };
+
+    /// Rectangle of the image in pixels.
+    struct Tile
+    {
+        Uint32 X      = 0;
+        Uint32 Y      = 0;
+        Uint32 Width  = 0;
+        Uint32 Height = 0;
+    };
+
+    explicit SoftwareTracer(Scene SceneData);
+    ~SoftwareTracer();
+
+    /// Renders a tile of a Width x Height image on the calling thread. pPixels receives the tile
+    /// row by row with the color in xyz and the primary hit distance in w, like the G-buffer depth.
+    void RenderTile(Uint32 Width, Uint32 Height, const Tile& T, float4* pPixels) const;
+
+    /// Renders the whole image in tiles on multiple threads.
+    void Render(Uint32 Width, Uint32 Height, float4* pPixels) const;
+
+    /// Replaces the camera, e.g. to render the frames of a sequence without rebuilding the scene.
+    void SetFrame(const HLSL::FrameConstants& Frame) { m_Scene.Frame = Frame; }
+
+    const Scene& GetScene() const { return m_Scene; }
+
+    /// Traces the primary rays of a Width x Height image and returns the hits with their
+    /// material types, e.g. to benchmark the material kernels.
+    void CollectPrimaryHits(Uint32 Width, Uint32 Height, std::vector<SurfaceHit>& Hits, std::vector<MATERIAL_TYPE>& Types) const;
+
+    /// Traces the primary rays of a Width x Height image and writes the G-buffer that the hit and
+    /// miss shaders write, see GBuffer.fxh: distances, normals with the shading cost in w, and object ids.
+    void RenderGBuffer(Uint32 Width, Uint32 Height, float* pDepth, float4* pNormals, Uint32* pObjectIds) const;
+
+    const MaterialConstants& GetMaterialConstants() const { return *m_pMaterialConstants; }
+
+private:
+    struct PixelContext;
+
+    float3 CastPrimaryRay(const PixelContext& Ctx, const SceneQuery::Ray& R, Uint32 Recursion, float* pDepth = nullptr) const;
+    float  CastShadow(const SceneQuery::Ray& R, Uint32 Recursion) const;
+    float3 ShadeHit(const PixelContext& Ctx, const SceneQuery::Ray& R, const SceneQuery::Hit& H, Uint32 Recursion) const;
+    float3 ResolveShading(const PixelContext& Ctx, const SurfaceHit& Hit, const SurfaceShading& Shading, Uint32 Recursion) const;
+    float3 ShadeLight(const PixelContext& Ctx, const float3& Color, const float3& Pos, const float3& Norm, const LightBVH::Light& Light, Uint32 Recursion) const;
+    float3 LightingPass(const PixelContext& Ctx, const float3& Color, const float3& Pos, const float3& Norm, Uint32 Recursion) const;
+    float2 GetDiscSample(const PixelContext& Ctx, Uint32 j, Uint32 Seed) const;
+
+    SceneQuery::Ray GetPrimaryRay(Uint32 Width, Uint32 Height, Uint32 x, Uint32 y) const;
+    SurfaceHit      GetSurfaceHit(const SceneQuery::Ray& R, const SceneQuery::Hit& H) const;
+
+    Scene                                    m_Scene;
+    std::unique_ptr<SceneQuery>              m_pQuery;
+    LightBVH                                 m_LightBVH;
+    std::unique_ptr<const MaterialConstants> m_pMaterialConstants;
+};
+
+} // namespace Diligent
@@ -0,0 +1,57 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "SpectralDispersion.hpp"
+
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+void ComputeDispersionDistribution(const float4* pSamples, Uint32 NumSamples, float* pCDF, float3& InvColorSum)
+{
+    VERIFY_EXPR(NumSamples > 0);
+
+    float3 ColorSum{0, 0, 0};
+    for (Uint32 i = 0; i < NumSamples; ++i)
+        ColorSum += float3{pSamples[i].x, pSamples[i].y, pSamples[i].z};
+    for (int c = 0; c < 3; ++c)
+        InvColorSum[c] = ColorSum[c] > 0 ? 1.f / ColorSum[c] : 0.f;
+
+    float Total = 0;
+    for (Uint32 i = 0; i < NumSamples; ++i)
+    {
+        Total += pSamples[i].x * InvColorSum.x + pSamples[i].y * InvColorSum.y + pSamples[i].z * InvColorSum.z;
+        pCDF[i] = Total;
+    }
+    for (Uint32 i = 0; i < NumSamples; ++i)
+        pCDF[i] = Total > 0 ? pCDF[i] / Total : static_cast<float>(i + 1) / static_cast<float>(NumSamples);
+    // Make sure that u < 1 always selects an entry.
+    pCDF[NumSamples - 1] = 1;
+}
+
+} // namespace Diligent
@@ -0,0 +1,55 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include "BasicMath.hpp"
+
+namespace Diligent
+{
+
+/// Spectral dispersion with one importance-sampled wavelength per path.
+
+/// The wavelength table stores the RGB response of every wavelength and the factor that
+/// interpolates the index of refraction between its minimum and maximum. Instead of tracing
+/// refracted rays for all wavelengths, every path picks one wavelength per frame and the
+/// result converges through frame accumulation. The refracted color is multiplied by the
+/// wavelength response divided by the sampling probability, so the expected value of every
+/// channel is the same as the average over the whole table.
+///
+/// The wavelength is selected and weighted by the shader code in RayUtils.fxh. The distribution
+/// computed by ComputeDispersionDistribution() is stored in the constant buffer.
+
+/// Computes the cumulative distribution over the table entries and the inverse of the
+/// per-channel sums of the table colors. An entry is selected with a probability that is
+/// proportional to the sum of its normalized channels.
+///   pSamples    - table entries, rgb is the color response and w is the IOR interpolation factor
+///   pCDF        - receives NumSamples values, the last one is 1
+///   InvColorSum - receives 1 / (sum of the table colors) per channel
+void ComputeDispersionDistribution(const float4* pSamples, Uint32 NumSamples, float* pCDF, float3& InvColorSum);
+
+} // namespace Diligent
@@ -0,0 +1,151 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "TextureBlob.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "Align.hpp"
+#include "GraphicsAccessories.hpp"
+#include "Errors.hpp"
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+constexpr Uint32 TextureBlobMagic     = 0x58455452; // 'RTEX'
+constexpr Uint32 TextureBlobAlignment = 16;
+
+struct TextureBlobHeader
+{
+    Uint32 Magic;
+    Uint32 Width;
+    Uint32 Height;
+    Uint32 Format;
+    Uint32 MipLevels;
+    Uint32 Reserved;
+};
+
+struct TextureBlobMip
+{
+    Uint64 Offset;
+    Uint64 Size;
+    Uint64 Stride;
+};
+
+} // namespace
+
+std::vector<Uint8> SerializeTexture(ITextureLoader* pLoader)
+{
+    const auto& Desc = pLoader->GetTextureDesc();
+    VERIFY(Desc.Type == RESOURCE_DIM_TEX_2D, "Only 2D textures are supported");
+
+    TextureBlobHeader Header{};
+    Header.Magic     = TextureBlobMagic;
+    Header.Width     = Desc.Width;
+    Header.Height    = Desc.Height;
+    Header.Format    = Desc.Format;
+    Header.MipLevels = Desc.MipLevels;
+
+    std::vector<TextureBlobMip> Mips(Desc.MipLevels);
+
+    Uint64 Offset = AlignUp(Uint64{sizeof(Header) + sizeof(TextureBlobMip) * Mips.size()}, Uint64{TextureBlobAlignment});
+    for (Uint32 m = 0; m < Desc.MipLevels; ++m)
+    {
+        const auto& SubRes = pLoader->GetSubresourceData(m);
+        const auto  Height = std::max(Desc.Height >> m, 1u);
+        // Compressed formats store rows of 4x4 blocks.
+        const auto NumRows = GetTextureFormatAttribs(Desc.Format).ComponentType == COMPONENT_TYPE_COMPRESSED ? (Height + 3) / 4 : Height;
+
+        Mips[m].Offset = Offset;
+        Mips[m].Size   = SubRes.Stride * NumRows;
+        Mips[m].Stride = SubRes.Stride;
+        Offset         = AlignUp(Offset + Mips[m].Size, Uint64{TextureBlobAlignment});
+    }
+
+    std::vector<Uint8> Data(static_cast<size_t>(Offset));
+    std::memcpy(Data.data(), &Header, sizeof(Header));
+    std::memcpy(&Data[sizeof(Header)], Mips.data(), sizeof(TextureBlobMip) * Mips.size());
+    for (Uint32 m = 0; m < Desc.MipLevels; ++m)
+        std::memcpy(&Data[static_cast<size_t>(Mips[m].Offset)], pLoader->GetSubresourceData(m).pData, static_cast<size_t>(Mips[m].Size));
+
+    return Data;
+}
+
+bool CreateTextureFromBlob(IRenderDevice* pDevice, const char* Name, const void* pData, size_t Size, ITexture** ppTexture)
+{
+    const auto* pBytes = static_cast<const Uint8*>(pData);
+
+    TextureBlobHeader Header;
+    if (Size < sizeof(Header))
+    {
+        LOG_ERROR_MESSAGE("Texture blob '", Name, "' is truncated");
+        return false;
+    }
+    std::memcpy(&Header, pBytes, sizeof(Header));
+    if (Header.Magic != TextureBlobMagic || Header.MipLevels == 0 ||
+        sizeof(Header) + sizeof(TextureBlobMip) * Header.MipLevels > Size)
+    {
+        LOG_ERROR_MESSAGE("Texture blob '", Name, "' is corrupted");
+        return false;
+    }
+
+    std::vector<TextureBlobMip> Mips(Header.MipLevels);
+    std::memcpy(Mips.data(), pBytes + sizeof(Header), sizeof(TextureBlobMip) * Mips.size());
+
+    std::vector<TextureSubResData> SubResources(Header.MipLevels);
+    for (Uint32 m = 0; m < Header.MipLevels; ++m)
+    {
+        if (Mips[m].Offset + Mips[m].Size > Size)
+        {
+            LOG_ERROR_MESSAGE("Texture blob '", Name, "' is corrupted");
+            return false;
+        }
+        SubResources[m].pData  = pBytes + Mips[m].Offset;
+        SubResources[m].Stride = Mips[m].Stride;
+    }
+
+    TextureDesc TexDesc;
+    TexDesc.Name      = Name;
+    TexDesc.Type      = RESOURCE_DIM_TEX_2D;
+    TexDesc.Width     = Header.Width;
+    TexDesc.Height    = Header.Height;
+    TexDesc.Format    = static_cast<TEXTURE_FORMAT>(Header.Format);
+    TexDesc.MipLevels = Header.MipLevels;
+    TexDesc.Usage     = USAGE_IMMUTABLE;
+    TexDesc.BindFlags = BIND_SHADER_RESOURCE;
+
+    TextureData TexData{SubResources.data(), Header.MipLevels};
+    pDevice->CreateTexture(TexDesc, &TexData, ppTexture);
+    return *ppTexture != nullptr;
+}
+
+} // namespace Diligent
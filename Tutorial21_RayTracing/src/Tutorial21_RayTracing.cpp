@@ -1,1098 +1,3264 @@
-﻿/*
- *  Copyright 2019-2024 Diligent Graphics LLC
- *  Copyright 2015-2019 Egor Yusov
- *
- *  Licensed under the Apache License, Version 2.0 (the "License");
- *  you may not use this file except in compliance with the License.
- *  You may obtain a copy of the License at
- *
- *      http://www.apache.org/licenses/LICENSE-2.0
- *
- *  Unless required by applicable law or agreed to in writing, software
- *  distributed under the License is distributed on an "AS IS" BASIS,
- *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
- *  See the License for the specific language governing permissions and
- *  limitations under the License.
- *
- *  In no event and under no legal theory, whether in tort (including negligence),
- *  contract, or otherwise, unless required by applicable law (such as deliberate
- *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
- *  liable for any damages, including any direct, indirect, special, incidental,
- *  or consequential damages of any character arising as a result of this License or
- *  out of the use or inability to use the software (including but not limited to damages
- *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
- *  all other commercial damages or losses), even if such Contributor has been advised
- *  of the possibility of such damages.
- */
-
-#include "Tutorial21_RayTracing.hpp"
-#include "MapHelper.hpp"
-#include "GraphicsTypesX.hpp"
-#include "GraphicsUtilities.h"
-#include "TextureUtilities.h"
-#include "ShaderMacroHelper.hpp"
-#include "imgui.h"
-#include "ImGuiUtils.hpp"
-#include "AdvancedMath.hpp"
-#include "PlatformMisc.hpp"
-#include <random>
-#include <vector>
-
-namespace Diligent
-{
-
-
-        namespace
-    {
-    // Para referenciar con claridad los distintos hit‑groups
-    constexpr char HG_Cube[]           = "CubePrimaryHit";
-    constexpr char HG_Ground[]         = "GroundHit";
-    constexpr char HG_GlassCube[]      = "GlassPrimaryHit";
-    constexpr char HG_SphereMetallic[] = "SpherePrimaryHit";
-    constexpr char HG_SphereDiffuse[]  = "SpherePrimaryDiffuseHit";
-    constexpr char HG_SphereGlass[]    = "SphereGlassHit"; // si lo usas
-    constexpr char HG_SphereShadow[]   = "SphereShadowHit";
-    } // namespace
-
-SampleBase* CreateSample()
-{
-    return new Tutorial21_RayTracing();
-}
-
-void Tutorial21_RayTracing::Render()
-{
-    UpdateTLAS();
-
-    // Update constants
-    {
-        float3 CameraWorldPos = float3::MakeVector(m_Camera.GetWorldMatrix()[3]);
-        auto   CameraViewProj = m_Camera.GetViewMatrix() * m_Camera.GetProjMatrix();
-
-        m_Constants.CameraPos   = float4{CameraWorldPos, 1.0f};
-        m_Constants.InvViewProj = CameraViewProj.Inverse();
-
-        m_pImmediateContext->UpdateBuffer(m_ConstantsCB, 0, sizeof(m_Constants), &m_Constants, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
-    }
-
-    // Trace rays
-    {
-        m_pRayTracingSRB->GetVariableByName(SHADER_TYPE_RAY_GEN, "g_ColorBuffer")->Set(m_pColorRT->GetDefaultView(TEXTURE_VIEW_UNORDERED_ACCESS));
-
-        m_pImmediateContext->SetPipelineState(m_pRayTracingPSO);
-        m_pImmediateContext->CommitShaderResources(m_pRayTracingSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
-
-        TraceRaysAttribs Attribs;
-        Attribs.DimensionX = m_pColorRT->GetDesc().Width;
-        Attribs.DimensionY = m_pColorRT->GetDesc().Height;
-        Attribs.pSBT       = m_pSBT;
-
-        m_pImmediateContext->TraceRays(Attribs);
-    }
-
-    // Blit to swapchain image
-    {
-        m_pImageBlitSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_Texture")->Set(m_pColorRT->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
-
-        auto* pRTV = m_pSwapChain->GetCurrentBackBufferRTV();
-        m_pImmediateContext->SetRenderTargets(1, &pRTV, nullptr, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
-
-        m_pImmediateContext->SetPipelineState(m_pImageBlitPSO);
-        m_pImmediateContext->CommitShaderResources(m_pImageBlitSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
-
-        m_pImmediateContext->Draw(DrawAttribs{3, DRAW_FLAG_VERIFY_ALL});
-    }
-}
-
-void Tutorial21_RayTracing::CreateGraphicsPSO()
-{
-    // Create graphics pipeline to blit render target into swapchain image.
-
-    GraphicsPipelineStateCreateInfo PSOCreateInfo;
-
-    PSOCreateInfo.PSODesc.Name         = "Image blit PSO";
-    PSOCreateInfo.PSODesc.PipelineType = PIPELINE_TYPE_GRAPHICS;
-
-    PSOCreateInfo.GraphicsPipeline.NumRenderTargets             = 1;
-    PSOCreateInfo.GraphicsPipeline.RTVFormats[0]                = m_pSwapChain->GetDesc().ColorBufferFormat;
-    PSOCreateInfo.GraphicsPipeline.PrimitiveTopology            = PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
-    PSOCreateInfo.GraphicsPipeline.RasterizerDesc.CullMode      = CULL_MODE_NONE;
-    PSOCreateInfo.GraphicsPipeline.DepthStencilDesc.DepthEnable = False;
-
-    ShaderCreateInfo ShaderCI;
-    ShaderCI.SourceLanguage = SHADER_SOURCE_LANGUAGE_HLSL;
-    ShaderCI.ShaderCompiler = SHADER_COMPILER_DXC;
-    ShaderCI.CompileFlags   = SHADER_COMPILE_FLAG_PACK_MATRIX_ROW_MAJOR;
-
-    // Create a shader source stream factory to load shaders from files.
-    RefCntAutoPtr<IShaderSourceInputStreamFactory> pShaderSourceFactory;
-    m_pEngineFactory->CreateDefaultShaderSourceStreamFactory(nullptr, &pShaderSourceFactory);
-    ShaderCI.pShaderSourceStreamFactory = pShaderSourceFactory;
-
-    RefCntAutoPtr<IShader> pVS;
-    {
-        ShaderCI.Desc.ShaderType = SHADER_TYPE_VERTEX;
-        ShaderCI.EntryPoint      = "main";
-        ShaderCI.Desc.Name       = "Image blit VS";
-        ShaderCI.FilePath        = "ImageBlit.vsh";
-        m_pDevice->CreateShader(ShaderCI, &pVS);
-        VERIFY_EXPR(pVS != nullptr);
-    }
-
-    RefCntAutoPtr<IShader> pPS;
-    {
-        ShaderCI.Desc.ShaderType = SHADER_TYPE_PIXEL;
-        ShaderCI.EntryPoint      = "main";
-        ShaderCI.Desc.Name       = "Image blit PS";
-        ShaderCI.FilePath        = "ImageBlit.psh";
-        m_pDevice->CreateShader(ShaderCI, &pPS);
-        VERIFY_EXPR(pPS != nullptr);
-    }
-
-    PSOCreateInfo.pVS = pVS;
-    PSOCreateInfo.pPS = pPS;
-
-    PSOCreateInfo.PSODesc.ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC;
-
-    m_pDevice->CreateGraphicsPipelineState(PSOCreateInfo, &m_pImageBlitPSO);
-    VERIFY_EXPR(m_pImageBlitPSO != nullptr);
-
-    m_pImageBlitPSO->CreateShaderResourceBinding(&m_pImageBlitSRB, true);
-    VERIFY_EXPR(m_pImageBlitSRB != nullptr);
-}
-
-void Tutorial21_RayTracing::CreateRayTracingPSO()
-{
-    m_MaxRecursionDepth = std::min(m_MaxRecursionDepth, m_pDevice->GetAdapterInfo().RayTracing.MaxRecursionDepth);
-
-    // Prepare ray tracing pipeline description.
-    RayTracingPipelineStateCreateInfoX PSOCreateInfo;
-
-    PSOCreateInfo.PSODesc.Name         = "Ray tracing PSO";
-    PSOCreateInfo.PSODesc.PipelineType = PIPELINE_TYPE_RAY_TRACING;
-
-    // Define shader macros
-    ShaderMacroHelper Macros;
-    Macros.AddShaderMacro("NUM_TEXTURES", NumTextures);
-
-    ShaderCreateInfo ShaderCI;
-    // We will not be using combined texture samplers as they
-    // are only required for compatibility with OpenGL, and ray
-    // tracing is not supported in OpenGL backend.
-    ShaderCI.Desc.UseCombinedTextureSamplers = false;
-
-    ShaderCI.Macros = Macros;
-
-    // Only new DXC compiler can compile HLSL ray tracing shaders.
-    ShaderCI.ShaderCompiler = SHADER_COMPILER_DXC;
-
-    // Use row-major matrices.
-    ShaderCI.CompileFlags = SHADER_COMPILE_FLAG_PACK_MATRIX_ROW_MAJOR;
-
-    // Shader model 6.3 is required for DXR 1.0, shader model 6.5 is required for DXR 1.1 and enables additional features.
-    // Use 6.3 for compatibility with DXR 1.0 and VK_NV_ray_tracing.
-    ShaderCI.HLSLVersion    = {6, 3};
-    ShaderCI.SourceLanguage = SHADER_SOURCE_LANGUAGE_HLSL;
-
-    // Create a shader source stream factory to load shaders from files.
-    RefCntAutoPtr<IShaderSourceInputStreamFactory> pShaderSourceFactory;
-    m_pEngineFactory->CreateDefaultShaderSourceStreamFactory(nullptr, &pShaderSourceFactory);
-    ShaderCI.pShaderSourceStreamFactory = pShaderSourceFactory;
-
-    // Create ray generation shader.
-    RefCntAutoPtr<IShader> pRayGen;
-    {
-        ShaderCI.Desc.ShaderType = SHADER_TYPE_RAY_GEN;
-        ShaderCI.Desc.Name       = "Ray tracing RG";
-        ShaderCI.FilePath        = "RayTrace.rgen";
-        ShaderCI.EntryPoint      = "main";
-        m_pDevice->CreateShader(ShaderCI, &pRayGen);
-        VERIFY_EXPR(pRayGen != nullptr);
-    }
-
-    // Create miss shaders.
-    RefCntAutoPtr<IShader> pPrimaryMiss, pShadowMiss;
-    {
-        ShaderCI.Desc.ShaderType = SHADER_TYPE_RAY_MISS;
-        ShaderCI.Desc.Name       = "Primary ray miss shader";
-        ShaderCI.FilePath        = "PrimaryMiss.rmiss";
-        ShaderCI.EntryPoint      = "main";
-        m_pDevice->CreateShader(ShaderCI, &pPrimaryMiss);
-        VERIFY_EXPR(pPrimaryMiss != nullptr);
-
-        ShaderCI.Desc.Name  = "Shadow ray miss shader";
-        ShaderCI.FilePath   = "ShadowMiss.rmiss";
-        ShaderCI.EntryPoint = "main";
-        m_pDevice->CreateShader(ShaderCI, &pShadowMiss);
-        VERIFY_EXPR(pShadowMiss != nullptr);
-    }
-
-    // Create closest hit shaders.
-    RefCntAutoPtr<IShader> pCubePrimaryHit, pGroundHit, pGlassPrimaryHit, pSpherePrimaryHit, hitSphereDiffuse, hitSphereGlass;
-    ;
-    {
-        ShaderCI.Desc.ShaderType = SHADER_TYPE_RAY_CLOSEST_HIT;
-        ShaderCI.Desc.Name       = "Cube primary ray closest hit shader";
-        ShaderCI.FilePath        = "CubePrimaryHit.rchit";
-        ShaderCI.EntryPoint      = "main";
-        m_pDevice->CreateShader(ShaderCI, &pCubePrimaryHit);
-        VERIFY_EXPR(pCubePrimaryHit != nullptr);
-
-        ShaderCI.Desc.Name  = "Ground primary ray closest hit shader";
-        ShaderCI.FilePath   = "Ground.rchit";
-        ShaderCI.EntryPoint = "main";
-        m_pDevice->CreateShader(ShaderCI, &pGroundHit);
-        VERIFY_EXPR(pGroundHit != nullptr);
-
-        ShaderCI.Desc.Name  = "Glass primary ray closest hit shader";
-        ShaderCI.FilePath   = "GlassPrimaryHit.rchit";
-        ShaderCI.EntryPoint = "main";
-        m_pDevice->CreateShader(ShaderCI, &pGlassPrimaryHit);
-        VERIFY_EXPR(pGlassPrimaryHit != nullptr);
-
-        ShaderCI.Desc.Name  = "Sphere primary ray closest hit shader";
-        ShaderCI.FilePath   = "SpherePrimaryHit.rchit";
-        ShaderCI.EntryPoint = "main";
-        m_pDevice->CreateShader(ShaderCI, &pSpherePrimaryHit);
-        VERIFY_EXPR(pSpherePrimaryHit != nullptr);
-
-        
-        ShaderCI.Desc.Name  = "Sphere primary ray closest hit diffuse shader";
-        ShaderCI.FilePath   = "SphereDiffuseHit.rchit";
-        ShaderCI.EntryPoint = "main";
-        m_pDevice->CreateShader(ShaderCI, &hitSphereDiffuse);
-        VERIFY_EXPR(hitSphereDiffuse!= nullptr);
-
-        ShaderCI.Desc.Name  = "Sphere primary ray closest hit glass shader";
-        ShaderCI.FilePath   = "SphereGlassHit.rchit";
-        ShaderCI.EntryPoint = "main";
-        m_pDevice->CreateShader(ShaderCI, &hitSphereGlass);
-        VERIFY_EXPR(hitSphereGlass != nullptr);
-
-
-    }
-
-    // Create intersection shader for a procedural sphere.
-    RefCntAutoPtr<IShader> pSphereIntersection;
-    {
-        ShaderCI.Desc.ShaderType = SHADER_TYPE_RAY_INTERSECTION;
-        ShaderCI.Desc.Name       = "Sphere intersection shader";
-        ShaderCI.FilePath        = "SphereIntersection.rint";
-        ShaderCI.EntryPoint      = "main";
-        m_pDevice->CreateShader(ShaderCI, &pSphereIntersection);
-        VERIFY_EXPR(pSphereIntersection != nullptr);
-    }
-
-    // Setup shader groups
-
-    // Ray generation shader is an entry point for a ray tracing pipeline.
-    PSOCreateInfo.AddGeneralShader("Main", pRayGen);
-    // Primary ray miss shader.
-    PSOCreateInfo.AddGeneralShader("PrimaryMiss", pPrimaryMiss);
-    // Shadow ray miss shader.
-    PSOCreateInfo.AddGeneralShader("ShadowMiss", pShadowMiss);
-
-    // Primary ray hit group for the textured cube.
-    PSOCreateInfo.AddTriangleHitShader("CubePrimaryHit", pCubePrimaryHit);
-    // Primary ray hit group for the ground.
-    PSOCreateInfo.AddTriangleHitShader("GroundHit", pGroundHit);
-    // Primary ray hit group for the glass cube.
-    PSOCreateInfo.AddTriangleHitShader("GlassPrimaryHit", pGlassPrimaryHit);
-
-    // Intersection and closest hit shaders for the procedural sphere.
-    PSOCreateInfo.AddProceduralHitShader("SpherePrimaryHit", pSphereIntersection, pSpherePrimaryHit);
-
-    PSOCreateInfo.AddProceduralHitShader("SpherePrimaryDiffuseHit", pSphereIntersection, hitSphereDiffuse);
-    PSOCreateInfo.AddProceduralHitShader("SphereGlassHit", pSphereIntersection, hitSphereGlass);
-
-    // Only intersection shader is needed for shadows.
-    PSOCreateInfo.AddProceduralHitShader("SphereShadowHit", pSphereIntersection);
-
-    // Specify the maximum ray recursion depth.
-    // WARNING: the driver does not track the recursion depth and it is the
-    //          application's responsibility to not exceed the specified limit.
-    //          The value is used to reserve the necessary stack size and
-    //          exceeding it will likely result in driver crash.
-    PSOCreateInfo.RayTracingPipeline.MaxRecursionDepth = static_cast<Uint8>(m_MaxRecursionDepth);
-
-    // Per-shader data is not used.
-    PSOCreateInfo.RayTracingPipeline.ShaderRecordSize = 0;
-
-    // DirectX 12 only: set attribute and payload size. Values should be as small as possible to minimize the memory usage.
-    PSOCreateInfo.MaxAttributeSize = std::max<Uint32>(sizeof(/*BuiltInTriangleIntersectionAttributes*/ float2), sizeof(HLSL::ProceduralGeomIntersectionAttribs));
-    PSOCreateInfo.MaxPayloadSize   = std::max<Uint32>(sizeof(HLSL::PrimaryRayPayload), sizeof(HLSL::ShadowRayPayload));
-
-    // Define immutable sampler for g_Texture and g_GroundTexture. Immutable samplers should be used whenever possible
-    SamplerDesc SamLinearWrapDesc{
-        FILTER_TYPE_LINEAR, FILTER_TYPE_LINEAR, FILTER_TYPE_LINEAR,
-        TEXTURE_ADDRESS_WRAP, TEXTURE_ADDRESS_WRAP, TEXTURE_ADDRESS_WRAP //
-    };
-
-    PipelineResourceLayoutDescX ResourceLayout;
-    ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE;
-    ResourceLayout.AddImmutableSampler(SHADER_TYPE_RAY_CLOSEST_HIT, "g_SamLinearWrap", SamLinearWrapDesc);
-    ResourceLayout
-        .AddVariable(SHADER_TYPE_RAY_GEN | SHADER_TYPE_RAY_MISS | SHADER_TYPE_RAY_CLOSEST_HIT, "g_ConstantsCB", SHADER_RESOURCE_VARIABLE_TYPE_STATIC)
-        .AddVariable(SHADER_TYPE_RAY_GEN, "g_ColorBuffer", SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC);
-
-    PSOCreateInfo.PSODesc.ResourceLayout = ResourceLayout;
-
-    m_pDevice->CreateRayTracingPipelineState(PSOCreateInfo, &m_pRayTracingPSO);
-    VERIFY_EXPR(m_pRayTracingPSO != nullptr);
-
-    m_pRayTracingPSO->GetStaticVariableByName(SHADER_TYPE_RAY_GEN, "g_ConstantsCB")->Set(m_ConstantsCB);
-    m_pRayTracingPSO->GetStaticVariableByName(SHADER_TYPE_RAY_MISS, "g_ConstantsCB")->Set(m_ConstantsCB);
-    m_pRayTracingPSO->GetStaticVariableByName(SHADER_TYPE_RAY_CLOSEST_HIT, "g_ConstantsCB")->Set(m_ConstantsCB);
-
-    m_pRayTracingPSO->CreateShaderResourceBinding(&m_pRayTracingSRB, true);
-    VERIFY_EXPR(m_pRayTracingSRB != nullptr);
-}
-
-void Tutorial21_RayTracing::LoadTextures()
-{
-    // Load textures
-    IDeviceObject*          pTexSRVs[NumTextures] = {};
-    RefCntAutoPtr<ITexture> pTex[NumTextures];
-    StateTransitionDesc     Barriers[NumTextures];
-    for (int tex = 0; tex < NumTextures; ++tex)
-    {
-        // Load current texture
-        TextureLoadInfo loadInfo;
-        loadInfo.IsSRGB = true;
-
-        std::stringstream FileNameSS;
-        FileNameSS << "DGLogo" << tex << ".png";
-        auto FileName = FileNameSS.str();
-        CreateTextureFromFile(FileName.c_str(), loadInfo, m_pDevice, &pTex[tex]);
-
-        // Get shader resource view from the texture
-        auto* pTextureSRV = pTex[tex]->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
-        pTexSRVs[tex]     = pTextureSRV;
-        Barriers[tex]     = StateTransitionDesc{pTex[tex], RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, STATE_TRANSITION_FLAG_UPDATE_STATE};
-    }
-    m_pImmediateContext->TransitionResourceStates(_countof(Barriers), Barriers);
-
-
-    m_pRayTracingSRB->GetVariableByName(SHADER_TYPE_RAY_CLOSEST_HIT, "g_CubeTextures")->SetArray(pTexSRVs, 0, NumTextures);
-
-    // Load ground texture
-    RefCntAutoPtr<ITexture> pGroundTex;
-    CreateTextureFromFile("Ground.jpg", TextureLoadInfo{}, m_pDevice, &pGroundTex);
-
-    m_pRayTracingSRB->GetVariableByName(SHADER_TYPE_RAY_CLOSEST_HIT, "g_GroundTexture")->Set(pGroundTex->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
-}
-
-void Tutorial21_RayTracing::CreateCubeBLAS(float cubeSize, RefCntAutoPtr<IBottomLevelAS>& OutBLAS)
-{
-    RefCntAutoPtr<IDataBlob> pCubeVerts;
-    RefCntAutoPtr<IDataBlob> pCubeIndices;
-    GeometryPrimitiveInfo    CubeGeoInfo;
-    //constexpr float          CubeSize = 2.f;
-    CreateGeometryPrimitive(CubeGeometryPrimitiveAttributes{cubeSize, GEOMETRY_PRIMITIVE_VERTEX_FLAG_ALL}, &pCubeVerts, &pCubeIndices, &CubeGeoInfo);
-
-    struct CubeVertex
-    {
-        float3 Pos;
-        float3 Normal;
-        float2 UV;
-    };
-    VERIFY_EXPR(CubeGeoInfo.VertexSize == sizeof(CubeVertex));
-    const CubeVertex* pVerts   = pCubeVerts->GetConstDataPtr<CubeVertex>();
-    const Uint32*     pIndices = pCubeIndices->GetConstDataPtr<Uint32>();
-
-    // Create a buffer with cube attributes.
-    // These attributes will be used in the hit shader to calculate UVs and normal for intersection point.
-    {
-        HLSL::CubeAttribs Attribs;
-        for (Uint32 v = 0; v < CubeGeoInfo.NumVertices; ++v)
-        {
-            Attribs.UVs[v]     = {pVerts[v].UV, 0, 0};
-            Attribs.Normals[v] = pVerts[v].Normal;
-        }
-
-        for (Uint32 i = 0; i < CubeGeoInfo.NumIndices; i += 3)
-        {
-            const Uint32* TriIdx{&pIndices[i]};
-            Attribs.Primitives[i / 3] = uint4{TriIdx[0], TriIdx[1], TriIdx[2], 0};
-        }
-
-        BufferDesc BuffDesc;
-        BuffDesc.Name      = "Cube Attribs size";
-        BuffDesc.Usage     = USAGE_IMMUTABLE;
-        BuffDesc.BindFlags = BIND_UNIFORM_BUFFER;
-        BuffDesc.Size      = sizeof(Attribs);
-
-        BufferData BufData = {&Attribs, BuffDesc.Size};
-
-        if (!m_CubeAttribsCB) {
-        
-        m_pDevice->CreateBuffer(BuffDesc, &BufData, &m_CubeAttribsCB);
-            VERIFY_EXPR(m_CubeAttribsCB != nullptr);
-
-
-            m_pRayTracingSRB->GetVariableByName(SHADER_TYPE_RAY_CLOSEST_HIT, "g_CubeAttribsCB")->Set(m_CubeAttribsCB);  
-        
-        }
-        
-    }
-
-    // Create vertex and index buffers
-    RefCntAutoPtr<IBuffer>             pCubeVertexBuffer;
-    RefCntAutoPtr<IBuffer>             pCubeIndexBuffer;
-    GeometryPrimitiveBuffersCreateInfo CubeBuffersCI;
-    CubeBuffersCI.VertexBufferBindFlags = BIND_RAY_TRACING;
-    CubeBuffersCI.IndexBufferBindFlags  = BIND_RAY_TRACING;
-    CreateGeometryPrimitiveBuffers(m_pDevice, CubeGeometryPrimitiveAttributes{cubeSize, GEOMETRY_PRIMITIVE_VERTEX_FLAG_POSITION},
-                                   &CubeBuffersCI, &pCubeVertexBuffer, &pCubeIndexBuffer);
-
-      /* … generación de vértices/índices idéntica … */
-
-    // ------------------ CREAR el BLAS ------------------
-    BLASTriangleDesc Triangles;
-    Triangles.GeometryName         = "Cube";
-    Triangles.MaxVertexCount       = CubeGeoInfo.NumVertices;
-    Triangles.VertexValueType      = VT_FLOAT32;
-    Triangles.VertexComponentCount = 3;
-    Triangles.MaxPrimitiveCount    = CubeGeoInfo.NumIndices / 3;
-    Triangles.IndexType            = VT_UINT32;
-
-    BottomLevelASDesc ASDesc;
-    ASDesc.Name          = (cubeSize == 2.f ? "Cube BLAS" : "SmallCube BLAS");
-    ASDesc.Flags         = RAYTRACING_BUILD_AS_PREFER_FAST_TRACE;
-    ASDesc.pTriangles    = &Triangles;
-    ASDesc.TriangleCount = 1;
-
-    m_pDevice->CreateBLAS(ASDesc, &OutBLAS);
-    VERIFY_EXPR(OutBLAS != nullptr);
-
-    // ------------------ SCRATCH BUFFER -----------------
-    RefCntAutoPtr<IBuffer> pScratchBuffer;
-    {
-        BufferDesc BuffDesc;
-        BuffDesc.Name      = "BLAS Scratch Buffer";
-        BuffDesc.Usage     = USAGE_DEFAULT;
-        BuffDesc.BindFlags = BIND_RAY_TRACING;
-        BuffDesc.Size      = OutBLAS->GetScratchBufferSizes().Build; // ← ¡ya existe!
-
-        m_pDevice->CreateBuffer(BuffDesc, nullptr, &pScratchBuffer);
-    }
-
-    // ------------------ BUILD BLAS ---------------------
-    BLASBuildTriangleData TriData;
-    TriData.GeometryName         = Triangles.GeometryName;
-    TriData.pVertexBuffer        = pCubeVertexBuffer;
-    TriData.VertexStride         = sizeof(float3);
-    TriData.VertexCount          = Triangles.MaxVertexCount;
-    TriData.VertexValueType      = Triangles.VertexValueType;
-    TriData.VertexComponentCount = Triangles.VertexComponentCount;
-    TriData.pIndexBuffer         = pCubeIndexBuffer;
-    TriData.PrimitiveCount       = Triangles.MaxPrimitiveCount;
-    TriData.IndexType            = Triangles.IndexType;
-    TriData.Flags                = RAYTRACING_GEOMETRY_FLAG_OPAQUE;
-
-    BuildBLASAttribs BuildAttrs;
-    BuildAttrs.pBLAS                  = OutBLAS; // ← usar OutBLAS
-    BuildAttrs.pTriangleData          = &TriData;
-    BuildAttrs.TriangleDataCount      = 1;
-    BuildAttrs.pScratchBuffer         = pScratchBuffer;
-    BuildAttrs.BLASTransitionMode     = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
-    BuildAttrs.GeometryTransitionMode = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
-    BuildAttrs.ScratchBufferTransitionMode =
-        RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
-
-    m_pImmediateContext->BuildBLAS(BuildAttrs);
-    }
-
-
-void Tutorial21_RayTracing::CreateProceduralBLAS()
-{
-    static_assert(sizeof(HLSL::BoxAttribs) % 16 == 0, "BoxAttribs must be aligned by 16 bytes");
-
-    const HLSL::BoxAttribs Boxes[] = {HLSL::BoxAttribs{-1.5f, -1.5f, -1.5f, 1.5f, 1.5f, 1.5f}, HLSL::BoxAttribs{-0.5f, -0.5f, -0.5f, 0.5f, 0.5f, 0.5f}};
-
-    // Create box buffer
-    {
-        BufferData BufData = {Boxes, sizeof(Boxes)};
-        BufferDesc BuffDesc;
-        BuffDesc.Name              = "AABB Buffer";
-        BuffDesc.Usage             = USAGE_IMMUTABLE;
-        BuffDesc.BindFlags         = BIND_RAY_TRACING | BIND_SHADER_RESOURCE;
-        BuffDesc.Size              = sizeof(Boxes);
-        BuffDesc.ElementByteStride = sizeof(Boxes[0]);
-        BuffDesc.Mode              = BUFFER_MODE_STRUCTURED;
-
-        m_pDevice->CreateBuffer(BuffDesc, &BufData, &m_BoxAttribsCB);
-        VERIFY_EXPR(m_BoxAttribsCB != nullptr);
-
-        m_pRayTracingSRB->GetVariableByName(SHADER_TYPE_RAY_INTERSECTION, "g_BoxAttribs")->Set(m_BoxAttribsCB->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE));
-    }
-
-    // Create & build bottom level acceleration structure
-    {
-        // Create BLAS
-        BLASBoundingBoxDesc BoxInfo;
-        {
-            BoxInfo.GeometryName = "Box";
-            BoxInfo.MaxBoxCount  = 1;
-
-            BottomLevelASDesc ASDesc;
-            ASDesc.Name     = "Procedural BLAS";
-            ASDesc.Flags    = RAYTRACING_BUILD_AS_PREFER_FAST_TRACE;
-            ASDesc.pBoxes   = &BoxInfo;
-            ASDesc.BoxCount = 1;
-
-            m_pDevice->CreateBLAS(ASDesc, &m_pProceduralBLAS);
-            VERIFY_EXPR(m_pProceduralBLAS != nullptr);
-        }
-
-        // Create scratch buffer
-        RefCntAutoPtr<IBuffer> pScratchBuffer;
-        {
-            BufferDesc BuffDesc;
-            BuffDesc.Name      = "BLAS Scratch Buffer";
-            BuffDesc.Usage     = USAGE_DEFAULT;
-            BuffDesc.BindFlags = BIND_RAY_TRACING;
-            BuffDesc.Size      = m_pProceduralBLAS->GetScratchBufferSizes().Build;
-
-            m_pDevice->CreateBuffer(BuffDesc, nullptr, &pScratchBuffer);
-            VERIFY_EXPR(pScratchBuffer != nullptr);
-        }
-
-        // Build BLAS
-        BLASBuildBoundingBoxData BoxData;
-        BoxData.GeometryName = BoxInfo.GeometryName;
-        BoxData.BoxCount     = 1;
-        BoxData.BoxStride    = sizeof(Boxes[0]);
-        BoxData.pBoxBuffer   = m_BoxAttribsCB;
-
-        BuildBLASAttribs Attribs;
-        Attribs.pBLAS        = m_pProceduralBLAS;
-        Attribs.pBoxData     = &BoxData;
-        Attribs.BoxDataCount = 1;
-
-        // Scratch buffer will be used to store temporary data during BLAS build.
-        // Previous content in the scratch buffer will be discarded.
-        Attribs.pScratchBuffer = pScratchBuffer;
-
-        // Allow engine to change resource states.
-        Attribs.BLASTransitionMode          = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
-        Attribs.GeometryTransitionMode      = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
-        Attribs.ScratchBufferTransitionMode = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
-
-        m_pImmediateContext->BuildBLAS(Attribs);
-    }
-}
-
-void Tutorial21_RayTracing::ModifyEngineInitInfo(const ModifyEngineInitInfoAttribs& Attribs)
-{
-    SampleBase::ModifyEngineInitInfo(Attribs);
-
-    // Require ray tracing feature.
-    Attribs.EngineCI.Features.RayTracing = DEVICE_FEATURE_STATE_ENABLED;
-}
-
-void Tutorial21_RayTracing::UpdateTLAS()
-{
-    // Create or update top-level acceleration structure
-    int  NumSmallSpheres = (2 * a) * (2 * b);
-    int  NumSmallCubes   = (2 * c) * (2 * d); // Corregido: ahora con N mayúscula
-    int  NumInstances    = 4 + NumSmallSpheres + NumSmallCubes;
-    bool NeedUpdate      = true;
-
-    // Create TLAS
-    if (!m_pTLAS)
-    {
-        TopLevelASDesc TLASDesc;
-        TLASDesc.Name             = "TLAS";
-        TLASDesc.MaxInstanceCount = NumInstances;
-        TLASDesc.Flags            = RAYTRACING_BUILD_AS_ALLOW_UPDATE | RAYTRACING_BUILD_AS_PREFER_FAST_TRACE;
-
-        m_pDevice->CreateTLAS(TLASDesc, &m_pTLAS);
-        VERIFY_EXPR(m_pTLAS != nullptr);
-
-        NeedUpdate = false; // build on first run
-
-        m_pRayTracingSRB->GetVariableByName(SHADER_TYPE_RAY_GEN, "g_TLAS")->Set(m_pTLAS);
-        m_pRayTracingSRB->GetVariableByName(SHADER_TYPE_RAY_CLOSEST_HIT, "g_TLAS")->Set(m_pTLAS);
-
-        // Reserva y genera posiciones solo UNA vez
-        m_SmallSphereTransforms.resize(NumSmallSpheres);
-        m_SmallCubeTransforms.resize(NumSmallCubes);
-        m_cubesCustomIds.resize(NumSmallCubes);
-
-        if (m_MaxSmallSpheres == 0)
-        {
-            m_MaxSmallSpheres       = NumSmallSpheres;
-            m_NumActiveSmallSpheres = NumSmallSpheres;
-        }
-
-        if (m_MaxSmallCubes == 0)
-        {
-            m_MaxSmallCubes       = NumSmallCubes;
-            m_NumActiveSmallCubes = NumSmallCubes;
-        }
-
-        // Nueva distribución: espiral para esferas
-        std::vector<float3> positions;
-        positions.reserve(NumSmallSpheres);
-
-        // Parámetros para distribución en espiral
-        const float radio_inicial     = 5.0f;
-        const float incremento_radio  = 0.3f;
-        const float incremento_angulo = 0.5f;
-        const float altura_base       = -5.5f;
-
-        // Generar posiciones en espiral para esferas
-        for (int i = 0; i < NumSmallSpheres; ++i)
-        {
-            float radio  = radio_inicial + incremento_radio * i;
-            float angulo = incremento_angulo * i;
-
-            float x = radio * cos(angulo);
-            float z = radio * sin(angulo);
-            float y = altura_base + (i * 0.05f); // Ligera elevación en espiral
-
-            float3 p = float3{x, y, z};
-            positions.push_back(p);
-
-            // Crea la matriz de instancia
-            InstanceMatrix xf;
-            xf.SetTranslation(p.x, p.y, p.z);
-            m_SmallSphereTransforms[i] = xf;
-        }
-
-        // Nueva distribución: estructura de grilla para cubos pero en forma de pirámide
-        std::vector<float3> cubePositions;
-        cubePositions.reserve(NumSmallCubes); // Corregido con N mayúscula
-
-        int capas = 5; // Número de capas de la pirámide
-        int index = 0;
-
-        for (int capa = 0; capa < capas && index < NumSmallCubes; capa++)
-        { // Corregido con N mayúscula
-            int   cubos_por_lado = capas - capa;
-            float nivel_y        = altura_base + (capa * 1.5f); // Altura de cada capa
-
-            // Generar cubos en forma de cuadrado para esta capa
-            for (int i = -cubos_por_lado / 2; i <= cubos_por_lado / 2 && index < NumSmallCubes; i++)
-            { // Corregido
-                for (int j = -cubos_por_lado / 2; j <= cubos_por_lado / 2 && index < NumSmallCubes; j++)
-                { // Corregido
-                    // Solo agregar cubos en los bordes del cuadrado para formar un marco
-                    if (i == -cubos_por_lado / 2 || i == cubos_por_lado / 2 ||
-                        j == -cubos_por_lado / 2 || j == cubos_por_lado / 2)
-                    {
-
-                        float  x = i * 2.0f; // Espaciado de 2 unidades
-                        float  z = j * 2.0f;
-                        float3 p = float3{x, nivel_y, z};
-
-                        cubePositions.push_back(p);
-
-                        // Asignar materiales de manera diferente - asignar más variedad
-                        int   instanceId;
-                        float mat_selector = static_cast<float>(index) / NumSmallCubes; // Corregido
-
-                        if (mat_selector < 0.6f)
-                        {
-                            instanceId = 0; // Textura cristal para mayoría
-                        }
-                        else if (mat_selector < 0.85f)
-                        {
-                            instanceId = 1; // Textura difusa
-                        }
-                        else
-                        {
-                            instanceId = 2; // Textura metal
-                        }
-
-                        m_cubesCustomIds[index] = instanceId;
-
-                        // Crear matriz de instancia
-                        InstanceMatrix xf;
-                        xf.SetTranslation(p.x, p.y, p.z);
-                        // Aplicar rotación adicional variada
-                        float3x3 rot = float3x3::RotationY(index * 0.2f) * float3x3::RotationX(capa * 0.15f);
-                        xf.SetRotation(rot.Data());
-                        m_SmallCubeTransforms[index] = xf;
-
-                        index++;
-                    }
-                }
-            }
-        }
-
-        // Llenar los cubos restantes si aún no hemos alcanzado el límite
-        while (index < NumSmallCubes)
-        { // Corregido
-            float x = (index % 10) * 2.0f - 10.0f;
-            float z = (index / 10) * 2.0f - 10.0f;
-            float y = altura_base - 2.0f; // Ponerlos más abajo que el resto
-
-            float3 p = float3{x, y, z};
-            cubePositions.push_back(p);
-
-            // Material aleatorio
-            m_cubesCustomIds[index] = index % 3;
-
-            // Crear matriz de instancia
-            InstanceMatrix xf;
-            xf.SetTranslation(p.x, p.y, p.z);
-            m_SmallCubeTransforms[index] = xf;
-
-            index++;
-        }
-
-        // Inicializar nombres de instancias
-        m_SphereInstanceNames.resize(NumSmallSpheres);
-        m_CubeInstanceNames.resize(NumSmallCubes); // Corregido
-    }
-
-    // Resto del código permanece igual...
-    // Create scratch buffer
-    if (!m_ScratchBuffer)
-    {
-        BufferDesc BuffDesc;
-        BuffDesc.Name      = "TLAS Scratch Buffer";
-        BuffDesc.Usage     = USAGE_DEFAULT;
-        BuffDesc.BindFlags = BIND_RAY_TRACING;
-        BuffDesc.Size      = std::max(m_pTLAS->GetScratchBufferSizes().Build, m_pTLAS->GetScratchBufferSizes().Update);
-
-        m_pDevice->CreateBuffer(BuffDesc, nullptr, &m_ScratchBuffer);
-        VERIFY_EXPR(m_ScratchBuffer != nullptr);
-    }
-
-    // Create instance buffer
-    if (!m_InstanceBuffer)
-    {
-        BufferDesc BuffDesc;
-        BuffDesc.Name      = "TLAS Instance Buffer";
-        BuffDesc.Usage     = USAGE_DEFAULT;
-        BuffDesc.BindFlags = BIND_RAY_TRACING;
-        BuffDesc.Size      = TLAS_INSTANCE_DATA_SIZE * NumInstances;
-
-        m_pDevice->CreateBuffer(BuffDesc, nullptr, &m_InstanceBuffer);
-        VERIFY_EXPR(m_InstanceBuffer != nullptr);
-    }
-
-    // Setup instances
-    std::vector<TLASBuildInstanceData> Instances(NumInstances);
-
-    // Configurar los objetos principales
-    Instances[0].InstanceName = "Ground Instance";
-    Instances[0].pBLAS        = m_pCubeBLAS;
-    Instances[0].Mask         = OPAQUE_GEOM_MASK;
-    Instances[0].Transform.SetRotation(float3x3::Scale(100.0f, 0.1f, 100.0f).Data());
-    Instances[0].Transform.SetTranslation(0.0f, -6.0f, 0.0f);
-
-    Instances[1].InstanceName = "Cube Instance 1";
-    Instances[1].CustomId     = 0;
-    Instances[1].pBLAS        = m_pCubeBLAS;
-    Instances[1].Mask         = OPAQUE_GEOM_MASK;
-    Instances[1].Transform.SetTranslation(-4.0f, -4.5f, -0.f);
-
-    Instances[2].InstanceName = "Cube Instance 2";
-    Instances[2].CustomId     = 1;
-    Instances[2].pBLAS        = m_pCubeBLAS;
-    Instances[2].Mask         = OPAQUE_GEOM_MASK;
-    Instances[2].Transform.SetTranslation(0.0f, -4.5f, -3.f);
-
-    Instances[3].InstanceName = "Cube Instance 3";
-    Instances[3].CustomId     = 2;
-    Instances[3].pBLAS        = m_pCubeBLAS;
-    Instances[3].Mask         = OPAQUE_GEOM_MASK;
-    Instances[3].Transform.SetTranslation(4.0f, -4.5f, -6.f);
-
-    // Configurar las esferas pequeñas
-    int idx = 4;
-    for (int i = 0; i < (2 * a) * (2 * b); ++i)
-    {
-        auto& name = m_SphereInstanceNames[i];
-        name       = "Sphere Instance " + std::to_string(idx);
-
-        auto& Inst        = Instances[idx];
-        Inst.InstanceName = name.c_str();
-        Inst.CustomId     = 1;
-        Inst.pBLAS        = m_pProceduralBLAS;
-        Inst.Mask         = (i < m_NumActiveSmallSpheres) ? OPAQUE_GEOM_MASK : 0;
-        Inst.Transform    = m_SmallSphereTransforms[i];
-
-        ++idx;
-    }
-
-    // Configurar los cubos pequeños
-    int idx_c2 = 0;
-    for (int i = 0; i < (2 * c) * (2 * d); ++i)
-    {
-        auto& name = m_CubeInstanceNames[i];
-        name       = "Cube Instance " + std::to_string(idx);
-
-        auto& Inst        = Instances[idx];
-        Inst.InstanceName = name.c_str();
-        Inst.CustomId     = m_cubesCustomIds[i];
-        Inst.pBLAS        = m_pSmallCubeBLAS;
-        Inst.Mask         = (i < m_NumActiveSmallCubes) ? OPAQUE_GEOM_MASK : 0;
-        Inst.Transform    = m_SmallCubeTransforms[i];
-
-        ++idx;
-        ++idx_c2;
-    }
-
-    // Build or update TLAS
-    BuildTLASAttribs Attribs;
-    Attribs.pTLAS                        = m_pTLAS;
-    Attribs.Update                       = NeedUpdate;
-    Attribs.pScratchBuffer               = m_ScratchBuffer;
-    Attribs.pInstanceBuffer              = m_InstanceBuffer;
-    Attribs.pInstances                   = Instances.data();
-    Attribs.InstanceCount                = NumInstances;
-    Attribs.BindingMode                  = HIT_GROUP_BINDING_MODE_PER_INSTANCE;
-    Attribs.HitGroupStride               = HIT_GROUP_STRIDE;
-    Attribs.TLASTransitionMode           = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
-    Attribs.BLASTransitionMode           = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
-    Attribs.InstanceBufferTransitionMode = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
-    Attribs.ScratchBufferTransitionMode  = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
-
-    m_pImmediateContext->BuildTLAS(Attribs);
-}
-
-void Tutorial21_RayTracing::Update(double CurrTime, double ElapsedTime)
-{
-    SampleBase::Update(CurrTime, ElapsedTime);
-    UpdateUI();
-
-    if (m_Animate)
-    {
-        m_AnimationTime += static_cast<float>(std::min(m_MaxAnimationTimeDelta, ElapsedTime));
-    }
-
-    m_Camera.Update(m_InputController, static_cast<float>(ElapsedTime));
-
-    // Do not allow going underground
-    auto oldPos = m_Camera.GetPos();
-    if (oldPos.y < -5.7f)
-    {
-        oldPos.y = -5.7f;
-        m_Camera.SetPos(oldPos);
-        m_Camera.Update(m_InputController, 0.f);
-    }
-}
-
-void Tutorial21_RayTracing::WindowResize(Uint32 Width, Uint32 Height)
-{
-    if (Width == 0 || Height == 0)
-        return;
-
-    // Update projection matrix.
-    float AspectRatio = static_cast<float>(Width) / static_cast<float>(Height);
-    m_Camera.SetProjAttribs(m_Constants.ClipPlanes.x, m_Constants.ClipPlanes.y, AspectRatio, PI_F / 4.f,
-                            m_pSwapChain->GetDesc().PreTransform, m_pDevice->GetDeviceInfo().NDC.MinZ == -1);
-
-    // Check if the image needs to be recreated.
-    if (m_pColorRT != nullptr &&
-        m_pColorRT->GetDesc().Width == Width &&
-        m_pColorRT->GetDesc().Height == Height)
-        return;
-
-    m_pColorRT = nullptr;
-
-    // Create window-size color image.
-    TextureDesc RTDesc       = {};
-    RTDesc.Name              = "Color buffer";
-    RTDesc.Type              = RESOURCE_DIM_TEX_2D;
-    RTDesc.Width             = Width;
-    RTDesc.Height            = Height;
-    RTDesc.BindFlags         = BIND_UNORDERED_ACCESS | BIND_SHADER_RESOURCE;
-    RTDesc.ClearValue.Format = m_ColorBufferFormat;
-    RTDesc.Format            = m_ColorBufferFormat;
-
-    m_pDevice->CreateTexture(RTDesc, nullptr, &m_pColorRT);
-}
-void Tutorial21_RayTracing::Initialize(const SampleInitInfo& InitInfo)
-{
-    SampleBase::Initialize(InitInfo);
-
-    if ((m_pDevice->GetAdapterInfo().RayTracing.CapFlags & RAY_TRACING_CAP_FLAG_STANDALONE_SHADERS) == 0)
-    {
-        UNSUPPORTED("Ray tracing shaders are not supported by device");
-        return;
-    }
-
-    // Create a buffer with shared constants.
-    BufferDesc BuffDesc;
-    BuffDesc.Name      = "Constant buffer";
-    BuffDesc.Size      = sizeof(m_Constants);
-    BuffDesc.Usage     = USAGE_DEFAULT;
-    BuffDesc.BindFlags = BIND_UNIFORM_BUFFER;
-
-    m_pDevice->CreateBuffer(BuffDesc, nullptr, &m_ConstantsCB);
-    VERIFY_EXPR(m_ConstantsCB != nullptr);
-
-    CreateGraphicsPSO();
-    CreateRayTracingPSO();
-    LoadTextures();
-    CreateCubeBLAS(2.0f, m_pCubeBLAS);
-    CreateCubeBLAS(0.5f, m_pSmallCubeBLAS);
-    CreateProceduralBLAS();
-    UpdateTLAS();
-    CreateSBT();
-
-    // Setup camera.
-    m_Camera.SetPos(float3(7.f, -0.5f, -16.5f));
-    m_Camera.SetRotation(0.48f, -0.145f);
-    m_Camera.SetRotationSpeed(0.005f);
-    m_Camera.SetMoveSpeed(5.f);
-    m_Camera.SetSpeedUpScales(5.f, 10.f);
-
-    // Initialize constants.
-    {
-        m_Constants.ClipPlanes   = float2{0.1f, 100.0f};
-        m_Constants.ShadowPCF    = 1;
-        m_Constants.MaxRecursion = std::min(Uint32{6}, m_MaxRecursionDepth);
-
-        // Sphere constants.
-        m_Constants.SphereReflectionColorMask = {0.81f, 1.0f, 0.45f};
-        m_Constants.SphereReflectionBlur      = 1;
-
-        // Glass cube constants.
-        m_Constants.GlassReflectionColorMask = {0.22f, 0.83f, 0.93f};
-        m_Constants.GlassAbsorption          = 0.5f;
-        m_Constants.GlassMaterialColor       = {0.33f, 0.93f, 0.29f};
-        m_Constants.GlassIndexOfRefraction   = {1.5f, 1.02f};
-        m_Constants.GlassEnableDispersion    = 0;
-
-        // Wavelength to RGB and index of refraction interpolation factor.
-        m_Constants.DispersionSamples[0]  = {0.140000f, 0.000000f, 0.266667f, 0.53f};
-        m_Constants.DispersionSamples[1]  = {0.130031f, 0.037556f, 0.612267f, 0.25f};
-        m_Constants.DispersionSamples[2]  = {0.100123f, 0.213556f, 0.785067f, 0.16f};
-        m_Constants.DispersionSamples[3]  = {0.050277f, 0.533556f, 0.785067f, 0.00f};
-        m_Constants.DispersionSamples[4]  = {0.000000f, 0.843297f, 0.619682f, 0.13f};
-        m_Constants.DispersionSamples[5]  = {0.000000f, 0.927410f, 0.431834f, 0.38f};
-        m_Constants.DispersionSamples[6]  = {0.000000f, 0.972325f, 0.270893f, 0.27f};
-        m_Constants.DispersionSamples[7]  = {0.000000f, 0.978042f, 0.136858f, 0.19f};
-        m_Constants.DispersionSamples[8]  = {0.324000f, 0.944560f, 0.029730f, 0.47f};
-        m_Constants.DispersionSamples[9]  = {0.777600f, 0.871879f, 0.000000f, 0.64f};
-        m_Constants.DispersionSamples[10] = {0.972000f, 0.762222f, 0.000000f, 0.77f};
-        m_Constants.DispersionSamples[11] = {0.971835f, 0.482222f, 0.000000f, 0.62f};
-        m_Constants.DispersionSamples[12] = {0.886744f, 0.202222f, 0.000000f, 0.73f};
-        m_Constants.DispersionSamples[13] = {0.715967f, 0.000000f, 0.000000f, 0.68f};
-        m_Constants.DispersionSamples[14] = {0.459920f, 0.000000f, 0.000000f, 0.91f};
-        m_Constants.DispersionSamples[15] = {0.218000f, 0.000000f, 0.000000f, 0.99f};
-        m_Constants.DispersionSampleCount = 4;
-
-        // Modificar el color del cielo (ambiente) a gris
-        m_Constants.AmbientColor  = float4(0.5f, 0.5f, 0.5f, 0.f) * 0.025f;
-        m_Constants.LightPos[0]   = {8.00f, +8.0f, +0.00f, 0.f};
-        m_Constants.LightColor[0] = {1.00f, +0.8f, +0.80f, 0.f};
-        m_Constants.LightPos[1]   = {0.00f, +4.0f, -5.00f, 0.f};
-        m_Constants.LightColor[1] = {0.85f, +1.0f, +0.85f, 0.f};
-
-        // Random points on disc.
-        m_Constants.DiscPoints[0] = {+0.0f, +0.0f, +0.9f, -0.9f};
-        m_Constants.DiscPoints[1] = {-0.8f, +1.0f, -1.1f, -0.8f};
-        m_Constants.DiscPoints[2] = {+1.5f, +1.2f, -2.1f, +0.7f};
-        m_Constants.DiscPoints[3] = {+0.1f, -2.2f, -0.2f, +2.4f};
-        m_Constants.DiscPoints[4] = {+2.4f, -0.3f, -3.0f, +2.8f};
-        m_Constants.DiscPoints[5] = {+2.0f, -2.6f, +0.7f, +3.5f};
-        m_Constants.DiscPoints[6] = {-3.2f, -1.6f, +3.4f, +2.2f};
-        m_Constants.DiscPoints[7] = {-1.8f, -3.2f, -1.1f, +3.6f};
-    }
-    static_assert(sizeof(HLSL::Constants) % 16 == 0, "must be aligned by 16 bytes");
-}
-void Tutorial21_RayTracing::CreateSBT()
-{
-    // Create shader binding table.
-    ShaderBindingTableDesc SBTDesc;
-    SBTDesc.Name = "SBT";
-    SBTDesc.pPSO = m_pRayTracingPSO;
-
-    m_pDevice->CreateSBT(SBTDesc, &m_pSBT);
-    VERIFY_EXPR(m_pSBT != nullptr);
-
-    m_pSBT->BindRayGenShader("Main");
-
-    m_pSBT->BindMissShader("PrimaryMiss", PRIMARY_RAY_INDEX);
-    m_pSBT->BindMissShader("ShadowMiss", SHADOW_RAY_INDEX);
-
-    // Hit groups for primary ray
-    m_pSBT->BindHitGroupForInstance(m_pTLAS, "Cube Instance 1", PRIMARY_RAY_INDEX, "GlassPrimaryHit");
-    m_pSBT->BindHitGroupForInstance(m_pTLAS, "Cube Instance 2", PRIMARY_RAY_INDEX, "GlassPrimaryHit");
-    m_pSBT->BindHitGroupForInstance(m_pTLAS, "Cube Instance 3", PRIMARY_RAY_INDEX, "GlassPrimaryHit");
-    m_pSBT->BindHitGroupForInstance(m_pTLAS, "Ground Instance", PRIMARY_RAY_INDEX, "GroundHit");
-
-    // Hit groups for shadow ray.
-    m_pSBT->BindHitGroupForTLAS(m_pTLAS, SHADOW_RAY_INDEX, nullptr);
-
-    // Distribuir aleatoriamente los tres tipos de materiales para esferas
-    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
-
-    for (int i = 0; i < m_SphereInstanceNames.size(); ++i)
-    {
-        // Nueva distribución de materiales: más metálico, menos vidrio
-        float materialSelector = dist(rng);
-
-        if (materialSelector < 0.7f) // 70% de probabilidad para metálico
-        {
-            m_pSBT->BindHitGroupForInstance(m_pTLAS, m_SphereInstanceNames[i].c_str(), PRIMARY_RAY_INDEX, "SpherePrimaryHit");
-        }
-        else if (materialSelector < 0.9f) // 20% de probabilidad para difuso
-        {
-            m_pSBT->BindHitGroupForInstance(m_pTLAS, m_SphereInstanceNames[i].c_str(), PRIMARY_RAY_INDEX, "SpherePrimaryDiffuseHit");
-        }
-        else // 10% de probabilidad para vidrio
-        {
-            m_pSBT->BindHitGroupForInstance(m_pTLAS, m_SphereInstanceNames[i].c_str(), PRIMARY_RAY_INDEX, "SphereGlassHit");
-        }
-
-        m_pSBT->BindHitGroupForInstance(m_pTLAS, m_SphereInstanceNames[i].c_str(), SHADOW_RAY_INDEX, "SphereShadowHit");
-    }
-
-    // Para los cubos, asignar materiales según los IDs personalizados
-    for (int i = 0; i < m_CubeInstanceNames.size(); ++i)
-    {
-        // Usar un hit group diferente basado en el ID personalizado
-        if (m_cubesCustomIds[i] == 0)
-        {
-            m_pSBT->BindHitGroupForInstance(m_pTLAS, m_CubeInstanceNames[i].c_str(), PRIMARY_RAY_INDEX, "GlassPrimaryHit");
-        }
-        else if (m_cubesCustomIds[i] == 1)
-        {
-            m_pSBT->BindHitGroupForInstance(m_pTLAS, m_CubeInstanceNames[i].c_str(), PRIMARY_RAY_INDEX, "CubePrimaryHit");
-        }
-        else
-        {
-            m_pSBT->BindHitGroupForInstance(m_pTLAS, m_CubeInstanceNames[i].c_str(), PRIMARY_RAY_INDEX, "GlassPrimaryHit");
-        }
-    }
-
-    // Update SBT with the shader groups we bound
-    m_pImmediateContext->UpdateSBT(m_pSBT);
-}
-
-void Tutorial21_RayTracing::UpdateUI()
-{
-    ImGui::SetNextWindowPos(ImVec2(10, 10), ImGuiCond_FirstUseEver);
-    if (ImGui::Begin("Ray Tracing Demo", nullptr, ImGuiWindowFlags_AlwaysAutoResize))
-    {
-        ImGui::Text("Scene Controls");
-        ImGui::Text("Use WASD keys to move camera");
-
-        // Essential controls only
-        ImGui::Separator();
-        ImGui::Text("Scene Objects");
-
-        // Sphere control
-        ImGui::SliderInt("Active Spheres", &m_NumActiveSmallSpheres, 0, m_MaxSmallSpheres);
-
-        // Cube control
-        ImGui::SliderInt("Active Cubes", &m_NumActiveSmallCubes, 0, m_MaxSmallCubes);
-
-        // Render quality
-        ImGui::Separator();
-        ImGui::Text("Render Quality");
-        ImGui::SliderInt("Recursion Depth", &m_Constants.MaxRecursion, 1, m_MaxRecursionDepth);
-        ImGui::SliderInt("Shadow Quality", &m_Constants.ShadowPCF, 0, 4);
-    }
-    ImGui::End();
-}
-
-} // namespace Diligent
+﻿/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "Tutorial21_RayTracing.hpp"
+#include "BLASBatchBuilder.hpp"
+#include "BLASCompaction.hpp"
+#include "MeshAttribsPool.hpp"
+#include "MapHelper.hpp"
+#include "GraphicsTypesX.hpp"
+#include "GraphicsUtilities.h"
+#include "TextureUtilities.h"
+#include "ShaderMacroHelper.hpp"
+#include "imgui.h"
+#include "ImGuiUtils.hpp"
+#include "AdvancedMath.hpp"
+#include "PlatformMisc.hpp"
+#include "ParallelFor.hpp"
+#include "RayConeLOD.hpp"
+#include "TextureBlob.hpp"
+#include "PipelineStateCache.hpp"
+#include "SpectralDispersion.hpp"
+#include "LightBVH.hpp"
+#include "InstanceCuller.hpp"
+#include "DistributedRenderer.hpp"
+#include "MaterialKernels.hpp"
+#include "ReferenceImageSuite.hpp"
+#include "FramePacking.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <vector>
+
+namespace Diligent
+{
+
+
+        namespace
+    {
+    // Para referenciar con claridad los distintos hit‑groups
+    constexpr char HG_Cube[]           = "CubePrimaryHit";
+    constexpr char HG_Ground[]         = "GroundHit";
+    constexpr char HG_GlassCube[]      = "GlassPrimaryHit";
+    constexpr char HG_SphereMetallic[] = "SpherePrimaryHit";
+    constexpr char HG_SphereDiffuse[]  = "SpherePrimaryDiffuseHit";
+    constexpr char HG_SphereGlass[]    = "SphereGlassHit"; // si lo usas
+    constexpr char HG_SphereShadow[]   = "SphereShadowHit";
+    } // namespace
+
+SampleBase* CreateSample()
+{
+    return new Tutorial21_RayTracing();
+}
+
+namespace
+{
+
+// Packs the mesh index and the user id (material, texture or box index) into the instance custom id.
+Uint32 PackInstanceCustomId(Uint32 MeshId, Uint32 UserId)
+{
+    VERIFY_EXPR(MeshId < MAX_MESHES && UserId <= INSTANCE_USER_ID_MASK);
+    return (MeshId << INSTANCE_USER_ID_BITS) | UserId;
+}
+
+// Chunks of the scene cache. Increment SceneCacheContentVersion whenever the data
+// stored in any chunk changes, so that existing caches are rebuilt.
+constexpr Uint32 SceneCacheContentVersion = 1;
+enum SCENE_CHUNK : Uint32
+{
+    SCENE_CHUNK_CUBE_TEXTURE0     = 0x100, // + texture index
+    SCENE_CHUNK_GROUND_TEXTURE    = 0x1FF,
+    SCENE_CHUNK_CUBE_MESH0        = 0x200, // + cube index
+    SCENE_CHUNK_LOADED_MESH       = 0x2FF,
+    SCENE_CHUNK_SPHERE_TRANSFORMS = 0x300,
+    SCENE_CHUNK_SPHERE_MATERIALS,
+    SCENE_CHUNK_CUBE_TRANSFORMS,
+    SCENE_CHUNK_CUBE_MATERIALS,
+};
+
+constexpr char GroundTextureFileName[] = "Ground.jpg";
+
+std::string GetCubeTextureFileName(int Tex)
+{
+    return "DGLogo" + std::to_string(Tex) + ".png";
+}
+
+// Adds the file name, size and modification time to the scene cache key.
+void AppendFileStamp(std::string& Key, const std::string& Path)
+{
+    std::error_code ec;
+    const auto      Size  = std::filesystem::file_size(Path, ec);
+    const auto      MTime = std::filesystem::last_write_time(Path, ec);
+    Key += Path + ':' + std::to_string(ec ? 0 : Size) + ':' + std::to_string(ec ? 0 : MTime.time_since_epoch().count()) + ';';
+}
+
+// Identifies a ray tracing pipeline variant by the values of specialized settings.
+Uint64 GetRayTracingPipelineKey(Int32 MaxRecursion, Int32 ShadowPCF, Int32 Dispersion)
+{
+    return (Uint64{static_cast<Uint16>(MaxRecursion)} << 32) | (Uint64{static_cast<Uint16>(ShadowPCF)} << 16) | static_cast<Uint16>(Dispersion);
+}
+
+// The number of frames averaged by the accumulation buffer. Moving objects leave trails,
+// so fewer frames are kept while the scene is animated.
+constexpr Uint32 MaxStaticAccumFrames   = 1024;
+constexpr Uint32 MaxAnimatedAccumFrames = 8;
+
+// Size of the grid cells that group small spheres and cubes into clusters, see InstanceClusterLOD.
+constexpr float InstanceClusterCellSize = 8.f;
+
+// Box 0 is the AABB of the single-sphere BLAS. It is followed by one box per small sphere
+// and by the boxes of the sphere cluster proxies.
+constexpr Uint32 FirstSphereBox = 1;
+
+// State of small spheres and cubes that is changed by scene edits, see ApplySceneEdits().
+enum INSTANCE_EDIT_FLAGS : Uint8
+{
+    INSTANCE_EDIT_FLAG_NONE = 0,
+
+    // The instance was removed by SCENE_EDIT_REMOVE_INSTANCE.
+    INSTANCE_EDIT_FLAG_REMOVED = 1u << 0,
+
+    // The instance was moved or got another material. Cluster proxies are built from the
+    // original layout, so the cluster of the instance always uses the individual instances.
+    INSTANCE_EDIT_FLAG_MODIFIED = 1u << 1,
+};
+
+// Meshes of the CPU renderer, see CreateTracerScene().
+enum TRACER_MESH : Uint32
+{
+    TRACER_MESH_CUBE = 0,
+    TRACER_MESH_SMALL_CUBE,
+    TRACER_MESH_LOADED
+};
+
+// Transform of the ground (instance 0) or of one of the three large cubes (instances 1 to 3).
+InstanceMatrix GetFixedInstanceTransform(Uint32 Idx)
+{
+    InstanceMatrix Transform;
+    if (Idx == 0)
+    {
+        Transform.SetRotation(float3x3::Scale(100.0f, 0.1f, 100.0f).Data());
+        Transform.SetTranslation(0.0f, -6.0f, 0.0f);
+    }
+    else
+    {
+        constexpr float CubePositions[][3] = {{-4.0f, -4.5f, -0.f}, {0.0f, -4.5f, -3.f}, {4.0f, -4.5f, -6.f}};
+        VERIFY_EXPR(Idx <= _countof(CubePositions));
+        Transform.SetTranslation(CubePositions[Idx - 1][0], CubePositions[Idx - 1][1], CubePositions[Idx - 1][2]);
+    }
+    return Transform;
+}
+
+// Image size of the CPU renderer modes, which run before the swap chain is created.
+constexpr Uint32 CPUModeImageWidth  = 1280;
+constexpr Uint32 CPUModeImageHeight = 720;
+
+// Modes that run from the command line end the process here instead of starting the app, so that
+// the exit code reports their result. The device has not been created yet, so nothing is released.
+[[noreturn]] void ExitAfterCommandLine(bool Success)
+{
+    std::exit(Success ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+} // namespace
+
+SampleBase::CommandLineStatus Tutorial21_RayTracing::ProcessCommandLine(int argc, const char* const* argv)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--mesh") == 0 && i + 1 < argc)
+            m_MeshPath = argv[++i];
+        else if (std::strcmp(argv[i], "--scene-cache") == 0 && i + 1 < argc)
+            m_SceneCachePath = argv[++i];
+        else if (std::strcmp(argv[i], "--pso-cache") == 0 && i + 1 < argc)
+            m_PipelineCachePath = argv[++i];
+        else if (std::strcmp(argv[i], "--query-benchmark") == 0 && i + 1 < argc)
+            m_QueryBenchmarkRays = static_cast<Uint32>(std::strtoul(argv[++i], nullptr, 10));
+        else if (std::strcmp(argv[i], "--denoise-benchmark") == 0 && i + 1 < argc)
+        {
+            char* pEnd               = nullptr;
+            m_DenoiseBenchmarkWidth  = static_cast<Uint32>(std::strtoul(argv[++i], &pEnd, 10));
+            m_DenoiseBenchmarkHeight = *pEnd == 'x' ? static_cast<Uint32>(std::strtoul(pEnd + 1, nullptr, 10)) : m_DenoiseBenchmarkWidth;
+        }
+        else if (std::strcmp(argv[i], "--distributed-benchmark") == 0 && i + 1 < argc)
+            m_DistributedBenchmarkWorkers = static_cast<Uint32>(std::strtoul(argv[++i], nullptr, 10));
+        else if (std::strcmp(argv[i], "--distributed-listen") == 0 && i + 1 < argc)
+        {
+            // [<host>:]<port>. Without a host, only workers on this machine can connect.
+            const std::string Address{argv[++i]};
+            const auto        PortPos = Address.rfind(':');
+            m_DistributedListenHost   = PortPos != std::string::npos ? Address.substr(0, PortPos) : std::string{};
+            m_DistributedListenPort   = static_cast<Uint16>(std::strtoul(Address.c_str() + (PortPos != std::string::npos ? PortPos + 1 : 0), nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--render-worker") == 0 && i + 2 < argc)
+        {
+            // Worker processes of DistributedRenderer only run the CPU tracer and exit without creating the device.
+            const char* Connection = argv[++i];
+            const char* Token      = argv[++i];
+            ExitAfterCommandLine(DistributedRenderer::RunWorker(Connection, Token));
+        }
+        else if (std::strcmp(argv[i], "--material-benchmark") == 0 && i + 1 < argc)
+            m_MaterialBenchmarkIterations = static_cast<Uint32>(std::strtoul(argv[++i], nullptr, 10));
+        else if (std::strcmp(argv[i], "--offline-frames") == 0 && i + 1 < argc)
+            m_OfflineFrames = static_cast<Uint32>(std::strtoul(argv[++i], nullptr, 10));
+        else if (std::strcmp(argv[i], "--offline-size") == 0 && i + 1 < argc)
+        {
+            char* pEnd      = nullptr;
+            m_OfflineWidth  = static_cast<Uint32>(std::strtoul(argv[++i], &pEnd, 10));
+            m_OfflineHeight = *pEnd == 'x' ? static_cast<Uint32>(std::strtoul(pEnd + 1, nullptr, 10)) : m_OfflineWidth;
+        }
+        else if (std::strcmp(argv[i], "--offline-output") == 0 && i + 1 < argc)
+            m_OfflineOutputDir = argv[++i];
+        else if (std::strcmp(argv[i], "--offline-format") == 0 && i + 1 < argc)
+            m_OfflineFormat = std::strcmp(argv[++i], "pfm") == 0 ? FrameSequenceWriter::FILE_FORMAT_PFM : FrameSequenceWriter::FILE_FORMAT_PNG;
+        else if (std::strcmp(argv[i], "--reference-suite") == 0 && i + 1 < argc)
+            m_ReferenceSuiteDir = argv[++i];
+        else if (std::strcmp(argv[i], "--reference-update") == 0)
+            m_UpdateReferenceImages = true;
+        else if (std::strcmp(argv[i], "--readback") == 0 && i + 1 < argc)
+        {
+            static constexpr const char* FormatNames[] = {"native", "rgba8", "rgb10a2", "ycbcr420"};
+            static_assert(_countof(FormatNames) == READBACK_FORMAT_COUNT, "Not all readback formats are handled");
+
+            m_EnableReadback = true;
+            ++i;
+            for (Uint32 Format = 0; Format < READBACK_FORMAT_COUNT; ++Format)
+            {
+                if (std::strcmp(argv[i], FormatNames[Format]) == 0)
+                    m_ReadbackFormat = static_cast<READBACK_FORMAT>(Format);
+            }
+        }
+        else if (std::strcmp(argv[i], "--hierarchy-benchmark") == 0 && i + 1 < argc)
+            m_HierarchyBenchmarkCopies = static_cast<Uint32>(std::strtoul(argv[++i], nullptr, 10));
+        else if (std::strcmp(argv[i], "--cluster-benchmark") == 0 && i + 1 < argc)
+            m_ClusterBenchmarkCopies = static_cast<Uint32>(std::strtoul(argv[++i], nullptr, 10));
+        else if (std::strcmp(argv[i], "--readback-benchmark") == 0 && i + 1 < argc)
+        {
+            char* pEnd                = nullptr;
+            m_ReadbackBenchmarkWidth  = static_cast<Uint32>(std::strtoul(argv[++i], &pEnd, 10));
+            m_ReadbackBenchmarkHeight = *pEnd == 'x' ? static_cast<Uint32>(std::strtoul(pEnd + 1, nullptr, 10)) : m_ReadbackBenchmarkWidth;
+        }
+        else if (std::strcmp(argv[i], "--variable-rate") == 0)
+            m_EnableVariableRate = true;
+        else if (std::strcmp(argv[i], "--variable-rate-check") == 0)
+        {
+            // Runs on the CPU and exits without creating the device, so it works without ray tracing support.
+            ExitAfterCommandLine(VariableRateTracing::RunSelfCheck());
+        }
+        else if (std::strcmp(argv[i], "--as-build-check") == 0)
+        {
+            // Checks the TLAS slot rotation and the scratch arena on the CPU with fake fence values.
+            const bool SchedulerPassed = ASBuildScheduler::RunSelfCheck();
+            const bool ArenaPassed     = ScratchArena::RunSelfCheck();
+            ExitAfterCommandLine(SchedulerPassed && ArenaPassed);
+        }
+        else if (std::strcmp(argv[i], "--variable-rate-benchmark") == 0 && i + 1 < argc)
+        {
+            char* pEnd                    = nullptr;
+            m_VariableRateBenchmarkWidth  = static_cast<Uint32>(std::strtoul(argv[++i], &pEnd, 10));
+            m_VariableRateBenchmarkHeight = *pEnd == 'x' ? static_cast<Uint32>(std::strtoul(pEnd + 1, nullptr, 10)) : m_VariableRateBenchmarkWidth;
+        }
+    }
+
+    // The reference suite renders its own scene on the CPU and exits without creating the device.
+    if (!m_ReferenceSuiteDir.empty())
+        ExitAfterCommandLine(RunReferenceSuite());
+
+    // The other CPU renderer modes render the scene of the sample, which is set up without the device
+    // as well, so they also run on devices without ray tracing support.
+    if (HasCPUModes())
+    {
+        InitializeScene();
+        ExitAfterCommandLine(RunCPUModes());
+    }
+
+    return CommandLineStatus::OK;
+}
+
+void Tutorial21_RayTracing::Render()
+{
+    // Nothing is created without ray tracing support, see Initialize().
+    if (!m_pRayTracingPSO)
+        return;
+
+    ApplySceneEdits();
+
+    // With a dedicated build queue, this frame traces the TLAS slot built during the previous
+    // frame while the other slot is rebuilt in parallel. When builds share the queue with
+    // tracing, build first and trace the result right away.
+    ASBuildScheduler::TraceTicket Trace;
+    if (m_AsyncASBuild)
+    {
+        Trace = m_ASBuildScheduler.BeginTrace();
+        UpdateTLAS();
+    }
+    else
+    {
+        UpdateTLAS();
+        Trace = m_ASBuildScheduler.BeginTrace();
+    }
+    VERIFY_EXPR(Trace.Slot != ASBuildScheduler::InvalidSlot);
+    ITopLevelAS* pTLAS = m_TLASSlots[Trace.Slot].pTLAS;
+
+    // Tiles are classified from the G-buffer of the previous frame, so the first frame after
+    // a resize is traced at the full rate.
+    const bool VariableRate = m_EnableVariableRate && m_VariableRateHistory;
+
+    // Update constants. Only the camera changes every frame, other constants change with settings.
+    const bool ConstantsChanged = std::memcmp(&m_Constants, &m_UploadedConstants, sizeof(m_Constants)) != 0;
+    if (ConstantsChanged)
+    {
+        m_pImmediateContext->UpdateBuffer(m_ConstantsCB, 0, sizeof(m_Constants), &m_Constants, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        m_UploadedConstants = m_Constants;
+    }
+    {
+        float3 CameraWorldPos = float3::MakeVector(m_Camera.GetWorldMatrix()[3]);
+        auto   CameraViewProj = m_Camera.GetViewMatrix() * m_Camera.GetProjMatrix();
+
+        // Accumulated frames are discarded when the view or the settings change.
+        if (ConstantsChanged || std::memcmp(&CameraViewProj, &m_LastViewProj, sizeof(CameraViewProj)) != 0)
+            m_NumAccumFrames = 0;
+        m_LastViewProj = CameraViewProj;
+
+        // Only paths that sample one wavelength, a subset of lights or jittered sample patterns per frame need accumulation.
+        const bool NeedsAccumulation = m_Constants.GlassEnableDispersion != 0 || m_Constants.NumLights > static_cast<Uint32>(m_Constants.LightSamples) ||
+            m_Constants.JitterSamplePatterns != 0;
+        const Uint32 MaxAccumFrames    = m_Animate ? MaxAnimatedAccumFrames : MaxStaticAccumFrames;
+        m_NumAccumFrames               = std::min(m_NumAccumFrames + 1, MaxAccumFrames);
+
+        MapHelper<HLSL::FrameConstants> FrameConsts{m_pImmediateContext, m_FrameCB, MAP_WRITE, MAP_FLAG_DISCARD};
+        FrameConsts->CameraPos    = float4{CameraWorldPos, 1.0f};
+        FrameConsts->InvViewProj  = CameraViewProj.Inverse();
+        FrameConsts->FrameIndex   = m_FrameIndex++;
+        FrameConsts->AccumWeight  = NeedsAccumulation ? 1.f / static_cast<float>(m_NumAccumFrames) : 1.f;
+        FrameConsts->VariableRate = VariableRate ? 1 : 0;
+    }
+
+    if (VariableRate)
+        ClassifyTiles();
+
+    // Trace rays
+    {
+        SelectRayTracingPipeline();
+
+        // The TLAS was transitioned to RESOURCE_STATE_RAY_TRACING by the build context,
+        // so the only synchronization required here is to wait for the build fence.
+        if (m_AsyncASBuild)
+            m_pImmediateContext->DeviceWaitForFence(m_pBuildFence, Trace.WaitBuildFenceValue);
+
+        m_pRayTracingSRB->GetVariableByName(SHADER_TYPE_RAY_GEN, "g_ColorBuffer")->Set(m_pColorRT->GetDefaultView(TEXTURE_VIEW_UNORDERED_ACCESS));
+        m_pRayTracingSRB->GetVariableByName(SHADER_TYPE_RAY_GEN, "g_AccumBuffer")->Set(m_pAccumRT->GetDefaultView(TEXTURE_VIEW_UNORDERED_ACCESS));
+        m_pRayTracingSRB->GetVariableByName(SHADER_TYPE_RAY_GEN, "g_GBufferDepth")->Set(m_pGBufferDepth->GetDefaultView(TEXTURE_VIEW_UNORDERED_ACCESS));
+        m_pRayTracingSRB->GetVariableByName(SHADER_TYPE_RAY_GEN, "g_TileRates")->Set(m_pTileRates->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
+        for (auto ShaderType : {SHADER_TYPE_RAY_MISS, SHADER_TYPE_RAY_CLOSEST_HIT})
+        {
+            m_pRayTracingSRB->GetVariableByName(ShaderType, "g_GBufferNormal")->Set(m_pGBufferNormal->GetDefaultView(TEXTURE_VIEW_UNORDERED_ACCESS));
+            m_pRayTracingSRB->GetVariableByName(ShaderType, "g_GBufferObjectId")->Set(m_pGBufferObjectId->GetDefaultView(TEXTURE_VIEW_UNORDERED_ACCESS));
+        }
+        m_pRayTracingSRB->GetVariableByName(SHADER_TYPE_RAY_GEN, "g_TLAS")->Set(pTLAS);
+        m_pRayTracingSRB->GetVariableByName(SHADER_TYPE_RAY_CLOSEST_HIT, "g_TLAS")->Set(pTLAS);
+        m_pRayTracingSRB->GetVariableByName(SHADER_TYPE_RAY_CLOSEST_HIT, "g_InstanceObjectIds")->Set(m_TLASSlots[Trace.Slot].pObjectIdBuffer->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE));
+
+        m_pImmediateContext->SetPipelineState(m_pRayTracingPSO);
+        m_pImmediateContext->CommitShaderResources(m_pRayTracingSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+        TraceRaysAttribs Attribs;
+        Attribs.DimensionX = m_pColorRT->GetDesc().Width;
+        Attribs.DimensionY = m_pColorRT->GetDesc().Height;
+        Attribs.pSBT       = m_pSBT;
+
+        m_pImmediateContext->TraceRays(Attribs);
+
+        // Let the build queue know when it may overwrite this slot.
+        if (m_AsyncASBuild)
+            m_pImmediateContext->EnqueueSignal(m_pTraceFence, Trace.SignalTraceFenceValue);
+    }
+
+    if (VariableRate)
+        FillSkippedPixels();
+    m_VariableRateHistory = true;
+
+    ITexture* pFinalColor = m_EnableDenoiser ? Denoise() : m_pColorRT.RawPtr();
+
+    // Blit to swapchain image
+    {
+        m_pImageBlitSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_Texture")->Set(pFinalColor->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
+
+        auto* pRTV = m_pSwapChain->GetCurrentBackBufferRTV();
+        m_pImmediateContext->SetRenderTargets(1, &pRTV, nullptr, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+        m_pImmediateContext->SetPipelineState(m_pImageBlitPSO);
+        m_pImmediateContext->CommitShaderResources(m_pImageBlitSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+        m_pImmediateContext->Draw(DrawAttribs{3, DRAW_FLAG_VERIFY_ALL});
+    }
+
+    // Frames arrive a few frames later, when their copies have completed; the GPU is never stalled.
+    if (m_EnableReadback)
+        m_pFrameReadback->Enqueue(m_pImmediateContext, pFinalColor, m_ReadbackFormat, m_FrameIndex);
+    m_pFrameReadback->Poll(m_pImmediateContext, [this](const FrameReadback::Frame& Frame) { ProcessReadbackFrame(Frame); });
+}
+
+void Tutorial21_RayTracing::CreateGraphicsPSO()
+{
+    // Create graphics pipeline to blit render target into swapchain image.
+
+    GraphicsPipelineStateCreateInfo PSOCreateInfo;
+
+    PSOCreateInfo.PSODesc.Name         = "Image blit PSO";
+    PSOCreateInfo.PSODesc.PipelineType = PIPELINE_TYPE_GRAPHICS;
+
+    PSOCreateInfo.GraphicsPipeline.NumRenderTargets             = 1;
+    PSOCreateInfo.GraphicsPipeline.RTVFormats[0]                = m_pSwapChain->GetDesc().ColorBufferFormat;
+    PSOCreateInfo.GraphicsPipeline.PrimitiveTopology            = PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
+    PSOCreateInfo.GraphicsPipeline.RasterizerDesc.CullMode      = CULL_MODE_NONE;
+    PSOCreateInfo.GraphicsPipeline.DepthStencilDesc.DepthEnable = False;
+
+    ShaderCreateInfo ShaderCI;
+    ShaderCI.SourceLanguage = SHADER_SOURCE_LANGUAGE_HLSL;
+    ShaderCI.ShaderCompiler = SHADER_COMPILER_DXC;
+    ShaderCI.CompileFlags   = SHADER_COMPILE_FLAG_PACK_MATRIX_ROW_MAJOR;
+
+    // Create a shader source stream factory to load shaders from files.
+    RefCntAutoPtr<IShaderSourceInputStreamFactory> pShaderSourceFactory;
+    m_pEngineFactory->CreateDefaultShaderSourceStreamFactory(nullptr, &pShaderSourceFactory);
+    ShaderCI.pShaderSourceStreamFactory = pShaderSourceFactory;
+
+    RefCntAutoPtr<IShader> pVS;
+    {
+        ShaderCI.Desc.ShaderType = SHADER_TYPE_VERTEX;
+        ShaderCI.EntryPoint      = "main";
+        ShaderCI.Desc.Name       = "Image blit VS";
+        ShaderCI.FilePath        = "ImageBlit.vsh";
+        m_pPipelineStateCache->CreateShader(ShaderCI, &pVS);
+        VERIFY_EXPR(pVS != nullptr);
+    }
+
+    RefCntAutoPtr<IShader> pPS;
+    {
+        ShaderCI.Desc.ShaderType = SHADER_TYPE_PIXEL;
+        ShaderCI.EntryPoint      = "main";
+        ShaderCI.Desc.Name       = "Image blit PS";
+        ShaderCI.FilePath        = "ImageBlit.psh";
+        m_pPipelineStateCache->CreateShader(ShaderCI, &pPS);
+        VERIFY_EXPR(pPS != nullptr);
+    }
+
+    PSOCreateInfo.pVS = pVS;
+    PSOCreateInfo.pPS = pPS;
+
+    PSOCreateInfo.PSODesc.ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC;
+
+    m_pPipelineStateCache->CreateGraphicsPipelineState(PSOCreateInfo, &m_pImageBlitPSO);
+    VERIFY_EXPR(m_pImageBlitPSO != nullptr);
+
+    m_pImageBlitPSO->CreateShaderResourceBinding(&m_pImageBlitSRB, true);
+    VERIFY_EXPR(m_pImageBlitSRB != nullptr);
+}
+
+void Tutorial21_RayTracing::CreateDenoisePSOs()
+{
+    BufferDesc BuffDesc;
+    BuffDesc.Name           = "Denoise constant buffer";
+    BuffDesc.Size           = sizeof(HLSL::DenoiseConstants);
+    BuffDesc.Usage          = USAGE_DYNAMIC;
+    BuffDesc.BindFlags      = BIND_UNIFORM_BUFFER;
+    BuffDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
+
+    m_pDevice->CreateBuffer(BuffDesc, nullptr, &m_DenoiseCB);
+    VERIFY_EXPR(m_DenoiseCB != nullptr);
+
+    ShaderCreateInfo ShaderCI;
+    ShaderCI.SourceLanguage = SHADER_SOURCE_LANGUAGE_HLSL;
+    ShaderCI.ShaderCompiler = SHADER_COMPILER_DXC;
+    ShaderCI.CompileFlags   = SHADER_COMPILE_FLAG_PACK_MATRIX_ROW_MAJOR;
+
+    RefCntAutoPtr<IShaderSourceInputStreamFactory> pShaderSourceFactory;
+    m_pEngineFactory->CreateDefaultShaderSourceStreamFactory(nullptr, &pShaderSourceFactory);
+    ShaderCI.pShaderSourceStreamFactory = pShaderSourceFactory;
+
+    // Both passes are entry points of the same shader file.
+    const auto CreatePSO = [&](const char* Name, const char* EntryPoint, RefCntAutoPtr<IPipelineState>& pPSO, RefCntAutoPtr<IShaderResourceBinding>& pSRB) {
+        ShaderCI.Desc.ShaderType = SHADER_TYPE_COMPUTE;
+        ShaderCI.Desc.Name       = Name;
+        ShaderCI.FilePath        = "Denoise.csh";
+        ShaderCI.EntryPoint      = EntryPoint;
+
+        RefCntAutoPtr<IShader> pCS;
+        m_pPipelineStateCache->CreateShader(ShaderCI, &pCS);
+        VERIFY_EXPR(pCS != nullptr);
+
+        ComputePipelineStateCreateInfo PSOCreateInfo;
+        PSOCreateInfo.PSODesc.Name         = Name;
+        PSOCreateInfo.PSODesc.PipelineType = PIPELINE_TYPE_COMPUTE;
+        PSOCreateInfo.pCS                  = pCS;
+
+        // Textures change with every pass, the constant buffer is the same dynamic buffer.
+        PipelineResourceLayoutDescX ResourceLayout;
+        ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC;
+        ResourceLayout.AddVariable(SHADER_TYPE_COMPUTE, "g_DenoiseCB", SHADER_RESOURCE_VARIABLE_TYPE_STATIC);
+        PSOCreateInfo.PSODesc.ResourceLayout = ResourceLayout;
+
+        m_pPipelineStateCache->CreateComputePipelineState(PSOCreateInfo, &pPSO);
+        VERIFY_EXPR(pPSO != nullptr);
+
+        if (auto* pVar = pPSO->GetStaticVariableByName(SHADER_TYPE_COMPUTE, "g_DenoiseCB"))
+            pVar->Set(m_DenoiseCB);
+
+        pPSO->CreateShaderResourceBinding(&pSRB, true);
+        VERIFY_EXPR(pSRB != nullptr);
+    };
+    CreatePSO("Denoise variance CS", "VarianceMain", m_pDenoiseVariancePSO, m_pDenoiseVarianceSRB);
+    CreatePSO("Denoise filter CS", "FilterMain", m_pDenoiseFilterPSO, m_pDenoiseFilterSRB);
+}
+
+ITexture* Tutorial21_RayTracing::Denoise()
+{
+    const auto&            ColorDesc = m_pColorRT->GetDesc();
+    DispatchComputeAttribs DispatchAttribs{(ColorDesc.Width + 7) / 8, (ColorDesc.Height + 7) / 8, 1};
+
+    // The variance pass reads the traced colors, then every filter pass reads the output of
+    // the previous pass. The filter taps are twice as far apart in every pass.
+    ITexture* pSrc = m_pColorRT;
+    for (Uint32 Pass = 0; Pass <= m_DenoiseSettings.NumPasses; ++Pass)
+    {
+        const bool IsVariancePass = Pass == 0;
+        ITexture*  pDst           = m_pDenoiseRT[Pass % 2];
+
+        IShaderResourceBinding* pSRB = IsVariancePass ? m_pDenoiseVarianceSRB : m_pDenoiseFilterSRB;
+        if (!IsVariancePass)
+        {
+            MapHelper<HLSL::DenoiseConstants> Consts{m_pImmediateContext, m_DenoiseCB, MAP_WRITE, MAP_FLAG_DISCARD};
+            Consts->StepSize       = 1 << (Pass - 1);
+            Consts->DepthSigma     = m_DenoiseSettings.DepthSigma;
+            Consts->NormalPower    = m_DenoiseSettings.NormalPower;
+            Consts->LuminanceSigma = m_DenoiseSettings.LuminanceSigma;
+
+            pSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_Depth")->Set(m_pGBufferDepth->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
+            pSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_Normal")->Set(m_pGBufferNormal->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
+        }
+        pSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_Color")->Set(pSrc->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
+        pSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_ObjectId")->Set(m_pGBufferObjectId->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
+        pSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_Output")->Set(pDst->GetDefaultView(TEXTURE_VIEW_UNORDERED_ACCESS));
+
+        m_pImmediateContext->SetPipelineState(IsVariancePass ? m_pDenoiseVariancePSO : m_pDenoiseFilterPSO);
+        m_pImmediateContext->CommitShaderResources(pSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        m_pImmediateContext->DispatchCompute(DispatchAttribs);
+
+        pSrc = pDst;
+    }
+    return pSrc;
+}
+
+void Tutorial21_RayTracing::RunDenoiseBenchmark()
+{
+    const auto Result = ATrousDenoiser::RunBenchmark(m_DenoiseBenchmarkWidth, m_DenoiseBenchmarkHeight, m_DenoiseSettings);
+    LOG_INFO_MESSAGE("Denoise benchmark: ", Result.Width, "x", Result.Height, ", ", m_DenoiseSettings.NumPasses, " passes in ", Result.FilterMs,
+                     " ms (", Result.Width * Result.Height / (Result.FilterMs * 1000.0), " MPixels/s). RMSE: ", Result.NoisyRMSE,
+                     " noisy, ", Result.FilteredRMSE, " filtered");
+}
+
+void Tutorial21_RayTracing::CreateVariableRatePSOs()
+{
+    BufferDesc BuffDesc;
+    BuffDesc.Name           = "Variable-rate constant buffer";
+    BuffDesc.Size           = sizeof(HLSL::VariableRateConstants);
+    BuffDesc.Usage          = USAGE_DYNAMIC;
+    BuffDesc.BindFlags      = BIND_UNIFORM_BUFFER;
+    BuffDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
+
+    m_pDevice->CreateBuffer(BuffDesc, nullptr, &m_VariableRateCB);
+    VERIFY_EXPR(m_VariableRateCB != nullptr);
+
+    ShaderCreateInfo ShaderCI;
+    ShaderCI.SourceLanguage = SHADER_SOURCE_LANGUAGE_HLSL;
+    ShaderCI.ShaderCompiler = SHADER_COMPILER_DXC;
+    ShaderCI.CompileFlags   = SHADER_COMPILE_FLAG_PACK_MATRIX_ROW_MAJOR;
+
+    RefCntAutoPtr<IShaderSourceInputStreamFactory> pShaderSourceFactory;
+    m_pEngineFactory->CreateDefaultShaderSourceStreamFactory(nullptr, &pShaderSourceFactory);
+    ShaderCI.pShaderSourceStreamFactory = pShaderSourceFactory;
+
+    // Both passes are entry points of the same shader file.
+    const auto CreatePSO = [&](const char* Name, const char* EntryPoint, RefCntAutoPtr<IPipelineState>& pPSO, RefCntAutoPtr<IShaderResourceBinding>& pSRB) {
+        ShaderCI.Desc.ShaderType = SHADER_TYPE_COMPUTE;
+        ShaderCI.Desc.Name       = Name;
+        ShaderCI.FilePath        = "VariableRate.csh";
+        ShaderCI.EntryPoint      = EntryPoint;
+
+        RefCntAutoPtr<IShader> pCS;
+        m_pPipelineStateCache->CreateShader(ShaderCI, &pCS);
+        VERIFY_EXPR(pCS != nullptr);
+
+        ComputePipelineStateCreateInfo PSOCreateInfo;
+        PSOCreateInfo.PSODesc.Name         = Name;
+        PSOCreateInfo.PSODesc.PipelineType = PIPELINE_TYPE_COMPUTE;
+        PSOCreateInfo.pCS                  = pCS;
+
+        // Textures are recreated when the window is resized, constant buffers are the same.
+        PipelineResourceLayoutDescX ResourceLayout;
+        ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC;
+        ResourceLayout
+            .AddVariable(SHADER_TYPE_COMPUTE, "g_FrameCB", SHADER_RESOURCE_VARIABLE_TYPE_STATIC)
+            .AddVariable(SHADER_TYPE_COMPUTE, "g_VariableRateCB", SHADER_RESOURCE_VARIABLE_TYPE_STATIC);
+        PSOCreateInfo.PSODesc.ResourceLayout = ResourceLayout;
+
+        m_pPipelineStateCache->CreateComputePipelineState(PSOCreateInfo, &pPSO);
+        VERIFY_EXPR(pPSO != nullptr);
+
+        if (auto* pVar = pPSO->GetStaticVariableByName(SHADER_TYPE_COMPUTE, "g_FrameCB"))
+            pVar->Set(m_FrameCB);
+        if (auto* pVar = pPSO->GetStaticVariableByName(SHADER_TYPE_COMPUTE, "g_VariableRateCB"))
+            pVar->Set(m_VariableRateCB);
+
+        pPSO->CreateShaderResourceBinding(&pSRB, true);
+        VERIFY_EXPR(pSRB != nullptr);
+    };
+    CreatePSO("Variable-rate classification CS", "ClassifyMain", m_pVRTClassifyPSO, m_pVRTClassifySRB);
+    CreatePSO("Variable-rate fill CS", "FillMain", m_pVRTFillPSO, m_pVRTFillSRB);
+}
+
+void Tutorial21_RayTracing::ClassifyTiles()
+{
+    {
+        MapHelper<HLSL::VariableRateConstants> Consts{m_pImmediateContext, m_VariableRateCB, MAP_WRITE, MAP_FLAG_DISCARD};
+        Consts->MaxDepthRatio   = m_VariableRateSettings.MaxDepthRatio;
+        Consts->MinNormalCosine = m_VariableRateSettings.MinNormalCosine;
+        Consts->MaxRate         = m_VariableRateSettings.MaxRate;
+    }
+
+    m_pVRTClassifySRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_Depth")->Set(m_pGBufferDepth->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
+    m_pVRTClassifySRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_Normal")->Set(m_pGBufferNormal->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
+    m_pVRTClassifySRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_ObjectId")->Set(m_pGBufferObjectId->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
+    m_pVRTClassifySRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_ClassifiedTileRates")->Set(m_pTileRates->GetDefaultView(TEXTURE_VIEW_UNORDERED_ACCESS));
+
+    m_pImmediateContext->SetPipelineState(m_pVRTClassifyPSO);
+    m_pImmediateContext->CommitShaderResources(m_pVRTClassifySRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+    // One thread per tile.
+    const auto& TileDesc = m_pTileRates->GetDesc();
+    m_pImmediateContext->DispatchCompute(DispatchComputeAttribs{(TileDesc.Width + 7) / 8, (TileDesc.Height + 7) / 8, 1});
+}
+
+void Tutorial21_RayTracing::FillSkippedPixels()
+{
+    m_pVRTFillSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_TileRates")->Set(m_pTileRates->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
+    m_pVRTFillSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_ColorBuffer")->Set(m_pColorRT->GetDefaultView(TEXTURE_VIEW_UNORDERED_ACCESS));
+    m_pVRTFillSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_AccumBuffer")->Set(m_pAccumRT->GetDefaultView(TEXTURE_VIEW_UNORDERED_ACCESS));
+    m_pVRTFillSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_GBufferDepth")->Set(m_pGBufferDepth->GetDefaultView(TEXTURE_VIEW_UNORDERED_ACCESS));
+    m_pVRTFillSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_GBufferNormal")->Set(m_pGBufferNormal->GetDefaultView(TEXTURE_VIEW_UNORDERED_ACCESS));
+    m_pVRTFillSRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_GBufferObjectId")->Set(m_pGBufferObjectId->GetDefaultView(TEXTURE_VIEW_UNORDERED_ACCESS));
+
+    m_pImmediateContext->SetPipelineState(m_pVRTFillPSO);
+    m_pImmediateContext->CommitShaderResources(m_pVRTFillSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+    // One thread group per tile.
+    const auto& TileDesc = m_pTileRates->GetDesc();
+    m_pImmediateContext->DispatchCompute(DispatchComputeAttribs{TileDesc.Width, TileDesc.Height, 1});
+}
+
+void Tutorial21_RayTracing::RunVariableRateBenchmark()
+{
+    const Uint32 Width     = m_VariableRateBenchmarkWidth;
+    const Uint32 Height    = m_VariableRateBenchmarkHeight;
+    const size_t NumPixels = size_t{Width} * Height;
+
+    const SoftwareTracer Tracer{CreateTracerScene(Width, Height)};
+
+    // The full-rate image of the current view is the reference, and its G-buffer stands in for
+    // the previous frame, as it would with a static camera.
+    std::vector<float4> Reference(NumPixels);
+    std::vector<float>  Depth(NumPixels);
+    std::vector<float4> Normals(NumPixels);
+    std::vector<Uint32> ObjectIds(NumPixels);
+    Tracer.Render(Width, Height, Reference.data());
+    Tracer.RenderGBuffer(Width, Height, Depth.data(), Normals.data(), ObjectIds.data());
+
+    using Clock         = std::chrono::high_resolution_clock;
+    const auto ElapsedMs = [](Clock::time_point Start) { return std::chrono::duration<double, std::milli>(Clock::now() - Start).count(); };
+
+    VariableRateTracing VRT;
+    auto                StartTime = Clock::now();
+    VRT.Classify(Depth.data(), Normals.data(), ObjectIds.data(), Width, Height, m_VariableRateSettings);
+    const double ClassifyMs = ElapsedMs(StartTime);
+
+    // The traced pixels move every frame, so every frame of the pattern cycle is filled from the
+    // traced pixels of the reference and compared with it.
+    constexpr Uint32    NumFrames = 4;
+    Uint64              NumTraced = 0;
+    double              FillMs    = 0;
+    double              SqError   = 0;
+    std::vector<float4> Color;
+    std::vector<float>  FrameDepth;
+    std::vector<float4> FrameNormals;
+    std::vector<Uint32> FrameObjectIds;
+    for (Uint32 Frame = 0; Frame < NumFrames; ++Frame)
+    {
+        Color          = Reference;
+        FrameDepth     = Depth;
+        FrameNormals   = Normals;
+        FrameObjectIds = ObjectIds;
+        NumTraced += VRT.CountTracedPixels(Frame);
+
+        StartTime = Clock::now();
+        VRT.Fill(Color.data(), FrameDepth.data(), FrameNormals.data(), FrameObjectIds.data(), Frame);
+        FillMs += ElapsedMs(StartTime);
+
+        for (size_t i = 0; i < NumPixels; ++i)
+        {
+            const float3 Diff = float3{Color[i].x, Color[i].y, Color[i].z} - float3{Reference[i].x, Reference[i].y, Reference[i].z};
+            SqError += dot(Diff, Diff);
+        }
+    }
+
+    const double RaysPerFrame = static_cast<double>(NumTraced) / NumFrames;
+    LOG_INFO_MESSAGE("Variable-rate benchmark: ", Width, "x", Height, ", tiles: ", VRT.CountTiles(VRT_RATE_FULL), " full, ", VRT.CountTiles(VRT_RATE_HALF),
+                     " half, ", VRT.CountTiles(VRT_RATE_QUARTER), " quarter rate. Primary rays per frame: ", RaysPerFrame, " of ", NumPixels, ", ",
+                     NumPixels - RaysPerFrame, " saved (", 100.0 * (1.0 - RaysPerFrame / NumPixels), "%). Classified in ", ClassifyMs,
+                     " ms, filled in ", FillMs / NumFrames, " ms per frame. Fill RMSE: ", std::sqrt(SqError / (3.0 * NumPixels * NumFrames)));
+}
+
+void Tutorial21_RayTracing::ProcessReadbackFrame(const FrameReadback::Frame& Frame)
+{
+    // The sample has no encoder: frames are converted into the input of an 8-bit image encoder,
+    // or of a video encoder for YCbCr frames, which is where a recorder would take them over.
+    const auto   StartTime = std::chrono::high_resolution_clock::now();
+    const size_t NumPixels = size_t{Frame.Width} * Frame.Height;
+    switch (Frame.Format)
+    {
+        case READBACK_FORMAT_NATIVE:
+            if (Frame.TexFormat == TEX_FORMAT_RGBA8_UNORM)
+            {
+                m_EncoderInput.resize(NumPixels * 4);
+                ConvertLinearRGBA8ToSRGB8(Frame.pData, Frame.Stride, Frame.Width, Frame.Height, m_EncoderInput.data(), size_t{Frame.Width} * 4);
+            }
+            else
+            {
+                // Float colors of the denoiser are passed on as they are, e.g. to an HDR encoder.
+                m_EncoderInput.assign(Frame.pData, Frame.pData + Frame.Size);
+            }
+            break;
+
+        case READBACK_FORMAT_RGB10A2:
+            m_EncoderInput.resize(NumPixels * 4);
+            ConvertRGB10A2ToRGBA8(reinterpret_cast<const Uint32*>(Frame.pData), NumPixels, m_EncoderInput.data());
+            break;
+
+        default:
+            // sRGB RGBA8 and YCbCr frames are packed in the encoder format by the GPU.
+            m_EncoderInput.assign(Frame.pData, Frame.pData + Frame.Size);
+    }
+
+    m_ReadbackConvertMs     = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - StartTime).count();
+    m_ReadbackBytesPerPixel = static_cast<float>(Frame.Size) / static_cast<float>(NumPixels);
+}
+
+void Tutorial21_RayTracing::RunReadbackBenchmark()
+{
+    const auto Result = RunFramePackingBenchmark(m_ReadbackBenchmarkWidth, m_ReadbackBenchmarkHeight);
+    LOG_INFO_MESSAGE("Readback benchmark: ", Result.Width, "x", Result.Height, ". Linear to sRGB ", Result.LinearToSRGBMs,
+                     " ms, RGB10A2 to RGBA8 ", Result.RGB10A2ScalarMs, " ms scalar, ", Result.RGB10A2SIMDMs, " ms SIMD, RGBA8 to YCbCr 4:2:0 ",
+                     Result.YCbCr420ScalarMs, " ms scalar, ", Result.YCbCr420SIMDMs, " ms SIMD. YCbCr round trip RMSE: ", Result.YCbCr420RMSE);
+    if (!Result.SIMDMatchesScalar)
+        LOG_ERROR_MESSAGE("SIMD frame packing does not match the scalar path");
+}
+
+RefCntAutoPtr<IPipelineState> Tutorial21_RayTracing::CreateRayTracingPSO(Int32 MaxRecursion, Int32 ShadowPCF, Int32 Dispersion)
+{
+    // Prepare ray tracing pipeline description.
+    RayTracingPipelineStateCreateInfoX PSOCreateInfo;
+
+    const std::string PSOName = "Ray tracing PSO (recursion " + std::to_string(MaxRecursion) + ", PCF " + std::to_string(ShadowPCF) +
+        ", dispersion " + std::to_string(Dispersion) + ")";
+    PSOCreateInfo.PSODesc.Name         = PSOName.c_str();
+    PSOCreateInfo.PSODesc.PipelineType = PIPELINE_TYPE_RAY_TRACING;
+
+    // Define shader macros. Settings equal to SETTING_NOT_SPECIALIZED are read from g_ConstantsCB.
+    ShaderMacroHelper Macros;
+    Macros.AddShaderMacro("NUM_TEXTURES", NumTextures);
+    Macros.AddShaderMacro("SPECIALIZED_MAX_RECURSION", MaxRecursion);
+    Macros.AddShaderMacro("SPECIALIZED_SHADOW_PCF", ShadowPCF);
+    Macros.AddShaderMacro("SPECIALIZED_DISPERSION", Dispersion);
+
+    ShaderCreateInfo ShaderCI;
+    // We will not be using combined texture samplers as they
+    // are only required for compatibility with OpenGL, and ray
+    // tracing is not supported in OpenGL backend.
+    ShaderCI.Desc.UseCombinedTextureSamplers = false;
+
+    ShaderCI.Macros = Macros;
+
+    // Only new DXC compiler can compile HLSL ray tracing shaders.
+    ShaderCI.ShaderCompiler = SHADER_COMPILER_DXC;
+
+    // Use row-major matrices.
+    ShaderCI.CompileFlags = SHADER_COMPILE_FLAG_PACK_MATRIX_ROW_MAJOR;
+
+    // Shader model 6.3 is required for DXR 1.0, shader model 6.5 is required for DXR 1.1 and enables additional features.
+    // Use 6.3 for compatibility with DXR 1.0 and VK_NV_ray_tracing.
+    ShaderCI.HLSLVersion    = {6, 3};
+    ShaderCI.SourceLanguage = SHADER_SOURCE_LANGUAGE_HLSL;
+
+    // Create a shader source stream factory to load shaders from files.
+    RefCntAutoPtr<IShaderSourceInputStreamFactory> pShaderSourceFactory;
+    m_pEngineFactory->CreateDefaultShaderSourceStreamFactory(nullptr, &pShaderSourceFactory);
+    ShaderCI.pShaderSourceStreamFactory = pShaderSourceFactory;
+
+    // Create ray generation shader.
+    RefCntAutoPtr<IShader> pRayGen;
+    {
+        ShaderCI.Desc.ShaderType = SHADER_TYPE_RAY_GEN;
+        ShaderCI.Desc.Name       = "Ray tracing RG";
+        ShaderCI.FilePath        = "RayTrace.rgen";
+        ShaderCI.EntryPoint      = "main";
+        m_pPipelineStateCache->CreateShader(ShaderCI, &pRayGen);
+        VERIFY_EXPR(pRayGen != nullptr);
+    }
+
+    // Create miss shaders.
+    RefCntAutoPtr<IShader> pPrimaryMiss, pShadowMiss;
+    {
+        ShaderCI.Desc.ShaderType = SHADER_TYPE_RAY_MISS;
+        ShaderCI.Desc.Name       = "Primary ray miss shader";
+        ShaderCI.FilePath        = "PrimaryMiss.rmiss";
+        ShaderCI.EntryPoint      = "main";
+        m_pPipelineStateCache->CreateShader(ShaderCI, &pPrimaryMiss);
+        VERIFY_EXPR(pPrimaryMiss != nullptr);
+
+        ShaderCI.Desc.Name  = "Shadow ray miss shader";
+        ShaderCI.FilePath   = "ShadowMiss.rmiss";
+        ShaderCI.EntryPoint = "main";
+        m_pPipelineStateCache->CreateShader(ShaderCI, &pShadowMiss);
+        VERIFY_EXPR(pShadowMiss != nullptr);
+    }
+
+    // Create closest hit shaders.
+    RefCntAutoPtr<IShader> pCubePrimaryHit, pGroundHit, pGlassPrimaryHit, pSpherePrimaryHit, hitSphereDiffuse, hitSphereGlass;
+    ;
+    {
+        ShaderCI.Desc.ShaderType = SHADER_TYPE_RAY_CLOSEST_HIT;
+        ShaderCI.Desc.Name       = "Cube primary ray closest hit shader";
+        ShaderCI.FilePath        = "CubePrimaryHit.rchit";
+        ShaderCI.EntryPoint      = "main";
+        m_pPipelineStateCache->CreateShader(ShaderCI, &pCubePrimaryHit);
+        VERIFY_EXPR(pCubePrimaryHit != nullptr);
+
+        ShaderCI.Desc.Name  = "Ground primary ray closest hit shader";
+        ShaderCI.FilePath   = "Ground.rchit";
+        ShaderCI.EntryPoint = "main";
+        m_pPipelineStateCache->CreateShader(ShaderCI, &pGroundHit);
+        VERIFY_EXPR(pGroundHit != nullptr);
+
+        ShaderCI.Desc.Name  = "Glass primary ray closest hit shader";
+        ShaderCI.FilePath   = "GlassPrimaryHit.rchit";
+        ShaderCI.EntryPoint = "main";
+        m_pPipelineStateCache->CreateShader(ShaderCI, &pGlassPrimaryHit);
+        VERIFY_EXPR(pGlassPrimaryHit != nullptr);
+
+        ShaderCI.Desc.Name  = "Sphere primary ray closest hit shader";
+        ShaderCI.FilePath   = "SpherePrimaryHit.rchit";
+        ShaderCI.EntryPoint = "main";
+        m_pPipelineStateCache->CreateShader(ShaderCI, &pSpherePrimaryHit);
+        VERIFY_EXPR(pSpherePrimaryHit != nullptr);
+
+        
+        ShaderCI.Desc.Name  = "Sphere primary ray closest hit diffuse shader";
+        ShaderCI.FilePath   = "SphereDiffuseHit.rchit";
+        ShaderCI.EntryPoint = "main";
+        m_pPipelineStateCache->CreateShader(ShaderCI, &hitSphereDiffuse);
+        VERIFY_EXPR(hitSphereDiffuse!= nullptr);
+
+        ShaderCI.Desc.Name  = "Sphere primary ray closest hit glass shader";
+        ShaderCI.FilePath   = "SphereGlassHit.rchit";
+        ShaderCI.EntryPoint = "main";
+        m_pPipelineStateCache->CreateShader(ShaderCI, &hitSphereGlass);
+        VERIFY_EXPR(hitSphereGlass != nullptr);
+
+
+    }
+
+    // Create intersection shader for a procedural sphere.
+    RefCntAutoPtr<IShader> pSphereIntersection;
+    {
+        ShaderCI.Desc.ShaderType = SHADER_TYPE_RAY_INTERSECTION;
+        ShaderCI.Desc.Name       = "Sphere intersection shader";
+        ShaderCI.FilePath        = "SphereIntersection.rint";
+        ShaderCI.EntryPoint      = "main";
+        m_pPipelineStateCache->CreateShader(ShaderCI, &pSphereIntersection);
+        VERIFY_EXPR(pSphereIntersection != nullptr);
+    }
+
+    // Setup shader groups
+
+    // Ray generation shader is an entry point for a ray tracing pipeline.
+    PSOCreateInfo.AddGeneralShader("Main", pRayGen);
+    // Primary ray miss shader.
+    PSOCreateInfo.AddGeneralShader("PrimaryMiss", pPrimaryMiss);
+    // Shadow ray miss shader.
+    PSOCreateInfo.AddGeneralShader("ShadowMiss", pShadowMiss);
+
+    // Primary ray hit group for the textured cube.
+    PSOCreateInfo.AddTriangleHitShader("CubePrimaryHit", pCubePrimaryHit);
+    // Primary ray hit group for the ground.
+    PSOCreateInfo.AddTriangleHitShader("GroundHit", pGroundHit);
+    // Primary ray hit group for the glass cube.
+    PSOCreateInfo.AddTriangleHitShader("GlassPrimaryHit", pGlassPrimaryHit);
+
+    // Intersection and closest hit shaders for the procedural sphere.
+    PSOCreateInfo.AddProceduralHitShader("SpherePrimaryHit", pSphereIntersection, pSpherePrimaryHit);
+
+    PSOCreateInfo.AddProceduralHitShader("SpherePrimaryDiffuseHit", pSphereIntersection, hitSphereDiffuse);
+    PSOCreateInfo.AddProceduralHitShader("SphereGlassHit", pSphereIntersection, hitSphereGlass);
+
+    // Only intersection shader is needed for shadows.
+    PSOCreateInfo.AddProceduralHitShader("SphereShadowHit", pSphereIntersection);
+
+    // Specify the maximum ray recursion depth.
+    // WARNING: the driver does not track the recursion depth and it is the
+    //          application's responsibility to not exceed the specified limit.
+    //          The value is used to reserve the necessary stack size and
+    //          exceeding it will likely result in driver crash.
+    //          Specialized pipelines only reserve the stack for their recursion depth.
+    PSOCreateInfo.RayTracingPipeline.MaxRecursionDepth = static_cast<Uint8>(MaxRecursion != SETTING_NOT_SPECIALIZED ? MaxRecursion : m_MaxRecursionDepth);
+
+    // Per-shader data is not used.
+    PSOCreateInfo.RayTracingPipeline.ShaderRecordSize = 0;
+
+    // DirectX 12 only: set attribute and payload size. Values should be as small as possible to minimize the memory usage.
+    PSOCreateInfo.MaxAttributeSize = std::max<Uint32>(sizeof(/*BuiltInTriangleIntersectionAttributes*/ float2), sizeof(HLSL::ProceduralGeomIntersectionAttribs));
+    PSOCreateInfo.MaxPayloadSize   = std::max<Uint32>(sizeof(HLSL::PrimaryRayPayload), sizeof(HLSL::ShadowRayPayload));
+
+    // Define immutable sampler for g_Texture and g_GroundTexture. Immutable samplers should be used whenever possible
+    SamplerDesc SamLinearWrapDesc{
+        FILTER_TYPE_LINEAR, FILTER_TYPE_LINEAR, FILTER_TYPE_LINEAR,
+        TEXTURE_ADDRESS_WRAP, TEXTURE_ADDRESS_WRAP, TEXTURE_ADDRESS_WRAP //
+    };
+
+    PipelineResourceLayoutDescX ResourceLayout;
+    ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE;
+    ResourceLayout.AddImmutableSampler(SHADER_TYPE_RAY_CLOSEST_HIT, "g_SamLinearWrap", SamLinearWrapDesc);
+    ResourceLayout
+        .AddVariable(SHADER_TYPE_RAY_GEN | SHADER_TYPE_RAY_MISS | SHADER_TYPE_RAY_CLOSEST_HIT, "g_ConstantsCB", SHADER_RESOURCE_VARIABLE_TYPE_STATIC)
+        .AddVariable(SHADER_TYPE_RAY_GEN | SHADER_TYPE_RAY_CLOSEST_HIT, "g_FrameCB", SHADER_RESOURCE_VARIABLE_TYPE_STATIC)
+        .AddVariable(SHADER_TYPE_RAY_GEN, "g_ColorBuffer", SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC)
+        .AddVariable(SHADER_TYPE_RAY_GEN, "g_AccumBuffer", SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC)
+        .AddVariable(SHADER_TYPE_RAY_GEN, "g_GBufferDepth", SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC)
+        .AddVariable(SHADER_TYPE_RAY_GEN, "g_TileRates", SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC)
+        .AddVariable(SHADER_TYPE_RAY_MISS | SHADER_TYPE_RAY_CLOSEST_HIT, "g_GBufferNormal", SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC)
+        .AddVariable(SHADER_TYPE_RAY_MISS | SHADER_TYPE_RAY_CLOSEST_HIT, "g_GBufferObjectId", SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC)
+        // TLAS is double-buffered and changes every frame.
+        .AddVariable(SHADER_TYPE_RAY_GEN | SHADER_TYPE_RAY_CLOSEST_HIT, "g_TLAS", SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC)
+        .AddVariable(SHADER_TYPE_RAY_CLOSEST_HIT, "g_InstanceObjectIds", SHADER_RESOURCE_VARIABLE_TYPE_DYNAMIC);
+
+    PSOCreateInfo.PSODesc.ResourceLayout = ResourceLayout;
+
+    RefCntAutoPtr<IPipelineState> pPSO;
+    m_pPipelineStateCache->CreateRayTracingPipelineState(PSOCreateInfo, &pPSO);
+    VERIFY_EXPR(pPSO != nullptr);
+
+    pPSO->GetStaticVariableByName(SHADER_TYPE_RAY_GEN, "g_ConstantsCB")->Set(m_ConstantsCB);
+    pPSO->GetStaticVariableByName(SHADER_TYPE_RAY_MISS, "g_ConstantsCB")->Set(m_ConstantsCB);
+    pPSO->GetStaticVariableByName(SHADER_TYPE_RAY_CLOSEST_HIT, "g_ConstantsCB")->Set(m_ConstantsCB);
+    pPSO->GetStaticVariableByName(SHADER_TYPE_RAY_GEN, "g_FrameCB")->Set(m_FrameCB);
+    pPSO->GetStaticVariableByName(SHADER_TYPE_RAY_CLOSEST_HIT, "g_FrameCB")->Set(m_FrameCB);
+
+    return pPSO;
+}
+
+void Tutorial21_RayTracing::SelectRayTracingPipeline()
+{
+    const Int32  MaxRecursion = m_SpecializePipelines ? m_Constants.MaxRecursion : SETTING_NOT_SPECIALIZED;
+    const Int32  ShadowPCF    = m_SpecializePipelines ? m_Constants.ShadowPCF : SETTING_NOT_SPECIALIZED;
+    const Int32  Dispersion   = m_SpecializePipelines ? m_Constants.GlassEnableDispersion : SETTING_NOT_SPECIALIZED;
+    const Uint64 Key          = GetRayTracingPipelineKey(MaxRecursion, ShadowPCF, Dispersion);
+
+    auto it = m_RayTracingPipelines.find(Key);
+    if (it == m_RayTracingPipelines.end())
+    {
+        // Variants are created the first time their settings are selected. Shaders compiled
+        // during previous launches are taken from the pipeline state cache.
+        RayTracingPipeline Pipeline;
+        Pipeline.pPSO = CreateRayTracingPSO(MaxRecursion, ShadowPCF, Dispersion);
+        VERIFY(Pipeline.pPSO->IsCompatibleWith(m_RayTracingPipelines.at(GetRayTracingPipelineKey(SETTING_NOT_SPECIALIZED, SETTING_NOT_SPECIALIZED, SETTING_NOT_SPECIALIZED)).pPSO),
+               "All variants must use the same resources so that they can share the SRB");
+        Pipeline.pSBT = CreateSBT(Pipeline.pPSO);
+
+        // Writing the cache file would stall the frame, so new variants are stored when the sample exits.
+        it = m_RayTracingPipelines.emplace(Key, std::move(Pipeline)).first;
+    }
+    else if (!it->second.pSBT)
+    {
+        // Instance materials have changed since the variant was last used, see ApplySceneEdits().
+        it->second.pSBT = CreateSBT(it->second.pPSO);
+    }
+
+    m_pRayTracingPSO = it->second.pPSO;
+    m_pSBT           = it->second.pSBT;
+}
+
+void Tutorial21_RayTracing::LoadTextures()
+{
+    struct TextureJob
+    {
+        Uint32          ChunkId = 0;
+        std::string     FileName;
+        TextureLoadInfo LoadInfo;
+
+        RefCntAutoPtr<ITextureLoader> pLoader;
+        std::vector<Uint8>            CacheData;
+        RefCntAutoPtr<ITexture>       pTexture;
+    };
+
+    // Cube textures followed by the ground texture.
+    std::vector<TextureJob> Jobs(NumTextures + 1);
+    for (int tex = 0; tex < NumTextures; ++tex)
+    {
+        Jobs[tex].ChunkId         = SCENE_CHUNK_CUBE_TEXTURE0 + tex;
+        Jobs[tex].FileName        = GetCubeTextureFileName(tex);
+        Jobs[tex].LoadInfo.IsSRGB = true;
+    }
+    Jobs[NumTextures].ChunkId  = SCENE_CHUNK_GROUND_TEXTURE;
+    Jobs[NumTextures].FileName = GroundTextureFileName;
+
+    // Textures found in the scene cache are created from the mapped data and need no decoding.
+    for (auto& Job : Jobs)
+        Job.pTexture = LoadCachedTexture(Job.ChunkId, Job.FileName.c_str());
+
+    // Decode images and generate the full mip chain of every texture on worker threads.
+    // Data for the scene cache is serialized there as well.
+    const bool WriteCache = m_pSceneCacheWriter != nullptr;
+    ParallelFor(static_cast<Uint32>(Jobs.size()), [&](Uint32 i) {
+        auto& Job = Jobs[i];
+        if (Job.pTexture)
+            return;
+
+        Job.LoadInfo.Name         = Job.FileName.c_str();
+        Job.LoadInfo.GenerateMips = true;
+        CreateTextureLoaderFromFile(Job.FileName.c_str(), IMAGE_FILE_FORMAT_UNKNOWN, Job.LoadInfo, &Job.pLoader);
+        if (Job.pLoader && WriteCache)
+            Job.CacheData = SerializeTexture(Job.pLoader);
+    });
+
+    // A texture that failed to load is replaced by a 1x1 gray texture, so that every shader
+    // variable is bound and the scene is still rendered.
+    const auto CreateFallbackTexture = [&](const TextureJob& Job) {
+        TextureDesc TexDesc;
+        TexDesc.Name      = Job.FileName.c_str();
+        TexDesc.Type      = RESOURCE_DIM_TEX_2D;
+        TexDesc.Width     = 1;
+        TexDesc.Height    = 1;
+        TexDesc.Format    = Job.LoadInfo.IsSRGB ? TEX_FORMAT_RGBA8_UNORM_SRGB : TEX_FORMAT_RGBA8_UNORM;
+        TexDesc.Usage     = USAGE_IMMUTABLE;
+        TexDesc.BindFlags = BIND_SHADER_RESOURCE;
+
+        const Uint8       Gray[4] = {128, 128, 128, 255};
+        TextureSubResData Level0{Gray, sizeof(Gray)};
+        TextureData       InitData{&Level0, 1};
+
+        RefCntAutoPtr<ITexture> pTexture;
+        m_pDevice->CreateTexture(TexDesc, &InitData, &pTexture);
+        VERIFY_EXPR(pTexture != nullptr);
+        return pTexture;
+    };
+
+    // Create textures on this thread and transition all of them with one barrier.
+    std::vector<StateTransitionDesc> Barriers;
+    Barriers.reserve(Jobs.size());
+    for (auto& Job : Jobs)
+    {
+        if (!Job.pTexture && !Job.pLoader)
+        {
+            LOG_ERROR_MESSAGE("Failed to load texture '", Job.FileName, "'. A gray texture is used instead.");
+            Job.pTexture = CreateFallbackTexture(Job);
+        }
+        else if (!Job.pTexture)
+        {
+            Job.pLoader->CreateTexture(m_pDevice, &Job.pTexture);
+            VERIFY_EXPR(Job.pTexture != nullptr);
+            Job.pLoader.Release();
+
+            if (!Job.CacheData.empty())
+                m_pSceneCacheWriter->AddChunk(Job.ChunkId, std::move(Job.CacheData));
+        }
+        Barriers.emplace_back(Job.pTexture, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, STATE_TRANSITION_FLAG_UPDATE_STATE);
+    }
+    m_pImmediateContext->TransitionResourceStates(static_cast<Uint32>(Barriers.size()), Barriers.data());
+
+    IDeviceObject* pTexSRVs[NumTextures] = {};
+    for (int tex = 0; tex < NumTextures; ++tex)
+        pTexSRVs[tex] = Jobs[tex].pTexture->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
+    m_pRayTracingSRB->GetVariableByName(SHADER_TYPE_RAY_CLOSEST_HIT, "g_CubeTextures")->SetArray(pTexSRVs, 0, NumTextures);
+
+    m_pRayTracingSRB->GetVariableByName(SHADER_TYPE_RAY_CLOSEST_HIT, "g_GroundTexture")->Set(Jobs[NumTextures].pTexture->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
+}
+
+void Tutorial21_RayTracing::LoadSceneMeshes()
+{
+    constexpr float CubeSizes[] = {2.f, 0.5f};
+    static_assert(_countof(CubeSizes) == std::tuple_size<decltype(m_CubeMeshData)>::value, "Not all cube meshes are created");
+    for (Uint32 c = 0; c < _countof(CubeSizes); ++c)
+    {
+        LoadSceneMesh(SCENE_CHUNK_CUBE_MESH0 + c, m_CubeMeshData[c], [&](MeshData& Mesh) {
+            RefCntAutoPtr<IDataBlob> pCubeVerts;
+            RefCntAutoPtr<IDataBlob> pCubeIndices;
+            GeometryPrimitiveInfo    CubeGeoInfo;
+            CreateGeometryPrimitive(CubeGeometryPrimitiveAttributes{CubeSizes[c], GEOMETRY_PRIMITIVE_VERTEX_FLAG_ALL}, &pCubeVerts, &pCubeIndices, &CubeGeoInfo);
+
+            VERIFY_EXPR(CubeGeoInfo.VertexSize == sizeof(MeshVertex));
+            const auto* pVerts   = pCubeVerts->GetConstDataPtr<MeshVertex>();
+            const auto* pIndices = pCubeIndices->GetConstDataPtr<Uint32>();
+            Mesh.SetData({pVerts, pVerts + CubeGeoInfo.NumVertices}, {pIndices, pIndices + CubeGeoInfo.NumIndices});
+            return true;
+        });
+    }
+
+    const MeshData& Cube      = m_CubeMeshData[0];
+    const MeshData& SmallCube = m_CubeMeshData[1];
+    m_pQueryCubeGeometry      = SceneQuery::CreateTriangleGeometry(Cube.GetVertices(), Cube.GetNumVertices(), Cube.GetIndices(), Cube.GetNumIndices());
+    m_pQuerySmallCubeGeometry = SceneQuery::CreateTriangleGeometry(SmallCube.GetVertices(), SmallCube.GetNumVertices(), SmallCube.GetIndices(), SmallCube.GetNumIndices());
+
+    // The CPU renderer needs normals as well, so it keeps its own copies of the meshes.
+    m_TracerMeshes.resize(TRACER_MESH_LOADED);
+    for (Uint32 c = 0; c < 2; ++c)
+    {
+        auto& Mesh = m_TracerMeshes[c == 0 ? TRACER_MESH_CUBE : TRACER_MESH_SMALL_CUBE];
+        Mesh.Vertices.assign(m_CubeMeshData[c].GetVertices(), m_CubeMeshData[c].GetVertices() + m_CubeMeshData[c].GetNumVertices());
+        Mesh.Indices.assign(m_CubeMeshData[c].GetIndices(), m_CubeMeshData[c].GetIndices() + m_CubeMeshData[c].GetNumIndices());
+    }
+
+    // Optional mesh given on the command line. A binary mesh is used directly from the mapped file.
+    if (!m_MeshPath.empty())
+    {
+        MeshData& Mesh = m_LoadedMeshData;
+        if (LoadSceneMesh(SCENE_CHUNK_LOADED_MESH, Mesh, [&](MeshData& M) { return LoadMesh(m_MeshPath.c_str(), M); }))
+        {
+            m_pQueryLoadedMeshGeometry = SceneQuery::CreateTriangleGeometry(Mesh.GetVertices(), Mesh.GetNumVertices(), Mesh.GetIndices(), Mesh.GetNumIndices());
+
+            m_TracerMeshes.resize(TRACER_MESH_LOADED + 1);
+            m_TracerMeshes[TRACER_MESH_LOADED].Vertices.assign(Mesh.GetVertices(), Mesh.GetVertices() + Mesh.GetNumVertices());
+            m_TracerMeshes[TRACER_MESH_LOADED].Indices.assign(Mesh.GetIndices(), Mesh.GetIndices() + Mesh.GetNumIndices());
+
+            // Fit the mesh into a 3-unit box standing on the ground.
+            const float3 Extent = Mesh.GetBoundsMax() - Mesh.GetBoundsMin();
+            const float  Scale  = 3.f / std::max(std::max(Extent.x, Extent.y), std::max(Extent.z, 1e-6f));
+            const float3 Center = (Mesh.GetBoundsMin() + Mesh.GetBoundsMax()) * 0.5f;
+            m_LoadedMeshTransform.SetRotation(float3x3::Scale(Scale, Scale, Scale).Data());
+            m_LoadedMeshTransform.SetTranslation(-Center.x * Scale, -5.9f - Mesh.GetBoundsMin().y * Scale, 3.f - Center.z * Scale);
+            m_LoadedMeshBoundsMin = Mesh.GetBoundsMin();
+            m_LoadedMeshBoundsMax = Mesh.GetBoundsMax();
+
+            LOG_INFO_MESSAGE("Loaded mesh '", m_MeshPath, "': ", Mesh.GetNumVertices(), " vertices, ", Mesh.GetNumIndices() / 3, " triangles");
+        }
+    }
+}
+
+void Tutorial21_RayTracing::CreateMeshBLASes()
+{
+    static_assert(sizeof(HLSL::MeshAttribs) == sizeof(MeshAttribsPool::Mesh), "MeshAttribs layout mismatch");
+    static_assert(sizeof(HLSL::MeshVertexAttribs) == sizeof(MeshAttribsPool::Vertex), "MeshVertexAttribs layout mismatch");
+
+    // All triangle meshes are built in one batch: geometry is packed into shared buffers,
+    // scratch memory is reserved once and all builds are recorded between two barriers.
+    // Shading attributes of all meshes go to shared structured buffers.
+    BLASBatchBuilder BatchBuilder{m_pDevice, m_ASContextMask};
+    MeshAttribsPool  AttribsPool;
+
+    const auto AddMesh = [&](const char* Name, const MeshVertex* pVertices, Uint32 NumVertices, const Uint32* pIndices, Uint32 NumIndices) {
+        BLASBatchBuilder::TriangleMeshDesc MeshDesc;
+        MeshDesc.Name           = Name;
+        MeshDesc.pVertices      = pVertices;
+        MeshDesc.VertexStride   = sizeof(MeshVertex);
+        MeshDesc.PositionOffset = offsetof(MeshVertex, Pos);
+        MeshDesc.NumVertices    = NumVertices;
+        MeshDesc.pIndices       = pIndices;
+        MeshDesc.NumIndices     = NumIndices;
+        MeshDesc.BuildFlags     = RAYTRACING_BUILD_AS_PREFER_FAST_TRACE | RAYTRACING_BUILD_AS_ALLOW_COMPACTION;
+
+        const auto MeshId = BatchBuilder.AddTriangleMesh(MeshDesc);
+        VERIFY_EXPR(MeshId == AttribsPool.GetNumMeshes());
+        AttribsPool.AddMesh(pVertices, NumVertices, pIndices, NumIndices);
+        return MeshId;
+    };
+
+    // Meshes are loaded by LoadSceneMeshes().
+    const MeshData& Cube      = m_CubeMeshData[0];
+    const MeshData& SmallCube = m_CubeMeshData[1];
+    m_CubeMeshId              = AddMesh("Cube BLAS", Cube.GetVertices(), Cube.GetNumVertices(), Cube.GetIndices(), Cube.GetNumIndices());
+    m_SmallCubeMeshId         = AddMesh("SmallCube BLAS", SmallCube.GetVertices(), SmallCube.GetNumVertices(), SmallCube.GetIndices(), SmallCube.GetNumIndices());
+
+    // Every cluster of small cubes is merged into one mesh in world space. Clusters only depend
+    // on the instance layout, so all proxies are built up front together with the other meshes.
+    {
+        std::vector<Uint32> CubeKeys{m_cubesCustomIds.begin(), m_cubesCustomIds.end()};
+        m_CubeClusters.Build(m_SmallCubeTransforms.data(), CubeKeys.data(), static_cast<Uint32>(m_SmallCubeTransforms.size()),
+                             SmallCube.GetBoundsMin(), SmallCube.GetBoundsMax(), InstanceClusterCellSize);
+
+        const auto& Clusters = m_CubeClusters.GetClusters();
+        m_CubeClusterMeshIds.resize(Clusters.size());
+        for (size_t c = 0; c < Clusters.size(); ++c)
+        {
+            std::vector<MeshVertex> Vertices;
+            std::vector<Uint32>     Indices;
+            for (const auto i : Clusters[c].Instances)
+            {
+                AppendTransformedMesh(SmallCube.GetVertices(), SmallCube.GetNumVertices(), SmallCube.GetIndices(), SmallCube.GetNumIndices(),
+                                      m_SmallCubeTransforms[i], Vertices, Indices);
+            }
+            const auto Name         = "Cube cluster BLAS " + std::to_string(c);
+            m_CubeClusterMeshIds[c] = AddMesh(Name.c_str(), Vertices.data(), static_cast<Uint32>(Vertices.size()), Indices.data(), static_cast<Uint32>(Indices.size()));
+        }
+    }
+
+    if (m_pQueryLoadedMeshGeometry)
+    {
+        const MeshData& Mesh = m_LoadedMeshData;
+        m_LoadedMeshId       = AddMesh("Loaded mesh BLAS", Mesh.GetVertices(), Mesh.GetNumVertices(), Mesh.GetIndices(), Mesh.GetNumIndices());
+    }
+    VERIFY(AttribsPool.GetNumMeshes() <= MAX_MESHES, "Too many meshes to encode the mesh index in the instance custom id");
+
+    BatchBuilder.Build(m_pBuildContext, *m_pScratchAllocator);
+
+    m_pCubeBLAS      = BatchBuilder.GetBLAS(m_CubeMeshId);
+    m_pSmallCubeBLAS = BatchBuilder.GetBLAS(m_SmallCubeMeshId);
+    if (m_LoadedMeshId != InvalidMeshId)
+        m_pLoadedMeshBLAS = BatchBuilder.GetBLAS(m_LoadedMeshId);
+    m_CubeClusterBLASes.clear();
+    for (const auto MeshId : m_CubeClusterMeshIds)
+        m_CubeClusterBLASes.emplace_back(BatchBuilder.GetBLAS(MeshId));
+
+    // Create structured buffers with mesh attributes.
+    // These attributes will be used in the hit shaders to calculate UVs and normal for intersection point.
+    const auto CreateAttribsBuffer = [&](const char* Name, const void* pData, size_t NumElements, Uint32 Stride, RefCntAutoPtr<IBuffer>& pBuffer, const char* VarName) {
+        BufferDesc BuffDesc;
+        BuffDesc.Name              = Name;
+        BuffDesc.Usage             = USAGE_IMMUTABLE;
+        BuffDesc.BindFlags         = BIND_SHADER_RESOURCE;
+        BuffDesc.Mode              = BUFFER_MODE_STRUCTURED;
+        BuffDesc.ElementByteStride = Stride;
+        BuffDesc.Size              = Uint64{Stride} * NumElements;
+
+        BufferData BufData = {pData, BuffDesc.Size};
+        m_pDevice->CreateBuffer(BuffDesc, &BufData, &pBuffer);
+        VERIFY_EXPR(pBuffer != nullptr);
+
+        m_pRayTracingSRB->GetVariableByName(SHADER_TYPE_RAY_CLOSEST_HIT, VarName)->Set(pBuffer->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE));
+    };
+    CreateAttribsBuffer("Mesh attribs", AttribsPool.GetMeshes().data(), AttribsPool.GetMeshes().size(), sizeof(MeshAttribsPool::Mesh), m_MeshAttribsBuffer, "g_MeshAttribs");
+    CreateAttribsBuffer("Mesh vertices", AttribsPool.GetVertices().data(), AttribsPool.GetVertices().size(), sizeof(MeshAttribsPool::Vertex), m_MeshVerticesBuffer, "g_MeshVertices");
+    CreateAttribsBuffer("Mesh indices", AttribsPool.GetIndices().data(), AttribsPool.GetIndices().size(), sizeof(Uint32), m_MeshIndicesBuffer, "g_MeshIndices");
+    CreateAttribsBuffer("Mesh triangle LODs", AttribsPool.GetTriangleLODs().data(), AttribsPool.GetTriangleLODs().size(), sizeof(float), m_MeshTriangleLODsBuffer, "g_MeshTriangleLODs");
+
+    // The BLASes, the attribute buffers and the CPU renderer have their own copies of the meshes,
+    // and mapped meshes must not outlive the scene cache.
+    for (auto& Mesh : m_CubeMeshData)
+        Mesh.Clear();
+    m_LoadedMeshData.Clear();
+}
+
+void Tutorial21_RayTracing::UpdateLights()
+{
+    static_assert(sizeof(HLSL::LightAttribs) == sizeof(LightBVH::Light), "LightAttribs layout mismatch");
+    static_assert(sizeof(HLSL::LightBVHNode) == sizeof(LightBVH::Node), "LightBVHNode layout mismatch");
+    static_assert(LIGHT_BVH_LEAF_FLAG == LightBVH::LeafFlag, "Leaf flag mismatch");
+
+    constexpr Uint32 MaxLights = MaxExtraLights + NUM_LIGHTS;
+    if (!m_LightsBuffer)
+    {
+        BufferDesc BuffDesc;
+        BuffDesc.Name              = "Lights";
+        BuffDesc.Usage             = USAGE_DEFAULT;
+        BuffDesc.BindFlags         = BIND_SHADER_RESOURCE;
+        BuffDesc.Mode              = BUFFER_MODE_STRUCTURED;
+        BuffDesc.ElementByteStride = sizeof(LightBVH::Light);
+        BuffDesc.Size              = Uint64{BuffDesc.ElementByteStride} * MaxLights;
+        m_pDevice->CreateBuffer(BuffDesc, nullptr, &m_LightsBuffer);
+        VERIFY_EXPR(m_LightsBuffer != nullptr);
+
+        BuffDesc.Name              = "Light BVH";
+        BuffDesc.ElementByteStride = sizeof(LightBVH::Node);
+        BuffDesc.Size              = Uint64{BuffDesc.ElementByteStride} * (MaxLights * 2 - 1);
+        m_pDevice->CreateBuffer(BuffDesc, nullptr, &m_LightBVHBuffer);
+        VERIFY_EXPR(m_LightBVHBuffer != nullptr);
+
+        m_pRayTracingSRB->GetVariableByName(SHADER_TYPE_RAY_CLOSEST_HIT, "g_Lights")->Set(m_LightsBuffer->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE));
+        m_pRayTracingSRB->GetVariableByName(SHADER_TYPE_RAY_CLOSEST_HIT, "g_LightBVH")->Set(m_LightBVHBuffer->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE));
+    }
+
+    GenerateLights();
+    UploadLights();
+}
+
+void Tutorial21_RayTracing::GenerateLights()
+{
+    // Key lights have an unlimited range and keep the look of the scene.
+    std::vector<LightBVH::Light> Lights(NUM_LIGHTS + m_NumExtraLights);
+    for (Uint32 i = 0; i < NUM_LIGHTS; ++i)
+    {
+        Lights[i].Pos   = float3::MakeVector(&m_Constants.LightPos[i].x);
+        Lights[i].Color = float3::MakeVector(&m_Constants.LightColor[i].x);
+        Lights[i].Range = 1e6f;
+    }
+
+    // Small colored lights scattered just above the ground. The seed is fixed so that
+    // the same number of lights always produces the same scene.
+    std::mt19937                          LightRng{42};
+    std::uniform_real_distribution<float> Rand{0.f, 1.f};
+    for (size_t i = NUM_LIGHTS; i < Lights.size(); ++i)
+    {
+        auto& L = Lights[i];
+        L.Pos    = float3{-30.f + 60.f * Rand(LightRng), -5.5f + Rand(LightRng), -30.f + 60.f * Rand(LightRng)};
+        L.Color  = float3{Rand(LightRng), Rand(LightRng), Rand(LightRng)} * 2.f;
+        L.Range  = 2.f + 2.f * Rand(LightRng);
+        L.Radius = 0.05f + 0.15f * Rand(LightRng);
+    }
+
+    m_Lights              = std::move(Lights);
+    m_UploadedExtraLights = m_NumExtraLights;
+    m_Constants.NumLights = static_cast<Uint32>(m_Lights.size());
+}
+
+void Tutorial21_RayTracing::UploadLights()
+{
+    LightBVH BVH;
+    BVH.Build(m_Lights.data(), static_cast<Uint32>(m_Lights.size()));
+
+    const auto& Nodes = BVH.GetNodes();
+    m_pImmediateContext->UpdateBuffer(m_LightsBuffer, 0, m_Lights.size() * sizeof(m_Lights[0]), m_Lights.data(), RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    m_pImmediateContext->UpdateBuffer(m_LightBVHBuffer, 0, Nodes.size() * sizeof(Nodes[0]), Nodes.data(), RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+}
+
+void Tutorial21_RayTracing::CreateProceduralBLAS()
+{
+    static_assert(sizeof(HLSL::BoxAttribs) % 16 == 0, "BoxAttribs must be aligned by 16 bytes");
+
+    const auto Layout = GetInstanceLayout();
+
+    // The single-sphere BLAS uses box 0, and every small sphere has its own box with the sphere
+    // shape, so that the closest hit shader gets a stable object id for every sphere.
+    std::vector<HLSL::BoxAttribs> Boxes;
+    Boxes.emplace_back(-1.5f, -1.5f, -1.5f, 1.5f, 1.5f, 1.5f);
+    const float3 SphereMin{-0.5f, -0.5f, -0.5f};
+    const float3 SphereMax{+0.5f, +0.5f, +0.5f};
+    m_pQuerySphereGeometry = SceneQuery::CreateSphereGeometry(float3{0, 0, 0}, 0.5f);
+    for (size_t i = 0; i < m_SmallSphereTransforms.size(); ++i)
+        Boxes.emplace_back(SphereMin.x, SphereMin.y, SphereMin.z, SphereMax.x, SphereMax.y, SphereMax.z, Layout.FirstSphere + static_cast<Uint32>(i));
+
+    // Cluster proxies hold the boxes of their spheres in world space.
+    {
+        std::vector<Uint32> SphereKeys{m_SphereInstanceMatIds.begin(), m_SphereInstanceMatIds.end()};
+        m_SphereClusters.Build(m_SmallSphereTransforms.data(), SphereKeys.data(), static_cast<Uint32>(m_SmallSphereTransforms.size()),
+                               SphereMin, SphereMax, InstanceClusterCellSize);
+
+        const auto& Clusters = m_SphereClusters.GetClusters();
+        m_SphereClusterFirstBoxes.resize(Clusters.size());
+        for (size_t c = 0; c < Clusters.size(); ++c)
+        {
+            m_SphereClusterFirstBoxes[c] = static_cast<Uint32>(Boxes.size());
+            for (const auto i : Clusters[c].Instances)
+            {
+                float3 BoxMin, BoxMax;
+                TransformBounds(SphereMin, SphereMax, m_SmallSphereTransforms[i], BoxMin, BoxMax);
+                Boxes.emplace_back(BoxMin.x, BoxMin.y, BoxMin.z, BoxMax.x, BoxMax.y, BoxMax.z, Layout.FirstSphere + i);
+            }
+        }
+    }
+    VERIFY(Boxes.size() < (size_t{1} << 24), "Box indices must fit into the instance custom id");
+
+    // Create box buffer
+    {
+        BufferData BufData = {Boxes.data(), Boxes.size() * sizeof(Boxes[0])};
+        BufferDesc BuffDesc;
+        BuffDesc.Name              = "AABB Buffer";
+        BuffDesc.Usage             = USAGE_IMMUTABLE;
+        BuffDesc.BindFlags         = BIND_RAY_TRACING | BIND_SHADER_RESOURCE;
+        BuffDesc.Size              = BufData.DataSize;
+        BuffDesc.ElementByteStride = sizeof(Boxes[0]);
+        BuffDesc.Mode              = BUFFER_MODE_STRUCTURED;
+
+        // The buffer is read by BLAS build and by the intersection shader.
+        BuffDesc.ImmediateContextMask = m_ASContextMask;
+
+        m_pDevice->CreateBuffer(BuffDesc, &BufData, &m_BoxAttribsCB);
+        VERIFY_EXPR(m_BoxAttribsCB != nullptr);
+
+        m_pRayTracingSRB->GetVariableByName(SHADER_TYPE_RAY_INTERSECTION, "g_BoxAttribs")->Set(m_BoxAttribsCB->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE));
+    }
+
+    // Create & build bottom level acceleration structures
+    const auto CreateBoxBLAS = [&](const char* Name, Uint32 FirstBox, Uint32 NumBoxes) {
+        RefCntAutoPtr<IBottomLevelAS> pBLAS;
+
+        // Create BLAS
+        BLASBoundingBoxDesc BoxInfo;
+        {
+            BoxInfo.GeometryName = "Box";
+            BoxInfo.MaxBoxCount  = NumBoxes;
+
+            BottomLevelASDesc ASDesc;
+            ASDesc.Name     = Name;
+            ASDesc.Flags    = RAYTRACING_BUILD_AS_PREFER_FAST_TRACE | RAYTRACING_BUILD_AS_ALLOW_COMPACTION;
+            ASDesc.pBoxes   = &BoxInfo;
+            ASDesc.BoxCount = 1;
+
+            ASDesc.ImmediateContextMask = m_ASContextMask;
+
+            m_pDevice->CreateBLAS(ASDesc, &pBLAS);
+            VERIFY_EXPR(pBLAS != nullptr);
+        }
+
+        // Allocate scratch memory from the shared scratch buffer.
+        const auto Scratch = m_pScratchAllocator->Allocate(pBLAS->GetScratchBufferSizes().Build);
+
+        // Build BLAS
+        BLASBuildBoundingBoxData BoxData;
+        BoxData.GeometryName = BoxInfo.GeometryName;
+        BoxData.BoxCount     = NumBoxes;
+        BoxData.BoxStride    = sizeof(Boxes[0]);
+        BoxData.BoxOffset    = Uint64{FirstBox} * sizeof(Boxes[0]);
+        BoxData.pBoxBuffer   = m_BoxAttribsCB;
+
+        BuildBLASAttribs Attribs;
+        Attribs.pBLAS        = pBLAS;
+        Attribs.pBoxData     = &BoxData;
+        Attribs.BoxDataCount = 1;
+
+        // Scratch buffer will be used to store temporary data during BLAS build.
+        // Previous content in the scratch buffer will be discarded.
+        Attribs.pScratchBuffer      = Scratch.pBuffer;
+        Attribs.ScratchBufferOffset = Scratch.Offset;
+
+        // Allow engine to change resource states.
+        Attribs.BLASTransitionMode          = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
+        Attribs.GeometryTransitionMode      = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
+        Attribs.ScratchBufferTransitionMode = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
+
+        m_pBuildContext->BuildBLAS(Attribs);
+        return pBLAS;
+    };
+
+    m_pProceduralBLAS = CreateBoxBLAS("Procedural BLAS", 0, 1);
+
+    const auto& Clusters = m_SphereClusters.GetClusters();
+    m_SphereClusterBLASes.resize(Clusters.size());
+    for (size_t c = 0; c < Clusters.size(); ++c)
+    {
+        const auto Name          = "Sphere cluster BLAS " + std::to_string(c);
+        m_SphereClusterBLASes[c] = CreateBoxBLAS(Name.c_str(), m_SphereClusterFirstBoxes[c], static_cast<Uint32>(Clusters[c].Instances.size()));
+    }
+}
+
+void Tutorial21_RayTracing::ModifyEngineInitInfo(const ModifyEngineInitInfoAttribs& Attribs)
+{
+    SampleBase::ModifyEngineInitInfo(Attribs);
+
+    // Require ray tracing feature.
+    Attribs.EngineCI.Features.RayTracing = DEVICE_FEATURE_STATE_ENABLED;
+
+    // Request an additional immediate context on a compute queue, so that acceleration
+    // structures can be built while the graphics queue is tracing rays.
+    const auto AdapterId = Attribs.EngineCI.AdapterId == DEFAULT_ADAPTER_ID ? 0 : Attribs.EngineCI.AdapterId;
+
+    Uint32 NumAdapters = 0;
+    Attribs.Factory->EnumerateAdapters(Attribs.EngineCI.GraphicsAPIVersion, NumAdapters, nullptr);
+    if (AdapterId >= NumAdapters)
+        return;
+
+    std::vector<GraphicsAdapterInfo> Adapters(NumAdapters);
+    Attribs.Factory->EnumerateAdapters(Attribs.EngineCI.GraphicsAPIVersion, NumAdapters, Adapters.data());
+
+    const auto& Adapter         = Adapters[AdapterId];
+    Uint8       GraphicsQueueId = MAX_ADAPTER_QUEUES;
+    Uint8       ComputeQueueId  = MAX_ADAPTER_QUEUES;
+    for (Uint8 q = 0; q < Adapter.NumQueues; ++q)
+    {
+        const auto QueueType = Adapter.Queues[q].QueueType & COMMAND_QUEUE_TYPE_PRIMARY_MASK;
+        if (QueueType == COMMAND_QUEUE_TYPE_GRAPHICS && GraphicsQueueId == MAX_ADAPTER_QUEUES)
+            GraphicsQueueId = q;
+        else if (QueueType == COMMAND_QUEUE_TYPE_COMPUTE && ComputeQueueId == MAX_ADAPTER_QUEUES)
+            ComputeQueueId = q;
+    }
+    if (GraphicsQueueId == MAX_ADAPTER_QUEUES || ComputeQueueId == MAX_ADAPTER_QUEUES)
+        return;
+
+    // The first context must be the graphics one as it is used for presentation.
+    m_ContextCI = {
+        ImmediateContextCreateInfo{"Graphics", GraphicsQueueId, QUEUE_PRIORITY_HIGH},
+        ImmediateContextCreateInfo{"AS build", ComputeQueueId, QUEUE_PRIORITY_MEDIUM},
+    };
+    Attribs.EngineCI.NumImmediateContexts  = static_cast<Uint32>(m_ContextCI.size());
+    Attribs.EngineCI.pImmediateContextInfo = m_ContextCI.data();
+
+    // Queues are synchronized on the GPU with DeviceWaitForFence(), which requires native fences.
+    Attribs.EngineCI.Features.NativeFence = DEVICE_FEATURE_STATE_OPTIONAL;
+}
+
+void Tutorial21_RayTracing::GenerateInstanceLayout()
+{
+    const int NumSmallSpheres = (2 * a) * (2 * b);
+    const int NumSmallCubes   = (2 * c) * (2 * d);
+
+    m_SmallSphereTransforms.resize(NumSmallSpheres);
+    m_SphereInstanceMatIds.resize(NumSmallSpheres);
+    m_SmallCubeTransforms.resize(NumSmallCubes);
+    m_cubesCustomIds.resize(NumSmallCubes);
+
+    // Nueva distribución: espiral para esferas
+    std::vector<float3> positions;
+    positions.reserve(NumSmallSpheres);
+
+    // Parámetros para distribución en espiral
+    const float radio_inicial     = 5.0f;
+    const float incremento_radio  = 0.3f;
+    const float incremento_angulo = 0.5f;
+    const float altura_base       = -5.5f;
+
+    // Generar posiciones en espiral para esferas
+    for (int i = 0; i < NumSmallSpheres; ++i)
+    {
+        float radio  = radio_inicial + incremento_radio * i;
+        float angulo = incremento_angulo * i;
+
+        float x = radio * cos(angulo);
+        float z = radio * sin(angulo);
+        float y = altura_base + (i * 0.05f); // Ligera elevación en espiral
+
+        float3 p = float3{x, y, z};
+        positions.push_back(p);
+
+        // Crea la matriz de instancia
+        InstanceMatrix xf;
+        xf.SetTranslation(p.x, p.y, p.z);
+        m_SmallSphereTransforms[i] = xf;
+    }
+
+    // Nueva distribución: estructura de grilla para cubos pero en forma de pirámide
+    std::vector<float3> cubePositions;
+    cubePositions.reserve(NumSmallCubes); // Corregido con N mayúscula
+
+    int capas = 5; // Número de capas de la pirámide
+    int index = 0;
+
+    for (int capa = 0; capa < capas && index < NumSmallCubes; capa++)
+    { // Corregido con N mayúscula
+        int   cubos_por_lado = capas - capa;
+        float nivel_y        = altura_base + (capa * 1.5f); // Altura de cada capa
+
+        // Generar cubos en forma de cuadrado para esta capa
+        for (int i = -cubos_por_lado / 2; i <= cubos_por_lado / 2 && index < NumSmallCubes; i++)
+        { // Corregido
+            for (int j = -cubos_por_lado / 2; j <= cubos_por_lado / 2 && index < NumSmallCubes; j++)
+            { // Corregido
+                // Solo agregar cubos en los bordes del cuadrado para formar un marco
+                if (i == -cubos_por_lado / 2 || i == cubos_por_lado / 2 ||
+                    j == -cubos_por_lado / 2 || j == cubos_por_lado / 2)
+                {
+
+                    float  x = i * 2.0f; // Espaciado de 2 unidades
+                    float  z = j * 2.0f;
+                    float3 p = float3{x, nivel_y, z};
+
+                    cubePositions.push_back(p);
+
+                    // Asignar materiales de manera diferente - asignar más variedad
+                    int   instanceId;
+                    float mat_selector = static_cast<float>(index) / NumSmallCubes; // Corregido
+
+                    if (mat_selector < 0.6f)
+                    {
+                        instanceId = 0; // Textura cristal para mayoría
+                    }
+                    else if (mat_selector < 0.85f)
+                    {
+                        instanceId = 1; // Textura difusa
+                    }
+                    else
+                    {
+                        instanceId = 2; // Textura metal
+                    }
+
+                    m_cubesCustomIds[index] = instanceId;
+
+                    // Crear matriz de instancia
+                    InstanceMatrix xf;
+                    xf.SetTranslation(p.x, p.y, p.z);
+                    // Aplicar rotación adicional variada
+                    float3x3 rot = float3x3::RotationY(index * 0.2f) * float3x3::RotationX(capa * 0.15f);
+                    xf.SetRotation(rot.Data());
+                    m_SmallCubeTransforms[index] = xf;
+
+                    index++;
+                }
+            }
+        }
+    }
+
+    // Llenar los cubos restantes si aún no hemos alcanzado el límite
+    while (index < NumSmallCubes)
+    { // Corregido
+        float x = (index % 10) * 2.0f - 10.0f;
+        float z = (index / 10) * 2.0f - 10.0f;
+        float y = altura_base - 2.0f; // Ponerlos más abajo que el resto
+
+        float3 p = float3{x, y, z};
+        cubePositions.push_back(p);
+
+        // Material aleatorio
+        m_cubesCustomIds[index] = index % 3;
+
+        // Crear matriz de instancia
+        InstanceMatrix xf;
+        xf.SetTranslation(p.x, p.y, p.z);
+        m_SmallCubeTransforms[index] = xf;
+
+        index++;
+    }
+
+    // Distribuir aleatoriamente los tres tipos de materiales para esferas
+    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+    for (int i = 0; i < NumSmallSpheres; ++i)
+    {
+        // Nueva distribución de materiales: más metálico, menos vidrio
+        float materialSelector = dist(rng);
+        if (materialSelector < 0.7f) // 70% de probabilidad para metálico
+            m_SphereInstanceMatIds[i] = 0;
+        else if (materialSelector < 0.9f) // 20% de probabilidad para difuso
+            m_SphereInstanceMatIds[i] = 1;
+        else // 10% de probabilidad para vidrio
+            m_SphereInstanceMatIds[i] = 2;
+    }
+}
+
+void Tutorial21_RayTracing::CreateInstanceLayout()
+{
+    const size_t NumSmallSpheres = (2 * a) * (2 * b);
+    const size_t NumSmallCubes   = (2 * c) * (2 * d);
+
+    // The layout is random, so a cached layout also keeps the scene identical between runs.
+    bool FromCache = false;
+    if (m_pSceneCacheReader)
+    {
+        const InstanceMatrix* pSphereTransforms = nullptr;
+        const Int32*          pSphereMatIds     = nullptr;
+        const InstanceMatrix* pCubeTransforms   = nullptr;
+        const Int32*          pCubeMatIds       = nullptr;
+        size_t                Counts[4]         = {};
+
+        FromCache =
+            m_pSceneCacheReader->GetArray(SCENE_CHUNK_SPHERE_TRANSFORMS, pSphereTransforms, Counts[0]) && Counts[0] == NumSmallSpheres &&
+            m_pSceneCacheReader->GetArray(SCENE_CHUNK_SPHERE_MATERIALS, pSphereMatIds, Counts[1]) && Counts[1] == NumSmallSpheres &&
+            m_pSceneCacheReader->GetArray(SCENE_CHUNK_CUBE_TRANSFORMS, pCubeTransforms, Counts[2]) && Counts[2] == NumSmallCubes &&
+            m_pSceneCacheReader->GetArray(SCENE_CHUNK_CUBE_MATERIALS, pCubeMatIds, Counts[3]) && Counts[3] == NumSmallCubes;
+        if (FromCache)
+        {
+            m_SmallSphereTransforms.assign(pSphereTransforms, pSphereTransforms + NumSmallSpheres);
+            m_SphereInstanceMatIds.assign(pSphereMatIds, pSphereMatIds + NumSmallSpheres);
+            m_SmallCubeTransforms.assign(pCubeTransforms, pCubeTransforms + NumSmallCubes);
+            m_cubesCustomIds.assign(pCubeMatIds, pCubeMatIds + NumSmallCubes);
+        }
+        else
+        {
+            LOG_WARNING_MESSAGE("Instance layout is missing in the scene cache");
+        }
+    }
+
+    if (!FromCache)
+    {
+        GenerateInstanceLayout();
+
+        if (m_pSceneCacheWriter)
+        {
+            static_assert(sizeof(int) == sizeof(Int32), "Material ids are stored as 32-bit integers");
+            m_pSceneCacheWriter->AddChunk(SCENE_CHUNK_SPHERE_TRANSFORMS, m_SmallSphereTransforms.data(), sizeof(InstanceMatrix) * NumSmallSpheres);
+            m_pSceneCacheWriter->AddChunk(SCENE_CHUNK_SPHERE_MATERIALS, m_SphereInstanceMatIds.data(), sizeof(Int32) * NumSmallSpheres);
+            m_pSceneCacheWriter->AddChunk(SCENE_CHUNK_CUBE_TRANSFORMS, m_SmallCubeTransforms.data(), sizeof(InstanceMatrix) * NumSmallCubes);
+            m_pSceneCacheWriter->AddChunk(SCENE_CHUNK_CUBE_MATERIALS, m_cubesCustomIds.data(), sizeof(Int32) * NumSmallCubes);
+        }
+    }
+
+    m_MaxSmallSpheres       = static_cast<Int32>(NumSmallSpheres);
+    m_NumActiveSmallSpheres = m_MaxSmallSpheres;
+    m_MaxSmallCubes         = static_cast<Int32>(NumSmallCubes);
+    m_NumActiveSmallCubes   = m_MaxSmallCubes;
+
+    m_SphereInstanceNames.resize(NumSmallSpheres);
+    m_CubeInstanceNames.resize(NumSmallCubes);
+    m_SphereEditFlags.assign(NumSmallSpheres, INSTANCE_EDIT_FLAG_NONE);
+    m_CubeEditFlags.assign(NumSmallCubes, INSTANCE_EDIT_FLAG_NONE);
+
+    BuildInstanceHierarchy();
+}
+
+void Tutorial21_RayTracing::BuildInstanceHierarchy()
+{
+    // Instances of the hierarchy are the small spheres followed by the small cubes. The spiral
+    // is one group, and every layer of cubes at the same height is a group of the pyramid, with
+    // the height of the layer in the group transform. Both are grouped again, so that the whole
+    // arrangement can be moved or instantiated at once.
+    m_InstanceGroups.Clear();
+    m_SceneGroup = m_InstanceGroups.AddGroup(InstanceHierarchy::RootGroup, InstanceMatrix{}, "Spiral and pyramid");
+
+    const Uint32 SpiralGroup = m_InstanceGroups.AddGroup(m_SceneGroup, InstanceMatrix{}, "Sphere spiral");
+    for (const auto& Transform : m_SmallSphereTransforms)
+        m_InstanceGroups.AddInstance(SpiralGroup, Transform);
+
+    std::vector<float> LayerHeights;
+    for (const auto& Transform : m_SmallCubeTransforms)
+        LayerHeights.push_back(Transform.data[1][3]);
+    std::sort(LayerHeights.begin(), LayerHeights.end());
+    LayerHeights.erase(std::unique(LayerHeights.begin(), LayerHeights.end()), LayerHeights.end());
+
+    const Uint32        PyramidGroup = m_InstanceGroups.AddGroup(m_SceneGroup, InstanceMatrix{}, "Cube pyramid");
+    std::vector<Uint32> LayerGroups(LayerHeights.size());
+    for (size_t l = 0; l < LayerHeights.size(); ++l)
+    {
+        InstanceMatrix LayerTransform;
+        LayerTransform.SetTranslation(0, LayerHeights[l], 0);
+        LayerGroups[l] = m_InstanceGroups.AddGroup(PyramidGroup, LayerTransform, ("Cube layer " + std::to_string(l)).c_str());
+    }
+
+    // The layer height is subtracted exactly, so flattening restores the original transforms.
+    for (const auto& Transform : m_SmallCubeTransforms)
+    {
+        const size_t Layer = std::lower_bound(LayerHeights.begin(), LayerHeights.end(), Transform.data[1][3]) - LayerHeights.begin();
+
+        InstanceMatrix Local = Transform;
+        Local.data[1][3] -= LayerHeights[Layer];
+        m_InstanceGroups.AddInstance(LayerGroups[Layer], Local);
+    }
+    m_InstanceGroups.Flatten();
+    m_SelectedInstanceGroup = m_SceneGroup;
+}
+
+void Tutorial21_RayTracing::RunHierarchyBenchmark(Uint32 NumCopies)
+{
+    // Instantiates the spiral and the pyramid NumCopies times in a row, then moves the copies
+    // with one group edit each. Without groups, every instance transform would be rewritten.
+    InstanceHierarchy Hierarchy = m_InstanceGroups;
+    Hierarchy.Flatten();
+
+    using Clock         = std::chrono::high_resolution_clock;
+    const auto ElapsedMs = [](Clock::time_point Start) { return std::chrono::duration<double, std::milli>(Clock::now() - Start).count(); };
+
+    auto                StartTime = Clock::now();
+    std::vector<Uint32> Copies(NumCopies);
+    for (Uint32 c = 0; c < NumCopies; ++c)
+    {
+        InstanceMatrix Transform;
+        Transform.SetTranslation(static_cast<float>(c + 1) * 60.f, 0, 0);
+        Copies[c] = Hierarchy.CloneGroup(m_SceneGroup, InstanceHierarchy::RootGroup, Transform);
+    }
+    Hierarchy.Flatten();
+    const double InstantiateMs = ElapsedMs(StartTime);
+
+    InstanceMatrix Moved;
+    Moved.SetTranslation(0, 1, 0);
+
+    StartTime = Clock::now();
+    Hierarchy.SetGroupTransform(Copies.empty() ? m_SceneGroup : Copies.back(), Moved);
+    const Uint32 NumMovedInstances = Hierarchy.Flatten();
+    const double MoveOneMs         = ElapsedMs(StartTime);
+
+    StartTime = Clock::now();
+    for (const auto Copy : Copies)
+        Hierarchy.SetGroupTransform(Copy, ConcatenateTransforms(Moved, Hierarchy.GetGroupTransform(Copy)));
+    const Uint32 NumMovedAll = Hierarchy.Flatten();
+    const double MoveAllMs   = ElapsedMs(StartTime);
+
+    LOG_INFO_MESSAGE("Hierarchy benchmark: ", NumCopies, " copies, ", Hierarchy.GetNumInstances(), " instances in ", Hierarchy.GetNumGroups(),
+                     " groups, instantiated in ", InstantiateMs, " ms. Moving one copy: 1 edit, ", NumMovedInstances, " instances flattened in ",
+                     MoveOneMs, " ms. Moving all copies: ", NumCopies, " edits, ", NumMovedAll, " instances flattened in ", MoveAllMs, " ms (",
+                     NumMovedAll / (MoveAllMs * 1000.0), " M instances/s)");
+}
+
+void Tutorial21_RayTracing::RunClusterBenchmark(Uint32 NumCopies)
+{
+    // Places NumCopies copies of the spiral and the pyramid in a row, like RunHierarchyBenchmark(),
+    // clusters them and merges the cube proxies as CreateMeshBLASes() does, then selects proxies for
+    // camera positions along the row.
+    const Uint32 NumSets = NumCopies + 1;
+
+    std::vector<InstanceMatrix> SphereTransforms, CubeTransforms;
+    std::vector<Uint32>         SphereKeys, CubeKeys;
+    for (Uint32 c = 0; c < NumSets; ++c)
+    {
+        const float Offset = static_cast<float>(c) * 60.f;
+        for (size_t i = 0; i < m_SmallSphereTransforms.size(); ++i)
+        {
+            SphereTransforms.push_back(m_SmallSphereTransforms[i]);
+            SphereTransforms.back().data[0][3] += Offset;
+            SphereKeys.push_back(static_cast<Uint32>(m_SphereInstanceMatIds[i]));
+        }
+        for (size_t i = 0; i < m_SmallCubeTransforms.size(); ++i)
+        {
+            CubeTransforms.push_back(m_SmallCubeTransforms[i]);
+            CubeTransforms.back().data[0][3] += Offset;
+            CubeKeys.push_back(static_cast<Uint32>(m_cubesCustomIds[i]));
+        }
+    }
+    const Uint32 NumSpheres = static_cast<Uint32>(SphereTransforms.size());
+    const Uint32 NumCubes   = static_cast<Uint32>(CubeTransforms.size());
+
+    using Clock         = std::chrono::high_resolution_clock;
+    const auto ElapsedMs = [](Clock::time_point Start) { return std::chrono::duration<double, std::milli>(Clock::now() - Start).count(); };
+
+    const MeshData&    SmallCube = m_CubeMeshData[1];
+    InstanceClusterLOD SphereClusters, CubeClusters;
+    auto               StartTime = Clock::now();
+    SphereClusters.Build(SphereTransforms.data(), SphereKeys.data(), NumSpheres, float3{-0.5f, -0.5f, -0.5f}, float3{0.5f, 0.5f, 0.5f}, InstanceClusterCellSize);
+    CubeClusters.Build(CubeTransforms.data(), CubeKeys.data(), NumCubes, SmallCube.GetBoundsMin(), SmallCube.GetBoundsMax(), InstanceClusterCellSize);
+    const double BuildMs = ElapsedMs(StartTime);
+
+    size_t NumProxyTriangles = 0;
+
+    StartTime = Clock::now();
+    for (const auto& Cluster : CubeClusters.GetClusters())
+    {
+        std::vector<MeshVertex> Vertices;
+        std::vector<Uint32>     Indices;
+        for (const auto i : Cluster.Instances)
+        {
+            AppendTransformedMesh(SmallCube.GetVertices(), SmallCube.GetNumVertices(), SmallCube.GetIndices(), SmallCube.GetNumIndices(),
+                                  CubeTransforms[i], Vertices, Indices);
+        }
+        NumProxyTriangles += Indices.size() / 3;
+    }
+    const double MergeMs = ElapsedMs(StartTime);
+
+    // The camera keeps its height and distance to the row and moves from the first copy to the last one.
+    constexpr Uint32 NumPositions = 16;
+    const float3     CameraPos    = m_Camera.GetPos();
+    Uint32           NumSwitched  = 0;
+    Uint32           MinTLASSize  = ~0u;
+    Uint32           MaxTLASSize  = 0;
+    double           SelectMs     = 0;
+    for (Uint32 p = 0; p < NumPositions; ++p)
+    {
+        const float3 Pos = CameraPos + float3{static_cast<float>(NumCopies) * 60.f * static_cast<float>(p) / (NumPositions - 1), 0, 0};
+
+        StartTime = Clock::now();
+        NumSwitched += SphereClusters.Update(Pos, m_ProxyDistance, nullptr);
+        NumSwitched += CubeClusters.Update(Pos, m_ProxyDistance, nullptr);
+        SelectMs += ElapsedMs(StartTime);
+
+        // Every proxy replaces the instances of its cluster with one TLAS instance.
+        Uint32 NumMerged = 0;
+        for (const auto* pClusters : {&SphereClusters, &CubeClusters})
+        {
+            for (const auto& Cluster : pClusters->GetClusters())
+                NumMerged += Cluster.UseProxy ? static_cast<Uint32>(Cluster.Instances.size()) : 0;
+        }
+        const Uint32 TLASSize = NumSpheres + NumCubes - NumMerged + SphereClusters.GetNumProxies() + CubeClusters.GetNumProxies();
+        MinTLASSize           = std::min(MinTLASSize, TLASSize);
+        MaxTLASSize           = std::max(MaxTLASSize, TLASSize);
+    }
+
+    LOG_INFO_MESSAGE("Cluster benchmark: ", NumCopies, " copies, ", NumSpheres, " spheres in ", SphereClusters.GetClusters().size(), " clusters, ",
+                     NumCubes, " cubes in ", CubeClusters.GetClusters().size(), " clusters built in ", BuildMs, " ms. Cube proxies: ",
+                     NumProxyTriangles, " triangles merged in ", MergeMs, " ms. Proxy selection at ", m_ProxyDistance, " units for ", NumPositions,
+                     " camera positions: ", NumSwitched, " switches in ", SelectMs, " ms (", SelectMs / NumPositions, " ms per position), ",
+                     SphereClusters.GetNumProxies(), " sphere and ", CubeClusters.GetNumProxies(), " cube proxies at the last position, ",
+                     MinTLASSize, " to ", MaxTLASSize, " of ", NumSpheres + NumCubes, " small instances in the TLAS");
+}
+
+void Tutorial21_RayTracing::ApplySceneEdits()
+{
+    const auto& Edits = m_SceneEdits.Drain();
+    if (Edits.empty())
+        return;
+
+    // Small spheres and cubes have three materials each, see CreateSBT().
+    constexpr Uint32 NumInstanceMaterials = 3;
+
+    const auto Layout = GetInstanceLayout();
+
+    bool InstancesChanged = false;
+    bool MaterialsChanged = false;
+    bool LightsChanged    = false;
+    for (const auto& Edit : Edits)
+    {
+        if (Edit.Type == SCENE_EDIT_MOVE_GROUP)
+        {
+            // The instances of the group are updated by Flatten() below.
+            if (Edit.Target < m_InstanceGroups.GetNumGroups())
+                m_InstanceGroups.SetGroupTransform(Edit.Target, Edit.Transform);
+            continue;
+        }
+
+        if (Edit.Type == SCENE_EDIT_SET_LIGHT)
+        {
+            // Edited lights are replaced when the number of extra lights changes, see UpdateLights().
+            if (Edit.Target >= m_Lights.size())
+                continue;
+
+            m_Lights[Edit.Target] = Edit.Light;
+            if (Edit.Target < NUM_LIGHTS)
+            {
+                m_Constants.LightPos[Edit.Target]   = float4{Edit.Light.Pos, 0.f};
+                m_Constants.LightColor[Edit.Target] = float4{Edit.Light.Color, 0.f};
+            }
+            LightsChanged = true;
+            continue;
+        }
+
+        // The ground, the large cubes and the loaded mesh are fixed.
+        const bool IsSphere = Edit.Target >= Layout.FirstSphere && Edit.Target < Layout.FirstCube;
+        const bool IsCube   = Edit.Target >= Layout.FirstCube && Edit.Target < Layout.LoadedMesh;
+        if (!IsSphere && !IsCube)
+            continue;
+
+        const Uint32 i     = Edit.Target - (IsSphere ? Layout.FirstSphere : Layout.FirstCube);
+        Uint8&       Flags = IsSphere ? m_SphereEditFlags[i] : m_CubeEditFlags[i];
+        switch (Edit.Type)
+        {
+            case SCENE_EDIT_ADD_INSTANCE:
+                Flags = static_cast<Uint8>(Flags & ~INSTANCE_EDIT_FLAG_REMOVED);
+                break;
+
+            case SCENE_EDIT_REMOVE_INSTANCE:
+                Flags = static_cast<Uint8>(Flags | INSTANCE_EDIT_FLAG_REMOVED);
+                break;
+
+            case SCENE_EDIT_MOVE_INSTANCE:
+                // The edit holds the world transform, the hierarchy keeps it relative to the group.
+                m_InstanceGroups.SetInstanceWorldTransform(IsSphere ? i : static_cast<Uint32>(m_SmallSphereTransforms.size()) + i, Edit.Transform);
+                break;
+
+            case SCENE_EDIT_SET_MATERIAL:
+                if (Edit.Material >= NumInstanceMaterials)
+                    continue;
+                (IsSphere ? m_SphereInstanceMatIds[i] : m_cubesCustomIds[i]) = static_cast<Int32>(Edit.Material);
+                Flags            = static_cast<Uint8>(Flags | INSTANCE_EDIT_FLAG_MODIFIED);
+                MaterialsChanged = true;
+                break;
+
+            default:
+                UNEXPECTED("Unexpected scene edit type");
+                continue;
+        }
+        InstancesChanged = true;
+    }
+
+    // Moved groups and instances get their world transforms once for all edits.
+    if (m_InstanceGroups.Flatten() > 0)
+    {
+        const auto&  WorldTransforms = m_InstanceGroups.GetWorldTransforms();
+        const Uint32 NumSpheres      = static_cast<Uint32>(m_SmallSphereTransforms.size());
+        for (Uint32 i = 0; i < m_InstanceGroups.GetNumInstances(); ++i)
+        {
+            if (!m_InstanceGroups.IsInstanceUpdated(i))
+                continue;
+
+            const bool IsSphere = i < NumSpheres;
+            const auto Idx      = IsSphere ? i : i - NumSpheres;
+            (IsSphere ? m_SmallSphereTransforms[Idx] : m_SmallCubeTransforms[Idx]) = WorldTransforms[i];
+
+            Uint8& Flags = IsSphere ? m_SphereEditFlags[Idx] : m_CubeEditFlags[Idx];
+            Flags        = static_cast<Uint8>(Flags | INSTANCE_EDIT_FLAG_MODIFIED);
+        }
+        InstancesChanged = true;
+    }
+
+    if (InstancesChanged)
+    {
+        // Rebuild the scene query and the CPU renderer instances in the next UpdateTLAS().
+        m_SceneQueryActiveSpheres = -1;
+        m_NumAccumFrames          = 0;
+    }
+
+    // Materials select the hit groups of the instances, so the SBTs of all pipeline variants
+    // are out of date. SelectRayTracingPipeline() recreates the SBT of the variant in use.
+    if (MaterialsChanged)
+    {
+        for (auto& Pipeline : m_RayTracingPipelines)
+            Pipeline.second.pSBT.Release();
+    }
+
+    if (LightsChanged)
+    {
+        UploadLights();
+        m_NumAccumFrames = 0;
+    }
+}
+
+void Tutorial21_RayTracing::UpdateTLAS()
+{
+    // Create or update top-level acceleration structure
+    const auto Layout          = GetInstanceLayout();
+    int        NumSmallSpheres = (2 * a) * (2 * b);
+    int        NumSmallCubes   = (2 * c) * (2 * d); // Corregido: ahora con N mayúscula
+    int        NumInstances    = static_cast<int>(Layout.NumInstances);
+
+    // Create TLAS slots
+    if (!m_TLASSlots[0].pTLAS)
+    {
+        for (Uint32 s = 0; s < NumTLASSlots; ++s)
+        {
+            auto& Slot = m_TLASSlots[s];
+
+            const auto TLASName = "TLAS " + std::to_string(s);
+
+            TopLevelASDesc TLASDesc;
+            TLASDesc.Name                 = TLASName.c_str();
+            TLASDesc.MaxInstanceCount     = NumInstances;
+            TLASDesc.Flags                = RAYTRACING_BUILD_AS_ALLOW_UPDATE | RAYTRACING_BUILD_AS_PREFER_FAST_TRACE;
+            TLASDesc.ImmediateContextMask = m_ASContextMask;
+
+            m_pDevice->CreateTLAS(TLASDesc, &Slot.pTLAS);
+            VERIFY_EXPR(Slot.pTLAS != nullptr);
+
+            // Each slot needs its own instance buffer as the slot that is being traced
+            // must not be modified by the next build.
+            const auto BufferName = "TLAS Instance Buffer " + std::to_string(s);
+
+            BufferDesc BuffDesc;
+            BuffDesc.Name                 = BufferName.c_str();
+            BuffDesc.Usage                = USAGE_DEFAULT;
+            BuffDesc.BindFlags            = BIND_RAY_TRACING;
+            BuffDesc.Size                 = TLAS_INSTANCE_DATA_SIZE * NumInstances;
+            BuffDesc.ImmediateContextMask = m_ASContextMask;
+
+            m_pDevice->CreateBuffer(BuffDesc, nullptr, &Slot.pInstanceBuffer);
+            VERIFY_EXPR(Slot.pInstanceBuffer != nullptr);
+
+            // Hit shaders map the index of a culled TLAS instance back to the instance.
+            const auto ObjectIdBufferName = "TLAS Object Ids " + std::to_string(s);
+
+            BuffDesc.Name              = ObjectIdBufferName.c_str();
+            BuffDesc.BindFlags         = BIND_SHADER_RESOURCE;
+            BuffDesc.Mode              = BUFFER_MODE_STRUCTURED;
+            BuffDesc.ElementByteStride = sizeof(Uint32);
+            BuffDesc.Size              = sizeof(Uint32) * NumInstances;
+
+            m_pDevice->CreateBuffer(BuffDesc, nullptr, &Slot.pObjectIdBuffer);
+            VERIFY_EXPR(Slot.pObjectIdBuffer != nullptr);
+        }
+        m_ASBuildScheduler.Reset();
+    }
+
+    // Resto del código permanece igual...
+    const auto Build = m_ASBuildScheduler.BeginBuild();
+    auto&      Slot  = m_TLASSlots[Build.Slot];
+
+    // Setup instances. Object-space bounds of the instances are used for culling.
+    std::vector<TLASBuildInstanceData> Instances(NumInstances);
+    m_InstanceCuller.Reset(NumInstances);
+
+    const float3 CubeBounds{1.f, 1.f, 1.f};
+    const float3 SmallCubeBounds{0.25f, 0.25f, 0.25f};
+    const float3 SphereBounds{1.5f, 1.5f, 1.5f}; // The box of the procedural BLAS
+    const auto   SetInstanceBounds = [&](int Idx, const float3& LocalMin, const float3& LocalMax, bool IsActive) {
+        // Every instance owns HIT_GROUP_STRIDE hit groups in the SBT, see CreateSBT().
+        Instances[Idx].ContributionToHitGroupIndex = static_cast<Uint32>(Idx) * HIT_GROUP_STRIDE;
+        m_InstanceCuller.SetInstance(Idx, LocalMin, LocalMax, Instances[Idx].Transform, IsActive);
+    };
+
+    // Configurar los objetos principales
+    Instances[0].InstanceName = "Ground Instance";
+    Instances[0].CustomId     = PackInstanceCustomId(m_CubeMeshId, 0);
+    Instances[0].pBLAS        = m_pCubeBLAS;
+    Instances[0].Mask         = OPAQUE_GEOM_MASK;
+    Instances[0].Transform    = GetFixedInstanceTransform(0);
+
+    Instances[1].InstanceName = "Cube Instance 1";
+    Instances[1].CustomId     = PackInstanceCustomId(m_CubeMeshId, 0);
+    Instances[1].pBLAS        = m_pCubeBLAS;
+    Instances[1].Mask         = OPAQUE_GEOM_MASK;
+    Instances[1].Transform    = GetFixedInstanceTransform(1);
+
+    Instances[2].InstanceName = "Cube Instance 2";
+    Instances[2].CustomId     = PackInstanceCustomId(m_CubeMeshId, 1);
+    Instances[2].pBLAS        = m_pCubeBLAS;
+    Instances[2].Mask         = OPAQUE_GEOM_MASK;
+    Instances[2].Transform    = GetFixedInstanceTransform(2);
+
+    Instances[3].InstanceName = "Cube Instance 3";
+    Instances[3].CustomId     = PackInstanceCustomId(m_CubeMeshId, 2);
+    Instances[3].pBLAS        = m_pCubeBLAS;
+    Instances[3].Mask         = OPAQUE_GEOM_MASK;
+    Instances[3].Transform    = GetFixedInstanceTransform(3);
+
+    for (int i = 0; i < 4; ++i)
+        SetInstanceBounds(i, -CubeBounds, CubeBounds, true);
+
+    // Distant clusters are replaced by their proxies. A cluster with inactive instances
+    // keeps the individual instances, so that the proxy never shows removed objects.
+    {
+        std::vector<Uint8> IsSphereActive(NumSmallSpheres), IsCubeActive(NumSmallCubes);
+        for (int i = 0; i < NumSmallSpheres; ++i)
+            IsSphereActive[i] = i < m_NumActiveSmallSpheres && m_SphereEditFlags[i] == INSTANCE_EDIT_FLAG_NONE ? 1 : 0;
+        for (int i = 0; i < NumSmallCubes; ++i)
+            IsCubeActive[i] = i < m_NumActiveSmallCubes && m_CubeEditFlags[i] == INSTANCE_EDIT_FLAG_NONE ? 1 : 0;
+
+        const float ProxyDistance = m_EnableInstanceLOD ? m_ProxyDistance : FLT_MAX;
+        m_SphereClusters.Update(m_Camera.GetPos(), ProxyDistance, IsSphereActive.data());
+        m_CubeClusters.Update(m_Camera.GetPos(), ProxyDistance, IsCubeActive.data());
+    }
+
+    // Configurar las esferas pequeñas
+    int idx = 4;
+    for (int i = 0; i < (2 * a) * (2 * b); ++i)
+    {
+        auto& name = m_SphereInstanceNames[i];
+        name       = "Sphere Instance " + std::to_string(idx);
+
+        auto& Inst        = Instances[idx];
+        Inst.InstanceName = name.c_str();
+        // The custom id selects the bounding box in the intersection shader.
+        Inst.CustomId     = FirstSphereBox + i;
+        Inst.pBLAS        = m_pProceduralBLAS;
+        Inst.Mask         = OPAQUE_GEOM_MASK;
+        Inst.Transform    = m_SmallSphereTransforms[i];
+        SetInstanceBounds(idx, -SphereBounds, SphereBounds,
+                          i < m_NumActiveSmallSpheres && (m_SphereEditFlags[i] & INSTANCE_EDIT_FLAG_REMOVED) == 0 && !m_SphereClusters.IsInstanceMerged(i));
+
+        ++idx;
+    }
+
+    // Configurar los cubos pequeños
+    int idx_c2 = 0;
+    for (int i = 0; i < (2 * c) * (2 * d); ++i)
+    {
+        auto& name = m_CubeInstanceNames[i];
+        name       = "Cube Instance " + std::to_string(idx);
+
+        auto& Inst        = Instances[idx];
+        Inst.InstanceName = name.c_str();
+        Inst.CustomId     = PackInstanceCustomId(m_SmallCubeMeshId, m_cubesCustomIds[i]);
+        Inst.pBLAS        = m_pSmallCubeBLAS;
+        Inst.Mask         = OPAQUE_GEOM_MASK;
+        Inst.Transform    = m_SmallCubeTransforms[i];
+        SetInstanceBounds(idx, -SmallCubeBounds, SmallCubeBounds,
+                          i < m_NumActiveSmallCubes && (m_CubeEditFlags[i] & INSTANCE_EDIT_FLAG_REMOVED) == 0 && !m_CubeClusters.IsInstanceMerged(i));
+
+        ++idx;
+        ++idx_c2;
+    }
+
+    if (m_pLoadedMeshBLAS)
+    {
+        // Diffuse material of GlassPrimaryHit.
+        auto& Inst        = Instances[idx];
+        Inst.InstanceName = "Mesh Instance";
+        Inst.CustomId     = PackInstanceCustomId(m_LoadedMeshId, 1);
+        Inst.pBLAS        = m_pLoadedMeshBLAS;
+        Inst.Mask         = OPAQUE_GEOM_MASK;
+        Inst.Transform    = m_LoadedMeshTransform;
+        SetInstanceBounds(idx, m_LoadedMeshBoundsMin, m_LoadedMeshBoundsMax, true);
+
+        ++idx;
+    }
+
+    // Cluster proxies hold their geometry in world space, so they use the identity transform.
+    VERIFY_EXPR(idx == static_cast<int>(Layout.FirstSphereCluster));
+    const auto& SphereClusters = m_SphereClusters.GetClusters();
+    const auto& CubeClusters   = m_CubeClusters.GetClusters();
+    m_ClusterInstanceNames.resize(SphereClusters.size() + CubeClusters.size());
+    for (size_t k = 0; k < SphereClusters.size(); ++k)
+    {
+        auto& name = m_ClusterInstanceNames[k];
+        name       = "Sphere Cluster " + std::to_string(k);
+
+        auto& Inst        = Instances[idx];
+        Inst.InstanceName = name.c_str();
+        Inst.CustomId     = m_SphereClusterFirstBoxes[k];
+        Inst.pBLAS        = m_SphereClusterBLASes[k];
+        Inst.Mask         = OPAQUE_GEOM_MASK;
+        SetInstanceBounds(idx, SphereClusters[k].BoundsMin, SphereClusters[k].BoundsMax, SphereClusters[k].UseProxy);
+
+        ++idx;
+    }
+    for (size_t k = 0; k < CubeClusters.size(); ++k)
+    {
+        auto& name = m_ClusterInstanceNames[SphereClusters.size() + k];
+        name       = "Cube Cluster " + std::to_string(k);
+
+        auto& Inst        = Instances[idx];
+        Inst.InstanceName = name.c_str();
+        Inst.CustomId     = PackInstanceCustomId(m_CubeClusterMeshIds[k], CubeClusters[k].Key);
+        Inst.pBLAS        = m_CubeClusterBLASes[k];
+        Inst.Mask         = OPAQUE_GEOM_MASK;
+        SetInstanceBounds(idx, CubeClusters[k].BoundsMin, CubeClusters[k].BoundsMax, CubeClusters[k].UseProxy);
+
+        ++idx;
+    }
+    VERIFY_EXPR(idx == NumInstances);
+
+    if (m_SceneQueryActiveSpheres != m_NumActiveSmallSpheres || m_SceneQueryActiveCubes != m_NumActiveSmallCubes)
+        UpdateSceneQuery(Instances);
+
+    // Inactive instances are removed from the build rather than masked out. With distance
+    // culling, distant instances outside of the view are removed as well.
+    InstanceCuller::CullAttribs CullAttribs;
+    {
+        ViewFrustum Frustum;
+        ExtractViewFrustumPlanesFromMatrix(m_Camera.GetViewMatrix() * m_Camera.GetProjMatrix(), Frustum, false);
+        for (Uint32 p = 0; p < ViewFrustum::NUM_PLANES; ++p)
+        {
+            const auto& Plane            = Frustum.GetPlane(static_cast<ViewFrustum::PLANE_IDX>(p));
+            CullAttribs.FrustumPlanes[p] = float4{Plane.Normal, Plane.Distance};
+        }
+        CullAttribs.CameraPos    = m_Camera.GetPos();
+        CullAttribs.CullDistance = m_DistanceCulling ? m_CullDistance : 0.f;
+    }
+    const auto& VisibleIds = m_InstanceCuller.Cull(CullAttribs);
+
+    std::vector<TLASBuildInstanceData> VisibleInstances;
+    VisibleInstances.reserve(VisibleIds.size());
+    for (const auto Id : VisibleIds)
+        VisibleInstances.push_back(Instances[Id]);
+
+    // A TLAS can only be updated with the instances it was built with, so the slot is rebuilt
+    // when the set of instances changes.
+    const bool IsUpdate = Slot.IsBuilt && Slot.InstanceIds == VisibleIds;
+    Slot.InstanceIds    = VisibleIds;
+
+    // All builds are serialized on the build context, so every TLAS build starts a new
+    // scratch batch and reuses the memory of the previous builds.
+    m_pScratchAllocator->Reset();
+
+    const auto& ScratchSizes = Slot.pTLAS->GetScratchBufferSizes();
+    const auto  Scratch      = m_pScratchAllocator->Allocate(IsUpdate ? ScratchSizes.Update : ScratchSizes.Build);
+
+    // Do not overwrite the slot until the trace queue is done reading it.
+    if (m_AsyncASBuild && Build.WaitTraceFenceValue > 0)
+        m_pBuildContext->DeviceWaitForFence(m_pTraceFence, Build.WaitTraceFenceValue);
+
+    // The TLAS is shared between the queues, so its states are transitioned explicitly.
+    // Instance and scratch buffers are only used by the build context and BLASes were
+    // transitioned to RESOURCE_STATE_BUILD_AS_READ once after they had been built.
+    StateTransitionDesc Barrier{Slot.pTLAS, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_BUILD_AS_WRITE, STATE_TRANSITION_FLAG_UPDATE_STATE};
+    m_pBuildContext->TransitionResourceStates(1, &Barrier);
+
+    // Build or update TLAS
+    BuildTLASAttribs Attribs;
+    Attribs.pTLAS                        = Slot.pTLAS;
+    Attribs.Update                       = IsUpdate;
+    Attribs.pScratchBuffer               = Scratch.pBuffer;
+    Attribs.ScratchBufferOffset          = Scratch.Offset;
+    Attribs.pInstanceBuffer              = Slot.pInstanceBuffer;
+    Attribs.pInstances                   = VisibleInstances.data();
+    Attribs.InstanceCount                = static_cast<Uint32>(VisibleInstances.size());
+    Attribs.BindingMode                  = HIT_GROUP_BINDING_MODE_USER_DEFINED;
+    Attribs.TLASTransitionMode           = RESOURCE_STATE_TRANSITION_MODE_VERIFY;
+    Attribs.BLASTransitionMode           = RESOURCE_STATE_TRANSITION_MODE_VERIFY;
+    Attribs.InstanceBufferTransitionMode = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
+    Attribs.ScratchBufferTransitionMode  = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
+
+    m_pBuildContext->BuildTLAS(Attribs);
+    Slot.IsBuilt = true;
+
+    Barrier = StateTransitionDesc{Slot.pTLAS, RESOURCE_STATE_BUILD_AS_WRITE, RESOURCE_STATE_RAY_TRACING, STATE_TRANSITION_FLAG_UPDATE_STATE};
+    m_pBuildContext->TransitionResourceStates(1, &Barrier);
+
+    // Instance indices in the TLAS change with the set of culled instances, so shaders look up
+    // the fixed index of every instance, see GetInstanceObjectId(). Updates keep the same instances.
+    if (!IsUpdate)
+    {
+        m_pBuildContext->UpdateBuffer(Slot.pObjectIdBuffer, 0, sizeof(Uint32) * VisibleIds.size(), VisibleIds.data(), RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+        Barrier = StateTransitionDesc{Slot.pObjectIdBuffer, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_SHADER_RESOURCE, STATE_TRANSITION_FLAG_UPDATE_STATE};
+        m_pBuildContext->TransitionResourceStates(1, &Barrier);
+    }
+
+    if (m_AsyncASBuild)
+    {
+        m_pBuildContext->EnqueueSignal(m_pBuildFence, Build.SignalBuildFenceValue);
+        m_pBuildContext->Flush();
+        // The sample application only finishes the frame in the main immediate context.
+        m_pBuildContext->FinishFrame();
+    }
+}
+
+void Tutorial21_RayTracing::UpdateSceneQuery(const std::vector<TLASBuildInstanceData>& TLASInstances)
+{
+    // Queries see the active instances with their full geometry, never the cluster proxies.
+    const auto Layout = GetInstanceLayout();
+
+    std::vector<SceneQuery::Instance> Instances;
+    const auto                        AddInstance = [&](Uint32 Idx, const std::shared_ptr<const SceneQuery::Geometry>& pGeometry) {
+        SceneQuery::Instance Inst;
+        Inst.pGeometry     = pGeometry;
+        Inst.Transform     = TLASInstances[Idx].Transform;
+        Inst.InstanceIndex = Idx;
+        Inst.CustomId      = TLASInstances[Idx].CustomId;
+        Instances.push_back(Inst);
+    };
+
+    for (Uint32 i = 0; i < Layout.FirstSphere; ++i)
+        AddInstance(i, m_pQueryCubeGeometry);
+
+    const Uint32 NumSpheres = std::min(static_cast<Uint32>(std::max(m_NumActiveSmallSpheres, 0)), Layout.FirstCube - Layout.FirstSphere);
+    for (Uint32 i = 0; i < NumSpheres; ++i)
+    {
+        if ((m_SphereEditFlags[i] & INSTANCE_EDIT_FLAG_REMOVED) != 0)
+            continue;
+
+        AddInstance(Layout.FirstSphere + i, m_pQuerySphereGeometry);
+    }
+
+    const Uint32 NumCubes = std::min(static_cast<Uint32>(std::max(m_NumActiveSmallCubes, 0)), Layout.LoadedMesh - Layout.FirstCube);
+    for (Uint32 i = 0; i < NumCubes; ++i)
+    {
+        if ((m_CubeEditFlags[i] & INSTANCE_EDIT_FLAG_REMOVED) != 0)
+            continue;
+
+        AddInstance(Layout.FirstCube + i, m_pQuerySmallCubeGeometry);
+    }
+
+    if (m_pLoadedMeshBLAS)
+        AddInstance(Layout.LoadedMesh, m_pQueryLoadedMeshGeometry);
+
+    // Threads that are tracing the previous scene keep it alive until they are done. Only the
+    // pointer is swapped under the lock; the scene is built and the previous one released outside.
+    std::shared_ptr<const SceneQuery> pQuery = std::make_shared<SceneQuery>(std::move(Instances));
+    {
+        std::lock_guard<std::mutex> Lock{m_SceneQueryMtx};
+        m_pSceneQuery.swap(pQuery);
+    }
+    m_SceneQueryActiveSpheres = m_NumActiveSmallSpheres;
+    m_SceneQueryActiveCubes   = m_NumActiveSmallCubes;
+}
+
+void Tutorial21_RayTracing::RunSceneQueryBenchmark(Uint32 NumRays)
+{
+    const auto pQuery = GetSceneQuery();
+    if (!pQuery)
+        return;
+
+    const auto Result = pQuery->RunBenchmark(m_Camera.GetPos(), NumRays);
+    LOG_INFO_MESSAGE("Scene query benchmark: ", Result.NumRays, " rays, ", pQuery->GetNumInstances(), " instances, ",
+                     Result.NumClosestHits, " hits. Closest hit: ", static_cast<Uint64>(Result.ClosestRaysPerMs * 1000), " rays/s, any hit: ",
+                     static_cast<Uint64>(Result.AnyRaysPerMs * 1000), " rays/s");
+}
+
+SoftwareTracer::Scene Tutorial21_RayTracing::CreateTracerScene(Uint32 Width, Uint32 Height) const
+{
+    // The scene is built from the CPU data only, so that it is available without ray tracing support.
+    const auto Layout = GetInstanceLayout();
+
+    SoftwareTracer::Scene Scene;
+    Scene.Meshes                     = m_TracerMeshes;
+    Scene.Lights                     = m_Lights;
+    Scene.Constants                  = m_Constants;
+    Scene.Constants.PixelSpreadAngle = ComputePixelSpreadAngle(PI_F / 4.f, Height);
+
+    // Instances have the shading model of their hit groups, see CreateSBT().
+    const auto AddInstance = [&](Uint32 Geometry, SoftwareTracer::MATERIAL_TYPE Material, Uint32 ObjectId, const InstanceMatrix& Transform) {
+        SoftwareTracer::Instance Inst;
+        Inst.Geometry  = Geometry;
+        Inst.Material  = Material;
+        Inst.ObjectId  = ObjectId;
+        Inst.Transform = Transform;
+        Scene.Instances.push_back(Inst);
+    };
+
+    // User ids of GlassPrimaryHit: 0 - glass, 1 - diffuse, 2 - metal.
+    const SoftwareTracer::MATERIAL_TYPE GlassCubeMaterials[] = {SoftwareTracer::MATERIAL_TYPE_GLASS, SoftwareTracer::MATERIAL_TYPE_DIFFUSE, SoftwareTracer::MATERIAL_TYPE_METAL};
+    const SoftwareTracer::MATERIAL_TYPE SphereMaterials[]    = {SoftwareTracer::MATERIAL_TYPE_MIRROR_SPHERE, SoftwareTracer::MATERIAL_TYPE_DIFFUSE_SPHERE, SoftwareTracer::MATERIAL_TYPE_GLASS_SPHERE};
+
+    // Instances use their index in the TLAS as the object id, see GetInstanceObjectId() in MeshAttribs.fxh.
+    AddInstance(TRACER_MESH_CUBE, SoftwareTracer::MATERIAL_TYPE_GROUND, 0, GetFixedInstanceTransform(0));
+    for (Uint32 i = 1; i < Layout.FirstSphere; ++i)
+        AddInstance(TRACER_MESH_CUBE, GlassCubeMaterials[i - 1], i, GetFixedInstanceTransform(i));
+
+    // Same instances as in UpdateSceneQuery(): active and not removed, with their full geometry.
+    const Uint32 NumSpheres = std::min(static_cast<Uint32>(std::max(m_NumActiveSmallSpheres, 0)), Layout.FirstCube - Layout.FirstSphere);
+    for (Uint32 i = 0; i < NumSpheres; ++i)
+    {
+        if ((m_SphereEditFlags[i] & INSTANCE_EDIT_FLAG_REMOVED) != 0)
+            continue;
+
+        AddInstance(SoftwareTracer::SphereGeometry, SphereMaterials[m_SphereInstanceMatIds[i]], Layout.FirstSphere + i, m_SmallSphereTransforms[i]);
+    }
+
+    const Uint32 NumCubes = std::min(static_cast<Uint32>(std::max(m_NumActiveSmallCubes, 0)), Layout.LoadedMesh - Layout.FirstCube);
+    for (Uint32 i = 0; i < NumCubes; ++i)
+    {
+        if ((m_CubeEditFlags[i] & INSTANCE_EDIT_FLAG_REMOVED) != 0)
+            continue;
+
+        AddInstance(TRACER_MESH_SMALL_CUBE, m_cubesCustomIds[i] == 1 ? SoftwareTracer::MATERIAL_TYPE_TEXTURED : GlassCubeMaterials[m_cubesCustomIds[i]],
+                    Layout.FirstCube + i, m_SmallCubeTransforms[i]);
+    }
+
+    if (m_pQueryLoadedMeshGeometry)
+        AddInstance(TRACER_MESH_LOADED, SoftwareTracer::MATERIAL_TYPE_DIFFUSE, Layout.LoadedMesh, m_LoadedMeshTransform);
+
+    // Materials are indexed by their type. The CPU renderer does not sample textures, so all
+    // materials, including the textured ones, use a constant gray base color.
+    Scene.Materials.resize(SoftwareTracer::MATERIAL_TYPE_COUNT);
+    for (Uint32 i = 0; i < SoftwareTracer::MATERIAL_TYPE_COUNT; ++i)
+    {
+        Scene.Materials[i].Type      = static_cast<SoftwareTracer::MATERIAL_TYPE>(i);
+        Scene.Materials[i].BaseColor = float3{0.5f, 0.5f, 0.5f};
+    }
+
+    // Same camera as in Render() with the projection of WindowResize() for the image size, which
+    // does not depend on the swap chain. The tracer only unprojects points on the far plane, which
+    // is at z = 1 with either depth range, so the projection does not depend on the device either.
+    const auto Proj         = float4x4::Projection(PI_F / 4.f, static_cast<float>(Width) / static_cast<float>(Height),
+                                                   m_Constants.ClipPlanes.x, m_Constants.ClipPlanes.y, false);
+    Scene.Frame.CameraPos   = float4{m_Camera.GetPos(), 1.0f};
+    Scene.Frame.InvViewProj = (m_Camera.GetViewMatrix() * Proj).Inverse();
+    Scene.Frame.FrameIndex    = m_FrameIndex;
+    Scene.Frame.AccumWeight   = 1.f;
+    return Scene;
+}
+
+void Tutorial21_RayTracing::RunDistributedBenchmark(Uint32 MaxWorkers)
+{
+    const Uint32 Width   = CPUModeImageWidth;
+    const Uint32 Height  = CPUModeImageHeight;
+    const auto   Scene   = CreateTracerScene(Width, Height);
+    const auto   Results = DistributedRenderer::RunScalingBenchmark(Scene, Width, Height, MaxWorkers);
+    for (const auto& Result : Results)
+    {
+        LOG_INFO_MESSAGE("Distributed benchmark: ", Width, "x", Height, " with ", Result.NumWorkers, " workers in ", Result.RenderMs,
+                         " ms, speedup ", Result.Speedup, ", efficiency ", Result.Efficiency);
+    }
+
+    // Workers on other machines are started with --render-worker <host>:<port> <token> and render the same image once.
+    if (m_DistributedListenPort != 0)
+    {
+        DistributedRenderer Renderer;
+        Renderer.SetScene(Scene);
+        LOG_INFO_MESSAGE("Waiting for ", MaxWorkers, " remote render workers. Start them with --render-worker <host>:", m_DistributedListenPort, " ", Renderer.GetToken());
+        const auto NumRemote = Renderer.AcceptWorkers(m_DistributedListenHost.c_str(), m_DistributedListenPort, MaxWorkers, /*TimeoutMs = */ 30000);
+        if (NumRemote > 0)
+        {
+            std::vector<float4> Pixels(size_t{Width} * Height);
+            Renderer.Render(Width, Height, 32, Pixels.data());
+            const auto& Stats = Renderer.GetLastRenderStats();
+            LOG_INFO_MESSAGE("Distributed benchmark: ", Width, "x", Height, " with ", NumRemote, " remote workers in ", Stats.RenderMs,
+                             " ms, ", Stats.NumLocalTiles, " of ", Stats.NumTiles, " tiles rendered locally");
+        }
+        Renderer.Stop();
+    }
+}
+
+void Tutorial21_RayTracing::RunMaterialBenchmark(Uint32 NumIterations)
+{
+    // Shade the primary hits of the current view, which have the material mix of a real frame.
+    const SoftwareTracer                       Tracer{CreateTracerScene(CPUModeImageWidth, CPUModeImageHeight)};
+    std::vector<SurfaceHit>                    Hits;
+    std::vector<SoftwareTracer::MATERIAL_TYPE> Types;
+    Tracer.CollectPrimaryHits(CPUModeImageWidth, CPUModeImageHeight, Hits, Types);
+
+    const auto Result = MaterialBatchShader::RunBenchmark(Tracer.GetMaterialConstants(), Hits, Types, NumIterations);
+    LOG_INFO_MESSAGE("Material benchmark: ", Result.NumHits, " hits, virtual dispatch ", Result.VirtualNsPerHit, " ns/hit, batched kernels ",
+                     Result.BatchNsPerHit, " ns/hit, speedup ", Result.Speedup, ", max difference ", Result.MaxDifference);
+}
+
+bool Tutorial21_RayTracing::RenderOfflineSequence()
+{
+    const Uint32 Width  = m_OfflineWidth > 0 ? m_OfflineWidth : CPUModeImageWidth;
+    const Uint32 Height = m_OfflineHeight > 0 ? m_OfflineHeight : CPUModeImageHeight;
+
+    SoftwareTracer Tracer{CreateTracerScene(Width, Height)};
+
+    FrameSequenceWriter::CreateInfo WriterCI;
+    WriterCI.Directory = m_OfflineOutputDir;
+    WriterCI.Format    = m_OfflineFormat;
+    FrameSequenceWriter Writer{WriterCI};
+
+    // The camera makes one orbit around the vertical axis of the scene. Rotating the world
+    // around the axis before the view transform moves the camera the opposite way.
+    const auto View      = m_Camera.GetViewMatrix();
+    const auto Proj      = float4x4::Projection(PI_F / 4.f, static_cast<float>(Width) / static_cast<float>(Height),
+                                                m_Constants.ClipPlanes.x, m_Constants.ClipPlanes.y, false);
+    const auto CameraPos = float4{m_Camera.GetPos(), 1.f};
+    const auto StartTime = std::chrono::high_resolution_clock::now();
+    double     TraceMs   = 0;
+    for (Uint32 i = 0; i < m_OfflineFrames; ++i)
+    {
+        const float Angle = 2.f * PI_F * static_cast<float>(i) / static_cast<float>(m_OfflineFrames);
+
+        HLSL::FrameConstants Frame = Tracer.GetScene().Frame;
+        Frame.InvViewProj          = (float4x4::RotationY(Angle) * View * Proj).Inverse();
+        Frame.CameraPos            = CameraPos * float4x4::RotationY(-Angle);
+        Frame.FrameIndex           = i;
+        Tracer.SetFrame(Frame);
+
+        // Frame i is traced while the writer threads encode and write the previous frames.
+        FrameSequenceWriter::Frame Output;
+        Output.Index  = i;
+        Output.Width  = Width;
+        Output.Height = Height;
+        Output.Pixels = Writer.AcquirePixels(size_t{Width} * Height);
+
+        const auto TraceStart = std::chrono::high_resolution_clock::now();
+        Tracer.Render(Width, Height, Output.Pixels.data());
+        TraceMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - TraceStart).count();
+
+        Writer.Submit(std::move(Output));
+    }
+    Writer.Finish();
+
+    const double TotalMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - StartTime).count();
+    const auto   Stats   = Writer.GetStats();
+    LOG_INFO_MESSAGE("Offline sequence: ", Stats.NumFrames, " of ", m_OfflineFrames, " frames (", Width, "x", Height, ") written to '",
+                     m_OfflineOutputDir, "' in ", TotalMs / 1000.0, " s, ", Stats.NumFrames * 60000.0 / std::max(TotalMs, 1.0),
+                     " frames per minute. Trace ", TraceMs, " ms, encode ", Stats.EncodeMs, " ms, write ", Stats.WriteMs,
+                     " ms, blocked on full queue ", Stats.SubmitWaitMs, " ms");
+    return Stats.NumFrames == m_OfflineFrames;
+}
+
+bool Tutorial21_RayTracing::RunReferenceSuite() const
+{
+    ReferenceImageSuite::CreateInfo SuiteCI;
+    SuiteCI.Directory    = m_ReferenceSuiteDir;
+    SuiteCI.UpdateGolden = m_UpdateReferenceImages;
+    ReferenceImageSuite Suite{SuiteCI};
+
+    const auto Results   = Suite.Run();
+    const bool AllPassed = ReferenceImageSuite::AllPassed(Results);
+
+    double TotalMs = 0;
+    for (const auto& Result : Results)
+        TotalMs += Result.RenderMs;
+    if (AllPassed)
+        LOG_INFO_MESSAGE("Reference image suite passed: ", Results.size(), " images rendered in ", TotalMs, " ms");
+    else
+        LOG_ERROR_MESSAGE("Reference image suite failed, see '", m_ReferenceSuiteDir, "' for the rendered images and differences");
+    return AllPassed;
+}
+
+bool Tutorial21_RayTracing::HasCPUModes() const
+{
+    return m_DistributedBenchmarkWorkers > 0 ||
+           m_MaterialBenchmarkIterations > 0 ||
+           m_OfflineFrames > 0 ||
+           m_HierarchyBenchmarkCopies > 0 ||
+           m_ClusterBenchmarkCopies > 0 ||
+           (m_VariableRateBenchmarkWidth > 0 && m_VariableRateBenchmarkHeight > 0);
+}
+
+bool Tutorial21_RayTracing::RunCPUModes()
+{
+    // Offline sequences are rendered by the CPU tracer only; reading back GPU frames into
+    // FrameSequenceWriter is not supported.
+    bool Success = true;
+    if (m_DistributedBenchmarkWorkers > 0)
+        RunDistributedBenchmark(m_DistributedBenchmarkWorkers);
+    if (m_MaterialBenchmarkIterations > 0)
+        RunMaterialBenchmark(m_MaterialBenchmarkIterations);
+    if (m_OfflineFrames > 0)
+        Success = RenderOfflineSequence() && Success;
+    if (m_HierarchyBenchmarkCopies > 0)
+        RunHierarchyBenchmark(m_HierarchyBenchmarkCopies);
+    if (m_ClusterBenchmarkCopies > 0)
+        RunClusterBenchmark(m_ClusterBenchmarkCopies);
+    if (m_VariableRateBenchmarkWidth > 0 && m_VariableRateBenchmarkHeight > 0)
+        RunVariableRateBenchmark();
+    return Success;
+}
+
+void Tutorial21_RayTracing::Update(double CurrTime, double ElapsedTime)
+{
+    SampleBase::Update(CurrTime, ElapsedTime);
+    if (!m_pRayTracingPSO)
+        return;
+
+    UpdateUI();
+
+    if (m_Animate)
+    {
+        m_AnimationTime += static_cast<float>(std::min(m_MaxAnimationTimeDelta, ElapsedTime));
+    }
+
+    if (m_NumExtraLights != m_UploadedExtraLights)
+        UpdateLights();
+
+    m_Camera.Update(m_InputController, static_cast<float>(ElapsedTime));
+
+    // Do not allow going underground
+    auto oldPos = m_Camera.GetPos();
+    if (oldPos.y < -5.7f)
+    {
+        oldPos.y = -5.7f;
+        m_Camera.SetPos(oldPos);
+        m_Camera.Update(m_InputController, 0.f);
+    }
+}
+
+void Tutorial21_RayTracing::WindowResize(Uint32 Width, Uint32 Height)
+{
+    if (Width == 0 || Height == 0)
+        return;
+
+    // Update projection matrix.
+    float AspectRatio = static_cast<float>(Width) / static_cast<float>(Height);
+    m_Camera.SetProjAttribs(m_Constants.ClipPlanes.x, m_Constants.ClipPlanes.y, AspectRatio, PI_F / 4.f,
+                            m_pSwapChain->GetDesc().PreTransform, m_pDevice->GetDeviceInfo().NDC.MinZ == -1);
+    m_Constants.PixelSpreadAngle = ComputePixelSpreadAngle(PI_F / 4.f, Height);
+
+    // Check if the image needs to be recreated.
+    if (m_pColorRT != nullptr &&
+        m_pColorRT->GetDesc().Width == Width &&
+        m_pColorRT->GetDesc().Height == Height)
+        return;
+
+    m_pColorRT = nullptr;
+
+    // Create window-size color image.
+    TextureDesc RTDesc       = {};
+    RTDesc.Name              = "Color buffer";
+    RTDesc.Type              = RESOURCE_DIM_TEX_2D;
+    RTDesc.Width             = Width;
+    RTDesc.Height            = Height;
+    RTDesc.BindFlags         = BIND_UNORDERED_ACCESS | BIND_SHADER_RESOURCE;
+    RTDesc.ClearValue.Format = m_ColorBufferFormat;
+    RTDesc.Format            = m_ColorBufferFormat;
+
+    m_pDevice->CreateTexture(RTDesc, nullptr, &m_pColorRT);
+
+    // Create the accumulation buffer with enough precision to average many frames.
+    m_pAccumRT               = nullptr;
+    RTDesc.Name              = "Accumulation buffer";
+    RTDesc.BindFlags         = BIND_UNORDERED_ACCESS;
+    RTDesc.ClearValue.Format = TEX_FORMAT_RGBA16_FLOAT;
+    RTDesc.Format            = TEX_FORMAT_RGBA16_FLOAT;
+
+    m_pDevice->CreateTexture(RTDesc, nullptr, &m_pAccumRT);
+    m_NumAccumFrames = 0;
+
+    // Create the G-buffer that guides the denoiser and the targets of the filter passes.
+    RTDesc.BindFlags = BIND_UNORDERED_ACCESS | BIND_SHADER_RESOURCE;
+
+    m_pGBufferDepth          = nullptr;
+    RTDesc.Name              = "G-buffer depth";
+    RTDesc.ClearValue.Format = TEX_FORMAT_R32_FLOAT;
+    RTDesc.Format            = TEX_FORMAT_R32_FLOAT;
+    m_pDevice->CreateTexture(RTDesc, nullptr, &m_pGBufferDepth);
+
+    m_pGBufferNormal         = nullptr;
+    RTDesc.Name              = "G-buffer normal";
+    RTDesc.ClearValue.Format = TEX_FORMAT_RGBA16_FLOAT;
+    RTDesc.Format            = TEX_FORMAT_RGBA16_FLOAT;
+    m_pDevice->CreateTexture(RTDesc, nullptr, &m_pGBufferNormal);
+
+    m_pGBufferObjectId       = nullptr;
+    RTDesc.Name              = "G-buffer object id";
+    RTDesc.ClearValue.Format = TEX_FORMAT_R32_UINT;
+    RTDesc.Format            = TEX_FORMAT_R32_UINT;
+    m_pDevice->CreateTexture(RTDesc, nullptr, &m_pGBufferObjectId);
+
+    // The filter passes store the color and its variance.
+    RTDesc.ClearValue.Format = TEX_FORMAT_RGBA16_FLOAT;
+    RTDesc.Format            = TEX_FORMAT_RGBA16_FLOAT;
+    for (auto& pRT : m_pDenoiseRT)
+    {
+        pRT         = nullptr;
+        RTDesc.Name = "Denoise target";
+        m_pDevice->CreateTexture(RTDesc, nullptr, &pRT);
+    }
+
+    // One texel per tile of variable-rate tracing. The new G-buffer holds no frame to classify yet.
+    m_pTileRates             = nullptr;
+    RTDesc.Name              = "Variable-rate tile rates";
+    RTDesc.Width             = (Width + VRT_TILE_SIZE - 1) / VRT_TILE_SIZE;
+    RTDesc.Height            = (Height + VRT_TILE_SIZE - 1) / VRT_TILE_SIZE;
+    RTDesc.ClearValue.Format = TEX_FORMAT_R8_UINT;
+    RTDesc.Format            = TEX_FORMAT_R8_UINT;
+    m_pDevice->CreateTexture(RTDesc, nullptr, &m_pTileRates);
+    m_VariableRateHistory = false;
+}
+void Tutorial21_RayTracing::InitializeConstants()
+{
+    m_Constants.ClipPlanes     = float2{0.1f, 100.0f};
+    m_Constants.TextureLODMode = TEXTURE_LOD_MODE_RAY_CONES;
+    m_Constants.ShadowPCF      = 1;
+    m_Constants.MaxRecursion   = std::min(Uint32{6}, m_MaxRecursionDepth);
+    m_Constants.LightSamples   = 2;
+
+    // Sphere constants.
+    m_Constants.SphereReflectionColorMask = {0.81f, 1.0f, 0.45f};
+    m_Constants.SphereReflectionBlur      = 1;
+
+    // Glass cube constants.
+    m_Constants.GlassReflectionColorMask = {0.22f, 0.83f, 0.93f};
+    m_Constants.GlassAbsorption          = 0.5f;
+    m_Constants.GlassMaterialColor       = {0.33f, 0.93f, 0.29f};
+    m_Constants.GlassIndexOfRefraction   = {1.5f, 1.5f + m_DispersionFactor};
+    m_Constants.GlassEnableDispersion    = 0;
+
+    // Wavelength to RGB and index of refraction interpolation factor.
+    m_Constants.DispersionSamples[0]  = {0.140000f, 0.000000f, 0.266667f, 0.53f};
+    m_Constants.DispersionSamples[1]  = {0.130031f, 0.037556f, 0.612267f, 0.25f};
+    m_Constants.DispersionSamples[2]  = {0.100123f, 0.213556f, 0.785067f, 0.16f};
+    m_Constants.DispersionSamples[3]  = {0.050277f, 0.533556f, 0.785067f, 0.00f};
+    m_Constants.DispersionSamples[4]  = {0.000000f, 0.843297f, 0.619682f, 0.13f};
+    m_Constants.DispersionSamples[5]  = {0.000000f, 0.927410f, 0.431834f, 0.38f};
+    m_Constants.DispersionSamples[6]  = {0.000000f, 0.972325f, 0.270893f, 0.27f};
+    m_Constants.DispersionSamples[7]  = {0.000000f, 0.978042f, 0.136858f, 0.19f};
+    m_Constants.DispersionSamples[8]  = {0.324000f, 0.944560f, 0.029730f, 0.47f};
+    m_Constants.DispersionSamples[9]  = {0.777600f, 0.871879f, 0.000000f, 0.64f};
+    m_Constants.DispersionSamples[10] = {0.972000f, 0.762222f, 0.000000f, 0.77f};
+    m_Constants.DispersionSamples[11] = {0.971835f, 0.482222f, 0.000000f, 0.62f};
+    m_Constants.DispersionSamples[12] = {0.886744f, 0.202222f, 0.000000f, 0.73f};
+    m_Constants.DispersionSamples[13] = {0.715967f, 0.000000f, 0.000000f, 0.68f};
+    m_Constants.DispersionSamples[14] = {0.459920f, 0.000000f, 0.000000f, 0.91f};
+    m_Constants.DispersionSamples[15] = {0.218000f, 0.000000f, 0.000000f, 0.99f};
+    m_Constants.DispersionSampleCount = MAX_DISPERS_SAMPLES;
+
+    // Distribution used to select one wavelength per path, see SpectralDispersion.hpp.
+    float3 InvColorSum;
+    ComputeDispersionDistribution(m_Constants.DispersionSamples, MAX_DISPERS_SAMPLES, &m_Constants.DispersionCDF[0].x, InvColorSum);
+    m_Constants.DispersionInvColorSum = float4{InvColorSum, 0};
+
+    // Modificar el color del cielo (ambiente) a gris
+    m_Constants.AmbientColor  = float4(0.5f, 0.5f, 0.5f, 0.f) * 0.025f;
+    m_Constants.LightPos[0]   = {8.00f, +8.0f, +0.00f, 0.f};
+    m_Constants.LightColor[0] = {1.00f, +0.8f, +0.80f, 0.f};
+    m_Constants.LightPos[1]   = {0.00f, +4.0f, -5.00f, 0.f};
+    m_Constants.LightColor[1] = {0.85f, +1.0f, +0.85f, 0.f};
+
+    // Random points on disc.
+    m_Constants.DiscPoints[0] = {+0.0f, +0.0f, +0.9f, -0.9f};
+    m_Constants.DiscPoints[1] = {-0.8f, +1.0f, -1.1f, -0.8f};
+    m_Constants.DiscPoints[2] = {+1.5f, +1.2f, -2.1f, +0.7f};
+    m_Constants.DiscPoints[3] = {+0.1f, -2.2f, -0.2f, +2.4f};
+    m_Constants.DiscPoints[4] = {+2.4f, -0.3f, -3.0f, +2.8f};
+    m_Constants.DiscPoints[5] = {+2.0f, -2.6f, +0.7f, +3.5f};
+    m_Constants.DiscPoints[6] = {-3.2f, -1.6f, +3.4f, +2.2f};
+    m_Constants.DiscPoints[7] = {-1.8f, -3.2f, -1.1f, +3.6f};
+}
+
+void Tutorial21_RayTracing::InitializeScene()
+{
+    // Scene data is taken from the scene cache when it is valid, and is recorded into a new cache otherwise.
+    OpenSceneCache();
+
+    // Instance clusters are built together with the BLASes, so the layout goes first.
+    CreateInstanceLayout();
+    LoadSceneMeshes();
+
+    // Setup camera.
+    m_Camera.SetPos(float3(7.f, -0.5f, -16.5f));
+    m_Camera.SetRotation(0.48f, -0.145f);
+    m_Camera.SetRotationSpeed(0.005f);
+    m_Camera.SetMoveSpeed(5.f);
+    m_Camera.SetSpeedUpScales(5.f, 10.f);
+
+    // The CPU renderer only reads the meshes, instances, constants and lights, so nothing here needs the device.
+    InitializeConstants();
+    GenerateLights();
+    static_assert(sizeof(HLSL::Constants) % 16 == 0, "must be aligned by 16 bytes");
+}
+
+void Tutorial21_RayTracing::Initialize(const SampleInitInfo& InitInfo)
+{
+    SampleBase::Initialize(InitInfo);
+
+    // The CPU denoiser does not need ray tracing support.
+    if (m_DenoiseBenchmarkWidth > 0 && m_DenoiseBenchmarkHeight > 0)
+        RunDenoiseBenchmark();
+    if (m_ReadbackBenchmarkWidth > 0 && m_ReadbackBenchmarkHeight > 0)
+        RunReadbackBenchmark();
+
+    using Clock               = std::chrono::high_resolution_clock;
+    const auto ElapsedMs      = [](Clock::time_point Start) { return std::chrono::duration<double, std::milli>(Clock::now() - Start).count(); };
+    auto       SceneLoadStart = Clock::now();
+    InitializeScene();
+    double SceneLoadMs = ElapsedMs(SceneLoadStart);
+
+    if ((m_pDevice->GetAdapterInfo().RayTracing.CapFlags & RAY_TRACING_CAP_FLAG_STANDALONE_SHADERS) == 0)
+    {
+        UNSUPPORTED("Ray tracing shaders are not supported by device");
+        return;
+    }
+
+    // Use the compute queue context requested in ModifyEngineInitInfo() for acceleration structure builds.
+    m_pBuildContext = m_pImmediateContext;
+    if (InitInfo.NumImmediateCtx > 1 && m_pDevice->GetDeviceInfo().Features.NativeFence)
+    {
+        m_pBuildContext = InitInfo.ppContexts[1];
+        m_AsyncASBuild  = true;
+        m_ASContextMask = (Uint64{1} << m_pImmediateContext->GetDesc().ContextId) | (Uint64{1} << m_pBuildContext->GetDesc().ContextId);
+
+        FenceDesc FenceCI;
+        FenceCI.Type = FENCE_TYPE_GENERAL;
+
+        FenceCI.Name = "AS build fence";
+        m_pDevice->CreateFence(FenceCI, &m_pBuildFence);
+        VERIFY_EXPR(m_pBuildFence != nullptr);
+
+        FenceCI.Name = "Trace fence";
+        m_pDevice->CreateFence(FenceCI, &m_pTraceFence);
+        VERIFY_EXPR(m_pTraceFence != nullptr);
+    }
+
+    m_pScratchAllocator = std::make_unique<ScratchBufferAllocator>(m_pDevice, m_ASContextMask);
+
+    // Create a buffer with shared constants.
+    BufferDesc BuffDesc;
+    BuffDesc.Name      = "Constant buffer";
+    BuffDesc.Size      = sizeof(m_Constants);
+    BuffDesc.Usage     = USAGE_DEFAULT;
+    BuffDesc.BindFlags = BIND_UNIFORM_BUFFER;
+
+    m_pDevice->CreateBuffer(BuffDesc, nullptr, &m_ConstantsCB);
+    VERIFY_EXPR(m_ConstantsCB != nullptr);
+
+    // Create a small dynamic buffer with constants that change every frame.
+    BuffDesc.Name           = "Frame constant buffer";
+    BuffDesc.Size           = sizeof(HLSL::FrameConstants);
+    BuffDesc.Usage          = USAGE_DYNAMIC;
+    BuffDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
+
+    m_pDevice->CreateBuffer(BuffDesc, nullptr, &m_FrameCB);
+    VERIFY_EXPR(m_FrameCB != nullptr);
+
+    // Shaders and pipelines compiled during previous launches are loaded from the cache.
+    m_pPipelineStateCache = std::make_unique<PipelineStateCache>(m_pDevice, m_PipelineCachePath);
+    m_MaxRecursionDepth   = std::min(m_MaxRecursionDepth, m_pDevice->GetAdapterInfo().RayTracing.MaxRecursionDepth);
+    m_Constants.MaxRecursion = std::min(m_Constants.MaxRecursion, static_cast<int>(m_MaxRecursionDepth));
+
+    CreateGraphicsPSO();
+    CreateDenoisePSOs();
+    CreateVariableRatePSOs();
+    {
+        RefCntAutoPtr<IShaderSourceInputStreamFactory> pShaderSourceFactory;
+        m_pEngineFactory->CreateDefaultShaderSourceStreamFactory(nullptr, &pShaderSourceFactory);
+
+        FrameReadback::CreateInfo ReadbackCI;
+        ReadbackCI.pDevice              = m_pDevice;
+        ReadbackCI.pStateCache          = m_pPipelineStateCache.get();
+        ReadbackCI.pShaderSourceFactory = pShaderSourceFactory;
+        m_pFrameReadback                = std::make_unique<FrameReadback>(ReadbackCI);
+    }
+
+    // The generic pipeline reads all settings from g_ConstantsCB. Its SRB is shared by all variants.
+    m_pRayTracingPSO = CreateRayTracingPSO(SETTING_NOT_SPECIALIZED, SETTING_NOT_SPECIALIZED, SETTING_NOT_SPECIALIZED);
+    m_pRayTracingPSO->CreateShaderResourceBinding(&m_pRayTracingSRB, true);
+    VERIFY_EXPR(m_pRayTracingSRB != nullptr);
+
+    SceneLoadStart = Clock::now();
+    LoadTextures();
+    CreateMeshBLASes();
+    CreateProceduralBLAS();
+
+    // BLASes are only read by TLAS builds from now on. Batched mesh BLASes are already transitioned.
+    {
+        std::vector<StateTransitionDesc> Barriers;
+        Barriers.emplace_back(m_pProceduralBLAS, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_BUILD_AS_READ, STATE_TRANSITION_FLAG_UPDATE_STATE);
+        for (auto& pBLAS : m_SphereClusterBLASes)
+            Barriers.emplace_back(pBLAS, RESOURCE_STATE_UNKNOWN, RESOURCE_STATE_BUILD_AS_READ, STATE_TRANSITION_FLAG_UPDATE_STATE);
+        m_pBuildContext->TransitionResourceStates(static_cast<Uint32>(Barriers.size()), Barriers.data());
+    }
+    CompactStaticBLASes();
+
+    UpdateTLAS();
+    m_pSBT = CreateSBT(m_pRayTracingPSO);
+    m_RayTracingPipelines[GetRayTracingPipelineKey(SETTING_NOT_SPECIALIZED, SETTING_NOT_SPECIALIZED, SETTING_NOT_SPECIALIZED)] = {m_pRayTracingPSO, m_pSBT};
+
+    const bool SceneFromCache = m_pSceneCacheReader != nullptr;
+    SaveSceneCache();
+    SceneLoadMs += ElapsedMs(SceneLoadStart);
+    LOG_INFO_MESSAGE("Scene loaded ", SceneFromCache ? "from cache " : "", "in ", SceneLoadMs, " ms");
+
+    UpdateASMemoryReport();
+    LOG_INFO_MESSAGE(m_ASMemoryReport.Format());
+
+    if (m_QueryBenchmarkRays > 0)
+        RunSceneQueryBenchmark(m_QueryBenchmarkRays);
+
+    UpdateLights();
+
+    // Create the pipeline variant for the initial settings and store all newly compiled states.
+    SelectRayTracingPipeline();
+    m_pPipelineStateCache->Save();
+}
+
+Tutorial21_RayTracing::InstanceLayout Tutorial21_RayTracing::GetInstanceLayout() const
+{
+    InstanceLayout Layout;
+    Layout.FirstSphere        = 4;
+    Layout.FirstCube          = Layout.FirstSphere + static_cast<Uint32>(m_SmallSphereTransforms.size());
+    Layout.LoadedMesh         = Layout.FirstCube + static_cast<Uint32>(m_SmallCubeTransforms.size());
+    Layout.FirstSphereCluster = Layout.LoadedMesh + (m_pQueryLoadedMeshGeometry ? 1 : 0);
+    Layout.FirstCubeCluster   = Layout.FirstSphereCluster + static_cast<Uint32>(m_SphereClusterBLASes.size());
+    Layout.NumInstances       = Layout.FirstCubeCluster + static_cast<Uint32>(m_CubeClusterBLASes.size());
+    return Layout;
+}
+
+RefCntAutoPtr<IShaderBindingTable> Tutorial21_RayTracing::CreateSBT(IPipelineState* pPSO)
+{
+    // Create shader binding table.
+    ShaderBindingTableDesc SBTDesc;
+    SBTDesc.Name = "SBT";
+    SBTDesc.pPSO = pPSO;
+
+    RefCntAutoPtr<IShaderBindingTable> pSBT;
+    m_pDevice->CreateSBT(SBTDesc, &pSBT);
+    VERIFY_EXPR(pSBT != nullptr);
+
+    // Instances are culled before TLAS builds, so hit groups are bound by the fixed index
+    // of every instance in UpdateTLAS() rather than by the instances of a TLAS.
+    const auto BindInstanceHitGroups = [&](size_t InstanceIdx, const char* PrimaryHitGroup, const char* ShadowHitGroup) {
+        const auto FirstIdx = static_cast<Uint32>(InstanceIdx) * HIT_GROUP_STRIDE;
+        pSBT->BindHitGroupByIndex(FirstIdx + PRIMARY_RAY_INDEX, PrimaryHitGroup);
+        pSBT->BindHitGroupByIndex(FirstIdx + SHADOW_RAY_INDEX, ShadowHitGroup);
+    };
+
+    pSBT->BindRayGenShader("Main");
+
+    pSBT->BindMissShader("PrimaryMiss", PRIMARY_RAY_INDEX);
+    pSBT->BindMissShader("ShadowMiss", SHADOW_RAY_INDEX);
+
+    // Ground and large cubes. Shadow rays only need the intersection shader of procedural
+    // geometry, so triangle geometry has no shadow hit group.
+    BindInstanceHitGroups(0, HG_Ground, nullptr);
+    BindInstanceHitGroups(1, HG_GlassCube, nullptr);
+    BindInstanceHitGroups(2, HG_GlassCube, nullptr);
+    BindInstanceHitGroups(3, HG_GlassCube, nullptr);
+
+    const auto Layout = GetInstanceLayout();
+
+    // Sphere materials are chosen by GenerateInstanceLayout().
+    const char* SphereHitGroups[] = {HG_SphereMetallic, HG_SphereDiffuse, HG_SphereGlass};
+    for (size_t i = 0; i < m_SphereInstanceNames.size(); ++i)
+        BindInstanceHitGroups(Layout.FirstSphere + i, SphereHitGroups[m_SphereInstanceMatIds[i]], HG_SphereShadow);
+
+    // Cube id 1 is diffuse, the others are glass.
+    const auto GetCubeHitGroup = [](Uint32 CubeId) {
+        return CubeId == 1 ? HG_Cube : HG_GlassCube;
+    };
+    for (size_t i = 0; i < m_CubeInstanceNames.size(); ++i)
+        BindInstanceHitGroups(Layout.FirstCube + i, GetCubeHitGroup(m_cubesCustomIds[i]), nullptr);
+
+    if (m_pLoadedMeshBLAS)
+        BindInstanceHitGroups(Layout.LoadedMesh, HG_GlassCube, nullptr);
+
+    // Clusters only contain instances with the same material, so proxies use the hit groups of their instances.
+    const auto& SphereClusters = m_SphereClusters.GetClusters();
+    for (size_t k = 0; k < SphereClusters.size(); ++k)
+        BindInstanceHitGroups(Layout.FirstSphereCluster + k, SphereHitGroups[SphereClusters[k].Key], HG_SphereShadow);
+
+    const auto& CubeClusters = m_CubeClusters.GetClusters();
+    for (size_t k = 0; k < CubeClusters.size(); ++k)
+        BindInstanceHitGroups(Layout.FirstCubeCluster + k, GetCubeHitGroup(CubeClusters[k].Key), nullptr);
+
+    // Update SBT with the shader groups we bound
+    m_pImmediateContext->UpdateSBT(pSBT);
+
+    return pSBT;
+}
+
+void Tutorial21_RayTracing::OpenSceneCache()
+{
+    if (m_SceneCachePath.empty())
+        return;
+
+    // The cache is valid as long as all scene inputs are the same.
+    std::string Key = "v" + std::to_string(SceneCacheContentVersion) + ';';
+    for (int Param : {a, b, c, d})
+        Key += std::to_string(Param) + ',';
+    for (int tex = 0; tex < NumTextures; ++tex)
+        AppendFileStamp(Key, GetCubeTextureFileName(tex));
+    AppendFileStamp(Key, GroundTextureFileName);
+    if (!m_MeshPath.empty())
+        AppendFileStamp(Key, m_MeshPath);
+    m_SceneSourceHash = ComputeHash64(Key.data(), Key.size());
+
+    std::error_code ec;
+    if (std::filesystem::exists(m_SceneCachePath, ec))
+    {
+        m_pSceneCacheReader = std::make_unique<SceneCacheReader>();
+        if (!m_pSceneCacheReader->Open(m_SceneCachePath.c_str(), m_SceneSourceHash))
+            m_pSceneCacheReader.reset();
+    }
+
+    if (!m_pSceneCacheReader)
+        m_pSceneCacheWriter = std::make_unique<SceneCacheWriter>();
+}
+
+void Tutorial21_RayTracing::SaveSceneCache()
+{
+    if (m_pSceneCacheWriter && m_pSceneCacheWriter->Write(m_SceneCachePath.c_str(), m_SceneSourceHash))
+        LOG_INFO_MESSAGE("Scene cache written to '", m_SceneCachePath, "'");
+
+    // All cached data has been copied to GPU resources, so the file can be unmapped.
+    m_pSceneCacheWriter.reset();
+    m_pSceneCacheReader.reset();
+}
+
+RefCntAutoPtr<ITexture> Tutorial21_RayTracing::LoadCachedTexture(Uint32 ChunkId, const char* Name)
+{
+    RefCntAutoPtr<ITexture> pTexture;
+    if (!m_pSceneCacheReader)
+        return pTexture;
+
+    size_t      Size  = 0;
+    const void* pData = m_pSceneCacheReader->GetChunk(ChunkId, Size);
+    if (pData == nullptr || !CreateTextureFromBlob(m_pDevice, Name, pData, Size, &pTexture))
+        LOG_WARNING_MESSAGE("Texture '", Name, "' is missing in the scene cache");
+    return pTexture;
+}
+
+bool Tutorial21_RayTracing::LoadSceneMesh(Uint32 ChunkId, MeshData& Mesh, const std::function<bool(MeshData&)>& LoadSource)
+{
+    if (m_pSceneCacheReader)
+    {
+        // The mesh references the mapped cache, which stays open until SaveSceneCache().
+        size_t      Size  = 0;
+        const void* pData = m_pSceneCacheReader->GetChunk(ChunkId, Size);
+        if (pData != nullptr && ParseBinaryMesh(pData, Size, Mesh))
+            return true;
+
+        LOG_WARNING_MESSAGE("Mesh ", ChunkId, " is missing in the scene cache");
+    }
+
+    if (!LoadSource(Mesh))
+        return false;
+
+    if (m_pSceneCacheWriter)
+        m_pSceneCacheWriter->AddChunk(ChunkId, SerializeBinaryMesh(Mesh));
+    return true;
+}
+
+void Tutorial21_RayTracing::CompactStaticBLASes()
+{
+    // BLASes are static, so they are compacted once after the initial build.
+    std::vector<RefCntAutoPtr<IBottomLevelAS>*> BLASes = {&m_pCubeBLAS, &m_pSmallCubeBLAS, &m_pProceduralBLAS};
+    for (auto& pBLAS : m_SphereClusterBLASes)
+        BLASes.push_back(&pBLAS);
+    for (auto& pBLAS : m_CubeClusterBLASes)
+        BLASes.push_back(&pBLAS);
+    if (m_pLoadedMeshBLAS)
+        BLASes.push_back(&m_pLoadedMeshBLAS);
+
+    std::vector<Uint64> CompactedSizes(BLASes.size());
+    CompactBLASes(m_pDevice, m_pBuildContext, m_ASContextMask, BLASes.data(), static_cast<Uint32>(BLASes.size()), CompactedSizes.data());
+
+    m_ASMemoryReport.RemoveEntries(ASMemoryReport::CATEGORY_BLAS);
+    for (size_t i = 0; i < BLASes.size(); ++i)
+        m_ASMemoryReport.AddEntry((*BLASes[i])->GetDesc().Name, ASMemoryReport::CATEGORY_BLAS, CompactedSizes[i]);
+}
+
+void Tutorial21_RayTracing::UpdateASMemoryReport()
+{
+    // BLAS entries are recorded by CompactStaticBLASes(); everything else is measured here.
+    m_ASMemoryReport.RemoveEntries(ASMemoryReport::CATEGORY_TLAS);
+    m_ASMemoryReport.RemoveEntries(ASMemoryReport::CATEGORY_INSTANCE_BUFFER);
+    m_ASMemoryReport.RemoveEntries(ASMemoryReport::CATEGORY_SCRATCH_BUFFER);
+    m_ASMemoryReport.RemoveEntries(ASMemoryReport::CATEGORY_SBT);
+
+    for (const auto& Slot : m_TLASSlots)
+    {
+        if (!Slot.pTLAS)
+            continue;
+
+        // The engine does not expose the size of an acceleration structure that was not compacted.
+        m_ASMemoryReport.AddUnknownEntry(Slot.pTLAS->GetDesc().Name, ASMemoryReport::CATEGORY_TLAS);
+        m_ASMemoryReport.AddEntry(Slot.pInstanceBuffer->GetDesc().Name, ASMemoryReport::CATEGORY_INSTANCE_BUFFER, Slot.pInstanceBuffer->GetDesc().Size);
+    }
+
+    for (Uint32 b = 0; b < m_pScratchAllocator->GetNumBuffers(); ++b)
+    {
+        const auto& ScratchDesc = m_pScratchAllocator->GetBuffer(b)->GetDesc();
+        m_ASMemoryReport.AddEntry(ScratchDesc.Name, ASMemoryReport::CATEGORY_SCRATCH_BUFFER, ScratchDesc.Size);
+    }
+
+    if (m_pSBT)
+    {
+        // One ray generation shader, one miss shader per ray type and the hit groups of all instances.
+        const auto& RTProps    = m_pDevice->GetAdapterInfo().RayTracing;
+        const auto  NumRecords = m_InstanceCuller.GetNumInstances() * HIT_GROUP_STRIDE;
+        const auto  SBTSize    = ASMemoryReport::ComputeSBTSize(RTProps.ShaderGroupHandleSize, RTProps.ShaderGroupBaseAlignment, 1, HIT_GROUP_STRIDE, NumRecords, 0);
+        m_ASMemoryReport.AddEntry(m_pSBT->GetDesc().Name, ASMemoryReport::CATEGORY_SBT, SBTSize);
+    }
+}
+
+void Tutorial21_RayTracing::UpdateUI()
+{
+    ImGui::SetNextWindowPos(ImVec2(10, 10), ImGuiCond_FirstUseEver);
+    if (ImGui::Begin("Ray Tracing Demo", nullptr, ImGuiWindowFlags_AlwaysAutoResize))
+    {
+        ImGui::Text("Scene Controls");
+        ImGui::Text("Use WASD keys to move camera");
+
+        // Essential controls only
+        ImGui::Separator();
+        ImGui::Text("Scene Objects");
+
+        // Sphere control
+        ImGui::SliderInt("Active Spheres", &m_NumActiveSmallSpheres, 0, m_MaxSmallSpheres);
+
+        // Cube control
+        ImGui::SliderInt("Active Cubes", &m_NumActiveSmallCubes, 0, m_MaxSmallCubes);
+
+        ImGui::Checkbox("Distance culling", &m_DistanceCulling);
+        if (m_DistanceCulling)
+            ImGui::SliderFloat("Cull distance", &m_CullDistance, 5.f, 100.f);
+        ImGui::Checkbox("Instance LOD", &m_EnableInstanceLOD);
+        if (m_EnableInstanceLOD)
+            ImGui::SliderFloat("Proxy distance", &m_ProxyDistance, 5.f, 100.f);
+        ImGui::Text("Cluster proxies: %u of %u", m_SphereClusters.GetNumProxies() + m_CubeClusters.GetNumProxies(),
+                    static_cast<Uint32>(m_SphereClusters.GetClusters().size() + m_CubeClusters.GetClusters().size()));
+        ImGui::Text("TLAS instances: %u of %u", m_InstanceCuller.GetNumVisible(), m_InstanceCuller.GetNumInstances());
+        ImGui::Text("Scene edits: %u, coalesced: %u", m_SceneEdits.GetStats().NumEdits, m_SceneEdits.GetStats().NumCoalesced);
+
+        if (ImGui::TreeNode("Instance groups"))
+        {
+            if (ImGui::BeginCombo("Group", m_InstanceGroups.GetGroupName(m_SelectedInstanceGroup)))
+            {
+                for (Uint32 g = InstanceHierarchy::RootGroup + 1; g < m_InstanceGroups.GetNumGroups(); ++g)
+                {
+                    if (ImGui::Selectable(m_InstanceGroups.GetGroupName(g), g == m_SelectedInstanceGroup))
+                        m_SelectedInstanceGroup = g;
+                }
+                ImGui::EndCombo();
+            }
+
+            // Groups are moved with scene edits, like edits from other threads.
+            const auto& Transform = m_InstanceGroups.GetGroupTransform(m_SelectedInstanceGroup);
+            float3      Position{Transform.data[0][3], Transform.data[1][3], Transform.data[2][3]};
+            if (ImGui::DragFloat3("Group position", &Position.x, 0.05f))
+            {
+                SceneEdit Edit;
+                Edit.Type      = SCENE_EDIT_MOVE_GROUP;
+                Edit.Target    = m_SelectedInstanceGroup;
+                Edit.Transform = Transform;
+                Edit.Transform.SetTranslation(Position.x, Position.y, Position.z);
+
+                SceneEditQueue::Writer Writer{m_SceneEdits};
+                Writer.Push(Edit);
+            }
+            ImGui::TreePop();
+        }
+
+        // Pick the instance under the cursor with the CPU copy of the scene.
+        if (const auto pQuery = GetSceneQuery())
+        {
+            const auto&  Mouse  = m_InputController.GetMouseState();
+            const auto&  SCDesc = m_pSwapChain->GetDesc();
+            const float4 NDC{Mouse.PosX / SCDesc.Width * 2.f - 1.f, 1.f - Mouse.PosY / SCDesc.Height * 2.f, 1.f, 1.f};
+            const float4 Far    = NDC * (m_Camera.GetViewMatrix() * m_Camera.GetProjMatrix()).Inverse();
+
+            SceneQuery::Ray Ray;
+            Ray.Origin    = m_Camera.GetPos();
+            Ray.Direction = normalize(float3{Far.x, Far.y, Far.z} / Far.w - Ray.Origin);
+
+            const auto Hit = pQuery->TraceClosest(Ray);
+            if (Hit.IsHit())
+                ImGui::Text("Under cursor: instance %u, id %u, %.2f away", Hit.InstanceIndex, Hit.CustomId, Hit.Distance);
+            else
+                ImGui::TextDisabled("Under cursor: nothing");
+        }
+        if (ImGui::Button("Query benchmark"))
+            RunSceneQueryBenchmark(m_QueryBenchmarkRays > 0 ? m_QueryBenchmarkRays : 1u << 18);
+
+        // Render quality
+        ImGui::Separator();
+        ImGui::Text("Render Quality");
+        ImGui::SliderInt("Recursion Depth", &m_Constants.MaxRecursion, 1, m_MaxRecursionDepth);
+        ImGui::SliderInt("Shadow Quality", &m_Constants.ShadowPCF, 0, 4);
+        ImGui::SliderInt("Extra lights", &m_NumExtraLights, 0, MaxExtraLights);
+        ImGui::SliderInt("Light samples", &m_Constants.LightSamples, 1, 8);
+
+        bool EnableDispersion = m_Constants.GlassEnableDispersion != 0;
+        if (ImGui::Checkbox("Glass dispersion", &EnableDispersion))
+            m_Constants.GlassEnableDispersion = EnableDispersion ? 1 : 0;
+        if (EnableDispersion && ImGui::SliderFloat("Dispersion", &m_DispersionFactor, 0.0f, 0.5f))
+            m_Constants.GlassIndexOfRefraction.y = m_Constants.GlassIndexOfRefraction.x + m_DispersionFactor;
+
+        // With the denoiser, sample patterns are jittered, so one shadow or reflection sample is enough.
+        if (ImGui::Checkbox("Denoiser", &m_EnableDenoiser))
+            m_Constants.JitterSamplePatterns = m_EnableDenoiser ? 1 : 0;
+        if (m_EnableDenoiser)
+        {
+            int NumPasses = static_cast<int>(m_DenoiseSettings.NumPasses);
+            if (ImGui::SliderInt("Denoise passes", &NumPasses, 1, 5))
+                m_DenoiseSettings.NumPasses = static_cast<Uint32>(NumPasses);
+            ImGui::SliderFloat("Depth sigma", &m_DenoiseSettings.DepthSigma, 0.001f, 0.1f, "%.3f");
+            ImGui::SliderFloat("Normal power", &m_DenoiseSettings.NormalPower, 1.f, 128.f);
+            ImGui::SliderFloat("Luminance sigma", &m_DenoiseSettings.LuminanceSigma, 0.5f, 16.f);
+        }
+
+        ImGui::Checkbox("Variable-rate tracing", &m_EnableVariableRate);
+        if (m_EnableVariableRate)
+        {
+            int MaxRate = static_cast<int>(m_VariableRateSettings.MaxRate);
+            if (ImGui::Combo("Lowest rate", &MaxRate, "Full\0Half\0Quarter\0\0"))
+                m_VariableRateSettings.MaxRate = static_cast<Uint32>(MaxRate);
+            ImGui::SliderFloat("Tile depth ratio", &m_VariableRateSettings.MaxDepthRatio, 0.005f, 0.5f, "%.3f");
+            ImGui::SliderFloat("Tile normal cosine", &m_VariableRateSettings.MinNormalCosine, 0.9f, 1.f, "%.3f");
+        }
+
+        ImGui::Combo("Texture LOD", &m_Constants.TextureLODMode, "Level 0\0Ray cones\0Visualize\0\0");
+        ImGui::Checkbox("Specialized pipelines", &m_SpecializePipelines);
+        ImGui::Text("Pipelines: %u, cache hits: %u, misses: %u", static_cast<Uint32>(m_RayTracingPipelines.size()),
+                    m_pPipelineStateCache->GetNumHits(), m_pPipelineStateCache->GetNumMisses());
+
+        ImGui::Separator();
+        ImGui::Checkbox("Frame readback", &m_EnableReadback);
+        if (m_EnableReadback)
+        {
+            int Format = static_cast<int>(m_ReadbackFormat);
+            if (ImGui::Combo("Readback format", &Format, "Native\0RGBA8 sRGB\0RGB10A2\0YCbCr 4:2:0\0\0"))
+                m_ReadbackFormat = static_cast<READBACK_FORMAT>(Format);
+        }
+        const auto& ReadbackStats = m_pFrameReadback->GetStatistics();
+        if (ReadbackStats.NumFrames > 0)
+        {
+            ImGui::Text("Readback: %u frames, %.1f MB, %u dropped", static_cast<Uint32>(ReadbackStats.NumFrames), ReadbackStats.BytesRead / (1024.0 * 1024.0),
+                        static_cast<Uint32>(ReadbackStats.NumDropped));
+            ImGui::Text("  %.2f bytes/pixel, map %.2f ms/frame, convert %.2f ms", m_ReadbackBytesPerPixel,
+                        ReadbackStats.MapMs / static_cast<double>(ReadbackStats.NumFrames), m_ReadbackConvertMs);
+        }
+
+        ImGui::Separator();
+        ImGui::Text("AS builds: %s", m_AsyncASBuild ? "async compute queue" : "immediate context");
+
+        const auto ScratchStats = m_pScratchAllocator->GetStatistics();
+        ImGui::Text("AS scratch: %.1f KB in %u buffer(s)", ScratchStats.CapacityBytes / 1024.0, ScratchStats.NumBlocks);
+        ImGui::Text("  peak used %.1f KB, peak wasted %.1f KB", ScratchStats.PeakUsedBytes / 1024.0, ScratchStats.PeakWastedBytes / 1024.0);
+
+        if (ImGui::TreeNode("Ray tracing memory"))
+        {
+            UpdateASMemoryReport();
+            for (Uint32 c = 0; c < ASMemoryReport::CATEGORY_COUNT; ++c)
+            {
+                const auto Category = static_cast<ASMemoryReport::CATEGORY>(c);
+                ImGui::Text("%s: %.1f KB%s", ASMemoryReport::GetCategoryName(Category), m_ASMemoryReport.GetCategorySize(Category) / 1024.0,
+                            m_ASMemoryReport.GetNumUnknownEntries(Category) > 0 ? " (not exposed)" : "");
+            }
+            ImGui::Text("Total: %.1f KB", m_ASMemoryReport.GetTotalSize() / 1024.0);
+            ImGui::TreePop();
+        }
+    }
+    ImGui::End();
+}
+
+} // namespace Diligent
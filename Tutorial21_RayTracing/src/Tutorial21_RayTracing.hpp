@@ -1,128 +1,400 @@
-/*
- *  Copyright 2019-2022 Diligent Graphics LLC
- *  Copyright 2015-2019 Egor Yusov
- *
- *  Licensed under the Apache License, Version 2.0 (the "License");
- *  you may not use this file except in compliance with the License.
- *  You may obtain a copy of the License at
- *
- *      http://www.apache.org/licenses/LICENSE-2.0
- *
- *  Unless required by applicable law or agreed to in writing, software
- *  distributed under the License is distributed on an "AS IS" BASIS,
- *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
- *  See the License for the specific language governing permissions and
- *  limitations under the License.
- *
- *  In no event and under no legal theory, whether in tort (including negligence),
- *  contract, or otherwise, unless required by applicable law (such as deliberate
- *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
- *  liable for any damages, including any direct, indirect, special, incidental,
- *  or consequential damages of any character arising as a result of this License or
- *  out of the use or inability to use the software (including but not limited to damages
- *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
- *  all other commercial damages or losses), even if such Contributor has been advised
- *  of the possibility of such damages.
- */
-
-#pragma once
-
-#include "SampleBase.hpp"
-#include "BasicMath.hpp"
-#include "FirstPersonCamera.hpp"
-#include <random>
-namespace Diligent
-{
-
-namespace HLSL
-{
-#include "../assets/structures.fxh"
-}
-
-class Tutorial21_RayTracing final : public SampleBase
-{
-public:
-    virtual void ModifyEngineInitInfo(const ModifyEngineInitInfoAttribs& Attribs) override final;
-    virtual void Initialize(const SampleInitInfo& InitInfo) override final;
-
-    virtual void Render() override final;
-    virtual void Update(double CurrTime, double ElapsedTime) override final;
-
-    virtual const Char* GetSampleName() const override final { return "Tutorial21: Ray tracing"; }
-
-    virtual void WindowResize(Uint32 Width, Uint32 Height) override final;
-
-private:
-    void CreateRayTracingPSO();
-    void CreateGraphicsPSO();
-    void CreateCubeBLAS(float cubeSize, RefCntAutoPtr<IBottomLevelAS>& OutBLAS);
-    void CreateProceduralBLAS();
-    void UpdateTLAS();
-    void CreateSBT();
-    void LoadTextures();
-    void UpdateUI();
-
-
-    static constexpr int NumTextures = 4;
-    static constexpr int NumCubes    = 4;
-
-    Int32                  m_NumActiveSmallSpheres = 0; 
-    Int32                  m_MaxSmallSpheres       = 0;
-    Int32                  m_MaxSmallCubes             = 0;
-    Int32                  m_NumActiveSmallCubes        = 0;
-
-    RefCntAutoPtr<IBuffer> m_CubeAttribsCB;
-    RefCntAutoPtr<IBuffer> m_BoxAttribsCB;
-    RefCntAutoPtr<IBuffer> m_ConstantsCB;
-
-    RefCntAutoPtr<IPipelineState>         m_pRayTracingPSO;
-    RefCntAutoPtr<IShaderResourceBinding> m_pRayTracingSRB;
-
-    RefCntAutoPtr<IPipelineState>         m_pImageBlitPSO;
-    RefCntAutoPtr<IShaderResourceBinding> m_pImageBlitSRB;
-
-    RefCntAutoPtr<IBottomLevelAS>      m_pCubeBLAS;
-    RefCntAutoPtr<IBottomLevelAS>      m_pSmallCubeBLAS; // cubo pequeo
-    RefCntAutoPtr<IBottomLevelAS>      m_pProceduralBLAS;
-    RefCntAutoPtr<ITopLevelAS>         m_pTLAS;
-    RefCntAutoPtr<IBuffer>             m_InstanceBuffer;
-    RefCntAutoPtr<IBuffer>             m_ScratchBuffer;
-    RefCntAutoPtr<IShaderBindingTable> m_pSBT;
-
-
-    // dentro de tu clase, usando namespace Diligent:
-    std::vector<InstanceMatrix> m_SmallSphereTransforms;
-    std::vector<InstanceMatrix> m_SmallCubeTransforms;
-    std::vector<Int32>          m_cubesCustomIds;
-
-
-    std::vector<std::string>           m_SphereInstanceNames;
-    std::vector<int>                   m_SphereInstanceMatIds;
-    std::vector<std::string>           m_CubeInstanceNames;
-    std::vector<int>                   m_CubeInstanceMatIds;
-
-    std::mt19937                          rng{std::random_device{}()};
-    std::uniform_real_distribution<float> u01{0.0f, 1.0f};
-
-
-
-    Uint32          m_MaxRecursionDepth     = 8;
-    const double    m_MaxAnimationTimeDelta = 1.0 / 60.0;
-    float           m_AnimationTime         = 0.0f;
-    HLSL::Constants m_Constants             = {};
-    bool            m_EnableCubes[NumCubes] = {true, true, true, true};
-    bool            m_Animate               = true;
-    float           m_DispersionFactor      = 0.1f;
-    float3            m_DiffuseAlbedo         = float3{0.8f, 0.8f, 0.8f};
-    int             a                       = 6;
-    int             b                       = 6;
-    int 		   c                       = 6;
-    int             d                       = 6;
-
-    FirstPersonCamera m_Camera;
-
-    TEXTURE_FORMAT          m_ColorBufferFormat = TEX_FORMAT_RGBA8_UNORM;
-    RefCntAutoPtr<ITexture> m_pColorRT;
-};
-
-} // namespace Diligent
+/*
+ *  Copyright 2019-2022 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include "SampleBase.hpp"
+#include "BasicMath.hpp"
+#include "FirstPersonCamera.hpp"
+#include "TextureLoader.h"
+#include "ASBuildScheduler.hpp"
+#include "ScratchBufferAllocator.hpp"
+#include "ASMemoryReport.hpp"
+#include "MeshLoader.hpp"
+#include "SceneCache.hpp"
+#include "PipelineStateCache.hpp"
+#include "InstanceCuller.hpp"
+#include "InstanceClusterLOD.hpp"
+#include "SceneQuery.hpp"
+#include "ATrousDenoiser.hpp"
+#include "ShaderStructures.hpp"
+#include "SoftwareTracer.hpp"
+#include "FrameSequenceWriter.hpp"
+#include "SceneEditQueue.hpp"
+#include "FrameReadback.hpp"
+#include "InstanceHierarchy.hpp"
+#include "VariableRateTracing.hpp"
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <unordered_map>
+namespace Diligent
+{
+
+class Tutorial21_RayTracing final : public SampleBase
+{
+public:
+    virtual void ModifyEngineInitInfo(const ModifyEngineInitInfoAttribs& Attribs) override final;
+    virtual void Initialize(const SampleInitInfo& InitInfo) override final;
+
+    virtual CommandLineStatus ProcessCommandLine(int argc, const char* const* argv) override final;
+
+    virtual void Render() override final;
+    virtual void Update(double CurrTime, double ElapsedTime) override final;
+
+    virtual const Char* GetSampleName() const override final { return "Tutorial21: Ray tracing"; }
+
+    virtual void WindowResize(Uint32 Width, Uint32 Height) override final;
+
+    /// Returns the CPU copy of the active instances for picking and occlusion queries.
+    /// The scene is immutable, so it can be queried from any thread while frames are rendered.
+    std::shared_ptr<const SceneQuery> GetSceneQuery() const
+    {
+        std::lock_guard<std::mutex> Lock{m_SceneQueryMtx};
+        return m_pSceneQuery;
+    }
+
+    /// Returns the queue of scene edits. Any thread can push edits through its own writer;
+    /// they are applied at the start of the next Render(). Instance edits target the small
+    /// spheres and cubes by their instance index, the same index as in SceneQuery hits.
+    SceneEditQueue& GetSceneEditQueue() { return m_SceneEdits; }
+
+private:
+    RefCntAutoPtr<IPipelineState> CreateRayTracingPSO(Int32 MaxRecursion, Int32 ShadowPCF, Int32 Dispersion);
+    void CreateGraphicsPSO();
+    void CreateDenoisePSOs();
+    ITexture* Denoise();
+    void RunDenoiseBenchmark();
+    void CreateVariableRatePSOs();
+    void ClassifyTiles();
+    void FillSkippedPixels();
+    void RunVariableRateBenchmark();
+    void ProcessReadbackFrame(const FrameReadback::Frame& Frame);
+    void RunReadbackBenchmark();
+    void LoadSceneMeshes();
+    void CreateMeshBLASes();
+    void CreateProceduralBLAS();
+    void InitializeConstants();
+    void GenerateLights();
+    void UpdateLights();
+    void UploadLights();
+    void ApplySceneEdits();
+    void UpdateTLAS();
+    void UpdateSceneQuery(const std::vector<TLASBuildInstanceData>& TLASInstances);
+    void RunSceneQueryBenchmark(Uint32 NumRays);
+    SoftwareTracer::Scene CreateTracerScene(Uint32 Width, Uint32 Height) const;
+    void RunDistributedBenchmark(Uint32 MaxWorkers);
+    void RunMaterialBenchmark(Uint32 NumIterations);
+    bool RenderOfflineSequence();
+    bool RunReferenceSuite() const;
+    bool HasCPUModes() const;
+    bool RunCPUModes();
+
+    // Fixed instance indices. Every instance owns HIT_GROUP_STRIDE hit groups in the SBT,
+    // whether or not it is in the TLAS, see UpdateTLAS() and CreateSBT().
+    struct InstanceLayout
+    {
+        Uint32 FirstSphere        = 0;
+        Uint32 FirstCube          = 0;
+        Uint32 LoadedMesh         = 0; // Only valid when the mesh is loaded
+        Uint32 FirstSphereCluster = 0;
+        Uint32 FirstCubeCluster   = 0;
+        Uint32 NumInstances       = 0;
+    };
+    InstanceLayout GetInstanceLayout() const;
+    RefCntAutoPtr<IShaderBindingTable> CreateSBT(IPipelineState* pPSO);
+    void SelectRayTracingPipeline();
+    void CompactStaticBLASes();
+    void UpdateASMemoryReport();
+    void LoadTextures();
+    void UpdateUI();
+
+    void InitializeScene();
+    void OpenSceneCache();
+    void SaveSceneCache();
+    void CreateInstanceLayout();
+    void GenerateInstanceLayout();
+    void BuildInstanceHierarchy();
+    void RunHierarchyBenchmark(Uint32 NumCopies);
+    void RunClusterBenchmark(Uint32 NumCopies);
+    bool LoadSceneMesh(Uint32 ChunkId, MeshData& Mesh, const std::function<bool(MeshData&)>& LoadSource);
+
+    RefCntAutoPtr<ITexture> LoadCachedTexture(Uint32 ChunkId, const char* Name);
+
+
+    static constexpr int NumTextures = 4;
+    static constexpr int NumCubes    = 4;
+
+    Int32                  m_NumActiveSmallSpheres = 0; 
+    Int32                  m_MaxSmallSpheres       = 0;
+    Int32                  m_MaxSmallCubes             = 0;
+    Int32                  m_NumActiveSmallCubes        = 0;
+
+    // Shading attributes of all triangle meshes, see MeshAttribsPool.
+    RefCntAutoPtr<IBuffer> m_MeshAttribsBuffer;
+    RefCntAutoPtr<IBuffer> m_MeshVerticesBuffer;
+    RefCntAutoPtr<IBuffer> m_MeshIndicesBuffer;
+    RefCntAutoPtr<IBuffer> m_MeshTriangleLODsBuffer;
+    RefCntAutoPtr<IBuffer> m_BoxAttribsCB;
+    RefCntAutoPtr<IBuffer> m_ConstantsCB;
+    RefCntAutoPtr<IBuffer> m_FrameCB;
+
+    // Key lights followed by the extra lights, and the light hierarchy, see LightBVH.
+    static constexpr Uint32 MaxExtraLights = 4096;
+    RefCntAutoPtr<IBuffer>  m_LightsBuffer;
+    RefCntAutoPtr<IBuffer>  m_LightBVHBuffer;
+    Int32                   m_NumExtraLights      = 256;
+    Int32                   m_UploadedExtraLights = -1;
+
+    // Ray tracing pipeline and SBT selected for the current settings, see SelectRayTracingPipeline().
+    RefCntAutoPtr<IPipelineState>         m_pRayTracingPSO;
+    RefCntAutoPtr<IShaderResourceBinding> m_pRayTracingSRB;
+
+    // Pipeline variants specialized for MaxRecursion, ShadowPCF and GlassEnableDispersion, see GetRayTracingPipelineKey().
+    // Variants use the same resources, so the SRB of the generic pipeline is shared by all of them.
+    struct RayTracingPipeline
+    {
+        RefCntAutoPtr<IPipelineState>      pPSO;
+        RefCntAutoPtr<IShaderBindingTable> pSBT;
+    };
+    std::unordered_map<Uint64, RayTracingPipeline> m_RayTracingPipelines;
+    bool                                           m_SpecializePipelines = true;
+
+    // Shader and pipeline cache given with --pso-cache on the command line. An empty path disables the cache.
+    std::string                         m_PipelineCachePath = "Tutorial21_RayTracing.psocache";
+    std::unique_ptr<PipelineStateCache> m_pPipelineStateCache;
+
+    RefCntAutoPtr<IPipelineState>         m_pImageBlitPSO;
+    RefCntAutoPtr<IShaderResourceBinding> m_pImageBlitSRB;
+
+    // Edge-aware a-trous denoiser between ray tracing and the blit, see Denoise.csh.
+    // It is guided by the G-buffer of the primary hits written by the ray tracing shaders.
+    RefCntAutoPtr<IPipelineState>          m_pDenoiseVariancePSO;
+    RefCntAutoPtr<IShaderResourceBinding>  m_pDenoiseVarianceSRB;
+    RefCntAutoPtr<IPipelineState>          m_pDenoiseFilterPSO;
+    RefCntAutoPtr<IShaderResourceBinding>  m_pDenoiseFilterSRB;
+    RefCntAutoPtr<IBuffer>                 m_DenoiseCB;
+    RefCntAutoPtr<ITexture>                m_pGBufferDepth;
+    RefCntAutoPtr<ITexture>                m_pGBufferNormal;
+    RefCntAutoPtr<ITexture>                m_pGBufferObjectId;
+    std::array<RefCntAutoPtr<ITexture>, 2> m_pDenoiseRT; // Ping-pong targets of the filter passes
+    bool                                   m_EnableDenoiser = false;
+    ATrousDenoiser::Settings               m_DenoiseSettings;
+    Uint32                                 m_DenoiseBenchmarkWidth  = 0; // --denoise-benchmark <W>x<H>
+    Uint32                                 m_DenoiseBenchmarkHeight = 0;
+
+    // Variable-rate tracing, see VariableRate.csh. Tiles are classified from the G-buffer of the
+    // previous frame, and the pixels that are not traced are filled before the denoiser.
+    RefCntAutoPtr<IPipelineState>         m_pVRTClassifyPSO;
+    RefCntAutoPtr<IShaderResourceBinding> m_pVRTClassifySRB;
+    RefCntAutoPtr<IPipelineState>         m_pVRTFillPSO;
+    RefCntAutoPtr<IShaderResourceBinding> m_pVRTFillSRB;
+    RefCntAutoPtr<IBuffer>                m_VariableRateCB;
+    RefCntAutoPtr<ITexture>               m_pTileRates;
+    VariableRateTracing::Settings         m_VariableRateSettings;
+    bool                                  m_EnableVariableRate          = false; // --variable-rate
+    bool                                  m_VariableRateHistory         = false; // The G-buffer holds a complete frame
+    Uint32                                m_VariableRateBenchmarkWidth  = 0;     // --variable-rate-benchmark <W>x<H>
+    Uint32                                m_VariableRateBenchmarkHeight = 0;
+
+    RefCntAutoPtr<IBottomLevelAS>      m_pCubeBLAS;
+    RefCntAutoPtr<IBottomLevelAS>      m_pSmallCubeBLAS; // cubo pequeo
+    RefCntAutoPtr<IBottomLevelAS>      m_pProceduralBLAS;
+    RefCntAutoPtr<IBottomLevelAS>      m_pLoadedMeshBLAS;
+
+    // Mesh indices are encoded in instance custom ids, see INSTANCE_USER_ID_BITS.
+    static constexpr Uint32 InvalidMeshId     = ~0u;
+    Uint32                  m_CubeMeshId      = 0;
+    Uint32                  m_SmallCubeMeshId = 0;
+    Uint32                  m_LoadedMeshId    = InvalidMeshId;
+    InstanceMatrix          m_LoadedMeshTransform;
+    float3                  m_LoadedMeshBoundsMin;
+    float3                  m_LoadedMeshBoundsMax;
+
+    // Meshes loaded by LoadSceneMeshes(), which are released once the BLASes are built.
+    std::array<MeshData, 2> m_CubeMeshData; // Cube and small cube
+    MeshData                m_LoadedMeshData;
+
+    // Mesh file given with --mesh on the command line (.obj or .rtmesh).
+    std::string m_MeshPath;
+
+    // Scene cache given with --scene-cache on the command line. While the sample is initialized,
+    // either the reader holds a valid mapped cache, or the writer collects data for a new one.
+    std::string                       m_SceneCachePath;
+    std::unique_ptr<SceneCacheReader> m_pSceneCacheReader;
+    std::unique_ptr<SceneCacheWriter> m_pSceneCacheWriter;
+    Uint64                            m_SceneSourceHash = 0;
+    RefCntAutoPtr<IShaderBindingTable> m_pSBT;
+
+    // Sizes of compacted BLASes and of the other ray tracing resources.
+    ASMemoryReport m_ASMemoryReport;
+
+    // Scratch memory for all BLAS and TLAS builds.
+    std::unique_ptr<ScratchBufferAllocator> m_pScratchAllocator;
+
+    // The TLAS is double-buffered: while one slot is traced, the other one is rebuilt.
+    struct TLASSlot
+    {
+        RefCntAutoPtr<ITopLevelAS> pTLAS;
+        RefCntAutoPtr<IBuffer>     pInstanceBuffer;
+        RefCntAutoPtr<IBuffer>     pObjectIdBuffer; // Fixed index of every instance of the TLAS, see g_InstanceObjectIds
+        bool                       IsBuilt = false;
+        std::vector<Uint32>        InstanceIds; // Instances of the last build, see InstanceCuller
+    };
+    static constexpr Uint32            NumTLASSlots = 2;
+    std::array<TLASSlot, NumTLASSlots> m_TLASSlots;
+    ASBuildScheduler                   m_ASBuildScheduler{NumTLASSlots};
+
+    // Instances that are submitted to TLAS builds. Every instance has a fixed hit group
+    // index, so the SBT does not depend on the set of instances in the TLAS.
+    InstanceCuller m_InstanceCuller;
+    bool           m_DistanceCulling = false;
+    float          m_CullDistance    = 30.f;
+
+    // Distant clusters of small spheres and cubes are replaced by proxies, see InstanceClusterLOD.
+    // Sphere proxies are procedural BLASes with one box per sphere, cube proxies are merged meshes.
+    InstanceClusterLOD                         m_SphereClusters;
+    InstanceClusterLOD                         m_CubeClusters;
+    std::vector<RefCntAutoPtr<IBottomLevelAS>> m_SphereClusterBLASes;
+    std::vector<Uint32>                        m_SphereClusterFirstBoxes;
+    std::vector<RefCntAutoPtr<IBottomLevelAS>> m_CubeClusterBLASes;
+    std::vector<Uint32>                        m_CubeClusterMeshIds;
+    std::vector<std::string>                   m_ClusterInstanceNames;
+    bool                                       m_EnableInstanceLOD      = true;
+    float                                      m_ProxyDistance          = 25.f;
+    Uint32                                     m_ClusterBenchmarkCopies = 0; // --cluster-benchmark
+
+    // CPU copy of the scene, see GetSceneQuery(). It is replaced when the set of active instances changes.
+    std::shared_ptr<const SceneQuery>           m_pSceneQuery;
+    mutable std::mutex                          m_SceneQueryMtx; // Guards m_pSceneQuery, not the scene itself
+    std::shared_ptr<const SceneQuery::Geometry> m_pQueryCubeGeometry;
+    std::shared_ptr<const SceneQuery::Geometry> m_pQuerySmallCubeGeometry;
+    std::shared_ptr<const SceneQuery::Geometry> m_pQuerySphereGeometry;
+    std::shared_ptr<const SceneQuery::Geometry> m_pQueryLoadedMeshGeometry;
+    Int32                                       m_SceneQueryActiveSpheres = -1;
+    Int32                                       m_SceneQueryActiveCubes   = -1;
+    Uint32                                      m_QueryBenchmarkRays      = 0; // --query-benchmark
+
+    // Input of the CPU renderer, see CreateTracerScene(). Instances are taken from the instance layout.
+    std::vector<SoftwareTracer::Mesh> m_TracerMeshes;
+    std::vector<LightBVH::Light>      m_Lights;
+    Uint32                            m_DistributedBenchmarkWorkers = 0; // --distributed-benchmark
+    Uint16                            m_DistributedListenPort       = 0; // --distributed-listen [<host>:]<port> of remote workers
+    std::string                       m_DistributedListenHost;           // Loopback if empty
+    Uint32                            m_MaterialBenchmarkIterations = 0; // --material-benchmark
+
+    // Offline sequence rendered with the CPU renderer, see RenderOfflineSequence().
+    Uint32                           m_OfflineFrames    = 0; // --offline-frames
+    Uint32                           m_OfflineWidth     = 0; // --offline-size, CPUModeImageWidth x CPUModeImageHeight by default
+    Uint32                           m_OfflineHeight    = 0;
+    std::string                      m_OfflineOutputDir = "frames";                           // --offline-output
+    FrameSequenceWriter::FILE_FORMAT m_OfflineFormat    = FrameSequenceWriter::FILE_FORMAT_PNG; // --offline-format png|pfm
+
+    // Reference image regression suite of the CPU renderer, see RunReferenceSuite(). Golden images are in assets/reference.
+    std::string m_ReferenceSuiteDir;             // --reference-suite
+    bool        m_UpdateReferenceImages = false; // --reference-update
+
+    // Readback of the final color for an encoder, see ProcessReadbackFrame().
+    std::unique_ptr<FrameReadback> m_pFrameReadback;
+    bool                           m_EnableReadback          = false;
+    READBACK_FORMAT                m_ReadbackFormat          = READBACK_FORMAT_NATIVE; // --readback native|rgba8|rgb10a2|ycbcr420
+    std::vector<Uint8>             m_EncoderInput;                                     // RGBA8, or YCbCr 4:2:0 for video encoders
+    double                         m_ReadbackConvertMs       = 0;                      // CPU conversion time of the last frame
+    float                          m_ReadbackBytesPerPixel   = 0;
+    Uint32                         m_ReadbackBenchmarkWidth  = 0; // --readback-benchmark <W>x<H>
+    Uint32                         m_ReadbackBenchmarkHeight = 0;
+
+    // Acceleration structures are recorded into this context. When the adapter exposes
+    // a compute queue, it is a separate immediate context and builds overlap tracing;
+    // otherwise it is the main immediate context.
+    RefCntAutoPtr<IDeviceContext>           m_pBuildContext;
+    RefCntAutoPtr<IFence>                   m_pBuildFence;
+    RefCntAutoPtr<IFence>                   m_pTraceFence;
+    bool                                    m_AsyncASBuild  = false;
+    Uint64                                  m_ASContextMask = 1;
+    std::vector<ImmediateContextCreateInfo> m_ContextCI;
+
+
+    // dentro de tu clase, usando namespace Diligent:
+    std::vector<InstanceMatrix> m_SmallSphereTransforms;
+    std::vector<InstanceMatrix> m_SmallCubeTransforms;
+    std::vector<Int32>          m_cubesCustomIds;
+
+    // Edits from other threads and the per-instance state they change, see ApplySceneEdits().
+    SceneEditQueue     m_SceneEdits;
+    std::vector<Uint8> m_SphereEditFlags;
+    std::vector<Uint8> m_CubeEditFlags;
+
+    // Groups of the small spheres and cubes, see BuildInstanceHierarchy(). The world transforms
+    // of the instances are flattened into the transform arrays above.
+    InstanceHierarchy m_InstanceGroups;
+    Uint32            m_SceneGroup               = InstanceHierarchy::RootGroup; // The spiral and the pyramid
+    Uint32            m_SelectedInstanceGroup    = InstanceHierarchy::RootGroup;
+    Uint32            m_HierarchyBenchmarkCopies = 0; // --hierarchy-benchmark
+
+
+    std::vector<std::string>           m_SphereInstanceNames;
+    std::vector<int>                   m_SphereInstanceMatIds;
+    std::vector<std::string>           m_CubeInstanceNames;
+    std::vector<int>                   m_CubeInstanceMatIds;
+
+    std::mt19937                          rng{std::random_device{}()};
+    std::uniform_real_distribution<float> u01{0.0f, 1.0f};
+
+
+
+    Uint32          m_MaxRecursionDepth     = 8;
+    const double    m_MaxAnimationTimeDelta = 1.0 / 60.0;
+    float           m_AnimationTime         = 0.0f;
+    HLSL::Constants m_Constants             = {};
+    HLSL::Constants m_UploadedConstants     = {}; // Contents of m_ConstantsCB
+    bool            m_EnableCubes[NumCubes] = {true, true, true, true};
+    bool            m_Animate               = true;
+    float           m_DispersionFactor      = 0.1f;
+    float3            m_DiffuseAlbedo         = float3{0.8f, 0.8f, 0.8f};
+    int             a                       = 6;
+    int             b                       = 6;
+    int 		   c                       = 6;
+    int             d                       = 6;
+
+    FirstPersonCamera m_Camera;
+
+    TEXTURE_FORMAT          m_ColorBufferFormat = TEX_FORMAT_RGBA8_UNORM;
+    RefCntAutoPtr<ITexture> m_pColorRT;
+    RefCntAutoPtr<ITexture> m_pAccumRT;
+
+    // Frame accumulation for paths that sample one wavelength or a subset of lights per frame.
+    Uint32   m_FrameIndex     = 0;
+    Uint32   m_NumAccumFrames = 0;
+    float4x4 m_LastViewProj;
+};
+
+} // namespace Diligent
@@ -0,0 +1,420 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "VariableRateTracing.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "ParallelFor.hpp"
+#include "Errors.hpp"
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+// See QuarterRateOffsets in VariableRate.fxh.
+constexpr Uint32 QuarterRateOffsets[4][2] = {{0, 0}, {1, 1}, {1, 0}, {0, 1}};
+
+// G-buffer of a synthetic view for RunSelfCheck(): sky above a flat ground, a curved diffuse
+// object and a specular box, so that tiles of every rate and object edges are present.
+struct SelfCheckGBuffer
+{
+    std::vector<float>  Depth;
+    std::vector<float4> Normals;
+    std::vector<Uint32> ObjectIds;
+
+    SelfCheckGBuffer(Uint32 Width, Uint32 Height)
+    {
+        const size_t NumPixels = size_t{Width} * Height;
+        Depth.resize(NumPixels);
+        Normals.resize(NumPixels);
+        ObjectIds.resize(NumPixels);
+
+        const float CenterX = Width * 0.5f;
+        const float CenterY = Height * 0.6f;
+        const float Radius  = std::max(Height * 0.2f, 1.f);
+        for (Uint32 y = 0; y < Height; ++y)
+        {
+            for (Uint32 x = 0; x < Width; ++x)
+            {
+                const size_t i  = size_t{y} * Width + x;
+                const float  dx = (x - CenterX) / Radius;
+                const float  dy = (y - CenterY) / Radius;
+                if (y < Height / 3)
+                {
+                    Depth[i]     = 1000.f;
+                    Normals[i]   = float4{dx, -1.f, 0.5f, static_cast<float>(GBUFFER_SHADING_SKY)};
+                    ObjectIds[i] = GBUFFER_MISS_OBJECT_ID;
+                }
+                else if (x >= Width / 8 && x < Width / 4 && y >= Height / 2 && y < Height * 3 / 4)
+                {
+                    Depth[i]     = 20.f;
+                    Normals[i]   = float4{0.f, 0.f, -1.f, static_cast<float>(GBUFFER_SHADING_SPECULAR)};
+                    ObjectIds[i] = 3;
+                }
+                else if (dx * dx + dy * dy < 1.f)
+                {
+                    const float dz = std::sqrt(1.f - dx * dx - dy * dy);
+                    Depth[i]       = 15.f - dz;
+                    Normals[i]     = float4{dx, -dy, -dz, static_cast<float>(GBUFFER_SHADING_DIFFUSE)};
+                    ObjectIds[i]   = 2;
+                }
+                else
+                {
+                    Depth[i]     = 10.f + y * 0.01f;
+                    Normals[i]   = float4{0.f, 1.f, 0.f, static_cast<float>(GBUFFER_SHADING_DIFFUSE)};
+                    ObjectIds[i] = 1;
+                }
+            }
+        }
+    }
+};
+
+} // namespace
+
+bool VariableRateTracing::IsPixelTracedAtRate(Uint32 x, Uint32 y, Uint32 Rate, Uint32 FrameIndex)
+{
+    if (Rate == VRT_RATE_HALF)
+        return ((x + y + FrameIndex) & 1u) == 0;
+    if (Rate == VRT_RATE_QUARTER)
+        return (x & 1u) == QuarterRateOffsets[FrameIndex & 3u][0] && (y & 1u) == QuarterRateOffsets[FrameIndex & 3u][1];
+    return true;
+}
+
+Uint8 VariableRateTracing::ClassifyTile(Uint32 TileX, Uint32 TileY, const float* pDepth, const float4* pNormals, const Uint32* pObjectIds, const Settings& Attribs) const
+{
+    // See ClassifyMain() in VariableRate.csh.
+    const Uint32 X0 = TileX * VRT_TILE_SIZE;
+    const Uint32 Y0 = TileY * VRT_TILE_SIZE;
+    if (X0 + VRT_TILE_SIZE > m_Width || Y0 + VRT_TILE_SIZE > m_Height)
+        return VRT_RATE_FULL;
+
+    const size_t Origin    = size_t{Y0} * m_Width + X0;
+    const Uint32 ObjectId  = pObjectIds[Origin];
+    const float4 Normal    = pNormals[Origin];
+    float        MinDepth  = pDepth[Origin];
+    float        MaxDepth  = MinDepth;
+    float        MinCosine = 1.f;
+    Uint32       Shading   = GBUFFER_SHADING_SKY;
+    for (Uint32 y = 0; y < VRT_TILE_SIZE; ++y)
+    {
+        const size_t Row = Origin + size_t{y} * m_Width;
+        for (Uint32 x = 0; x < VRT_TILE_SIZE; ++x)
+        {
+            if (pObjectIds[Row + x] != ObjectId)
+                return VRT_RATE_FULL;
+
+            const float4& N = pNormals[Row + x];
+            MinDepth        = std::min(MinDepth, pDepth[Row + x]);
+            MaxDepth        = std::max(MaxDepth, pDepth[Row + x]);
+            MinCosine       = std::min(MinCosine, N.x * Normal.x + N.y * Normal.y + N.z * Normal.z);
+            Shading         = std::max(Shading, static_cast<Uint32>(N.w + 0.5f));
+        }
+    }
+
+    Uint32 Rate = VRT_RATE_HALF;
+    if (Shading == GBUFFER_SHADING_SPECULAR || MaxDepth - MinDepth > Attribs.MaxDepthRatio * MinDepth)
+        Rate = VRT_RATE_FULL;
+    else if (Shading == GBUFFER_SHADING_SKY || MinCosine >= Attribs.MinNormalCosine)
+        Rate = VRT_RATE_QUARTER;
+
+    return static_cast<Uint8>(std::min(Rate, Attribs.MaxRate));
+}
+
+void VariableRateTracing::Classify(const float*    pDepth,
+                                   const float4*   pNormals,
+                                   const Uint32*   pObjectIds,
+                                   Uint32          Width,
+                                   Uint32          Height,
+                                   const Settings& Attribs)
+{
+    m_Width     = Width;
+    m_Height    = Height;
+    m_NumTilesX = (Width + VRT_TILE_SIZE - 1) / VRT_TILE_SIZE;
+    m_NumTilesY = (Height + VRT_TILE_SIZE - 1) / VRT_TILE_SIZE;
+    m_ClassifiedRates.resize(size_t{m_NumTilesX} * m_NumTilesY);
+    m_TileRates.resize(m_ClassifiedRates.size());
+
+    ParallelFor(m_NumTilesY, [&](Uint32 TileY) {
+        for (Uint32 TileX = 0; TileX < m_NumTilesX; ++TileX)
+            m_ClassifiedRates[TileY * m_NumTilesX + TileX] = ClassifyTile(TileX, TileY, pDepth, pNormals, pObjectIds, Attribs);
+    });
+
+    // See GetTileRate() in VariableRate.fxh.
+    for (Uint32 TileY = 0; TileY < m_NumTilesY; ++TileY)
+    {
+        for (Uint32 TileX = 0; TileX < m_NumTilesX; ++TileX)
+        {
+            Uint8 Rate = m_ClassifiedRates[TileY * m_NumTilesX + TileX];
+            for (Uint32 y = TileY > 0 ? TileY - 1 : 0; y <= std::min(TileY + 1, m_NumTilesY - 1); ++y)
+            {
+                for (Uint32 x = TileX > 0 ? TileX - 1 : 0; x <= std::min(TileX + 1, m_NumTilesX - 1); ++x)
+                {
+                    if (m_ClassifiedRates[y * m_NumTilesX + x] == VRT_RATE_FULL)
+                        Rate = std::min(Rate, Uint8{VRT_RATE_HALF});
+                }
+            }
+            m_TileRates[TileY * m_NumTilesX + TileX] = Rate;
+        }
+    }
+}
+
+Uint32 VariableRateTracing::CountTracedPixels(Uint32 FrameIndex) const
+{
+    Uint32 NumTraced = 0;
+    for (Uint32 y = 0; y < m_Height; ++y)
+    {
+        for (Uint32 x = 0; x < m_Width; ++x)
+            NumTraced += IsPixelTraced(x, y, FrameIndex) ? 1 : 0;
+    }
+    return NumTraced;
+}
+
+Uint32 VariableRateTracing::CountTiles(Uint32 Rate) const
+{
+    return static_cast<Uint32>(std::count(m_TileRates.begin(), m_TileRates.end(), static_cast<Uint8>(Rate)));
+}
+
+void VariableRateTracing::Fill(float4* pColor, float* pDepth, float4* pNormals, Uint32* pObjectIds, Uint32 FrameIndex) const
+{
+    // See FillMain() in VariableRate.csh. Only pixels that were not traced are written, and only
+    // traced pixels are read, so the image is filled in place and rows of tiles in parallel.
+    ParallelFor(m_NumTilesY, [&](Uint32 TileY) {
+        const Uint32 Y0 = TileY * VRT_TILE_SIZE;
+        const Uint32 Y1 = std::min(Y0 + VRT_TILE_SIZE, m_Height);
+        for (Uint32 TileX = 0; TileX < m_NumTilesX; ++TileX)
+        {
+            const Uint32 Rate = GetTileRate(TileX, TileY);
+            if (Rate == VRT_RATE_FULL)
+                continue;
+
+            // Tiles below the full rate are never cut by the image border.
+            const Uint32 X0 = TileX * VRT_TILE_SIZE;
+            for (Uint32 y = Y0; y < Y1; ++y)
+            {
+                for (Uint32 x = X0; x < X0 + VRT_TILE_SIZE; ++x)
+                {
+                    if (IsPixelTracedAtRate(x, y, Rate, FrameIndex))
+                        continue;
+
+                    float3 ColorSum;
+                    float  DepthSum = 0;
+                    Uint32 Count    = 0;
+                    size_t Nearest  = 0;
+                    for (Uint32 qy = std::max(y, Y0 + 1) - 1; qy <= std::min(y + 1, Y1 - 1); ++qy)
+                    {
+                        for (Uint32 qx = std::max(x, X0 + 1) - 1; qx <= std::min(x + 1, X0 + VRT_TILE_SIZE - 1); ++qx)
+                        {
+                            if (!IsPixelTracedAtRate(qx, qy, Rate, FrameIndex))
+                                continue;
+
+                            // Direct neighbors come before diagonal ones.
+                            const size_t q = size_t{qy} * m_Width + qx;
+                            if (Count == 0 || qx == x || qy == y)
+                                Nearest = q;
+
+                            ColorSum += float3{pColor[q].x, pColor[q].y, pColor[q].z};
+                            DepthSum += pDepth[q];
+                            ++Count;
+                        }
+                    }
+                    VERIFY(Count > 0, "Every skipped pixel must have a traced neighbor in its tile");
+
+                    const size_t p    = size_t{y} * m_Width + x;
+                    const float3 Mean = ColorSum / static_cast<float>(Count);
+                    pColor[p]         = float4{Mean, 1.f};
+                    pDepth[p]         = DepthSum / static_cast<float>(Count);
+                    pNormals[p]       = pNormals[Nearest];
+                    pObjectIds[p]     = pObjectIds[Nearest];
+                }
+            }
+        }
+    });
+}
+
+bool VariableRateTracing::RunSelfCheck()
+{
+    // Sizes that are not multiples of the tile size have tiles cut by the image border.
+    constexpr Uint32 Sizes[][2] = {{157, 101}, {64, 48}, {61, 45}, {7, 5}, {1, 1}};
+    constexpr Uint32 NumFrames  = 4;
+
+    Uint32 NumErrors = 0;
+    for (const auto& Size : Sizes)
+    {
+        const Uint32           Width  = Size[0];
+        const Uint32           Height = Size[1];
+        const SelfCheckGBuffer GBuffer{Width, Height};
+        for (Uint32 MaxRate = VRT_RATE_FULL; MaxRate <= VRT_RATE_QUARTER; ++MaxRate)
+        {
+            const auto ReportError = [&](Uint32 x, Uint32 y, const char* Message) {
+                if (NumErrors++ < 16)
+                    LOG_ERROR_MESSAGE("Variable-rate check (", Width, "x", Height, ", max rate ", MaxRate, "): ", Message, " at (", x, ", ", y, ")");
+            };
+
+            Settings Attribs;
+            Attribs.MaxRate = MaxRate;
+            VariableRateTracing VRT;
+            VRT.Classify(GBuffer.Depth.data(), GBuffer.Normals.data(), GBuffer.ObjectIds.data(), Width, Height, Attribs);
+
+            // Tile rates follow ClassifyMain() in VariableRate.csh and GetTileRate() in VariableRate.fxh.
+            const int NumTilesX = static_cast<int>(VRT.GetNumTilesX());
+            const int NumTilesY = static_cast<int>(VRT.GetNumTilesY());
+            for (int TileY = 0; TileY < NumTilesY; ++TileY)
+            {
+                for (int TileX = 0; TileX < NumTilesX; ++TileX)
+                {
+                    const Uint32 Classified = VRT.GetClassifiedRates()[TileY * NumTilesX + TileX];
+                    const Uint32 X0         = TileX * VRT_TILE_SIZE;
+                    const Uint32 Y0         = TileY * VRT_TILE_SIZE;
+                    if (Classified > MaxRate)
+                        ReportError(TileX, TileY, "tile is classified below the maximum rate");
+                    if ((X0 + VRT_TILE_SIZE > Width || Y0 + VRT_TILE_SIZE > Height) && Classified != VRT_RATE_FULL)
+                        ReportError(TileX, TileY, "tile cut by the image border is not classified at the full rate");
+
+                    bool HasEdge = false;
+                    for (Uint32 y = Y0; y < std::min(Y0 + VRT_TILE_SIZE, Height); ++y)
+                    {
+                        for (Uint32 x = X0; x < std::min(X0 + VRT_TILE_SIZE, Width); ++x)
+                            HasEdge = HasEdge || GBuffer.ObjectIds[size_t{y} * Width + x] != GBuffer.ObjectIds[size_t{Y0} * Width + X0];
+                    }
+                    if (HasEdge && Classified != VRT_RATE_FULL)
+                        ReportError(TileX, TileY, "tile on an object edge is not classified at the full rate");
+
+                    Uint32 Rate = Classified;
+                    for (int y = -1; y <= 1; ++y)
+                    {
+                        for (int x = -1; x <= 1; ++x)
+                        {
+                            const int NeighborX = TileX + x;
+                            const int NeighborY = TileY + y;
+                            if (NeighborX >= 0 && NeighborY >= 0 && NeighborX < NumTilesX && NeighborY < NumTilesY &&
+                                VRT.GetClassifiedRates()[NeighborY * NumTilesX + NeighborX] == VRT_RATE_FULL)
+                                Rate = std::min(Rate, Uint32{VRT_RATE_HALF});
+                        }
+                    }
+                    if (VRT.GetTileRate(TileX, TileY) != Rate)
+                        ReportError(TileX, TileY, "tile rate differs from GetTileRate() in VariableRate.fxh");
+                }
+            }
+
+            // The largest view has tiles of every rate, or the checks below would not cover them.
+            if (Width == Sizes[0][0] && MaxRate == VRT_RATE_QUARTER &&
+                (VRT.CountTiles(VRT_RATE_FULL) == 0 || VRT.CountTiles(VRT_RATE_HALF) == 0 || VRT.CountTiles(VRT_RATE_QUARTER) == 0))
+                ReportError(0, 0, "the synthetic view does not have tiles of every rate");
+
+            // Every skipped pixel has a traced pixel of the same tile in its 3x3 neighborhood,
+            // as FillMain() in VariableRate.csh requires, and every pixel is traced at least once
+            // in any NumFrames consecutive frames.
+            std::vector<Uint32> NumTraced(size_t{Width} * Height);
+            for (Uint32 Frame = 0; Frame < NumFrames * 2; ++Frame)
+            {
+                for (Uint32 y = 0; y < Height; ++y)
+                {
+                    for (Uint32 x = 0; x < Width; ++x)
+                    {
+                        if (VRT.IsPixelTraced(x, y, Frame))
+                        {
+                            ++NumTraced[size_t{y} * Width + x];
+                            continue;
+                        }
+
+                        bool HasTracedNeighbor = false;
+                        for (Uint32 qy = std::max(y, 1u) - 1; qy <= std::min(y + 1, Height - 1); ++qy)
+                        {
+                            for (Uint32 qx = std::max(x, 1u) - 1; qx <= std::min(x + 1, Width - 1); ++qx)
+                            {
+                                HasTracedNeighbor = HasTracedNeighbor ||
+                                    (qx / VRT_TILE_SIZE == x / VRT_TILE_SIZE && qy / VRT_TILE_SIZE == y / VRT_TILE_SIZE && VRT.IsPixelTraced(qx, qy, Frame));
+                            }
+                        }
+                        if (!HasTracedNeighbor)
+                            ReportError(x, y, "skipped pixel has no traced neighbor in its tile");
+                    }
+                }
+
+                if (Frame + 1 >= NumFrames)
+                {
+                    for (Uint32 y = 0; y < Height; ++y)
+                    {
+                        for (Uint32 x = 0; x < Width; ++x)
+                        {
+                            if (NumTraced[size_t{y} * Width + x] == 0)
+                                ReportError(x, y, "pixel is not traced in four consecutive frames");
+                        }
+                    }
+
+                    // Slide the window of frames.
+                    const Uint32 FirstFrame = Frame + 1 - NumFrames;
+                    for (Uint32 y = 0; y < Height; ++y)
+                    {
+                        for (Uint32 x = 0; x < Width; ++x)
+                            NumTraced[size_t{y} * Width + x] -= VRT.IsPixelTraced(x, y, FirstFrame) ? 1 : 0;
+                    }
+                }
+            }
+
+            // A uniform image stays uniform after the fill, which catches skipped pixels that are not written.
+            // Fill() relies on the checks above and is not run if they failed.
+            for (Uint32 Frame = 0; Frame < NumFrames && NumErrors == 0; ++Frame)
+            {
+                std::vector<float4> Color(size_t{Width} * Height);
+                for (Uint32 y = 0; y < Height; ++y)
+                {
+                    for (Uint32 x = 0; x < Width; ++x)
+                        Color[size_t{y} * Width + x] = VRT.IsPixelTraced(x, y, Frame) ? float4{0.5f, 0.25f, 0.125f, 1.f} : float4{-1.f, -1.f, -1.f, 1.f};
+                }
+                auto Depth     = GBuffer.Depth;
+                auto Normals   = GBuffer.Normals;
+                auto ObjectIds = GBuffer.ObjectIds;
+                VRT.Fill(Color.data(), Depth.data(), Normals.data(), ObjectIds.data(), Frame);
+                for (Uint32 y = 0; y < Height; ++y)
+                {
+                    for (Uint32 x = 0; x < Width; ++x)
+                    {
+                        const auto& C = Color[size_t{y} * Width + x];
+                        if (!(std::abs(C.x - 0.5f) <= 1e-6f && std::abs(C.y - 0.25f) <= 1e-6f && std::abs(C.z - 0.125f) <= 1e-6f))
+                            ReportError(x, y, "pixel is not filled from traced pixels");
+                    }
+                }
+            }
+        }
+    }
+
+    if (NumErrors > 0)
+    {
+        LOG_ERROR_MESSAGE("Variable-rate check failed with ", NumErrors, " errors");
+        return false;
+    }
+    LOG_INFO_MESSAGE("Variable-rate check passed");
+    return true;
+}
+
+} // namespace Diligent
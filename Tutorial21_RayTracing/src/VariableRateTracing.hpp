@@ -0,0 +1,115 @@
+/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "BasicMath.hpp"
+#include "ShaderStructures.hpp"
+
+namespace Diligent
+{
+
+/// CPU implementation of the tile classification and the fill pass of VariableRate.csh.
+
+/// The image is divided into tiles of VRT_TILE_SIZE x VRT_TILE_SIZE pixels. Classify() selects
+/// the rate of every tile from the G-buffer of the previous frame: tiles on object edges, across
+/// depth discontinuities and on reflective or refractive surfaces are traced at the full rate,
+/// the sky and flat diffuse surfaces at a quarter of the rate, and other diffuse surfaces at half
+/// the rate. Tiles next to a full-rate tile are traced at least at half rate, as edges move
+/// between frames. Fill() interpolates the pixels that were not traced from the traced pixels
+/// of the same tile.
+///
+/// The traced pixels move every frame, so that accumulated frames cover all pixels. Results are
+/// the same as on the GPU, so the classification and the interpolation can be tested without one.
+class VariableRateTracing
+{
+public:
+    struct Settings
+    {
+        float  MaxDepthRatio   = 0.05f;            ///< Largest depth range of a tile below the full rate, relative to its nearest depth
+        float  MinNormalCosine = 0.995f;           ///< Smallest cosine between the normals of a tile at the quarter rate
+        Uint32 MaxRate         = VRT_RATE_QUARTER; ///< Lowest rate that tiles are traced at, see VRT_RATE_*
+    };
+
+    /// Classifies the tiles of a Width x Height image. The G-buffer holds distances to the primary
+    /// hits, world-space normals with the shading cost in w and object ids, see GBuffer.fxh.
+    void Classify(const float*    pDepth,
+                  const float4*   pNormals,
+                  const Uint32*   pObjectIds,
+                  Uint32          Width,
+                  Uint32          Height,
+                  const Settings& Attribs);
+
+    Uint32 GetNumTilesX() const { return m_NumTilesX; }
+    Uint32 GetNumTilesY() const { return m_NumTilesY; }
+
+    /// Rates as written by the classification pass, before neighbors of full-rate tiles are raised.
+    const std::vector<Uint8>& GetClassifiedRates() const { return m_ClassifiedRates; }
+
+    /// Rate the tile is traced at, see VRT_RATE_*.
+    Uint32 GetTileRate(Uint32 TileX, Uint32 TileY) const { return m_TileRates[TileY * m_NumTilesX + TileX]; }
+
+    /// Returns true if the pixel is traced at the rate of its tile in the frame.
+    bool IsPixelTraced(Uint32 x, Uint32 y, Uint32 FrameIndex) const
+    {
+        return IsPixelTracedAtRate(x, y, GetTileRate(x / VRT_TILE_SIZE, y / VRT_TILE_SIZE), FrameIndex);
+    }
+
+    static bool IsPixelTracedAtRate(Uint32 x, Uint32 y, Uint32 Rate, Uint32 FrameIndex);
+
+    /// Returns the number of pixels traced in the frame, i.e. the number of primary rays.
+    Uint32 CountTracedPixels(Uint32 FrameIndex) const;
+
+    /// Returns the number of tiles traced at the rate.
+    Uint32 CountTiles(Uint32 Rate) const;
+
+    /// Replaces the pixels that were not traced in the frame with the average of the traced pixels
+    /// of the same tile in their 3x3 neighborhood, and fills their G-buffer from the nearest one.
+    /// Colors are not accumulated, as with AccumWeight equal to 1.
+    void Fill(float4* pColor, float* pDepth, float4* pNormals, Uint32* pObjectIds, Uint32 FrameIndex) const;
+
+    /// Checks on synthetic G-buffers, including tiles cut by the image border, that tile rates follow
+    /// the rules of VariableRate.csh, that every skipped pixel has a traced neighbor in its tile, that
+    /// any four consecutive frames trace every pixel, and that Fill() writes every skipped pixel.
+    /// Logs the errors and returns false if a check fails.
+    static bool RunSelfCheck();
+
+private:
+    Uint8 ClassifyTile(Uint32 TileX, Uint32 TileY, const float* pDepth, const float4* pNormals, const Uint32* pObjectIds, const Settings& Attribs) const;
+
+    Uint32 m_Width     = 0;
+    Uint32 m_Height    = 0;
+    Uint32 m_NumTilesX = 0;
+    Uint32 m_NumTilesY = 0;
+
+    std::vector<Uint8> m_ClassifiedRates;
+    std::vector<Uint8> m_TileRates;
+};
+
+} // namespace Diligent